@@ -111,9 +111,9 @@ endif
 # define debug and nondebug c libraries and cc libraries
 #
 ifndef NODEBUG
-LIBC_MT = -lm -lc -lstdc++
+LIBC_MT = -lm -lc -lstdc++ -lpthread
 else
-LIBC_MT = -lm -lc -lstdc++
+LIBC_MT = -lm -lc -lstdc++ -lpthread
 endif
 
 #
@@ -133,6 +133,11 @@ class DLContour {
 
     int                 prim_num;
 
+// Level of detail of the contour in its surface's contour pyramid,
+// and the tile of the full resolution grid for tile contours.
+    int                 lod_level;
+    int                 tile_num;
+
     int drawContour (COntourDrawOptions *draw_options,
                      DLContourProperties *dlprop,
                      void *vptr);
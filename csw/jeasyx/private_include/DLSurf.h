@@ -23,6 +23,20 @@
 #  include "csw/utils/include/csw_.h"
 #  include "csw/utils/private_include/ply_utils.h"
 
+/*
+ * Contours are kept as a level of detail pyramid.  Level 0 is the
+ * contouring of the (possibly resampled) display grid, and each
+ * coarser level has half the contour levels and half the point
+ * density.  When zoomed in past level 0, a large grid is contoured
+ * at full resolution one tile at a time, and the tiles are cached.
+ */
+#define _DL_CONTOUR_LOD_LEVELS_     6
+#define _DL_CONTOUR_TILE_LOD_       -1
+#define _DL_CONTOUR_LOD_PIXELS_     2.0
+#define _DL_CONTOUR_TILE_SIZE_      256
+#define _DL_CONTOUR_MAX_TILES_      16
+#define _DL_CONTOUR_TILE_CACHE_     64
+
 
 
 class DLSurf {
@@ -68,6 +82,7 @@ class DLSurf {
     int              needs_contour_reclip;
     int              needs_recalc;
     int              needs_rotation;
+    int              contour_lod;
 
     double           ncdata[201000];
 
@@ -121,6 +136,14 @@ class DLSurf {
 
     int CalcFaultLines (void *dlist);
 
+    int SelectContourLod (double units_per_pixel,
+                          double x1, double y1, double x2, double y2);
+    int ContourLodChanged (double units_per_pixel,
+                           double x1, double y1, double x2, double y2);
+    int CalcTileContours (void *dlist,
+                          double x1, double y1, double x2, double y2);
+    int TileIsDrawn (int tile_num);
+
     int CalcNodes (void *dlist);
     int CalcEdges (void *dlist);
 
@@ -143,6 +166,14 @@ class DLSurf {
                        int           *ncontoursout,
                        COntourCalcOptions *calc_options);
     int              calc_outline_polygon (void);
+    int              add_contour_pyramid (void *dlist,
+                                          COntourOutputRec *contours,
+                                          int ncontours);
+    int              calc_tile_contours (void *dlist, int tile_num);
+    void             get_tile_range (double x1, double y1,
+                                     double x2, double y2,
+                                     int *c1, int *r1, int *c2, int *r2);
+    void             free_tiles (void);
 
     CSW_F            *data = NULL;
     CSW_F            *trigrid = NULL;
@@ -208,6 +239,20 @@ class DLSurf {
     int              band_zscale_needed;
     int              smooth_needed;
 
+    double           lod_spacing;
+    int              num_lod;
+
+    COntourCalcOptions  tile_options;
+    double           tile_zfact;
+    char             *tile_flags = NULL;
+    int              tile_ncol,
+                     tile_nrow,
+                     num_tile_cached;
+    int              tile_c1,
+                     tile_r1,
+                     tile_c2,
+                     tile_r2;
+
 };
 
 /*  do not add anything after this endif  */
@@ -493,6 +493,12 @@ private:
     int AddContour (COntourOutputRec *crec,
                     int grid_num,
                     int image_id);
+    int AddLodContour (COntourOutputRec *crec,
+                       int grid_num,
+                       int image_id,
+                       int lod_level,
+                       int tile_num);
+    void DeleteSurfTileContours (int surf_num, int tile_num);
     int AddContour (double *x, double *y, int npts,
                     double zvalue, char *label);
     int SetSpatialIndexForContour (int index_of_contour);
@@ -914,6 +920,7 @@ private:
     void delete_frame_ndp_images (int fnum);
 
     void reclip_frame_contours (int fnum);
+    void update_frame_contour_lod (int fnum);
     void reclip_frame_lines (int fnum);
     void reclip_frame_fills (int fnum);
     void reclip_frame_symbs (int fnum);
@@ -65,6 +65,9 @@ DLContour::DLContour (GTXDrawPrim *dp)
 
     prim_num = -1;
 
+    lod_level = 0;
+    tile_num = -1;
+
     in_extra = 0;
 
   /*
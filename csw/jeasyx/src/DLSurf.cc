@@ -145,6 +145,21 @@ DLSurf::DLSurf ()
     tmesh_zscale_needed = 0;
     band_zscale_needed = 0;
 
+    contour_lod = 0;
+    lod_spacing = 0.0;
+    num_lod = 0;
+
+    memset (&tile_options, 0, sizeof(COntourCalcOptions));
+    tile_zfact = 1.0;
+    tile_flags = NULL;
+    tile_ncol = 0;
+    tile_nrow = 0;
+    num_tile_cached = 0;
+    tile_c1 = 0;
+    tile_r1 = 0;
+    tile_c2 = -1;
+    tile_r2 = -1;
+
 }
 
 DLSurf::~DLSurf ()
@@ -173,6 +188,8 @@ DLSurf::~DLSurf ()
     zpoly = NULL;
     nvpoly = NULL;
     ncpoly = NULL;
+    csw_Free (tile_flags);
+    tile_flags = NULL;
 }
 
 
@@ -676,6 +693,15 @@ int DLSurf::CalcContours (void *vptr)
     };
     CSWScopeGuard func_scope_guard (fscope);
 
+/*
+ * Any contour pyramid and tiles from an earlier calculation
+ * have been deleted from the display list by now.
+ */
+    free_tiles ();
+    contour_lod = 0;
+    lod_spacing = 0.0;
+    num_lod = 0;
+    tile_zfact = 1.0;
 
     if (conprop.showContours == 0) {
         return 1;
@@ -739,6 +765,9 @@ int DLSurf::CalcContours (void *vptr)
                     if (cdata[i] >= 1.e20) continue;
                     cdata[i] *= (CSW_F)sfact;
                 }
+                if (cdata == ncdata) {
+                    tile_zfact = sfact;
+                }
             }
             grid_zscale_needed = 0;
         }
@@ -762,6 +791,30 @@ int DLSurf::CalcContours (void *vptr)
         if (istat == -1) {
             return -1;
         }
+
+        lod_spacing = ((gxmax - gxmin) / (ncc - 1) +
+                       (gymax - gymin) / (nrr - 1)) / 2.0;
+
+    /*
+     * If the grid was resampled for the display contours, the full
+     * resolution grid can be contoured a tile at a time when zoomed
+     * in.  The tiles use exactly the levels used here, so they match
+     * no matter how the interval was picked.
+     */
+        if (cdata == ncdata  &&
+            calc_options.convert_to_log == 0  &&
+            calc_options.step_flag == 0) {
+            istat = conapi_obj.con_GetContourLevels (
+                tile_options.minor_contours, &tile_options.nminor,
+                tile_options.major_contours, &tile_options.nmajor,
+                MAX_CONTOURS);
+            if (istat == 1) {
+                tile_ncol = (ncol - 2) / _DL_CONTOUR_TILE_SIZE_ + 1;
+                tile_nrow = (nrow - 2) / _DL_CONTOUR_TILE_SIZE_ + 1;
+                tile_flags = (char *)csw_Calloc (tile_ncol * tile_nrow *
+                                                 sizeof(char));
+            }
+        }
     }
 
 /*
@@ -837,27 +890,457 @@ int DLSurf::CalcContours (void *vptr)
         if (istat == -1) {
             return -1;
         }
+
+    /*
+     * The average edge length is used as the point spacing
+     * of the trimesh contours.
+     */
+        int    nedge = 0;
+        for (i=0; i<cnum_edges; i++) {
+            if (cedges[i].deleted) continue;
+            double dx = cnodes[cedges[i].node1].x - cnodes[cedges[i].node2].x;
+            double dy = cnodes[cedges[i].node1].y - cnodes[cedges[i].node2].y;
+            lod_spacing += sqrt (dx * dx + dy * dy);
+            nedge++;
+        }
+        if (nedge > 0) {
+            lod_spacing /= nedge;
+        }
     }
 
     if (contours == NULL  ||  ncontours < 1) {
         return 0;
     }
 
+    istat = add_contour_pyramid (vptr, contours, ncontours);
+
+    return istat;
 
-    int  icskip = ncontours / 20000 + 1;
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Add the calculated contours to the display list as level 0 of the
+ * contour pyramid, and add coarser levels built from them.  Only the
+ * level chosen for the current frame scale is drawn, so zooming out
+ * just picks a coarser level rather than contouring again.  If the
+ * coarser levels cannot be built, level 0 is still used at any scale.
+ */
+int DLSurf::add_contour_pyramid (void *vptr,
+                                 COntourOutputRec *contours,
+                                 int ncontours)
+{
+    CDisplayList        *dlist;
+    COntourOutputRec    *pyramid = NULL;
+    int                 npyramid = 0;
+    int                 level_start[_DL_CONTOUR_LOD_LEVELS_ + 1];
+    int                 i, lev, istat, n, icskip;
+
+    auto fscope = [&]()
+    {
+        conapi_obj.con_FreeContours (pyramid, npyramid);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    dlist = (CDisplayList *)vptr;
+
+    icskip = ncontours / 20000 + 1;
 
     for (i=0; i<ncontours; i+=icskip) {
 
-        dlist->AddContour (contours+i,
-                           index_num,
-                           image_id);
+        dlist->AddLodContour (contours+i,
+                              index_num,
+                              image_id,
+                              0, -1);
+
+    }
+
+    num_lod = 1;
+
+    if (lod_spacing <= 0.0) {
+        return 1;
+    }
+
+    istat = conapi_obj.con_BuildContourPyramid (
+        contours, ncontours,
+        (CSW_F)lod_spacing, _DL_CONTOUR_LOD_LEVELS_,
+        &pyramid, &npyramid,
+        level_start);
+    if (istat == -1) {
+        return 1;
+    }
 
+    for (lev=1; lev<_DL_CONTOUR_LOD_LEVELS_; lev++) {
+        n = level_start[lev+1] - level_start[lev];
+        icskip = n / 20000 + 1;
+        for (i=level_start[lev]; i<level_start[lev+1]; i+=icskip) {
+            dlist->AddLodContour (pyramid+i,
+                                  index_num,
+                                  image_id,
+                                  lev, -1);
+        }
     }
 
+    num_lod = _DL_CONTOUR_LOD_LEVELS_;
+
     return 1;
 
 }
 
+
+/*--------------------------------------------------------------------------*/
+
+/*
+ * Return the contour pyramid level to draw at the specified frame
+ * scale.  This is the coarsest level whose thinning tolerance is
+ * less than a pixel.  If a pixel is smaller than half of the level 0
+ * point spacing and the grid can be contoured in tiles, the tile
+ * level is returned, unless too many tiles are in the visible area.
+ */
+int DLSurf::SelectContourLod (double units_per_pixel,
+                              double x1, double y1, double x2, double y2)
+{
+    double      pix, spacing;
+    int         lod, c1, r1, c2, r2;
+
+    if (num_lod < 1  ||  lod_spacing <= 0.0) {
+        return 0;
+    }
+
+    pix = units_per_pixel * _DL_CONTOUR_LOD_PIXELS_;
+
+    if (pix < lod_spacing) {
+        if (tile_flags != NULL) {
+            get_tile_range (x1, y1, x2, y2, &c1, &r1, &c2, &r2);
+            if ((c2 - c1 + 1) * (r2 - r1 + 1) <= _DL_CONTOUR_MAX_TILES_) {
+                return _DL_CONTOUR_TILE_LOD_;
+            }
+        }
+        return 0;
+    }
+
+    lod = 0;
+    spacing = lod_spacing;
+    while (lod < num_lod - 1  &&  spacing * 2.0 <= pix) {
+        spacing *= 2.0;
+        lod++;
+    }
+
+    return lod;
+
+}
+
+
+/*
+ * Return 1 if the contours drawn for this surface are not the right
+ * ones for the specified frame scale and visible area, or zero if
+ * they are still good.  Panning at the same scale only changes things
+ * when tiles are drawn and a tile that is not drawn becomes visible.
+ */
+int DLSurf::ContourLodChanged (double units_per_pixel,
+                               double x1, double y1, double x2, double y2)
+{
+    int         lod, c1, r1, c2, r2;
+
+    lod = SelectContourLod (units_per_pixel, x1, y1, x2, y2);
+    if (lod != contour_lod) {
+        return 1;
+    }
+
+    if (lod == _DL_CONTOUR_TILE_LOD_) {
+        get_tile_range (x1, y1, x2, y2, &c1, &r1, &c2, &r2);
+        if (c2 >= c1  &&  r2 >= r1) {
+            if (c1 < tile_c1  ||  c2 > tile_c2  ||
+                r1 < tile_r1  ||  r2 > tile_r2) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+
+/*
+ * Make sure the full resolution contours for all the tiles in the
+ * visible area are in the display list, and mark those tiles as the
+ * ones to draw.  Tiles already calculated are reused.  If more than
+ * _DL_CONTOUR_TILE_CACHE_ tiles are cached, tiles outside of the
+ * visible area are deleted.  Zero is returned if tiles cannot be
+ * used for this surface or area, 1 on success and -1 on an error.
+ */
+int DLSurf::CalcTileContours (void *vptr,
+                              double x1, double y1, double x2, double y2)
+{
+    CDisplayList    *dlist;
+    int             i, j, k, c1, r1, c2, r2, istat;
+
+    if (tile_flags == NULL  ||  vptr == NULL) {
+        return 0;
+    }
+    dlist = (CDisplayList *)vptr;
+
+    get_tile_range (x1, y1, x2, y2, &c1, &r1, &c2, &r2);
+    if ((c2 - c1 + 1) * (r2 - r1 + 1) > _DL_CONTOUR_MAX_TILES_) {
+        return 0;
+    }
+
+    for (i=r1; i<=r2; i++) {
+        for (j=c1; j<=c2; j++) {
+            k = i * tile_ncol + j;
+            if (tile_flags[k] == 1) {
+                continue;
+            }
+            istat = calc_tile_contours (vptr, k);
+            if (istat == -1) {
+                return -1;
+            }
+            tile_flags[k] = 1;
+            num_tile_cached++;
+        }
+    }
+
+    if (num_tile_cached > _DL_CONTOUR_TILE_CACHE_) {
+        for (k=0; k<tile_ncol*tile_nrow; k++) {
+            if (tile_flags[k] == 0) {
+                continue;
+            }
+            i = k / tile_ncol;
+            j = k % tile_ncol;
+            if (i >= r1  &&  i <= r2  &&  j >= c1  &&  j <= c2) {
+                continue;
+            }
+            dlist->DeleteSurfTileContours (index_num, k);
+            tile_flags[k] = 0;
+            num_tile_cached--;
+            if (num_tile_cached <= _DL_CONTOUR_TILE_CACHE_) {
+                break;
+            }
+        }
+    }
+
+    tile_c1 = c1;
+    tile_r1 = r1;
+    tile_c2 = c2;
+    tile_r2 = r2;
+
+    return 1;
+
+}
+
+
+/*
+ * Return 1 if the specified tile is one of the tiles to draw.
+ */
+int DLSurf::TileIsDrawn (int tile_num)
+{
+    int         i, j;
+
+    if (tile_flags == NULL  ||  tile_num < 0  ||
+        tile_num >= tile_ncol * tile_nrow) {
+        return 0;
+    }
+
+    i = tile_num / tile_ncol;
+    j = tile_num % tile_ncol;
+    if (i >= tile_r1  &&  i <= tile_r2  &&
+        j >= tile_c1  &&  j <= tile_c2) {
+        return 1;
+    }
+
+    return 0;
+
+}
+
+
+/*
+ * Find the range of tile columns and rows that intersect the specified
+ * area.  If the area is completely outside of the grid, the returned
+ * range is empty (c2 is less than c1 and r2 is less than r1).
+ */
+void DLSurf::get_tile_range (double x1, double y1, double x2, double y2,
+                             int *c1, int *r1, int *c2, int *r2)
+{
+    double      tw, th;
+
+    *c1 = 0;
+    *r1 = 0;
+    *c2 = -1;
+    *r2 = -1;
+
+    if (tile_ncol < 1  ||  tile_nrow < 1  ||  ncol < 2  ||  nrow < 2) {
+        return;
+    }
+
+    if (x1 > x2) {
+        tw = x1;
+        x1 = x2;
+        x2 = tw;
+    }
+    if (y1 > y2) {
+        th = y1;
+        y1 = y2;
+        y2 = th;
+    }
+
+    if (x2 < gxmin  ||  x1 > gxmax  ||  y2 < gymin  ||  y1 > gymax) {
+        return;
+    }
+
+    tw = _DL_CONTOUR_TILE_SIZE_ * (gxmax - gxmin) / (ncol - 1);
+    th = _DL_CONTOUR_TILE_SIZE_ * (gymax - gymin) / (nrow - 1);
+    if (tw <= 0.0  ||  th <= 0.0) {
+        return;
+    }
+
+    *c1 = (int)((x1 - gxmin) / tw);
+    *c2 = (int)((x2 - gxmin) / tw);
+    *r1 = (int)((y1 - gymin) / th);
+    *r2 = (int)((y2 - gymin) / th);
+
+    if (*c1 < 0) *c1 = 0;
+    if (*r1 < 0) *r1 = 0;
+    if (*c1 > tile_ncol - 1) *c1 = tile_ncol - 1;
+    if (*r1 > tile_nrow - 1) *r1 = tile_nrow - 1;
+    if (*c2 > tile_ncol - 1) *c2 = tile_ncol - 1;
+    if (*r2 > tile_nrow - 1) *r2 = tile_nrow - 1;
+
+    return;
+
+}
+
+
+/*
+ * Contour one tile of the full resolution grid and add the contours
+ * to the display list.  Adjacent tiles share their edge rows and
+ * columns, so the tile contours meet at the tile edges.  Only the
+ * levels used for the display contours that are inside the tile's
+ * z range are traced.
+ */
+int DLSurf::calc_tile_contours (void *vptr, int tile_num)
+{
+    CDisplayList        *dlist;
+    CSW_F               *tgrid = NULL;
+    COntourOutputRec    *contours = NULL;
+    int                 ncontours = 0;
+    COntourCalcOptions  topt;
+    int                 i, j, c0, r0, c1, r1, nc, nr, istat;
+    double              zt, zmin, zmax, xsp, ysp;
+
+    auto fscope = [&]()
+    {
+        csw_Free (tgrid);
+        conapi_obj.con_FreeContours (contours, ncontours);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    dlist = (CDisplayList *)vptr;
+
+    c0 = (tile_num % tile_ncol) * _DL_CONTOUR_TILE_SIZE_;
+    r0 = (tile_num / tile_ncol) * _DL_CONTOUR_TILE_SIZE_;
+    c1 = c0 + _DL_CONTOUR_TILE_SIZE_;
+    r1 = r0 + _DL_CONTOUR_TILE_SIZE_;
+    if (c1 > ncol - 1) c1 = ncol - 1;
+    if (r1 > nrow - 1) r1 = nrow - 1;
+    nc = c1 - c0 + 1;
+    nr = r1 - r0 + 1;
+    if (nc < 2  ||  nr < 2) {
+        return 1;
+    }
+
+    tgrid = (CSW_F *)csw_Malloc (nc * nr * sizeof(CSW_F));
+    if (tgrid == NULL) {
+        return -1;
+    }
+
+    zmin = 1.e30;
+    zmax = -1.e30;
+    for (i=0; i<nr; i++) {
+        for (j=0; j<nc; j++) {
+            zt = data[(r0 + i) * ncol + c0 + j];
+            if (zt < 1.e20) {
+                zt *= tile_zfact;
+                if (zt < zmin) zmin = zt;
+                if (zt > zmax) zmax = zt;
+            }
+            tgrid[i * nc + j] = (CSW_F)zt;
+        }
+    }
+
+    if (zmin > zmax) {
+        return 1;
+    }
+
+    memcpy (&topt, &calc_options, sizeof(COntourCalcOptions));
+    topt.contour_interval = -1.0;
+    topt.nminor = 0;
+    topt.nmajor = 0;
+    for (i=0; i<tile_options.nminor; i++) {
+        zt = tile_options.minor_contours[i];
+        if (zt >= zmin  &&  zt <= zmax) {
+            topt.minor_contours[topt.nminor] = (CSW_F)zt;
+            topt.nminor++;
+        }
+    }
+    for (i=0; i<tile_options.nmajor; i++) {
+        zt = tile_options.major_contours[i];
+        if (zt >= zmin  &&  zt <= zmax) {
+            topt.major_contours[topt.nmajor] = (CSW_F)zt;
+            topt.nmajor++;
+        }
+    }
+
+    if (topt.nminor + topt.nmajor < 1) {
+        return 1;
+    }
+
+    xsp = (gxmax - gxmin) / (ncol - 1);
+    ysp = (gymax - gymin) / (nrow - 1);
+
+    istat = conapi_obj.con_CalcContoursFromDouble (
+        tgrid, nc, nr,
+        gxmin + c0 * xsp, gymin + r0 * ysp,
+        gxmin + c1 * xsp, gymin + r1 * ysp,
+        0.0,  /* unknown scale */
+        &contours, &ncontours,
+        faults, nfaults,
+        &topt);
+    if (istat == -1) {
+        return -1;
+    }
+
+    for (i=0; i<ncontours; i++) {
+        dlist->AddLodContour (contours+i,
+                              index_num,
+                              image_id,
+                              _DL_CONTOUR_TILE_LOD_, tile_num);
+    }
+
+    return 1;
+
+}
+
+
+/*
+ * Forget all the cached contour tiles.  The display list owns the
+ * tile contours, so it has to delete them separately.
+ */
+void DLSurf::free_tiles (void)
+{
+    csw_Free (tile_flags);
+    tile_flags = NULL;
+    tile_ncol = 0;
+    tile_nrow = 0;
+    num_tile_cached = 0;
+    tile_c1 = 0;
+    tile_r1 = 0;
+    tile_c2 = -1;
+    tile_r2 = -1;
+}
+
 /*--------------------------------------------------------------------------*/
 
 int DLSurf::CalcImage (void *vptr)
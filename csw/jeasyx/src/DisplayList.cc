@@ -902,6 +902,7 @@ void CDisplayList::Draw (void)
 
                 patch_draw_flag = frptr->patch_draw_flag;
 
+                update_frame_contour_lod (i);
                 reclip_frame_contours (i);
                 delete_frame_grid_images (i);
                 reclip_frame_grid_images (i);
@@ -8823,10 +8824,20 @@ void CDisplayList::rescale_frame (FRameStruct *frptr)
             reclip_frame_texts (i);
             reclip_frame_symbs (i);
             reclip_frame_shapes (i);
+            update_frame_contour_lod (i);
             reclip_frame_contours (i);
         }
     }
 
+/*
+ * Without patch drawing, the contour lines are only redrawn
+ * if the frame scale needs a different contour pyramid level.
+ */
+    else {
+        update_frame_contour_lod (fnum);
+        reclip_frame_contours (fnum);
+    }
+
     reclip_frame_grid_images (fnum);
 
     current_frame_num = save_fnum;
@@ -11277,6 +11288,26 @@ int CDisplayList::AddContour (
     COntourOutputRec *crec,
     int    grid_index,
     int    image_id)
+{
+    int    istat;
+
+    istat = AddLodContour (crec, grid_index, image_id, 0, -1);
+
+    return istat;
+}
+
+
+/*
+ * Add a contour for a grid or trimesh as part of a specific level
+ * of the surface's contour pyramid.  Tile contours use the tile
+ * level and also have the tile number set.
+ */
+int CDisplayList::AddLodContour (
+    COntourOutputRec *crec,
+    int    grid_index,
+    int    image_id,
+    int    lod_level,
+    int    tile_num)
 {
     DLContour *dlc;
     DLSurf    *grid;
@@ -11318,6 +11349,8 @@ int CDisplayList::AddContour (
     dlc->SetCrec (crec);
     dlc->grid_index = grid_index;
     dlc->image_id = image_id;
+    dlc->lod_level = lod_level;
+    dlc->tile_num = tile_num;
     if (grid) {
         dlc->frame_num = grid->frame_num;
         dlc->layer_num = grid->layer_num;
@@ -11365,11 +11398,39 @@ void CDisplayList::delete_surf_contours (int snum)
 
     DLContour     *dlc;
     for (i=0; i<cl_size; i++) {
-        if (cl_data[i]->grid_index == snum) {
-            dlc = cl_data[i];
-            if (dlc != NULL) {
-                delete (dlc);
-            }
+        dlc = cl_data[i];
+        if (dlc == NULL) {
+            continue;
+        }
+        if (dlc->grid_index == snum) {
+            delete (dlc);
+            cl_data[i] = NULL;
+            add_available_contour (i);
+        }
+    }
+}
+
+
+/*
+ * Delete the cached full resolution contours of one tile of a surface.
+ */
+void CDisplayList::DeleteSurfTileContours (int snum, int tile_num)
+{
+    int   i;
+
+    int        cl_size = (int)contour_list.size();
+    DLContour  **cl_data = contour_list.data();
+
+    DLContour     *dlc;
+    for (i=0; i<cl_size; i++) {
+        dlc = cl_data[i];
+        if (dlc == NULL) {
+            continue;
+        }
+        if (dlc->grid_index == snum  &&
+            dlc->lod_level == _DL_CONTOUR_TILE_LOD_  &&
+            dlc->tile_num == tile_num) {
+            delete (dlc);
             cl_data[i] = NULL;
             add_available_contour (i);
         }
@@ -11922,7 +11983,8 @@ void CDisplayList::reclip_frame_contours (int fnum)
     DLContourProperties *conprop;
     int                 grid_num;
     int                 nprim, ido, i, j, k, n, npts, istat, ncout, np2;
-    int                 fsave;
+    int                 fsave, lod;
+    double              units_per_pixel;
     DLSurf              *grid;
     COntourDrawOptions const  *draw_options;
     COntourDrawOptions  local_options;
@@ -11963,11 +12025,46 @@ void CDisplayList::reclip_frame_contours (int fnum)
     current_frame_num = fnum;
     update_frame_limits ();
 
-    nprim = cl_size;
-
     int        sf_size = surf_list.size();
     DLSurf     **sf_data = surf_list.data();
 
+/*
+ * Pick the contour pyramid level to draw from the frame scale for
+ * each surface whose contours need drawing.  If the full resolution
+ * tiles are picked, make sure the tiles for the visible area have
+ * been calculated.  This can add to the contour list, so the list
+ * data is fetched again afterwards.
+ */
+    units_per_pixel = GetFrameUnitsPerPixel (fnum);
+
+    if (sf_data != NULL  &&  sf_size > 0) {
+        for (i=0; i<sf_size; i++) {
+            grid = sf_data[i];
+            if (grid == NULL  ||  grid->deleted_flag == 1) {
+                continue;
+            }
+            if (grid->frame_num != fnum  ||
+                grid->needs_contour_reclip != 1) {
+                continue;
+            }
+            lod = grid->SelectContourLod (units_per_pixel,
+                                          Fx1, Fy1, Fx2, Fy2);
+            if (lod == _DL_CONTOUR_TILE_LOD_) {
+                istat = grid->CalcTileContours ((void *)this,
+                                                Fx1, Fy1, Fx2, Fy2);
+                if (istat != 1) {
+                    lod = 0;
+                }
+            }
+            grid->contour_lod = lod;
+        }
+    }
+
+    cl_size = (int)contour_list.size();
+    cl_data = contour_list.data();
+
+    nprim = cl_size;
+
     for (ido=0; ido<nprim; ido++) {
 
         i = ido;
@@ -12011,6 +12108,13 @@ void CDisplayList::reclip_frame_contours (int fnum)
                 continue;
             }
             grid->turn_off_reclip = 1;
+            if (contour->lod_level != grid->contour_lod) {
+                continue;
+            }
+            if (contour->lod_level == _DL_CONTOUR_TILE_LOD_  &&
+                grid->TileIsDrawn (contour->tile_num) == 0) {
+                continue;
+            }
             draw_options = grid->GetDrawOptions ();
             conprop = (DLContourProperties *)grid->GetContourProperties ();
         }
@@ -12211,6 +12315,61 @@ void CDisplayList::reclip_frame_contours (int fnum)
 
 
 
+/*
+ * Check if the contours drawn for the surfaces in a frame are still the
+ * right contour pyramid level for the frame's current scale and visible
+ * area.  If not, the contour lines for the surface are deleted and the
+ * surface is flagged so the next reclip_frame_contours call draws the
+ * contours for the new level.  Nothing is recontoured here.
+ */
+void CDisplayList::update_frame_contour_lod (int fnum)
+{
+    DLSurf              *grid;
+    double              units_per_pixel;
+    int                 i, fsave;
+
+    int        sf_size = surf_list.size();
+    DLSurf     **sf_data = surf_list.data();
+
+    if (sf_data == NULL  ||  sf_size < 1) {
+        return;
+    }
+
+    fsave = current_frame_num;
+    current_frame_num = fnum;
+    update_frame_limits ();
+
+    units_per_pixel = GetFrameUnitsPerPixel (fnum);
+
+    for (i=0; i<sf_size; i++) {
+        grid = sf_data[i];
+        if (grid == NULL  ||  grid->deleted_flag == 1) {
+            continue;
+        }
+        if (grid->frame_num != fnum) {
+            continue;
+        }
+        if (grid->needs_recalc == 1  ||  grid->needs_contour_reclip == 1) {
+            continue;
+        }
+        if (grid->ContourLodChanged (units_per_pixel,
+                                     Fx1, Fy1, Fx2, Fy2) == 0) {
+            continue;
+        }
+        delete_surf_contour_lines (i);
+        grid->needs_contour_reclip = 1;
+    }
+
+    current_frame_num = fsave;
+    update_frame_limits ();
+
+    return;
+
+}  /*  end of function update_frame_contour_lod */
+
+
+
+
 /*
  *  Add the line primitives, including label gaps and ticks for contours.
  *  These are usually calculated once for each contour and put into the
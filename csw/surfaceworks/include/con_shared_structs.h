@@ -49,6 +49,7 @@
 #  define CON_RESAMPLE_FLAG            11
 #  define CON_THICKNESS_FLAG           12
 #  define CON_CONTOUR_IN_FAULTS        13
+#  define CON_NUM_THREADS              14
 
 #  define CON_FAULTED_GRID_FLAG      1001
 
@@ -101,6 +102,15 @@ typedef struct {
     char          faultflag;
 }  COntourOutputRec;
 
+/*
+    Function called with each contour line as soon as it is finished,
+    when contours are streamed rather than returned in an array.  The
+    record and its points are only valid during the call.  Return -1
+    to stop the contour calculation or any other value to continue.
+*/
+typedef int (*CONTOUR_OUTPUT_FUNC) (COntourOutputRec *contour,
+                                    void *client_data);
+
 /*
     Structure for returning contour fills.
 */
@@ -147,6 +157,9 @@ typedef struct {
     int           nminor,
                   nmajor;
     int           error_number;
+
+    /*  threads used for contour tracing, negative for one per core  */
+    int           num_threads;
 }  COntourCalcOptions;
 
 
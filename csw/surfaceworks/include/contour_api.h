@@ -176,6 +176,17 @@
                               COntourOutputRec **, int*,
                               FAultLineStruct*, int,
                               COntourCalcOptions*);
+        int con_StreamContoursFromDouble
+                             (CSW_F*, int, int,
+                              double, double, double, double, CSW_F,
+                              CONTOUR_OUTPUT_FUNC, void*,
+                              FAultLineStruct*, int,
+                              COntourCalcOptions*);
+        int con_StreamContours (CSW_F*, int, int,
+                                CSW_F, CSW_F, CSW_F, CSW_F, CSW_F,
+                                CONTOUR_OUTPUT_FUNC, void*,
+                                FAultLineStruct*, int,
+                                COntourCalcOptions*);
         int con_FreeContours (COntourOutputRec *, int);
 
         int con_BuildColorBands (CSW_F, CSW_F, CSW_F, int,
@@ -248,6 +259,13 @@
                                        COntourOutputRec **conclip, int *nconclip);
 
         COntourOutputRec *con_CopyOutputRec (COntourOutputRec *cp);
+        int con_BuildContourPyramid (COntourOutputRec *contours, int ncontours,
+                                     CSW_F spacing, int nlevels,
+                                     COntourOutputRec **pyramid, int *npyramid,
+                                     int *level_start);
+        int con_GetContourLevels (CSW_F *minor, int *nminor,
+                                  CSW_F *major, int *nmajor,
+                                  int maxlevels);
 
         int con_SmoothTriMesh (NOdeStruct **nodes, int *numnodes,
                                EDgeStruct **edges, int *numedges,
@@ -54,6 +54,8 @@
 #define GRD_WORK_MARGIN              16
 #define GRD_TRIANGULATE_FLAG         17
 #define GRD_DEFAULT_SIZE_MULTIPLIER  18
+#define GRD_NUM_THREADS              19
+#define GRD_SEARCH_ENGINE            20
 
 #define GRD_FAULTED_GRID_FLAG        1001
 
@@ -64,6 +66,9 @@
 #define GRD_OCTANT_SEARCH            2
 #define GRD_RADIAL_SEARCH            3
 
+#define GRD_CELL_LIST_ENGINE         0
+#define GRD_PACKED_BUCKET_ENGINE     1
+
 #define GRD_NONE                     0
 #define GRD_GLOBAL_ANISOTROPY        1
 #define GRD_LOCAL_ANISOTROPY         2
@@ -169,6 +174,8 @@
         int       work_margin;
         int       error_number;
         int       moving_avg_only = 0;
+        int       num_threads = 0;
+        int       search_engine = 0;
     }  GRidCalcOptions;
 
     typedef struct {
@@ -310,6 +317,14 @@
 
 #define GRD_CELL_DIAGONALS          1
 #define GRD_EQUILATERAL             2
+#define GRD_ADAPTIVE                3
+
+#define GRD_SUBDIVIDE_INSERTION     0
+#define GRD_SORTED_INSERTION        1
+
+#define GRD_VALIDATE_NONE           0
+#define GRD_VALIDATE_TOPOLOGY       1
+#define GRD_VALIDATE_FULL           2
 
 #define GRD_CHECK_FOR_NULL_POINTER  0.0
 
@@ -441,6 +456,30 @@ typedef struct {
                     node3;
 }  NOdeTriangleStruct;
 
+/*
+ * Compact copy of a trimesh, with the node coordinates in separate
+ * arrays and the connectivity packed two per edge (enodes and etris)
+ * or three per triangle (tnodes and tedges).  Loops that only need
+ * the coordinates and the connectivity use this rather than the full
+ * node, edge and triangle structures.
+ */
+typedef struct {
+    double          *x,
+                    *y,
+                    *z;
+    int             *enodes,
+                    *etris,
+                    *eflags;
+    int             *tnodes,
+                    *tedges;
+    char            *ndeleted,
+                    *edeleted,
+                    *tdeleted;
+    int             numnodes,
+                    numedges,
+                    numtriangles;
+}  COmpactTriMesh;
+
 typedef struct {
     SPillpointStruct  *spillpoint_list;
     int               total_spillpoints;
@@ -58,6 +58,8 @@ Define grid option constants.
 #define GRD_WORK_MARGIN              16
 #define GRD_TRIANGULATE_FLAG         17
 #define GRD_DEFAULT_SIZE_MULTIPLIER  18
+#define GRD_NUM_THREADS              19
+#define GRD_SEARCH_ENGINE            20
 
 #define GRD_FAULTED_GRID_FLAG        1001
 
@@ -68,6 +70,9 @@ Define grid option constants.
 #define GRD_OCTANT_SEARCH            2
 #define GRD_RADIAL_SEARCH            3
 
+#define GRD_CELL_LIST_ENGINE         0
+#define GRD_PACKED_BUCKET_ENGINE     1
+
 #define GRD_NONE                     0
 #define GRD_GLOBAL_ANISOTROPY        1
 #define GRD_LOCAL_ANISOTROPY         2
@@ -251,6 +256,12 @@ class CSWGrdAPI
 
     FILE   *LineFilePtr = NULL;
 
+    int CalcGridMultiParallel (CSW_F*, CSW_F*, CSW_F**, int, int,
+                               CSW_F**, char**, int, int,
+                               CSW_F, CSW_F, CSW_F, CSW_F,
+                               CSW_F, CSW_F,
+                               GRidCalcOptions *);
+
   public:
 
     CSWGrdAPI () {SetObjPtrs ();};
@@ -301,7 +312,29 @@ return 1;
                       CSW_F, CSW_F, CSW_F, CSW_F,
                       FAultLineStruct*, int,
                       GRidCalcOptions *);
+    int grd_CalcGridTiled (CSW_F*, CSW_F*, CSW_F*, int,
+                           const char*, const char*, int, int,
+                           CSW_F, CSW_F, CSW_F, CSW_F,
+                           FAultLineStruct*, int,
+                           int, GRidCalcOptions *);
+    int grd_BeginPointStream (int);
+    int grd_AddPointChunk (CSW_F*, CSW_F*, CSW_F*, int);
+    int grd_CalcGridFromStream (CSW_F*,
+                                CSW_F*, char*, char**, int, int,
+                                CSW_F, CSW_F, CSW_F, CSW_F,
+                                FAultLineStruct*, int,
+                                GRidCalcOptions *);
+    int grd_GetPointStreamCount (void);
+    int grd_EndPointStream (void);
+    int grd_SetFaultIndexCacheSize (long);
+    int grd_CalcGridMulti (CSW_F*, CSW_F*, CSW_F**, int, int,
+                           CSW_F**, char**, int, int,
+                           CSW_F, CSW_F, CSW_F, CSW_F,
+                           FAultLineStruct*, int,
+                           GRidCalcOptions *);
     void grd_SetNoisyDataFlag (int ndf);
+    int grd_BeginCalcSession (void);
+    int grd_EndCalcSession (void);
     int grd_SetCalcOption (int, int, CSW_F);
     int grd_SetCalcOptions (GRidCalcOptions *);
     int grd_DefaultCalcOptions (GRidCalcOptions *);
@@ -723,6 +756,11 @@ return 1;
                                  TRiangleStruct *triangles, int numtriangles,
                                  int degree_flag,
                                  double *direction, double *amplitude);
+        int grd_CalcTriMeshNormals (NOdeStruct *nodes, int numnodes,
+                                 EDgeStruct *edges, int numedges,
+                                 TRiangleStruct *triangles, int numtriangles,
+                                 double *tnx, double *tny, double *tnz,
+                                 double *nnx, double *nny, double *nnz);
     
         int grd_FreeDrainagesStruct (DRainagesStruct *dptr);
     
@@ -926,6 +964,39 @@ return 1;
              int *num_nodes_out, int *num_edges_out, int *num_triangles_out);
     
         int grd_SetPolyConstraintFlag (int val);
+        int grd_SetTriMeshInsertion (int method);
+        int grd_SetTriMeshThreads (int nthreads);
+        int grd_SetTriMeshBulkConstraints (int flag);
+        int grd_SetTriMeshGridTolerance (double ztol);
+        int grd_SetTriMeshValidation (int level);
+        int grd_GetTriMeshValidationTimes (double *topo_time,
+                                           double *full_time);
+
+        int grd_BeginTriMeshEdit (NOdeStruct *nodes, int numnodes,
+                                  EDgeStruct *edges, int numedges,
+                                  TRiangleStruct *triangles, int numtriangles);
+        int grd_EndTriMeshEdit (NOdeStruct **nodes_out, int *num_nodes_out,
+                                EDgeStruct **edges_out, int *num_edges_out,
+                                TRiangleStruct **triangles_out,
+                                int *num_triangles_out);
+        int grd_GetTriMeshEdit (NOdeStruct **nodes_out, int *num_nodes_out,
+                                EDgeStruct **edges_out, int *num_edges_out,
+                                TRiangleStruct **triangles_out,
+                                int *num_triangles_out);
+        int grd_EditTriMeshInsertNode (double x, double y, double z,
+                                       int *nodenum,
+                                       int **changed, int *nchanged);
+        int grd_EditTriMeshDeleteNode (int nodenum,
+                                       int **changed, int *nchanged);
+        int grd_EditTriMeshMoveNode (int nodenum,
+                                     double x, double y, double z,
+                                     int **changed, int *nchanged);
+        int grd_EditTriMeshInsertSegment (double x1, double y1, double z1,
+                                          double x2, double y2, double z2,
+                                          int flag, int *node1, int *node2,
+                                          int **changed, int *nchanged);
+        int grd_EditTriMeshDeleteSegment (int node1, int node2,
+                                          int **changed, int *nchanged);
     
         int grd_FilterDataSpikes (double *xin, double *yin, double *zin,
                                   int *ibad, int nin,
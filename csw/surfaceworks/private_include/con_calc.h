@@ -57,6 +57,10 @@
 
 #define MAX_SUB_GRID_SIZE      200
 
+#define CELL_BLOCK_SHIFT       3
+#define CELL_BLOCK_SIZE        (1 << CELL_BLOCK_SHIFT)
+#define MAX_CELL_BLOCK_LEVELS  32
+
 #define Z_TINY_DIVISOR         50000.0f
 
 #define TINY_PERCENT           0.01f
@@ -82,6 +86,35 @@ typedef struct {
     char       major;
 }  COntourVal;
 
+/*
+    An unsmoothed contour line saved by a tracing thread, with
+    everything needed to smooth and output it later.
+*/
+typedef struct {
+    CSW_F      *x,
+               *y;
+    int        *cell;
+    char       *crowd,
+               *di;
+    int        npts,
+               downhill,
+               closure;
+}  COnRawLine;
+
+/*
+    The part of the traced output for a contour level that
+    is held by a tracing thread.
+*/
+typedef struct {
+    int        rawthread,
+               rawfirst,
+               nraw,
+               outthread,
+               outfirst,
+               nout,
+               istat;
+}  COnLevelWork;
+
 
 class CSWConCalc;
 
@@ -154,6 +187,7 @@ class CSWConCalc
                   OptStepGridFlag {0},
                   OptFaultedFlag {0},
                   OptContourInFaultsFlag {0},
+                  OptContourNumThreads {0},
                   OptContourLogConvert {0};
     CSW_F         OptContourBaseValue {0.0},
                   OptContourLogBase {0.0},
@@ -207,6 +241,36 @@ class CSWConCalc
                   *Vcrossing2 {NULL},
                   *SmoothFlags {NULL};
 
+/*
+    CrossList has the Hcrossing (positive) and Vcrossing (negative,
+    offset by -1) indices set while tracing the current level.  The
+    entries from CrossStart on were set by the current line.  Only
+    these entries need to be zeroed for the next line or level.
+*/
+    int           *CrossList {NULL};
+    int           NumCross {0},
+                  MaxCross {0},
+                  CrossStart {0};
+
+/*
+    Block min/max pyramid over the grid being contoured or filled.
+    A level zero block is CELL_BLOCK_SIZE by CELL_BLOCK_SIZE cells, and
+    each higher level block covers 2 by 2 blocks of the level below.  The
+    range of a block includes all of the nodes of its cells, ignoring
+    nulls.  BlockNull is set for a level zero block with a null node.
+    BlockColor is the single color band index of all the nodes of a
+    level zero block for color fills, or -1 if there is no such index.
+*/
+    CSW_F         *BlockZmin {NULL},
+                  *BlockZmax {NULL};
+    char          *BlockNull {NULL};
+    int           *BlockColor {NULL};
+    int           BlockLevels {0},
+                  BlockCols[MAX_CELL_BLOCK_LEVELS],
+                  BlockRows[MAX_CELL_BLOCK_LEVELS],
+                  BlockStart[MAX_CELL_BLOCK_LEVELS];
+    int           *LevelSpans {NULL};
+
     CSW_F         **SmoothSubgrids {NULL};
     int           SubgridCols {0},
                   SubgridRows {0};
@@ -261,6 +325,34 @@ class CSWConCalc
 
     int           RangeCheckNeeded {1};
 
+/*
+    Levels of a contour interval are traced on up to ContourThreads
+    threads.  Each thread uses a worker object with its own tracing
+    buffers and output list.  The shared grids and smoothing arrays
+    are only read by the workers.  SaveRawLines is set when a worker
+    saves unsmoothed lines in RawLines for later smoothing, and
+    SmoothPrebuilt is set when the smoothing flags are final and the
+    needed subgrids have already been built.
+*/
+    int           ContourThreads {0};
+    int           SaveRawLines {0},
+                  SmoothPrebuilt {0};
+    COnRawLine    *RawLines {NULL};
+    int           NumRawLines {0},
+                  MaxRawLines {0};
+
+/*
+    If OutputFunc is set, each finished contour is passed to it instead
+    of being kept in ContourData.  The OutputXshift and OutputYshift
+    values are added to the points first.  OutputStopped is set if
+    the function asks for the calculation to stop.
+*/
+    CONTOUR_OUTPUT_FUNC  OutputFunc {NULL};
+    void          *OutputFuncData {NULL};
+    double        OutputXshift {0.0},
+                  OutputYshift {0.0};
+    int           OutputStopped {0};
+
 
    COnColor       ColorLookup[MAX_LOOKUP];
 
@@ -303,11 +395,26 @@ class CSWConCalc
     int          AdjustSubgrid (CSW_F *grid, int n, CSW_F zlev);
     int          SetToPositiveNulls (void);
     int          TraceContours (void);
+    int          TraceContourLevel (CSW_F zlev, int major, CSW_F ztiny,
+                                    int bottomedge, int rightedge,
+                                    int topedge, int leftedge);
+    int          TraceLevelsParallel (CSW_F ztiny,
+                                      int bottomedge, int rightedge,
+                                      int topedge, int leftedge);
+    int          FinishTracedContour (void);
+    int          SaveRawLine (void);
+    int          LoadRawLine (COnRawLine *rptr);
+    int          InitTraceWorker (CSWConCalc *src);
+    void         FreeTraceWorker (void);
     int          TraceCellToCell
                     (int irow, int jcol, int side, CSW_F zlev);
     int          SmoothContour (void);
+    void         SetLineSmoothFlags (CSW_F *xbuf, CSW_F *ybuf,
+                                     int *cellbuf, int nbuf);
+    CSW_F        *BuildSmoothSubgrid (int node, CSW_F xref, CSW_F yref);
     int          OutputContours (void);
     int          PutInOutputStruct (CSW_F *xptr, CSW_F *yptr, int len);
+    int          SendContour (COntourOutputRec *crec);
     int          SamePoint
                      (CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2, CSW_F tiny);
     int          TooCrowded (int kcell);
@@ -336,6 +443,14 @@ class CSWConCalc
 
     int          ShiftInputGrid (CSW_F *grid, int ncol, int nrow);
 
+    int          BuildBlockPyramid (CSW_F *grid, CSW_F nullvalue);
+    void         FreeBlockPyramid (void);
+    void         WidenBlockPyramid (int node, CSW_F zval);
+    int          FindLevelSpans (int irow, CSW_F zlev, int *spans);
+    int          SetBlockColors (void);
+    int          AddCrossing (int kcross);
+    void         ClearCrossings (int levelflag);
+
     int          SaddleCheck (CSW_F z1, CSW_F z2, CSW_F z3, CSW_F z4);
     int          SaddleTweak (int kcell, int *di, CSW_F zlev);
 
@@ -351,6 +466,9 @@ class CSWConCalc
                                    CSW_F **gridout);
     void         CorrectResampledThickness
                      (CSW_F *grid, int ncol, int nrow, int nskip);
+    int          ThinContourLine (CSW_F *x, CSW_F *y, int npts,
+                                  CSW_F tolerance,
+                                  char *keep, int *stack);
 
     int          BuildContourArrays (void);
 
@@ -371,6 +489,8 @@ class CSWConCalc
                            COntourOutputRec **contours, int *ncont,
                            COntourCalcOptions *options);
     int con_free_contours (COntourOutputRec *list, int nlist);
+    void con_set_output_func (CONTOUR_OUTPUT_FUNC func, void *client_data,
+                              double xshift, double yshift);
 
     int con_build_color_bands (CSW_F cint,
                                CSW_F first, CSW_F last,
@@ -407,6 +527,14 @@ class CSWConCalc
                                 COntourOutputRec *contours, int ncontours,
                                 double *xpoly, double *ypoly, int *ipoly, int npoly,
                                 COntourOutputRec **conclip, int *nconclip);
+    int con_build_contour_pyramid
+                               (COntourOutputRec *contours, int ncontours,
+                                CSW_F spacing, int nlevels,
+                                COntourOutputRec **pyramid, int *npyramid,
+                                int *level_start);
+    int con_get_contour_levels (CSW_F *minor, int *nminor,
+                                CSW_F *major, int *nmajor,
+                                int maxlevels);
 
 }; // end of main class definition
 
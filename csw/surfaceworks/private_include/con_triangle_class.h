@@ -29,6 +29,32 @@
 
 #define MAXDIV   4
 
+/*
+  Each contour level is traced using its own LEvelTraceStruct.  The
+  edges whose z range can bound the level are listed in the class
+  LevelEdges array, starting at the start member.  Nothing in the
+  structure is shared with other levels while tracing, so separate
+  levels can be traced on separate threads.
+*/
+typedef struct {
+    double              level;
+    int                 major;
+    long                start;
+    int                 nedge;
+    int                 downhill;
+    int                 closure;
+    int                 tracing_fault;
+    int                 istat;
+    char                *etflag;
+    double              *xwork,
+                        *ywork;
+    int                 nwork;
+    int                 maxwork;
+    COntourOutputRec    *lines;
+    int                 nlines;
+    int                 maxlines;
+}  LEvelTraceStruct;
+
 class CSWConTriangle;
 
 #include "csw/surfaceworks/private_include/grd_fault.h"
@@ -82,15 +108,24 @@ class CSWConTriangle
     int                 NumEdges {0};
     int                 NumNodes {0};
 
+/*
+  The contour tracing uses a compact copy of the trimesh.  The edges
+  are bucketed by the contour levels they cross, so each level only
+  visits its own edges.  ContourThreads is the number of threads used
+  to trace the levels.
+*/
+    COmpactTriMesh      Cmesh {};
+
+    LEvelTraceStruct    *LevelTrace {NULL};
+    int                 NumLevels {0};
+    int                 *LevelEdges {NULL};
+    double              LevelAdjust {0.0},
+                        LevelFudge {0.0};
+    int                 ContourThreads {0};
+
     COntourOutputRec    *ContourLines {NULL};
     int                 NumContourLines {0};
-    int                 MaxContourLines {0};
 
-    double              *XconWork {NULL},
-                        *YconWork {NULL};
-    int                 NumConWork {0};
-    int                 MaxConWork {0};
-    double              *ZvalSave {NULL};
     double              ZvalAdjust {0.0};
     double              Zmin {0.0},
                         Zmax {0.0},
@@ -98,16 +133,11 @@ class CSWConTriangle
 
     double              DeltaZCrit {0.0};
 
-    double              ContourLevel {0.0};
-
     double              ContourMin {0.0},
                         ContourMax {0.0};
     double              NullValue {0.0};
 
-    int                 MajorFlag {0};
     int                 MajorInterval {5};
-    int                 DownhillFlag {0};
-    int                 ClosureFlag {0};
 
     int                 Nmajor {0},
                         Nminor {0};
@@ -117,8 +147,6 @@ class CSWConTriangle
                         ContourBase {0.0};
     double              LogBase {0.0};
 
-    int                 TracingFaultFlag {0};
-
     double tnxNorm {0.0},
            tnyNorm {0.0},
            tnzNorm {0.0};
@@ -134,17 +162,20 @@ class CSWConTriangle
 /*
   File static functions changed to class private methods
 */
-    int EdgeZrange (EDgeStruct *e);
+    int EdgeZrange (int iedge, double level);
+    double NodeZ (int inode, double level);
     int CalcContours (void);
-    int TraceContourLevel (void);
-    int TraceSingleContour (EDgeStruct *estart);
-    EDgeStruct *FindExitEdge (EDgeStruct *enow, TRiangleStruct *tnow);
-    void AddEdgePoint (EDgeStruct *enow);
+    int BuildContourLevels (void);
+    int BuildLevelEdgeLists (void);
+    int TraceContourLevel (LEvelTraceStruct *lt);
+    int TraceSingleContour (int estart, LEvelTraceStruct *lt);
+    int FindExitEdge (int enow, int tnow, LEvelTraceStruct *lt);
+    void AddEdgePoint (int enow, LEvelTraceStruct *lt);
     int PointLimits (void);
-    int OutputContourLine (void);
-    int AdjustNodeValues (void);
+    int OutputContourLine (LEvelTraceStruct *lt);
+    void FreeLevels (void);
     void FreeMem (void);
-    void SetDownhill (EDgeStruct *e1, EDgeStruct *e2);
+    void SetDownhill (int e1, int e2, LEvelTraceStruct *lt);
     int SetContourLimits (void);
     void AdjustNodesForInterval (void);
 
@@ -66,9 +66,15 @@
 #define MAX_PASS1                1000
 #define MAX_WORK                 30000
 
+#define MAX_SHARED_TABLES        4
+#define MAX_SHARED_POINTS        10000000
+
 #define MIN_ROWS_GCALC           2
 #define MIN_COLS_GCALC           2
 
+#define DEFAULT_TILE_SIZE        1000
+#define MIN_TILE_HALO            16
+
 
 
 /*
@@ -85,6 +91,179 @@ typedef struct {
     int        type;
 }  COntrolGridStruct;
 
+/*
+    Scratch space used while a single grid node is estimated from its
+    local data.  The serial calculation uses the SerialWork member of
+    the class.  Each thread of a parallel coarse node calculation gets
+    its own copy, so nothing in here can be shared between nodes.
+*/
+typedef struct {
+    int        ploc_int1[MAX_LOCAL],
+               ploc_int2[MAX_LOCAL],
+               ploc_int3[MAX_LOCAL],
+               ploc_int4[MAX_LOCAL];
+    CSW_F      ploc_f1[MAX_LOCAL],
+               ploc_f2[MAX_LOCAL],
+               ploc_f3[MAX_LOCAL],
+               ploc_f4[MAX_LOCAL];
+    CSW_F      p_xloc[MAX_LOCAL*2],
+               p_yloc[MAX_LOCAL*2],
+               p_zloc[MAX_LOCAL*2],
+               p_dsq[MAX_LOCAL],
+               p_xp[MAX_LOCAL],
+               p_yp[MAX_LOCAL],
+               p_zp[MAX_LOCAL],
+               p_ep[MAX_LOCAL],
+               p_pdsq[MAX_LOCAL];
+    double     p_dist[MAX_LOCAL*2];
+    CSW_F      p_res[MAX_LOCAL*2];
+    CSW_F      local_area_size;
+    CSW_F      zloc_min,
+               zloc_max;
+    int        firstq1,
+               firstq2,
+               firstq3,
+               firstq4;
+    int        extension;
+}  LOcalNodeWork;
+
+/*
+    Wall clock seconds spent in each phase of the last grd_calc_grid
+    call.  These are listed at the end of the grid report.  The error
+    correction, smoothing and refinement times are the totals for all
+    of the coarse levels in IterateToFinalGrid.
+*/
+typedef struct {
+    double     tables,
+               coarse,
+               error_grid,
+               smooth,
+               refine,
+               total;
+    int        nthreads;
+}  PHaseTimeStruct;
+
+/*
+    Derived data kept between grd_calc_grid calls while a gridding
+    session is active.  The data table part holds copies of the
+    DataTable, Icoarse and ClosestPoint (distance table) work arrays
+    along with the scalars set up with them.  The empty area part
+    holds the EmptyAreaGrid from AddPointsToEmptyRegions, which is
+    built from the same data as the tables.  The trend part holds
+    the trend surface grid.  Each part is only reused if all of the
+    values it was calculated from (the key members) are the same.
+*/
+typedef struct {
+    int        active;
+    int        table_valid;
+    int        table_hit;
+    int        trend_valid;
+
+  /* data table key */
+    int        ndata, ncol, nrow, nccol, ncrow, ncoarse,
+               orig_ncol, orig_nrow, thickness_flag, noisy_in,
+               search_engine;
+    CSW_F      xmin, ymin, xmax, ymax, xspace, yspace,
+               orig_xmin, orig_ymin, orig_xmax, orig_ymax;
+    CSW_F      *xdata, *ydata, *zdata_in;
+
+  /* data table results */
+    int        *itable;
+    int        nitable;
+    char       *ctable;
+    int        nctable;
+    CSW_F      *zdata_out;
+    int        *extra;
+    int        nextra;
+    int        flat_grid_flag, noisy_data_flag;
+    CSW_F      point_density, rxmin, rymin, rxmax, rymax,
+               xrange, yrange, zmin, zmax, zmean, zminus_val,
+               zrange, ztiny;
+
+  /* empty area key */
+    int        empty_valid;
+    int        empty_anisotropy_in, triangulate_in, empty_region_in;
+
+  /* empty area results */
+    CSW_F      *empty_grid;
+
+  /* trend surface key */
+    int        anisotropy_in;
+    CSW_F      smoothing_in, strike_in;
+
+  /* trend surface results */
+    CSW_F      *trend_grid;
+    int        in_line_flag, trend_distance, anisotropy_flag;
+    CSW_F      smoothing_factor, preferred_strike;
+}  CAlcSessionStruct;
+
+/*
+    Points added a chunk at a time for a streamed grid calculation.
+    The x, y and z arrays are owned by the stream and are used
+    directly as the grid calculation data, so the points are only
+    stored once.  The arrays grow geometrically as chunks are added.
+    The x and y limits of the points are kept up to date as they
+    are added.
+*/
+typedef struct {
+    int        active;
+    int        npts;
+    int        maxpts;
+    CSW_F      *x, *y, *z;
+    CSW_F      xmin, ymin, xmax, ymax;
+}  POintStreamStruct;
+
+/*
+    Local point lists found by CollectLocalPoints for one grid row.
+    Each record has the search parameters, the results put into the
+    work structure and the offset of its points in the points array.
+    The first array has the first record for each column, and the
+    records for a column are chained with the next member.
+*/
+typedef struct {
+    int        jcol, start, end, maxquad, maxloc;
+    CSW_F      coincident;
+    int        nlist, nquad;
+    int        firstq1, firstq2, firstq3, firstq4;
+    CSW_F      area;
+    int        offset;
+    int        next;
+}  SHaredListRecord;
+
+typedef struct {
+    SHaredListRecord  *recs;
+    int               nrecs, maxrecs;
+    int               *points;
+    int               npoints, maxpoints;
+    int               *first;
+}  SHaredListRow;
+
+/*
+    The local point lists are shared by the attributes of a multiple
+    attribute grid calculation.  The lists found while the first
+    attribute is calculated are recorded, and the later attributes
+    replay them instead of searching again.  A set of lists is kept
+    for each data table built during the calculation, and ibuild counts
+    the tables built so far for the current attribute.  The key members
+    are compared exactly before a set of lists is replayed.
+*/
+typedef struct {
+    int        ncol, nrow, ndata, search_engine, search_pattern,
+               num_local, max_distance, row_limit;
+    CSW_F      xmin, ymin, xspace, yspace;
+    int        *table;
+    CSW_F      *xdata, *ydata;
+    SHaredListRow  *rows;
+}  SHaredListTable;
+
+typedef struct {
+    int              mode;
+    int              ibuild;
+    int              itable;
+    int              ntables;
+    SHaredListTable  tables[MAX_SHARED_TABLES];
+}  SHaredSearchStruct;
+
 
 
 class CSWGrdCalc;
@@ -118,21 +297,22 @@ class CSWGrdCalc
         TruncationGrid.grid = NULL;
     }
 
-    int    ploc_int1[MAX_LOCAL];
-    int    ploc_int2[MAX_LOCAL];
-    int    ploc_int3[MAX_LOCAL];
-    int    ploc_int4[MAX_LOCAL];
+    LOcalNodeWork    SerialWork;
+
+    CAlcSessionStruct  Session {};
 
-    CSW_F  ploc_f1[MAX_LOCAL];
-    CSW_F  ploc_f2[MAX_LOCAL];
-    CSW_F  ploc_f3[MAX_LOCAL];
-    CSW_F  ploc_f4[MAX_LOCAL];
+    PHaseTimeStruct  PhaseTimes {};
+
+    POintStreamStruct  Stream {};
+
+    SHaredSearchStruct  SharedSearch {};
 
 
   public:
 
     CSWGrdCalc () {__init();};
-    ~CSWGrdCalc () {FreeMem();};
+    ~CSWGrdCalc () {FreeMem(); FreeSessionData(); grd_end_point_stream();
+                    FreeSharedSearch();};
 
 // It makes no sense to copy construct, move construct,
 // assign or move assign an object of this class.  The
@@ -158,21 +338,11 @@ class CSWGrdCalc
   Some work space used in local functions.  These were local static
   variables in the old c functions.
 */
-    CSW_F     p_xloc[MAX_LOCAL*2],
-              p_yloc[MAX_LOCAL*2],
-              p_zloc[MAX_LOCAL*2],
-              p_dsq[MAX_LOCAL],
-              p_xp[MAX_LOCAL],
-              p_yp[MAX_LOCAL],
-              p_zp[MAX_LOCAL],
-              p_ep[MAX_LOCAL],
-              p_pdsq[MAX_LOCAL],
-              p_work1[MAX_WORK],
+    CSW_F     p_work1[MAX_WORK],
               p_work2[MAX_WORK],
               p_work3[MAX_WORK];
 
     int       noisy_edge_data = 0;
-    CSW_F     LocalPointAreaSize = 0.0;
 
 /*
   Old static file variables become private class variables
@@ -233,6 +403,21 @@ class CSWGrdCalc
                       *Left {NULL},
                       *Right {NULL};
 
+/*
+    Packed copy of the DataTable link lists, used when the search
+    engine is GRD_PACKED_BUCKET_ENGINE.  The points in detail cell k
+    are PackedPoints[PackedStart[k]] up to PackedPoints[PackedStart[k+1]-1],
+    in the same order as the link list.  PackedRowNext[k] is the index
+    of the first occupied cell at or to the right of cell k in the
+    same row (or the first cell of the next row).  PackedColNext[k] is
+    the row of the first occupied cell at or above cell k in the same
+    column (or Nrow if there is none).
+*/
+    int               *PackedStart {NULL},
+                      *PackedPoints {NULL},
+                      *PackedRowNext {NULL},
+                      *PackedColNext {NULL};
+
     CSW_F             *Grid {NULL},
                       *Gwork1 {NULL},
                       *Gwork2 {NULL},
@@ -257,6 +442,7 @@ class CSWGrdCalc
                       *Zerr {NULL},
                       *ZerrBC {NULL};
     int               FreeZdataFlag {0};
+    int               InputOwnedFlag {0};
     CSW_F             Xsmall[10],
                       Ysmall[10],
                       Zsmall[10];
@@ -296,7 +482,6 @@ class CSWGrdCalc
     CSW_F             *AnisoStrike {NULL},
                       *AnisoPower {NULL},
                       *AratioGrid {NULL};
-    int               Firstq1 {0}, Firstq2 {0}, Firstq3 {0}, Firstq4 {0};
 
     CSW_F             SmoothingFactor {3.0f},
                       PreferredStrike {-1000.0f},
@@ -337,7 +522,9 @@ class CSWGrdCalc
                       OptTriangulateFlag {0},
                       OptDefaultSizeMultiplier {1},
                       OptWorkMargin {-1},
-                      OptStepGridFlag {0};
+                      OptStepGridFlag {0},
+                      OptNumThreads {0},
+                      OptSearchEngine {GRD_CELL_LIST_ENGINE};
     CSW_F             OptMaxSearchDistance {1.e30f};
 
     int               AnisotropyFlag {0},
@@ -355,7 +542,9 @@ class CSWGrdCalc
                       NoTrendFlag {0},
                       EmptyRegionFlag {1},
                       WorkMargin {-1},
-                      StepGridFlag {0};
+                      StepGridFlag {0},
+                      NumThreads {0},
+                      SearchEngine {GRD_CELL_LIST_ENGINE};
     int               NoisyDataFlag = 0;
     CSW_F             MaxSearchDistance {1.e30f};
     int               MaxNodeDistance {100000};
@@ -371,9 +560,6 @@ class CSWGrdCalc
 
     int               MedianFlag {0};
 
-    CSW_F             ZlocMin {1.e30f},
-                      ZlocMax {-1.e30f};
-
     CSW_F             CoincidentDistance {0.0};
 
     double            XOutputShift {0.0};
@@ -388,16 +574,47 @@ class CSWGrdCalc
 */
     int               FindDifferentZValue (CSW_F *x, CSW_F *y, CSW_F *z);
 
+    int               AllocateWorkSpace (void);
     int               SetupDataTable (int zflag, int first);
+    int               SetupPackedBuckets (void);
+    void              FreePackedBuckets (void);
+    int               SessionTablesUsable (void);
+    int               SessionTableKeyMatches (void);
+    int               LoadSessionTables (void);
+    void              SaveSessionTables (CSW_F *zin, int noisy_in);
+    int               LoadSessionEmptyArea (void);
+    void              SaveSessionEmptyArea (int anisotropy_in);
+    int               LoadSessionTrend (void);
+    void              SaveSessionTrend (int anisotropy_in,
+                                        CSW_F smoothing_in, CSW_F strike_in);
+    void              FreeSessionData (void);
     int               SetupDistanceTable (void);
     int               CollectLocalPoints
                          (int i, int j, int start, int end,
                           int maxquad, int maxloc,
-                          int *listout, int *nlist, int *nquad);
+                          int *listout, int *nlist, int *nquad,
+                          LOcalNodeWork *wk);
+    int               SearchLocalPoints
+                         (int i, int j, int start, int end,
+                          int maxquad, int maxloc,
+                          int *listout, int *nlist, int *nquad,
+                          LOcalNodeWork *wk);
+    void              StartSharedSearch (void);
+    int               ReplaySharedList
+                         (int i, int j, int start, int end,
+                          int maxquad, int maxloc,
+                          int *listout, int *nlist, int *nquad,
+                          LOcalNodeWork *wk);
+    void              RecordSharedList
+                         (int i, int j, int start, int end,
+                          int maxquad, int maxloc,
+                          int *listout, int nlist, int nquad,
+                          LOcalNodeWork *wk);
+    void              FreeSharedSearch (void);
     int               ProcessLocalPoints
                          (int *list, int nlist, int nquad,
                           int irow, int jcol, int cp,
-                          CSW_F *value);
+                          CSW_F *value, LOcalNodeWork *wk);
     int               HalfPlaneSwitch
                          (int ido,
                           CSW_F *xloc, CSW_F *yloc,
@@ -406,6 +623,15 @@ class CSWGrdCalc
                           CSW_F *xp, CSW_F *yp, CSW_F *zp,
                           CSW_F *ep, CSW_F *pdsq, int *npout);
     int               CalcLocalNodes (void);
+    int               CalcLocalNode
+                         (int irow, int jcol,
+                          int icrit, int fcrit, int ncmax, int nc2,
+                          int iendmax, int maxquad,
+                          CSW_F *value, LOcalNodeWork *wk);
+    int               CalcLocalNodesParallel
+                         (int nthreads,
+                          int icrit, int fcrit, int ncmax, int nc2,
+                          int iendmax, int maxquad);
     int               AssignTrendNodes (void);
     int               FillInCoarse (void);
     int               FillInPerimeter (void);
@@ -422,11 +648,14 @@ class CSWGrdCalc
     int               CalcErrorGrid (int iter);
     int               CalcErrorAtNode
                          (int irow, int jcol,
-                          int *list, int nlist, CSW_F *error);
+                          int *list, int nlist, CSW_F *error,
+                          LOcalNodeWork *wk);
     int               CalcFaultedErrorAtNode
                          (int irow, int jcol,
                           int *list, int nlist, CSW_F *error);
     int               CheckForBicub (int irow, int jcol);
+    int               IterationThreads (void);
+    static double     WallTime (void);
     int               MaskBadNodes (void);
     int               DivideRightBoundary (int start, int end);
     int               DivideLeftBoundary (int start, int end);
@@ -456,7 +685,8 @@ class CSWGrdCalc
     int               FilterPointsForStrike
                          (int *list1, int n1, int *list2, int *n2,
                           int nmax, int nquad, int irow, int jcol,
-                          CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2);
+                          CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+                          LOcalNodeWork *wk);
     int               CalcLocalAnisotropy (void);
 
     int               FreeMem (void);
@@ -545,7 +775,34 @@ class CSWGrdCalc
         int ncol, int nrow,
         CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
         GRidCalcOptions *options);
+    int grd_calc_grid_tiled
+       (CSW_F *x, CSW_F *y, CSW_F *z, int npts,
+        const char *filename, const char *comment,
+        int ncol, int nrow,
+        CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+        int tile_size, GRidCalcOptions *options);
     int grd_set_calc_option (int tag, int ival, CSW_F fval);
+    int grd_begin_calc_session (void);
+    int grd_end_calc_session (void);
+    int grd_begin_point_stream (int npts_hint);
+    int grd_add_point_chunk (CSW_F *x, CSW_F *y, CSW_F *z, int npts);
+    int grd_get_point_stream (CSW_F **x, CSW_F **y, CSW_F **z, int *npts,
+                              CSW_F *xmin, CSW_F *ymin,
+                              CSW_F *xmax, CSW_F *ymax);
+    int grd_calc_grid_from_stream
+       (CSW_F *err,
+        CSW_F *in_grid, char *in_mask, char **report,
+        int ncol, int nrow,
+        CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+        GRidCalcOptions *options);
+    int grd_end_point_stream (void);
+    int grd_calc_grid_multi
+       (CSW_F *x, CSW_F *y, CSW_F **zlist, int nattr, int npts,
+        CSW_F **grids, char **masks,
+        int ncol, int nrow,
+        CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+        GRidCalcOptions *options);
+    int grd_uses_saved_settings (void);
     int grd_set_calc_options (GRidCalcOptions *options);
     int grd_default_calc_options (GRidCalcOptions *options);
     int grd_smooth_plateau_grid
@@ -49,6 +49,14 @@
 
 #define DUPLICATE_FAULT            -113
 
+/*
+    Limits for the cache of fault index grids.  The cache is used
+    when several grids are calculated with the same faults and the
+    same grid geometry.
+*/
+#define MAX_FAULT_INDEX_CACHE      16
+#define FAULT_INDEX_CACHE_BYTES    100000000L
+
 
 /*
     define structures used only in this class
@@ -94,6 +102,26 @@ typedef struct {
                y;
 }  ENdPoint;
 
+typedef struct {
+    unsigned long long  hash;
+    int        ncol,
+               nrow,
+               extent,
+               nvec,
+               nlink;
+    CSW_F      x1,
+               y1,
+               x2,
+               y2;
+    FAultVector     *vectors;
+    char            *crossings;
+    int             *closest;
+    int             *index_grid;
+    FAultIndexLink  *links;
+    long       nbytes;
+    long       stamp;
+}  FAultIndexCache;
+
 
 class CSWGrdFault;
 
@@ -116,7 +144,7 @@ class CSWGrdFault
   public:
 
     CSWGrdFault () {};
-    ~CSWGrdFault () {};
+    ~CSWGrdFault () {grd_free_fault_index_cache ();};
 
 // It makes no sense to copy construct, move construct,
 // assign or move assign an object of this class.  The
@@ -240,6 +268,12 @@ class CSWGrdFault
 
     int               *VecNumWork = NULL;
 
+    FAultIndexCache   IndexCache[MAX_FAULT_INDEX_CACHE];
+    int               NumIndexCache = 0;
+    long              IndexCacheBytes = 0;
+    long              IndexCacheLimit = FAULT_INDEX_CACHE_BYTES;
+    long              IndexCacheStamp = 0;
+
 
     int               Ncheck1 = 0,
                       Ncheck2 = 0;
@@ -259,6 +293,12 @@ class CSWGrdFault
     int BuildRowIndex (void);
     int BuildCellIndex (void);
     int BuildDistanceTable (void);
+    int BuildIndexGrids (void);
+    unsigned long long IndexCacheHash (void);
+    int FindCachedIndices (unsigned long long hash);
+    int RestoreCachedIndices (int ientry);
+    int SaveCachedIndices (unsigned long long hash);
+    void RemoveCachedIndices (int ientry);
     int SetColumnCrossingForVector
         (CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2, int n);
     int SetRowCrossingForVector
@@ -362,6 +402,8 @@ class CSWGrdFault
                                       CSW_F ymax);
     int grd_free_faults (void);
     int grd_free_fault_indices (void);
+    int grd_set_fault_index_cache_size (long nbytes);
+    void grd_free_fault_index_cache (void);
     int grd_check_fault_blocking
        (int irow, int jcol,
         CSW_F x2, CSW_F y2, CSW_F *weight);
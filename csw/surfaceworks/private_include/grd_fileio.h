@@ -70,6 +70,27 @@
 #define NULL_INT_READ       19000000
 
 
+/*
+    State used while a grid file is written a band of tiles at a time.
+    Each band of tiles is put together in the band scratch file.  Full
+    rows from finished bands are appended to the row scratch file.  The
+    grid file itself is only written at the end, when the z range of
+    the whole grid is known.
+*/
+typedef struct {
+    int        active;
+    int        band_file;
+    int        row_file;
+    int        ncol, nrow;
+    int        band_rows;
+    int        rows_done;
+    int        gridtype;
+    double     xmin, ymin, xmax, ymax;
+    double     zmin, zmax;
+    char       filename[500];
+    char       comment[COMMENT_SIZE];
+}  TIledFileStruct;
+
 class CSWGrdFileio;
 
 #include "csw/surfaceworks/private_include/grd_fault.h"
@@ -90,7 +111,7 @@ class CSWGrdFileio
   public:
 
     CSWGrdFileio () {};
-    ~CSWGrdFileio () {};
+    ~CSWGrdFileio () {grd_end_tiled_file (0);};
 
 // It makes no sense to copy construct, move construct,
 // assign or move assign an object of this class.  The
@@ -138,6 +159,16 @@ class CSWGrdFileio
                           int*, int*,
                           double*, double*, double*, double*, int*,
                           FAultLineStruct**, int*);
+    int    grd_begin_tiled_file (const char *filename, const char *comment,
+                                 int ncol, int nrow,
+                                 double xmin, double ymin,
+                                 double xmax, double ymax,
+                                 int gridtype, int band_rows);
+    int    grd_put_tiled_block (CSW_F *block, char *mask,
+                                int bcol, int brow, int col0);
+    int    grd_end_tiled_band (int nrows);
+    int    grd_end_tiled_file (int write_flag);
+
     int    grd_write_multiple_file (char*, GRidFileRec*, int);
     int    grd_read_multiple_file (char*, GRidFileRec*, int);
     int    grd_clean_file_rec_list (GRidFileRec *list, int nlist);
@@ -223,6 +254,8 @@ class CSWGrdFileio
 
     int         FilePos[GRD_MAX_MULTI_FILES];
 
+    TIledFileStruct  Tiled {};
+
 /*
     Old file static functions become private class methods.
 */
@@ -240,6 +273,14 @@ class CSWGrdFileio
                            double xmin, double ymin,
                            double xmax, double ymax,
                            int gridtype);
+    int         WriteGridHeader (int filenum, int fileptr, const char *comment,
+                                 int ncol, int nrow,
+                                 double xmin, double ymin,
+                                 double xmax, double ymax,
+                                 int gridtype, double zmin, double zmax,
+                                 double *scalezmin, double *zscale);
+    int         WriteGridValues (int filenum, CSW_F *grid, char *mask,
+                                 int nval, double scalezmin, double zscale);
     int         ReadGrid (int filenum, int fileptr, char *comment,
                           CSW_F **grid, char **mask,
                           int *ncol, int *nrow, 
@@ -0,0 +1,119 @@
+
+/*
+         ************************************************
+         *                                              *
+         *    Copyright (1997-2017) Glenn Pinkerton.    *
+         *    All rights reserved.                      *
+         *                                              *
+         ************************************************
+*/
+
+/*
+    grd_simd.h
+
+    Define the CSWGrdSimd class, which has the element by element
+    kernels used in the inner loops of the gridding calculations.
+*/
+
+
+/*
+    If an application attempts to include this file, an error is displayed
+    at compile time.  This is a private header file, which the application
+    should not need.  If the application defines the macro PRIVATE_HEADERS_OK,
+    then it can use this file.  Application programmers should be very careful
+    in bypassing private header security in this fashion.
+*/
+#ifndef PRIVATE_HEADERS_OK
+#error Illegal attempt to include private header file grd_simd.h.
+#endif
+
+
+/*
+    Add nothing above this line
+*/
+#ifndef GRD_SIMD_H
+#  define GRD_SIMD_H
+
+#include "csw/utils/include/csw_.h"
+
+/*
+ * Instruction set levels used by the kernels.
+ */
+#define GRD_SIMD_SCALAR          0
+#define GRD_SIMD_SSE2            1
+#define GRD_SIMD_AVX2            2
+
+/*
+ * Size of the scratch arrays that callers use when they feed
+ * the kernels a chunk of points at a time.
+ */
+#define GRD_SIMD_CHUNK           256
+
+
+/*
+ *  The CSWGrdSimd class only has static methods.
+ *
+ *  Each method works on every element of its input arrays
+ *  independently and writes one output value per element.
+ *  None of them do sums or other reductions, so the caller
+ *  can do those in the original order and get exactly the
+ *  same results whether the kernel ran with AVX2, SSE2 or
+ *  plain scalar code.  No fused multiply add is used for
+ *  the same reason.
+ *
+ *  The instruction set is picked once, at the first call.
+ *  SSE2 is used where the compiler has it.  Setting the
+ *  CSW_SIMD_LEVEL environment variable to "scalar" uses the
+ *  plain code, and setting it to "avx2" uses the AVX2 code
+ *  if the cpu supports it.  This is useful when comparing
+ *  results or speeds (see grd_simd_bench.cc).
+ */
+class CSWGrdSimd
+{
+
+  public:
+
+    static int Level (void);
+
+/*
+ * dt = x * x + y * y, raised to dpower / 2 using the same
+ * overflow limits as grd_inverse_distance_average.
+ */
+    static void DistancePowers (const CSW_F *x, const CSW_F *y,
+                                int n, int dpower, CSW_F *dt);
+
+/*
+ * x -= x0 and y -= y0 in place.
+ */
+    static void Reorigin (CSW_F *x, CSW_F *y, int n,
+                          CSW_F x0, CSW_F y0);
+
+/*
+ * dist = sqrt (x * x + y * y)
+ */
+    static void Distances (const CSW_F *x, const CSW_F *y,
+                           int n, double *dist);
+
+/*
+ * Squared residual between the plane defined by coef and each
+ * z value, with the same tiny value snapping as ProcessLocalPoints.
+ */
+    static void PlaneResiduals (const CSW_F *coef,
+                                const CSW_F *x, const CSW_F *y,
+                                const CSW_F *z, int n,
+                                CSW_F tiny_value, CSW_F tiny_value_2,
+                                CSW_F *res);
+
+/*
+ * Clamp the perpendicular squared distances in st0 in place and
+ * put the strike weight for each into wgt, as StrikeAverage needs.
+ */
+    static void StrikeWeights (CSW_F *st0, int n, CSW_F spower,
+                               CSW_F tiny, CSW_F *wgt);
+
+};
+
+/*
+    Add nothing to this file below the following endif
+*/
+#endif
@@ -46,6 +46,7 @@
 #define MAX_ITER_TRI                  100
 #define CORNER_POINT                  99
 #define TRI_INDEX_CHUNK               6
+#define TRI_EDGE_LIST_SLACK           4
 #define CORNER_BIAS                   2.0
 
 #define MAXLIST                       100
@@ -72,6 +73,14 @@
 
 #define _MAX_ADD_REM_                 2000
 
+#define TRI_STRIP_MIN_POINTS          1000
+#define TRI_STRIP_MAX_SWAP_PASS       50
+#define TRI_STRIP_MAX_REMOVE_TRY      3
+
+#define TRI_ADAPTIVE_MAX_PASS         6
+
+#define TRI_NORMAL_BLOCK_SIZE         10000
+
 
 /*
     Define structures used only in this class.
@@ -171,6 +180,107 @@ typedef struct {
 
 
 class CSWGrdTriangle;
+class CSWPolyUtils;
+
+/*
+    The points are triangulated in vertical strips when more than one
+    thread is used.  Each strip is done by its own CSWGrdTriangle object.
+    The raw point, node, edge and triangle maps are used to put each
+    strip back into the full trimesh.
+*/
+typedef struct {
+    CSWGrdTriangle  *tri;
+    int             *rawmap = NULL,
+                    *nodemap = NULL,
+                    *edgemap = NULL;
+    int             nraw,
+                    nleft,
+                    nright;
+    int             nnode,
+                    nedge,
+                    nnew;
+    int             nodebase,
+                    edgebase,
+                    tribase,
+                    rawbase;
+    int             status;
+}  TRiStripStruct;
+
+/*
+    The nodes shared by adjacent strips are all on the vertical
+    seam lines between the strips.  The nodes on seam k are
+    seamfirst[k] through seamfirst[k+1]-1, sorted by y.  The
+    seamraw value is -1 for a node that is not at a raw point.
+    The seamx value is the x of the raw point before it was
+    moved onto the seam.
+*/
+typedef struct {
+    int             nstrip;
+    double          *stripx = NULL;
+    double          ymin,
+                    ymax,
+                    band;
+    int             *seamfirst = NULL;
+    double          *seamx = NULL,
+                    *seamy = NULL,
+                    *seamz = NULL;
+    int             *seamraw = NULL;
+    int             nseam,
+                    nart;
+    int             *rawstrip = NULL,
+                    *rawseam = NULL,
+                    *rawlocal = NULL;
+    int             *chaintri = NULL;
+    int             nchain;
+    int             nold;
+    TRiStripStruct  *strips = NULL;
+}  TRiStripSet;
+
+/*
+    A trimesh edit session keeps its own copy of the trimesh between
+    edit calls.  Deleted elements stay in the lists, flagged as deleted,
+    until the session is ended.  The nodetri array has a triangle that
+    uses each node, which is where searches around the node start.  The
+    freetri and freeedge lists have deleted slots for later edits to
+    reuse.  The changed list has the triangles made or modified by the
+    most recent edit.  The star lists are work space for the triangles
+    and the ring of nodes around a node.  Nodes never move outside of
+    the original bounding box, so points outside of it can be rejected
+    without searching the triangles.
+*/
+typedef struct {
+    int             active;
+    NOdeStruct      *nodes = NULL;
+    EDgeStruct      *edges = NULL;
+    TRiangleStruct  *tris = NULL;
+    int             numnodes,
+                    numedges,
+                    numtris,
+                    maxnodes,
+                    maxedges,
+                    maxtris;
+    int             *nodetri = NULL;
+    int             maxnodetri;
+    int             *freetri = NULL,
+                    *freeedge = NULL;
+    int             nfreetri,
+                    maxfreetri,
+                    nfreeedge,
+                    maxfreeedge;
+    int             *changed = NULL;
+    int             nchanged,
+                    maxchanged;
+    int             *startri = NULL,
+                    *starring = NULL;
+    int             maxstartri,
+                    maxstarring;
+    int             lasttri;
+    double          perimeter;
+    double          xmin,
+                    ymin,
+                    xmax,
+                    ymax;
+}  TRiEditStruct;
 
 #include "csw/surfaceworks/private_include/grd_utils.h"
 #include "csw/surfaceworks/private_include/grd_fault.h"
@@ -194,7 +304,7 @@ class CSWGrdTriangle
   public:
 
     CSWGrdTriangle () {};
-    ~CSWGrdTriangle () {};
+    ~CSWGrdTriangle () {FreeEditSession ();};
 
 // It makes no sense to copy construct, move construct,
 // assign or move assign an object of this class.  The
@@ -278,6 +388,31 @@ return 1;
         int             num_edges,
         TRiangleStruct  *tris,
         int             num_tris);
+    int grd_calc_trimesh_normal_arrays (
+        NOdeStruct      *nodes,
+        int             num_nodes,
+        EDgeStruct      *edges,
+        int             num_edges,
+        TRiangleStruct  *tris,
+        int             num_tris,
+        double          *tnx,
+        double          *tny,
+        double          *tnz,
+        double          *nnx,
+        double          *nny,
+        double          *nnz);
+    void grd_sum_node_normals (
+        int             num_nodes,
+        EDgeStruct      *edges,
+        TRiangleStruct  *tris,
+        int             num_tris,
+        double          *tnx,
+        double          *tny,
+        double          *tnz,
+        double          *nnx,
+        double          *nny,
+        double          *nnz,
+        int             *ncount);
     int grd_free_trimesh_normals (
         NOdeStruct      *nodes,
         int             num_nodes,
@@ -308,6 +443,14 @@ return 1;
     void grd_unset_trimesh (void);
 
     void grd_set_dont_do_eq (int ival);
+    void grd_set_trimesh_insertion (int ival);
+    void grd_set_trimesh_threads (int ival);
+    int grd_get_trimesh_threads (void);
+    void grd_set_bulk_constraints (int ival);
+    void grd_set_adaptive_grid_tolerance (double dval);
+    void grd_set_trimesh_validation (int ival);
+    void grd_get_trimesh_validation_times (double *topo_time,
+                                           double *full_time);
 
     void setZisAttribute (int ival);
 
@@ -351,6 +494,27 @@ return 1;
                                        EDgeStruct **edgelist, int *numedges,
                                        TRiangleStruct **trilist, int *numtris,
                                        int *nodes_to_delete, int num_nodes_to_delete);
+
+    int grd_begin_trimesh_edit (NOdeStruct *nodes, int numnodes,
+                                EDgeStruct *edges, int numedges,
+                                TRiangleStruct *tris, int numtris);
+    int grd_end_trimesh_edit (NOdeStruct **nodes_out, int *numnodes_out,
+                              EDgeStruct **edges_out, int *numedges_out,
+                              TRiangleStruct **tris_out, int *numtris_out);
+    int grd_get_trimesh_edit (NOdeStruct **nodes_out, int *numnodes_out,
+                              EDgeStruct **edges_out, int *numedges_out,
+                              TRiangleStruct **tris_out, int *numtris_out);
+    int grd_edit_insert_node (double x, double y, double z, int *nodenum,
+                              int **changed, int *nchanged);
+    int grd_edit_delete_node (int nodenum, int **changed, int *nchanged);
+    int grd_edit_move_node (int nodenum, double x, double y, double z,
+                            int **changed, int *nchanged);
+    int grd_edit_insert_segment (double x1, double y1, double z1,
+                                 double x2, double y2, double z2,
+                                 int flag, int *node1, int *node2,
+                                 int **changed, int *nchanged);
+    int grd_edit_delete_segment (int node1, int node2,
+                                 int **changed, int *nchanged);
     int grd_pointer_grid_to_trimesh
                             (void**, int, int,
                              double, double, double, double,
@@ -385,6 +549,12 @@ return 1;
                                     CSW_F*, int, int,
                                     double, double, double, double);
 
+    int grd_build_compact_trimesh (NOdeStruct*, int,
+                                   EDgeStruct*, int,
+                                   TRiangleStruct*, int,
+                                   COmpactTriMesh*);
+    void grd_free_compact_trimesh (COmpactTriMesh*);
+
     int grd_calc_trimesh_bounding_box (NOdeStruct*, int,
                                        EDgeStruct*, int,
                                        TRiangleStruct*, int,
@@ -690,6 +860,15 @@ return 1;
                              int *num_nodes_out, int *num_edges_out,
                              int *num_triangles_out);
 
+    int grd_adaptive_tri_mesh_from_grid (CSW_F *grid, int ncol, int nrow,
+                             double xmin, double ymin, double xmax, double ymax,
+                             double *xlines, double *ylines, double *zlines,
+                             int *line_pts, int *line_types, int nlines,
+                             double ztol,
+                             NOdeStruct **nodes, int *num_nodes,
+                             EDgeStruct **edges, int *num_edges,
+                             TRiangleStruct **triangles, int *num_triangles);
+
   private:
 
 
@@ -702,11 +881,52 @@ return 1;
 
     int                  DontDoEquilateral = 0;
 
+/*
+    GRD_SORTED_INSERTION inserts the points in Hilbert curve order
+    and walks to each containing triangle.  GRD_SUBDIVIDE_INSERTION
+    is the original one point per triangle subdivision.
+*/
+    int                  InsertionMethod = GRD_SUBDIVIDE_INSERTION;
+    int                  *NodeSwapStack = NULL;
+    int                  MaxNodeSwapStack = 0;
+
+/*
+    If TriMeshThreads is not zero, grd_calc_trimesh splits the points
+    into vertical strips and triangulates each strip on its own thread.
+    The triangle dip and trimesh normal calculations also use this many
+    threads.  A negative value uses one thread per core.
+*/
+    int                  TriMeshThreads = 0;
+
+/*
+    If BulkConstraintFlag is set, the zero area triangles left after the
+    constraint lines are added are removed in sweeps over all triangles
+    rather than starting over after each one is removed.
+*/
+    int                  BulkConstraintFlag = 0;
+
+/*
+    Vertical tolerance used by grd_calc_tri_mesh_from_grid for the
+    GRD_ADAPTIVE style.  Zero or less uses a thousandth of the z range.
+*/
+    double               AdaptiveGridTolerance = 0.0;
+
+    TRiEditStruct        EditSession {};
+
     int                  ListNullNeeded = 0;
 
     int                  RemoveZeroFlag = 1;
     int                  RemoveNodeForZeroAreaFlag = 0;
 
+/*
+    The exact orientation tests count the triangles they find with
+    exactly zero area, and RemoveZeroLengthEdges counts the edges it
+    collapses.  If both counts are zero after an unconstrained
+    triangulation, it is valid by construction and the zero area
+    triangle cleanup is skipped.
+*/
+    int                  NumZeroArea = 0;
+
     int                  OutsidePointAdjust = 0;
 
     TRiangleIndexListStruct  *TriIndexList = NULL;
@@ -827,6 +1047,7 @@ return 1;
     int                  GridNrow = 0;
 
     double               StaticCriticalDistance = -1.0;
+    int                  ExistingNodeAnchor = -1;
     int                  Orignt1,
                          Orignt2;
 
@@ -891,6 +1112,14 @@ return 1;
     NOdeEdgeListStruct   *NodeEdgeList = NULL;
     int                  NumNodeEdgeList = 0;
 
+/*
+    The raw point edge lists made by BuildRawPointEdgeLists are
+    carved out of this block.  A list that outgrows its space in
+    the block is moved to its own memory.
+*/
+    int                  *EdgeListArena = NULL;
+    int                  MaxEdgeListArena = 0;
+
     int                  *PolySegs = NULL;
     POlygonStruct        *PolygonList = NULL;
     int                  NumPolygons,
@@ -924,6 +1153,14 @@ return 1;
 
     int                  ForceValidate = 0;
 
+/*
+    ValidationLevel selects the checks done on a calculated trimesh.
+    The wall clock seconds spent in the checks at each level since the
+    level was last set are added up in ValidateTimes.
+*/
+    int                  ValidationLevel = GRD_VALIDATE_NONE;
+    double               ValidateTimes[3] = {0.0, 0.0, 0.0};
+
     int                  Nsearch = 0,
                          Ntpt = 0;
 
@@ -1065,10 +1302,21 @@ return 1;
     void PrintRidgeNodes (int ridgenum);
 
     void ValidateEdgeIntersection (const char *msg);
+    int CheckEdgePair (int i, int j, double ztiny,
+                       CSWPolyUtils *ply_utils_ptr);
+    int ValidateAtLevel (int level);
+    double WallTime (void);
     void ValidateConstraints (void);
     void ValidateExactConstraints (void);
     void ValidateTriangles (char *msg);
     void ValidateTriangleShapes (void);
+    void ValidateStripTriangulation (double *xpts, double *ypts,
+                                     double *zpts, int npts,
+                                     double *xlines, double *ylines,
+                                     double *zlines, int *linepoints,
+                                     int *lineflags, int nlines);
+    double TriMeshArea (NOdeStruct *nodes, EDgeStruct *edges,
+                        TRiangleStruct *tris, int ntri);
 
     int CreateTriangleIndexGrid (void);
     int AddToIndexGrid (int start, int end);
@@ -1105,7 +1353,60 @@ return 1;
     int SplitTriangle (int, int);
     int SplitTriangleXYZ (int triangle_num,
                           double xp, double yp, double zp);
+    int CheckEdgeSplit (int edgenum, int trinum, int nodenum);
     int SubdivideTriangles (void);
+    int InsertSortedPoints (int *nleft);
+    int WalkToTriangle (double x, double y, int trinum);
+    int SwapAroundNode (int nodenum, int trinum);
+    int PushSwapEdge (int edgenum, int *nstack);
+    double HilbertKey (double x, double y);
+    int StartCornerTriangles (int rc1);
+    int EstimateConstraintNodes (int rc1);
+    int TriangulateInStrips (int rc1);
+    int ChooseStripSeams (TRiStripSet *ss);
+    int FindSeamNodes (TRiStripSet *ss);
+    double NearestIndexZ (double x, double y);
+    int LoadStripPoints (TRiStripSet *ss, int istrip);
+    int TriangulateStrip (void);
+    int MapStripTopology (TRiStripSet *ss, int istrip);
+    int MergeStrips (TRiStripSet *ss);
+    void CopyStripTopology (TRiStripSet *ss, int istrip);
+    void FinishStripMerge (TRiStripSet *ss);
+
+    void FreeEditSession (void);
+    void LoadEditLists (void);
+    int SaveEditLists (void);
+    int EditGrowList (int **list, int *maxlist, int needed);
+    int EditAddChanged (int trinum);
+    int EditFinishChanged (int **changed, int *nchanged);
+    int EditNewEdge (void);
+    int EditNewTriangle (void);
+    int EditFreeEdge (int edgenum);
+    int EditFreeTriangle (int trinum);
+    void EditTriangleNodes (int trinum, int *nodes);
+    double EditOrient (int n1, int n2, int n3);
+    double EditInCircle (int n1, int n2, int n3, int n4);
+    int EditLocate (double x, double y);
+    int EditNodeTriangle (int nodenum);
+    int EditNodeStar (int nodenum, int *nstar, int *closed);
+    int EditFindEdge (int n1, int n2);
+    int EditInsertNode (double x, double y, double z, int *nodenum);
+    int EditDeleteNode (int nodenum);
+    int EditRecoverSegment (int n1, int n2, int flag);
+    int EditEarClip (int *poly, int npoly, int keep,
+                     int *tnodes, int *ntri);
+    void EditPseudoPolygon (int n1, int n2, int *chain, int nchain,
+                            int *tnodes, int *ntri);
+    int EditFillCavity (int *deltris, int ndeltri,
+                        int *deledges, int ndeledge,
+                        int *bedges, int nbedge,
+                        int *tnodes, int ntri,
+                        int *newedges, int *nnewedge);
+    int EditSwapEdges (int *seeds, int nseeds);
+    int RemoveSeamNodes (TRiStripSet *ss);
+    void RestoreSeamNodes (TRiStripSet *ss);
+    int SeamNodeNumber (TRiStripSet *ss, int iseam, int ipos);
+    void FreeStripSet (TRiStripSet *ss);
     int FreeMem (void);
     void ListNull (void);
     int AddNode (double, double, double, int);
@@ -1118,6 +1419,8 @@ return 1;
     int BuildRawPointEdgeLists (void);
     int BuildNodeEdgeLists (void);
     int AddEdgeToRawPoint (RAwPointStruct*, int);
+    int GrowRawPointEdgeList (RAwPointStruct*, int);
+    void FreeRawPointEdgeList (RAwPointStruct*);
     int ApplyConstraints (void);
 
     int CompressRawLines (void);
@@ -1166,7 +1469,8 @@ return 1;
     void RemoveZeroAreaTriangles (void);
     int FindMiddleNode (int n1, int n2, int n3);
     int  CheckZeroAreaTriangle (int index);
-    void RemoveZeroAreaTriangle (int tnum);
+    int RemoveZeroAreaTriangle (int tnum);
+    void RemoveZeroAreaTrianglesBulk (void);
 
     double CalcEquilateralness (int n1, int n2, int n3);
     int NodeOnSegment (int nchk, int n1, int n2, double *dperp);
@@ -1217,6 +1521,7 @@ return 1;
     int BuildInitialDrainageEdgeList (void);
     int CleanInitialDrainageEdgeList (void);
     int AddToNodeEdgeList (int edgenum, int nodenum);
+    void FreeNodeEdgeListEntry (NOdeEdgeListStruct *nptr);
     int RemoveFromNodeEdgeList (int edgenum, int nodenum);
     int AddNodeToRidgeLine (RIdgeLineStruct *rptr, int nodenum);
     int PrependNodeToRidgeLine (RIdgeLineStruct *rptr, int nodenum);
@@ -1310,8 +1615,29 @@ return 1;
 
     int IsConstraintPoint (double x, double y,
                            double *xl, double *yl, int nltot);
+    void FlagConstraintPoints (double *xpts, double *ypts, int npts,
+                               double *xl, double *yl, int nltot,
+                               char *flags);
     int AdjustForConstraintPoints (void);
 
+    int AdaptiveLineCells (double *xlines, double *ylines,
+                           int *line_pts, int nlines,
+                           int ncol, int nrow,
+                           double xmin, double ymin,
+                           double xspace, double yspace,
+                           int **cells_out, int *ncells_out);
+    int AdaptiveBlockOK (CSW_F *grid, int ncol,
+                         int c0, int r0, int c1, int r1,
+                         double ztol,
+                         int *faultcells, int nfault);
+    int AdaptiveWorstNodes (CSW_F *grid, int ncol, int nrow,
+                            double xmin, double ymin,
+                            double xspace, double yspace,
+                            double ztol,
+                            NOdeStruct *nodes, EDgeStruct *edges,
+                            TRiangleStruct *tris, int ntri,
+                            int *used, int nused);
+
     int SplitLongEdges (void);
 
     int CheckTriangleNodeGraze (int itri, double x, double y);
@@ -1357,6 +1683,8 @@ return 1;
                           double *z);
 
     void TriangleNormal (double *x, double *y, double *z);
+    void TriangleNormalValues (double *x, double *y, double *z,
+                               double *nx, double *ny, double *nz);
     int CalcNodeNormals (void);
 
     void CleanupTriNormals (void);
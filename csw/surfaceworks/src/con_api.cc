@@ -370,6 +370,155 @@ int CSWContourApi::con_CalcContours
 
 
 
+/*
+  ****************************************************************
+
+                 c o n _ S t r e a m C o n t o u r s
+
+  ****************************************************************
+
+  function name:  con_StreamContours            (int)
+
+  call sequence:  con_StreamContours (grid, ncol, nrow,
+                                      x1, y1, x2, y2, scale,
+                                      func, client_data,
+                                      faults, nfaults,
+                                      options)
+
+  purpose:        Calculate contour lines the same way as con_CalcContours,
+                  but pass each contour line to an application function as
+                  soon as it is finished instead of returning an array of
+                  all the lines.  This lets the application draw or write
+                  the contours as they are calculated, without the memory
+                  for a complete contour array.
+
+                  The contour record and its points passed to the function
+                  are only valid during the function call.  The application
+                  must copy anything it needs to keep, and it must not free
+                  the points.  The function should return -1 to stop the
+                  calculation or any other value to continue.
+
+                  When the levels are traced on more than one thread (see
+                  the num_threads option), the contours are passed to the
+                  function in level order after all levels are traced.
+                  Contours of a faulted grid are calculated using a trimesh,
+                  and they are also passed to the function after all of
+                  them have been calculated.
+
+  return value:   status code
+
+                  1 = success
+                 -1 = error
+
+  errors:         The same as con_CalcContours, except that error 5 means
+                  that func is NULL, plus:
+
+                  14 = The output function returned -1 to stop the
+                       calculation.
+
+  calling parameters:
+
+    grid          r   CSW_F*            2-d grid array of elevations
+    ncol          r   int               number of columns in the grid
+    nrow          r   int               number of rows in the grid
+    x1            r   CSW_F             x coordinate of the lower left
+                                        corner of the grid
+    y1            r   CSW_F             y coordinate of lower left
+    x2            r   CSW_F             x of upper right
+    y2            r   CSW_F             y of upper right
+    scale         r   CSW_F             scale in grid units per inch or 0.0
+                                        if scaling is not known.
+    func          r   CONTOUR_OUTPUT_FUNC  Function to call with each
+                                        finished contour line.
+    client_data   r   void*             Pointer passed to each func call.
+    faults        r   FAultLineStruct*  Optional fault lines.
+    nfaults       r   int               Number of fault lines.
+    options       r  COntourCalcOptions*  Optional Contour calc options structure.
+
+*/
+
+int CSWContourApi::con_StreamContours
+                     (CSW_F *grid, int ncol, int nrow,
+                      CSW_F x1, CSW_F y1,
+                      CSW_F x2, CSW_F y2, CSW_F scale,
+                      CONTOUR_OUTPUT_FUNC func, void *client_data,
+                      FAultLineStruct *faults, int nfaults,
+                      COntourCalcOptions *options)
+{
+    int               i, istat;
+    COntourOutputRec  *contours = NULL;
+    int               ncontours = 0;
+
+    auto fscope = [&]()
+    {
+        con_calc_obj.con_set_output_func (NULL, NULL, 0.0, 0.0);
+        con_FreeContours (contours, ncontours);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    if (func == NULL) {
+        grd_utils_obj.grd_set_err (5);
+        if (options) {
+            options->error_number = 5;
+        }
+        return -1;
+    }
+
+/*
+ * Faulted grids are contoured using a trimesh, which
+ * only returns a complete list of contours.
+ */
+    if (faults  &&  nfaults > 0) {
+        istat = con_CalcContours (grid, ncol, nrow,
+                                  x1, y1, x2, y2, scale,
+                                  &contours, &ncontours,
+                                  faults, nfaults,
+                                  options);
+        if (istat == -1) {
+            return -1;
+        }
+        for (i=0; i<ncontours; i++) {
+            istat = func (contours + i, client_data);
+            if (istat == -1) {
+                grd_utils_obj.grd_set_err (14);
+                if (options) {
+                    options->error_number = 14;
+                }
+                return -1;
+            }
+        }
+        return 1;
+    }
+
+    if ((faults && nfaults<1)  ||  (!faults && nfaults>0)) {
+        grd_utils_obj.grd_set_err (11);
+        return -1;
+    }
+
+    istat = csw_CheckRange2 (x1, y1, x2, y2);
+    if (istat == 0) {
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    con_calc_obj.con_set_output_func (func, client_data, 0.0, 0.0);
+
+    istat = con_calc_obj.con_calc_contours
+                          (grid, ncol, nrow,
+                           x1, y1, x2, y2, scale,
+                           NULL, NULL, options);
+
+    if (istat == -1  &&  options) {
+        options->error_number = con_GetErr ();
+    }
+
+    return istat;
+
+}  /*  end of function con_StreamContours  */
+
+
+
+
 
 /*
   ****************************************************************
@@ -1340,6 +1489,133 @@ int CSWContourApi::con_CalcContoursFromDouble
 
 
 
+/*
+  ****************************************************************
+
+        c o n _ S t r e a m C o n t o u r s F r o m D o u b l e
+
+  ****************************************************************
+
+  function name:  con_StreamContoursFromDouble    (int)
+
+  call sequence:  con_StreamContoursFromDouble
+                                   (grid, ncol, nrow,
+                                    x1, y1, x2, y2, scale,
+                                    func, client_data,
+                                    faults, nfaults,
+                                    options)
+
+  purpose:        Stream contour lines to an application function the
+                  same way as con_StreamContours, with double precision
+                  grid limits.  This is almost identical to
+                  con_CalcContoursFromDouble.  The contours are calculated
+                  relative to the lower left corner of the grid, and each
+                  line is shifted back to the true coordinates before it
+                  is passed to func.
+
+  return value:   status code
+
+                  1 = success
+                 -1 = error
+
+  errors:         The same as con_StreamContours.
+
+  calling parameters:
+
+    The same as con_StreamContours, except that x1, y1, x2 and y2
+    are double values.
+
+*/
+
+int CSWContourApi::con_StreamContoursFromDouble
+                     (CSW_F *grid, int ncol, int nrow,
+                      double x1, double y1, double x2, double y2, CSW_F scale,
+                      CONTOUR_OUTPUT_FUNC func, void *client_data,
+                      FAultLineStruct *faults, int nfaults,
+                      COntourCalcOptions *options)
+{
+    int               istat, i, j, nt;
+    CSW_F             xt1, yt1, xt2, yt2;
+    FAultLineStruct   *fp;
+    POint3D           *p3d;
+
+    auto fscope = [&]()
+    {
+        con_calc_obj.con_set_output_func (NULL, NULL, 0.0, 0.0);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    if (func == NULL) {
+        grd_utils_obj.grd_set_err (5);
+        if (options) {
+            options->error_number = 5;
+        }
+        return -1;
+    }
+
+/*
+ *  If faults are present, shift them to origin at
+ *  the lower left of the grid.
+ */
+    if (faults && nfaults > 0) {
+        for (i=0; i<nfaults; i++) {
+            fp = faults + i;
+            p3d = fp->points;
+            nt = fp->num_points;
+            for (j=0; j<nt; j++) {
+                p3d[j].x -= x1;
+                p3d[j].y -= y1;
+            }
+        }
+    }
+
+    grd_triangle_obj.get()->grd_set_shifts_for_debug (x1, y1);
+
+    xt1 = 0.0f;
+    yt1 = 0.0f;
+    xt2 = (CSW_F)(x2 - x1);
+    yt2 = (CSW_F)(y2 - y1);
+
+/*
+ *  The contour points are shifted back to true
+ *  coordinates as each contour is streamed.
+ */
+    con_calc_obj.con_set_output_func (func, client_data, x1, y1);
+
+    istat = con_calc_obj.con_calc_contours
+                             (grid, ncol, nrow,
+                              xt1, yt1, xt2, yt2, scale,
+                              NULL, NULL,
+                              options);
+
+/*
+ *  If faults are present, shift them back to the proper origin
+ */
+    if (faults && nfaults > 0) {
+        for (i=0; i<nfaults; i++) {
+            fp = faults + i;
+            p3d = fp->points;
+            nt = fp->num_points;
+            for (j=0; j<nt; j++) {
+                p3d[j].x += x1;
+                p3d[j].y += y1;
+            }
+        }
+    }
+
+    if (istat == -1  &&  options) {
+        options->error_number = con_GetErr ();
+    }
+
+    grd_triangle_obj.get()->grd_set_shifts_for_debug (0.0, 0.0);
+
+    return istat;
+
+}  /*  end of function con_StreamContoursFromDouble  */
+
+
+
+
 
 
 
@@ -2089,3 +2365,86 @@ COntourOutputRec* CSWContourApi::con_CopyOutputRec (COntourOutputRec *cp)
 
     return cp2;
 }
+
+
+
+/*
+ *************************************************************************
+
+              c o n _ B u i l d C o n t o u r P y r a m i d
+
+ *************************************************************************
+
+  Build a level of detail pyramid from a set of contour lines, usually
+  the lines returned by con_CalcContours or con_CalcTriMeshContours.
+  Level zero is a copy of the input lines.  Each coarser level keeps
+  every other contour level of the level below (counted from the first
+  major level) and thins its lines to twice the tolerance of the level
+  below.  Level k is thinned to half of spacing times 2 to the k power,
+  where spacing is the distance between points of the input lines,
+  usually the grid cell size.  A display can pick the coarsest level
+  whose tolerance is below its pixel size instead of contouring again.
+
+  All levels are returned in the pyramid array, which should be freed
+  with con_FreeContours.  The level_start array must have room for
+  nlevels + 1 values.  Level k is in pyramid[level_start[k]] up to,
+  but not including, pyramid[level_start[k+1]].
+
+  return value:   1 = success
+                 -1 = error
+
+  errors:         1 = memory allocation failure
+                  2 = NULL pointer or nlevels less than 1
+
+*/
+
+int CSWContourApi::con_BuildContourPyramid
+                              (COntourOutputRec *contours, int ncontours,
+                               CSW_F spacing, int nlevels,
+                               COntourOutputRec **pyramid, int *npyramid,
+                               int *level_start)
+{
+    int                    istat;
+
+    istat = con_calc_obj.con_build_contour_pyramid
+                                         (contours, ncontours,
+                                          spacing, nlevels,
+                                          pyramid, npyramid,
+                                          level_start);
+    return istat;
+
+}  /* end of function con_BuildContourPyramid */
+
+
+
+/*
+ *************************************************************************
+
+                c o n _ G e t C o n t o u r L e v e l s
+
+ *************************************************************************
+
+  Return the contour levels used by the most recent con_CalcContours or
+  con_CalcContoursFromDouble call on this object.  The lists are in the
+  same form as the minor_contours and major_contours arrays of the calc
+  options, so a part of the same grid can be contoured again later with
+  exactly the same levels, even when the interval was chosen automatically.
+  At most maxlevels values are put in each list.  Zero is returned if no
+  contours have been calculated yet.
+
+*/
+
+int CSWContourApi::con_GetContourLevels
+                              (CSW_F *minor, int *nminor,
+                               CSW_F *major, int *nmajor,
+                               int maxlevels)
+{
+    int                    istat;
+
+    istat = con_calc_obj.con_get_contour_levels
+                                         (minor, nminor,
+                                          major, nmajor,
+                                          maxlevels);
+    return istat;
+
+}  /* end of function con_GetContourLevels */
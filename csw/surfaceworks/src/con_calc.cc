@@ -22,8 +22,11 @@
 #include <math.h>
 #include <float.h>
 
+#include <algorithm>
+
 #include "csw/utils/include/csw_.h"
 #include "csw/utils/private_include/csw_scope.h"
+#include "csw/utils/private_include/csw_parallel.h"
 #include "csw/utils/private_include/ply_calc.h"
 
 #include "csw/utils/private_include/simulP.h"
@@ -68,6 +71,7 @@ int CSWConCalc::con_set_calc_option
             OptFaultedFlag = 0;
             OptContourResampleFlag = 1;
             OptContourThicknessFlag = 0;
+            OptContourNumThreads = 0;
             break;
 
         case CON_CONVERT_TO_LOG:
@@ -136,6 +140,10 @@ int CSWConCalc::con_set_calc_option
             OptContourInFaultsFlag = ival;
             break;
 
+        case CON_NUM_THREADS:
+            OptContourNumThreads = ival;
+            break;
+
         default:
             grd_utils_ptr->grd_set_err (2);
             return -1;
@@ -186,6 +194,7 @@ int CSWConCalc::con_set_calc_options (COntourCalcOptions *options)
     con_set_calc_option (CON_RESAMPLE_FLAG, options->resample_flag, 0.0f);
     con_set_calc_option (CON_THICKNESS_FLAG, options->thickness_flag, 0.0f);
     con_set_calc_option (CON_CONTOUR_IN_FAULTS, options->contour_in_faults_flag, 0.0f);
+    con_set_calc_option (CON_NUM_THREADS, options->num_threads, 0.0f);
 
     return 1;
 
@@ -240,6 +249,7 @@ int CSWConCalc::con_default_calc_options (COntourCalcOptions *options)
     options->last_contour = 0.0f;
     options->nminor = 0;
     options->nmajor = 0;
+    options->num_threads = 0;
 
     options->error_number = 0;
 
@@ -362,8 +372,8 @@ int CSWConCalc::con_calc_contours
     auto fscope = [&]()
     {
         if (b_success == false) {
-            *ncont = 0;
-            *contours = NULL;
+            if (ncont) *ncont = 0;
+            if (contours) *contours = NULL;
             if (rawgridin != rawgridinput) {
                 csw_Free (rawgridin);
                 rawgridin = NULL;
@@ -389,8 +399,9 @@ int CSWConCalc::con_calc_contours
 /*
  * Initialize output pointers in case of error.
  */
-    *contours = NULL;
-    *ncont = 0;
+    if (contours) *contours = NULL;
+    if (ncont) *ncont = 0;
+    OutputStopped = 0;
 
 /*
     Check for obvious errors.
@@ -421,7 +432,7 @@ int CSWConCalc::con_calc_contours
         return -1;
     }
 
-    if (contours == NULL  ||  ncont == NULL) {
+    if ((contours == NULL  ||  ncont == NULL)  &&  OutputFunc == NULL) {
         grd_utils_ptr->grd_set_err (5);
         return -1;
     }
@@ -532,6 +543,7 @@ int CSWConCalc::con_calc_contours
         StepGridFlag = options->step_flag;
         FaultedFlag = options->faulted_flag;
         ContourInFaultsFlag = options->contour_in_faults_flag;
+        ContourThreads = options->num_threads;
         NumMinor = options->nminor;
         NumMajor = options->nmajor;
         if (NumMajor > 0) memcpy ((char *)MajorContours,
@@ -557,6 +569,7 @@ int CSWConCalc::con_calc_contours
         StepGridFlag = OptStepGridFlag;
         FaultedFlag = OptFaultedFlag;
         ContourInFaultsFlag = OptContourInFaultsFlag;
+        ContourThreads = OptContourNumThreads;
         BaseGridValue = -1.e30f;
         TopGridValue = 1.e30f;
     }
@@ -859,8 +872,8 @@ int CSWConCalc::con_calc_contours
     Initialize the contour output stuff to NULL and zero
     in case of an error.
 */
-    *contours = NULL;
-    *ncont = 0;
+    if (contours) *contours = NULL;
+    if (ncont) *ncont = 0;
     ContourData = NULL;
     MaxConData = 0;
     NconData = 0;
@@ -931,6 +944,9 @@ MSL
     Vcrossing = Hcrossing + Ncol * Nrow;
     Hcrossing2 = Vcrossing + Ncol * Nrow;
     Vcrossing2 = Hcrossing2 + Ncol * Nrow;
+    memset (Hcrossing, 0, Ncol * Nrow * 4 * sizeof(char));
+    NumCross = 0;
+    CrossStart = 0;
 
 MSL
     Xbuf1 = (CSW_F *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(CSW_F));
@@ -1166,15 +1182,27 @@ MSL
 
     istat = TraceContours ();
     if (istat == -1) {
-        grd_utils_ptr->grd_set_err (1);
+        if (OutputStopped) {
+            grd_utils_ptr->grd_set_err (14);
+        }
+        else {
+            grd_utils_ptr->grd_set_err (1);
+        }
         return -1;
     }
 
 /*
-    Free work memory, set output and return.
+    Free work memory, set output and return.  Streamed contours
+    have already been passed on, so only the reused output
+    structures are freed.
 */
-    *contours = ContourData;
-    *ncont = NconData;
+    if (OutputFunc) {
+        con_free_contours (ContourData, 0);
+        ContourData = NULL;
+        MaxConData = 0;
+    }
+    if (contours) *contours = ContourData;
+    if (ncont) *ncont = NconData;
     ContourData = NULL;
     NconData = 0;
     ContourInterval = csav;
@@ -1223,6 +1251,42 @@ int CSWConCalc::con_free_contours (COntourOutputRec *list, int nlist)
 
 
 
+
+
+/*
+  ****************************************************************
+
+              c o n _ s e t _ o u t p u t _ f u n c
+
+  ****************************************************************
+
+    Set the function to stream contours to.  While this is set,
+  con_calc_contours passes each contour to the function as soon as
+  it is finished, and no contour array is returned.  The x and y
+  shifts are added to the contour points before they are passed on.
+  Set a NULL function to go back to returning contour arrays.
+
+*/
+
+void CSWConCalc::con_set_output_func (CONTOUR_OUTPUT_FUNC func,
+                                      void *client_data,
+                                      double xshift, double yshift)
+{
+
+    OutputFunc = func;
+    OutputFuncData = client_data;
+    OutputXshift = xshift;
+    OutputYshift = yshift;
+    if (func == NULL) {
+        OutputFuncData = NULL;
+        OutputXshift = 0.0;
+        OutputYshift = 0.0;
+    }
+
+}  /*  end of function con_set_output_func  */
+
+
+
 /*
  ****************************************************************
 
@@ -1532,6 +1596,8 @@ int CSWConCalc::FreeMem (void)
     if (Xbuf2) csw_Free (Xbuf2);
     if (Ybuf2) csw_Free (Ybuf2);
     if (SmoothFlags) csw_Free (SmoothFlags);
+    if (CrossList) csw_Free (CrossList);
+    FreeBlockPyramid ();
 
     if (SmoothSubgrids) {
         for (i=0; i<Ncol*Nrow; i++) {
@@ -1566,6 +1632,11 @@ int CSWConCalc::FreeMem (void)
     SmoothSubgrids = NULL;
     SmoothFlags = NULL;
 
+    CrossList = NULL;
+    NumCross = 0;
+    MaxCross = 0;
+    CrossStart = 0;
+
     if (FaultedFlag == 1) {
         grd_fault_ptr->grd_free_faults ();
     }
@@ -1595,9 +1666,9 @@ int CSWConCalc::FreeMem (void)
 
 int CSWConCalc::TraceContours (void)
 {
-    int             istat, i, j, k, offset, ilev;
-    int             edgelevel, topedge, bottomedge, leftedge, rightedge;
-    CSW_F           zlev, z1, z2, dz, ztiny;
+    int             istat, i, j, k, ilev;
+    int             topedge, bottomedge, leftedge, rightedge;
+    CSW_F           zlev, ztiny;
 
 /*
  *  If a side of the grid has a very tiny gradient, do not start
@@ -1711,6 +1782,18 @@ int CSWConCalc::TraceContours (void)
         AdjustGridForContourInterval ();
     }
 
+/*
+    Build the block min/max pyramid used to skip the parts of
+    the grid that cannot have a contour at a level.  Step grid
+    contours do not test the level, so they need every cell.
+*/
+    if (StepGridFlag == 0) {
+        istat = BuildBlockPyramid (Grid, ContourNullValue);
+        if (istat == -1) {
+            return -1;
+        }
+    }
+
 /*
  * Added to help debug problems with contour calculation.
  * See bug 8052 for an example.
@@ -1727,6 +1810,19 @@ int CSWConCalc::TraceContours (void)
 #endif
  */
 
+/*
+    Levels at a constant contour interval do not change the grid, so
+    they can be traced on more than one thread.  Specific levels adjust
+    the grid for each level and faulted tracing uses shared fault state,
+    so those are always traced one level at a time.
+*/
+    if (ContourInterval > 0.0f  &&  FaultedFlag == 0  &&  Ncvals > 1  &&
+        CSWParallel::NumThreads (ContourThreads) > 1) {
+        istat = TraceLevelsParallel (ztiny, bottomedge, rightedge,
+                                     topedge, leftedge);
+        return istat;
+    }
+
 /*
     Loop through the contour levels.  At each level check for
     contours intersecting each side of the grid and the center
@@ -1759,56 +1855,364 @@ int CSWConCalc::TraceContours (void)
             AdjustGridForContourLevel (zlev);
         }
 
-    /*
-        Zero the Hcrossing and Vcrossing arrays.  These
-        are used to keep track of which cells have already been
-        traced through for a given contour level.
-    */
-        memset (Hcrossing, 0, Ncol*Nrow*sizeof(MYSIGNED char));
-        memset (Vcrossing, 0, Ncol*Nrow*sizeof(MYSIGNED char));
+        istat = TraceContourLevel (zlev, OutputMajor, ztiny,
+                                   bottomedge, rightedge,
+                                   topedge, leftedge);
+        if (istat == -1) {
+            return -1;
+        }
 
-        MiddleStart = 0;
+    }  /*  end of loop through contour levels  */
 
-    /*
-        contours intersecting the bottom edge
-    */
-        for (edgelevel=0; edgelevel<=bottomedge; edgelevel++) {
-            for (j=0; j<Ncol-1; j++) {
+    return 1;
+
+}  /*  end of private TraceContours function  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+                 T r a c e C o n t o u r L e v e l
+
+  ****************************************************************
+
+    Trace all of the contours at a single level, starting from each
+  edge of the grid and then from the middle of the grid.  The edge
+  index arrays must already have been set up by TraceContours.
 
-                i = BottomSide[j];
+*/
+
+int CSWConCalc::TraceContourLevel (CSW_F zlev, int major, CSW_F ztiny,
+                                   int bottomedge, int rightedge,
+                                   int topedge, int leftedge)
+{
+    int             istat, i, j, offset, edgelevel,
+                    nspan, ispan, j1, j2;
+    CSW_F           z1, z2, dz;
+
+    OutputZlev = zlev;
+    OutputMajor = major;
+
+/*
+    Zero the Hcrossing and Vcrossing arrays.  These
+    are used to keep track of which cells have already been
+    traced through for a given contour level.  Only the entries
+    set while tracing the previous level can be non zero.
+*/
+    ClearCrossings (1);
+
+    MiddleStart = 0;
+
+/*
+    contours intersecting the bottom edge
+*/
+    for (edgelevel=0; edgelevel<=bottomedge; edgelevel++) {
+        for (j=0; j<Ncol-1; j++) {
+
+            i = BottomSide[j];
+
+            if (i < 0) {
+                continue;
+            }
+
+            if (i != edgelevel) {
+                continue;
+            }
+
+            offset = i * Ncol;
+            if (Hcrossing[offset+j]) {
+                continue;
+            }
+
+        /*
+            If a fault intersects this side of the cell, don't start
+            a contour here.  The cell will eventually be entered from
+            another side not having a fault, or if all 4 sides are faulted,
+            no contours will go through the cell.
+        */
+            if (FaultRowCrossings) {
+                if (FaultRowCrossings[offset+j] == 1) {
+                    continue;
+                }
+            }
+            if (FaultNodeGraze) {
+                if (FaultNodeGraze[offset+j] == 1  ||
+                    FaultNodeGraze[offset+j+1] == 1) {
+                    continue;
+                }
+            }
+            z1 = Grid[offset+j];
+            z2 = Grid[offset+j+1];
+            if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
+                continue;
+            }
+
+            if (StepGridFlag) {
+                if (StepGraze(z1,z2) == 1) continue;
+            }
+            else {
+                if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
+                dz = z1 - z2;
+                if (dz < 0.0) dz = -dz;
+                if (dz <= ztiny) continue;
+            }
+
+            istat = TraceCellToCell (i, j, 0, zlev);
+            if (istat == -1) {
+                return -1;
+            }
+            istat = FinishTracedContour ();
+            if (istat == -1) {
+                return -1;
+            }
+        }
+    }
+
+/*
+    contours intersecting the right edge
+*/
+    for (edgelevel=Ncol-1; edgelevel>=rightedge; edgelevel--) {
+        for (i=0; i<Nrow-1; i++) {
+
+            j = RightSide[i];
+
+            if (j < 0) {
+                continue;
+            }
+
+            if (j != edgelevel) {
+                continue;
+            }
 
-                if (i < 0) {
+            offset = i * Ncol;
+            if (Vcrossing[offset+j+1]) {
+                continue;
+            }
+        /*
+            If a fault intersects this side of the cell, don't start
+            a contour here.  The cell will eventually be entered from
+            another side not having a fault, or if all 4 sides are faulted,
+            no contours will go through the cell.
+        */
+            if (FaultColumnCrossings) {
+                if (FaultColumnCrossings[offset+j+1] == 1) {
+                    continue;
+                }
+            }
+            if (FaultNodeGraze) {
+                if (FaultNodeGraze[offset+j+1] == 1  ||
+                    FaultNodeGraze[offset+j+Ncol+1] == 1) {
                     continue;
                 }
+            }
+            z1 = Grid[offset+j+1];
+            z2 = Grid[offset+j+Ncol+1];
+            if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
+                continue;
+            }
+
+            if (StepGridFlag) {
+                if (StepGraze(z1,z2) == 1) continue;
+            }
+            else {
+                if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
+                dz = z1 - z2;
+                if (dz < 0.0) dz = -dz;
+                if (dz <= ztiny) continue;
+            }
+
+            istat = TraceCellToCell (i, j, 1, zlev);
+            if (istat == -1) {
+                return -1;
+            }
+            istat = FinishTracedContour ();
+            if (istat == -1) {
+                return -1;
+            }
+        }
+    }
+
+/*
+    contours intersecting the top edge
+*/
+    for (edgelevel=Nrow-1; edgelevel>=topedge; edgelevel--) {
+        for (j=0; j<Ncol-1; j++) {
+
+            i = TopSide[j];
+
+            if (i < 0) {
+                continue;
+            }
 
-                if (i != edgelevel) {
+            if (i != edgelevel) {
+                continue;
+            }
+
+            offset = i * Ncol + Ncol;
+            if (Hcrossing[offset+j]) {
+                continue;
+            }
+        /*
+            If a fault intersects this side of the cell, don't start
+            a contour here.  The cell will eventually be entered from
+            another side not having a fault, or if all 4 sides are faulted,
+            no contours will go through the cell.
+        */
+            if (FaultRowCrossings) {
+                if (FaultRowCrossings[offset+j] == 1) {
+                    continue;
+                }
+            }
+            if (FaultNodeGraze) {
+                if (FaultNodeGraze[offset+j] == 1  ||
+                    FaultNodeGraze[offset+j+1] == 1) {
                     continue;
                 }
+            }
+            z1 = Grid[offset+j];
+            z2 = Grid[offset+j+1];
+            if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
+                continue;
+            }
 
-                offset = i * Ncol;
-                if (Hcrossing[offset+j]) {
+            if (StepGridFlag) {
+                if (StepGraze(z1,z2) == 1) continue;
+            }
+            else {
+                if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
+                dz = z1 - z2;
+                if (dz < 0.0) dz = -dz;
+                if (dz <= ztiny) continue;
+            }
+
+            istat = TraceCellToCell (i, j, 2, zlev);
+            if (istat == -1) {
+                return -1;
+            }
+            istat = FinishTracedContour ();
+            if (istat == -1) {
+                return -1;
+            }
+        }
+    }
+
+/*
+    contours intersecting the left edge
+*/
+    for (edgelevel=0; edgelevel<=leftedge; edgelevel++) {
+        for (i=0; i<Nrow-1; i++) {
+
+            j = LeftSide[i];
+
+            if (j < 0) {
+                continue;
+            }
+
+            if (j != edgelevel) {
+                continue;
+            }
+
+            offset = i * Ncol;
+            if (Vcrossing[offset+j]) {
+                continue;
+            }
+        /*
+            If a fault intersects this side of the cell, don't start
+            a contour here.  The cell will eventually be entered from
+            another side not having a fault, or if all 4 sides are faulted,
+            no contours will go through the cell.
+        */
+            if (FaultColumnCrossings) {
+                if (FaultColumnCrossings[offset+j] == 1) {
                     continue;
                 }
+            }
+            if (FaultNodeGraze) {
+                if (FaultNodeGraze[offset+j] == 1  ||
+                    FaultNodeGraze[offset+j+Ncol] == 1) {
+                    continue;
+                }
+            }
+            z1 = Grid[offset+j];
+            z2 = Grid[offset+j+Ncol];
+            if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
+                continue;
+            }
+
+            if (StepGridFlag) {
+                if (StepGraze(z1,z2) == 1) continue;
+            }
+            else {
+                if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
+                dz = z1 - z2;
+                if (dz < 0.0) dz = -dz;
+                if (dz <= ztiny) continue;
+            }
+
+            istat = TraceCellToCell (i, j, 3, zlev);
+            if (istat == -1) {
+                return -1;
+            }
+            istat = FinishTracedContour ();
+            if (istat == -1) {
+                return -1;
+            }
+        }
+    }
+
+    MiddleStart = 1;
+
+/*
+    intersecting a vertical edge in the middle
+
+    Only the spans of cells in the row whose blocks have
+    nodes on both sides of the level can have a crossing.
+*/
+    for (i=0; i<Nrow-1; i++) {
+
+        offset = i * Ncol;
+        nspan = FindLevelSpans (i, zlev, LevelSpans);
+
+        for (ispan=0; ispan<nspan; ispan++) {
 
+            j1 = 0;
+            j2 = Ncol - 1;
+            if (LevelSpans) {
+                j1 = LevelSpans[ispan*2];
+                j2 = LevelSpans[ispan*2+1];
+            }
+            if (j1 < 1) j1 = 1;
+            if (j2 > Ncol - 2) j2 = Ncol - 2;
+
+            for (j=j1; j<=j2; j++) {
+
+                if (Vcrossing[offset+j]) {
+                    continue;
+                }
             /*
                 If a fault intersects this side of the cell, don't start
                 a contour here.  The cell will eventually be entered from
                 another side not having a fault, or if all 4 sides are faulted,
                 no contours will go through the cell.
             */
-                if (FaultRowCrossings) {
-                    if (FaultRowCrossings[offset+j] == 1) {
+                if (FaultColumnCrossings) {
+                    if (FaultColumnCrossings[offset+j] == 1) {
                         continue;
                     }
                 }
                 if (FaultNodeGraze) {
                     if (FaultNodeGraze[offset+j] == 1  ||
-                        FaultNodeGraze[offset+j+1] == 1) {
+                        FaultNodeGraze[offset+j+Ncol] == 1) {
                         continue;
                     }
                 }
+
                 z1 = Grid[offset+j];
-                z2 = Grid[offset+j+1];
+                z2 = Grid[offset+j+Ncol];
                 if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
                     continue;
                 }
@@ -1823,42 +2227,38 @@ int CSWConCalc::TraceContours (void)
                     if (dz <= ztiny) continue;
                 }
 
-                istat = TraceCellToCell (i, j, 0, zlev);
+                istat = TraceCellToCell (i, j, 3, zlev);
                 if (istat == -1) {
                     return -1;
                 }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
-                }
-MSL
-                istat = OutputContours ();
+                istat = FinishTracedContour ();
                 if (istat == -1) {
                     return -1;
                 }
             }
         }
+    }
 
-    /*
-        contours intersecting the right edge
-    */
-        for (edgelevel=Ncol-1; edgelevel>=rightedge; edgelevel--) {
-            for (i=0; i<Nrow-1; i++) {
+/*
+    intersecting a horizontal edge in the middle
+*/
+    for (i=1; i<Nrow-1; i++) {
 
-                j = RightSide[i];
+        offset = i * Ncol;
+        nspan = FindLevelSpans (i, zlev, LevelSpans);
 
-                if (j < 0) {
-                    continue;
-                }
+        for (ispan=0; ispan<nspan; ispan++) {
 
-                if (j != edgelevel) {
-                    continue;
-                }
+            j1 = 0;
+            j2 = Ncol - 1;
+            if (LevelSpans) {
+                j1 = LevelSpans[ispan*2];
+                j2 = LevelSpans[ispan*2+1];
+            }
 
-                offset = i * Ncol;
-                if (Vcrossing[offset+j+1]) {
+            for (j=j1; j<j2; j++) {
+
+                if (Hcrossing[offset+j]) {
                     continue;
                 }
             /*
@@ -1867,19 +2267,20 @@ MSL
                 another side not having a fault, or if all 4 sides are faulted,
                 no contours will go through the cell.
             */
-                if (FaultColumnCrossings) {
-                    if (FaultColumnCrossings[offset+j+1] == 1) {
+                if (FaultRowCrossings) {
+                    if (FaultRowCrossings[offset+j] == 1) {
                         continue;
                     }
                 }
                 if (FaultNodeGraze) {
-                    if (FaultNodeGraze[offset+j+1] == 1  ||
-                        FaultNodeGraze[offset+j+Ncol+1] == 1) {
+                    if (FaultNodeGraze[offset+j] == 1  ||
+                        FaultNodeGraze[offset+j+1] == 1) {
                         continue;
                     }
                 }
-                z1 = Grid[offset+j+1];
-                z2 = Grid[offset+j+Ncol+1];
+
+                z1 = Grid[offset+j];
+                z2 = Grid[offset+j+1];
                 if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
                     continue;
                 }
@@ -1894,301 +2295,697 @@ MSL
                     if (dz <= ztiny) continue;
                 }
 
-                istat = TraceCellToCell (i, j, 1, zlev);
+                istat = TraceCellToCell (i, j, 0, zlev);
                 if (istat == -1) {
                     return -1;
                 }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
-                }
-MSL
-                istat = OutputContours ();
+                istat = FinishTracedContour ();
                 if (istat == -1) {
                     return -1;
                 }
             }
         }
+    }
 
-    /*
-        contours intersecting the top edge
-    */
-        for (edgelevel=Nrow-1; edgelevel>=topedge; edgelevel--) {
-            for (j=0; j<Ncol-1; j++) {
+    return 1;
 
-                i = TopSide[j];
+}  /*  end of private TraceContourLevel function  */
 
-                if (i < 0) {
-                    continue;
-                }
 
-                if (i != edgelevel) {
-                    continue;
-                }
 
-                offset = i * Ncol + Ncol;
-                if (Hcrossing[offset+j]) {
-                    continue;
-                }
-            /*
-                If a fault intersects this side of the cell, don't start
-                a contour here.  The cell will eventually be entered from
-                another side not having a fault, or if all 4 sides are faulted,
-                no contours will go through the cell.
-            */
-                if (FaultRowCrossings) {
-                    if (FaultRowCrossings[offset+j] == 1) {
-                        continue;
-                    }
-                }
-                if (FaultNodeGraze) {
-                    if (FaultNodeGraze[offset+j] == 1  ||
-                        FaultNodeGraze[offset+j+1] == 1) {
+
+
+/*
+  ****************************************************************
+
+              F i n i s h T r a c e d C o n t o u r
+
+  ****************************************************************
+
+    Smooth and output the contour line just traced into Xbuf1 and
+  Ybuf1.  A tracing worker that is saving raw lines keeps the
+  unsmoothed line instead, so it can be smoothed after all of the
+  cell smoothing flags have been set.
+
+*/
+
+int CSWConCalc::FinishTracedContour (void)
+{
+    int             istat;
+
+    if (SaveRawLines) {
+        istat = SaveRawLine ();
+        return istat;
+    }
+
+    if (DoSmoothing) {
+        istat = SmoothContour ();
+        if (istat == -1) {
+            return -1;
+        }
+    }
+MSL
+    istat = OutputContours ();
+    if (istat == -1) {
+        return -1;
+    }
+
+    return 1;
+
+}  /*  end of private FinishTracedContour function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+              T r a c e L e v e l s P a r a l l e l
+
+  ****************************************************************
+
+    Trace the levels of a constant contour interval on up to
+  ContourThreads threads.  Each thread traces whole levels using
+  its own worker object.
+
+    Without smoothing, each level is output as it is traced.  With
+  smoothing, the first contour through a cell decides whether the
+  cell is smoothed, so the workers save the unsmoothed lines.  The
+  smoothing flags are then set from the saved lines in the same
+  level and line order used by single thread tracing, the subgrids
+  for the smoothed cells are built, and the saved lines are smoothed
+  and output on the threads.
+
+    The output from all levels is put into ContourData in level order,
+  so the contours are the same for any number of threads.
+
+*/
+
+int CSWConCalc::TraceLevelsParallel (CSW_F ztiny,
+                                     int bottomedge, int rightedge,
+                                     int topedge, int leftedge)
+{
+    int               i, k, n, ilev, nthread, ntot, istat;
+    CSWConCalc        *workers, *wptr;
+    COnLevelWork      *levwork, *lw;
+    COnRawLine        *rptr;
+    COntourOutputRec  *cptr;
+    char              *cellmark;
+
+    workers = NULL;
+    levwork = NULL;
+    cellmark = NULL;
+
+    nthread = CSWParallel::NumThreads (ContourThreads);
+    if (nthread > Ncvals) nthread = Ncvals;
+
+    auto fscope = [&]()
+    {
+        if (workers) {
+            for (i=0; i<nthread; i++) {
+                workers[i].FreeTraceWorker ();
+            }
+            delete [] workers;
+        }
+        csw_Free (levwork);
+        csw_Free (cellmark);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    levwork = (COnLevelWork *)csw_Calloc (Ncvals * sizeof(COnLevelWork));
+    if (!levwork) {
+        return -1;
+    }
+
+    try {
+        workers = new CSWConCalc[nthread];
+    }
+    catch (...) {
+        printf ("\n***** Exception from new *****\n\n");
+        workers = NULL;
+    }
+    if (!workers) {
+        return -1;
+    }
+
+    for (i=0; i<nthread; i++) {
+        istat = workers[i].InitTraceWorker (this);
+        if (istat == -1) {
+            return -1;
+        }
+    }
+
+/*
+    Trace each level with the worker for the thread.
+*/
+    auto ftrace = [&](int ilevel, int ithread)
+    {
+        CSWConCalc      *wp;
+        COnLevelWork    *lwp;
+        CSW_F           zl;
+
+        zl = Cvals[ilevel].z;
+        if (zl > 1.e20f) {
+            return;
+        }
+
+        wp = workers + ithread;
+        lwp = levwork + ilevel;
+        lwp->rawthread = ithread;
+        lwp->rawfirst = wp->NumRawLines;
+        lwp->outthread = ithread;
+        lwp->outfirst = wp->NconData;
+
+        lwp->istat = wp->TraceContourLevel (zl, Cvals[ilevel].major, ztiny,
+                                            bottomedge, rightedge,
+                                            topedge, leftedge);
+
+        lwp->nraw = wp->NumRawLines - lwp->rawfirst;
+        lwp->nout = wp->NconData - lwp->outfirst;
+    };
+
+    CSWParallel::ForEach (nthread, Ncvals, ftrace);
+
+    for (ilev=0; ilev<Ncvals; ilev++) {
+        if (levwork[ilev].istat == -1) {
+            return -1;
+        }
+    }
+
+    if (DoSmoothing) {
+
+    /*
+        Set the smoothing flags from the saved lines in level order
+        and mark each cell that a saved line goes through.
+    */
+        cellmark = (char *)csw_Calloc (Ncol * Nrow * sizeof(char));
+        if (!cellmark) {
+            return -1;
+        }
+
+        for (ilev=0; ilev<Ncvals; ilev++) {
+            lw = levwork + ilev;
+            if (lw->nraw < 1) {
+                continue;
+            }
+            rptr = workers[lw->rawthread].RawLines + lw->rawfirst;
+            for (n=0; n<lw->nraw; n++) {
+                SetLineSmoothFlags (rptr->x, rptr->y, rptr->cell, rptr->npts);
+                for (i=0; i<rptr->npts-1; i++) {
+                    k = rptr->cell[i];
+                    if (k < 0) {
                         continue;
                     }
+                    cellmark[k % MAX_NODES] = 1;
                 }
-                z1 = Grid[offset+j];
-                z2 = Grid[offset+j+1];
-                if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
+                rptr++;
+            }
+        }
+
+    /*
+        Build the subgrids of the marked cells that will be smoothed.
+        The reference point is only used for faulted smoothing, which
+        is never done on more than one thread.
+    */
+        auto fsubgrid = [&](int irow, int)
+        {
+            int         jcol, kcell;
+
+            for (jcol=0; jcol<Ncol; jcol++) {
+                kcell = irow * Ncol + jcol;
+                if (cellmark[kcell] == 0  ||
+                    SmoothFlags[kcell] <= 0  ||
+                    SmoothSubgrids[kcell] != NULL) {
                     continue;
                 }
+                SmoothSubgrids[kcell] =
+                    BuildSmoothSubgrid (kcell, 0.0f, 0.0f);
+            }
+        };
 
-                if (StepGridFlag) {
-                    if (StepGraze(z1,z2) == 1) continue;
-                }
-                else {
-                    if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
-                    dz = z1 - z2;
-                    if (dz < 0.0) dz = -dz;
-                    if (dz <= ztiny) continue;
-                }
+        CSWParallel::ForEach (nthread, Nrow, fsubgrid);
 
-                istat = TraceCellToCell (i, j, 2, zlev);
-                if (istat == -1) {
-                    return -1;
+    /*
+        Smooth and output the saved lines of each level.
+    */
+        for (i=0; i<nthread; i++) {
+            workers[i].SaveRawLines = 0;
+            workers[i].SmoothPrebuilt = 1;
+        }
+
+        auto fsmooth = [&](int ilevel, int ithread)
+        {
+            CSWConCalc      *wp;
+            COnLevelWork    *lwp;
+            COnRawLine      *rp;
+            int             j, ist;
+
+            wp = workers + ithread;
+            lwp = levwork + ilevel;
+            lwp->outthread = ithread;
+            lwp->outfirst = wp->NconData;
+            lwp->nout = 0;
+            if (lwp->nraw < 1) {
+                return;
+            }
+
+            wp->OutputZlev = Cvals[ilevel].z;
+            wp->OutputMajor = Cvals[ilevel].major;
+
+            rp = workers[lwp->rawthread].RawLines + lwp->rawfirst;
+            for (j=0; j<lwp->nraw; j++) {
+                ist = wp->LoadRawLine (rp + j);
+                if (ist != -1) {
+                    ist = wp->FinishTracedContour ();
                 }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
+                if (ist == -1) {
+                    lwp->istat = -1;
+                    break;
                 }
-MSL
-                istat = OutputContours ();
+            }
+
+            lwp->nout = wp->NconData - lwp->outfirst;
+        };
+
+        CSWParallel::ForEach (nthread, Ncvals, fsmooth);
+
+        for (ilev=0; ilev<Ncvals; ilev++) {
+            if (levwork[ilev].istat == -1) {
+                return -1;
+            }
+        }
+    }
+
+/*
+    If the contours are streamed, pass the output of each level to
+    the output function in level order.  The points of each contour
+    are freed once it has been passed on, and any contours not passed
+    on are freed with the workers.
+*/
+    if (OutputFunc) {
+        for (ilev=0; ilev<Ncvals; ilev++) {
+            lw = levwork + ilev;
+            if (lw->nout < 1) {
+                continue;
+            }
+            wptr = workers + lw->outthread;
+            for (k=lw->outfirst; k<lw->outfirst+lw->nout; k++) {
+                cptr = wptr->ContourData + k;
+                istat = SendContour (cptr);
+                csw_Free (cptr->x);
+                cptr->x = NULL;
+                cptr->y = NULL;
                 if (istat == -1) {
                     return -1;
                 }
             }
         }
+        return 1;
+    }
 
-    /*
-        contours intersecting the left edge
-    */
-        for (edgelevel=0; edgelevel<=leftedge; edgelevel++) {
-            for (i=0; i<Nrow-1; i++) {
+/*
+    Move the output of each level into ContourData in level order.
+    The points now belong to ContourData, so only the worker output
+    arrays are freed with the workers.
+*/
+    ntot = NconData;
+    for (ilev=0; ilev<Ncvals; ilev++) {
+        ntot += levwork[ilev].nout;
+    }
 
-                j = LeftSide[i];
+    if (ntot > MaxConData) {
+MSL
+        cptr = (COntourOutputRec *)csw_Realloc
+                   (ContourData, ntot * sizeof(COntourOutputRec));
+        if (!cptr) {
+            return -1;
+        }
+        ContourData = cptr;
+        MaxConData = ntot;
+    }
 
-                if (j < 0) {
-                    continue;
-                }
+    for (ilev=0; ilev<Ncvals; ilev++) {
+        lw = levwork + ilev;
+        if (lw->nout < 1) {
+            continue;
+        }
+        wptr = workers + lw->outthread;
+        memcpy (ContourData + NconData, wptr->ContourData + lw->outfirst,
+                lw->nout * sizeof(COntourOutputRec));
+        NconData += lw->nout;
+    }
 
-                if (j != edgelevel) {
-                    continue;
-                }
+    for (i=0; i<nthread; i++) {
+        workers[i].NconData = 0;
+    }
 
-                offset = i * Ncol;
-                if (Vcrossing[offset+j]) {
-                    continue;
-                }
-            /*
-                If a fault intersects this side of the cell, don't start
-                a contour here.  The cell will eventually be entered from
-                another side not having a fault, or if all 4 sides are faulted,
-                no contours will go through the cell.
-            */
-                if (FaultColumnCrossings) {
-                    if (FaultColumnCrossings[offset+j] == 1) {
-                        continue;
-                    }
-                }
-                if (FaultNodeGraze) {
-                    if (FaultNodeGraze[offset+j] == 1  ||
-                        FaultNodeGraze[offset+j+Ncol] == 1) {
-                        continue;
-                    }
-                }
-                z1 = Grid[offset+j];
-                z2 = Grid[offset+j+Ncol];
-                if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
-                    continue;
-                }
+    return 1;
 
-                if (StepGridFlag) {
-                    if (StepGraze(z1,z2) == 1) continue;
-                }
-                else {
-                    if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
-                    dz = z1 - z2;
-                    if (dz < 0.0) dz = -dz;
-                    if (dz <= ztiny) continue;
-                }
+}  /*  end of private TraceLevelsParallel function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                     S a v e R a w L i n e
+
+  ****************************************************************
+
+    Save a copy of the unsmoothed contour line in Xbuf1 and Ybuf1,
+  along with its cells, crowding and output attributes.  A line with
+  less than 2 points is never output, so it is not saved.
+
+*/
+
+int CSWConCalc::SaveRawLine (void)
+{
+    int             n;
+    CSW_F           *fbuf;
+    COnRawLine      *rptr;
+
+    if (Nbuf1 < 2) {
+        return 1;
+    }
+
+    if (NumRawLines >= MaxRawLines) {
+        MaxRawLines += LINE_BUFFER_CHUNK;
+MSL
+        rptr = (COnRawLine *)csw_Realloc
+                   (RawLines, MaxRawLines * sizeof(COnRawLine));
+        if (!rptr) {
+            return -1;
+        }
+        RawLines = rptr;
+    }
+
+    n = Nbuf1;
+MSL
+    fbuf = (CSW_F *)csw_Malloc
+               (n * (2 * sizeof(CSW_F) + sizeof(int) + 2 * sizeof(char)));
+    if (!fbuf) {
+        return -1;
+    }
+
+    rptr = RawLines + NumRawLines;
+    rptr->x = fbuf;
+    rptr->y = fbuf + n;
+    rptr->cell = (int *)(rptr->y + n);
+    rptr->crowd = (char *)(rptr->cell + n);
+    rptr->di = rptr->crowd + n;
+
+    memcpy (rptr->x, Xbuf1, n * sizeof(CSW_F));
+    memcpy (rptr->y, Ybuf1, n * sizeof(CSW_F));
+    memcpy (rptr->cell, CellBuf, n * sizeof(int));
+    memcpy (rptr->crowd, CrowdBuf, n * sizeof(char));
+    memcpy (rptr->di, Dibuf1, n * sizeof(char));
+
+    rptr->npts = n;
+    rptr->downhill = OutputDownhill;
+    rptr->closure = OutputClosure;
+
+    NumRawLines++;
+
+    return 1;
+
+}  /*  end of private SaveRawLine function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                     L o a d R a w L i n e
+
+  ****************************************************************
+
+    Put a saved unsmoothed line back into the line buffers and
+  output attributes, as if it had just been traced.
+
+*/
+
+int CSWConCalc::LoadRawLine (COnRawLine *rptr)
+{
+    int             n, lsize;
+    CSW_F           *fbuf;
+    int             *ibuf;
+    char            *cbuf;
+
+    n = rptr->npts;
+
+    if (n > MaxBuf1) {
+        MaxBuf1 = n + LINE_BUFFER_CHUNK;
+        lsize = MaxBuf1 * sizeof(CSW_F);
+MSL
+        fbuf = (CSW_F *)csw_Realloc (Xbuf1, lsize);
+        if (!fbuf) return -1;
+        Xbuf1 = fbuf;
+MSL
+        fbuf = (CSW_F *)csw_Realloc (Ybuf1, lsize);
+        if (!fbuf) return -1;
+        Ybuf1 = fbuf;
+
+        lsize = MaxBuf1 * sizeof(int);
+MSL
+        ibuf = (int *)csw_Realloc (CellBuf, lsize);
+        if (!ibuf) return -1;
+        CellBuf = ibuf;
+
+        lsize = MaxBuf1 * sizeof(char);
+MSL
+        cbuf = (char *)csw_Realloc (CrowdBuf, lsize);
+        if (!cbuf) return -1;
+        CrowdBuf = cbuf;
+MSL
+        cbuf = (char *)csw_Realloc (CrowdWork, lsize);
+        if (!cbuf) return -1;
+        CrowdWork = cbuf;
+MSL
+        cbuf = (char *)csw_Realloc (Dibuf1, lsize);
+        if (!cbuf) return -1;
+        Dibuf1 = cbuf;
+    }
+
+    memcpy (Xbuf1, rptr->x, n * sizeof(CSW_F));
+    memcpy (Ybuf1, rptr->y, n * sizeof(CSW_F));
+    memcpy (CellBuf, rptr->cell, n * sizeof(int));
+    memcpy (CrowdBuf, rptr->crowd, n * sizeof(char));
+    memcpy (Dibuf1, rptr->di, n * sizeof(char));
+
+    Nbuf1 = n;
+    OutputDownhill = rptr->downhill;
+    OutputClosure = rptr->closure;
+
+    return 1;
+
+}  /*  end of private LoadRawLine function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                  I n i t T r a c e W o r k e r
+
+  ****************************************************************
+
+    Set up this object to trace levels for the src object.  The
+  grids, edge index arrays and smoothing arrays of src are shared
+  and only read by the worker.  The worker has its own crossing
+  flags, line buffers and output list.
+
+*/
+
+int CSWConCalc::InitTraceWorker (CSWConCalc *src)
+{
+    grd_fault_ptr = src->grd_fault_ptr;
+    grd_arith_ptr = src->grd_arith_ptr;
+    grd_utils_ptr = src->grd_utils_ptr;
+
+    Xmin = src->Xmin;
+    Ymin = src->Ymin;
+    Xmax = src->Xmax;
+    Ymax = src->Ymax;
+    Xspace = src->Xspace;
+    Yspace = src->Yspace;
+    Scale = src->Scale;
+    GridShift = src->GridShift;
+    Zmin = src->Zmin;
+    Zmax = src->Zmax;
+    HistoZmin = src->HistoZmin;
+    HistoZmax = src->HistoZmax;
+
+    Grid = src->Grid;
+    NoNullGrid = src->NoNullGrid;
+    OriginalGrid = src->OriginalGrid;
+    Ncol = src->Ncol;
+    Nrow = src->Nrow;
+
+    ContourSmoothing = src->ContourSmoothing;
+    DoSmoothing = src->DoSmoothing;
+    SmoothMargin = src->SmoothMargin;
+    DoLogContours = src->DoLogContours;
+    StepGridFlag = src->StepGridFlag;
+    FaultedFlag = src->FaultedFlag;
+    ContourInterval = src->ContourInterval;
+    ContourLogBase = src->ContourLogBase;
+    ContourNullValue = src->ContourNullValue;
+
+    BottomSide = src->BottomSide;
+    TopSide = src->TopSide;
+    LeftSide = src->LeftSide;
+    RightSide = src->RightSide;
+
+    SmoothFlags = src->SmoothFlags;
+    SmoothSubgrids = src->SmoothSubgrids;
+    SubgridCols = src->SubgridCols;
+    SubgridRows = src->SubgridRows;
+    BicubCutoff = src->BicubCutoff;
+
+    MajorCrowd = src->MajorCrowd;
+    MinorCrowd = src->MinorCrowd;
+    MajorGradient = src->MajorGradient;
+    MinorGradient = src->MinorGradient;
+
+    FaultCellCrossings = src->FaultCellCrossings;
+    FaultColumnCrossings = src->FaultColumnCrossings;
+    FaultRowCrossings = src->FaultRowCrossings;
+    FaultNodeGraze = src->FaultNodeGraze;
+    ClosestFault = src->ClosestFault;
+
+    BlockZmin = src->BlockZmin;
+    BlockZmax = src->BlockZmax;
+    BlockNull = src->BlockNull;
+    BlockLevels = src->BlockLevels;
+    memcpy (BlockCols, src->BlockCols, sizeof(BlockCols));
+    memcpy (BlockRows, src->BlockRows, sizeof(BlockRows));
+    memcpy (BlockStart, src->BlockStart, sizeof(BlockStart));
+
+    SaveRawLines = DoSmoothing;
+    SmoothPrebuilt = 0;
+
+MSL
+    Hcrossing = (MYSIGNED char *)csw_Malloc (Ncol * Nrow * 4 * sizeof(char));
+    if (!Hcrossing) {
+        return -1;
+    }
+    Vcrossing = Hcrossing + Ncol * Nrow;
+    Hcrossing2 = Vcrossing + Ncol * Nrow;
+    Vcrossing2 = Hcrossing2 + Ncol * Nrow;
+    memset (Hcrossing, 0, Ncol * Nrow * 4 * sizeof(char));
+    NumCross = 0;
+    CrossStart = 0;
 
-                istat = TraceCellToCell (i, j, 3, zlev);
-                if (istat == -1) {
-                    return -1;
-                }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
-                }
+/*
+    The block pyramid is shared, but each worker needs
+    its own spans for the row it is checking.
+*/
+    if (BlockZmin) {
 MSL
-                istat = OutputContours ();
-                if (istat == -1) {
-                    return -1;
-                }
-            }
+        LevelSpans = (int *)csw_Malloc (BlockCols[0] * 2 * sizeof(int));
+        if (!LevelSpans) {
+            return -1;
         }
+    }
 
-        MiddleStart = 1;
+MSL
+    Xbuf1 = (CSW_F *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(CSW_F));
+    Ybuf1 = (CSW_F *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(CSW_F));
+    CellBuf = (int *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(int));
+    CrowdBuf = (char *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(char));
+    CrowdWork = (char *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(char));
+    Dibuf1 = (char *)csw_Malloc (LINE_BUFFER_CHUNK * sizeof(char));
+    Xbuf2 = (CSW_F *)csw_Malloc (2 * LINE_BUFFER_CHUNK * sizeof(CSW_F));
+    Ybuf2 = (CSW_F *)csw_Malloc (2 * LINE_BUFFER_CHUNK * sizeof(CSW_F));
+    if (!Xbuf1  ||  !Ybuf1  ||  !CellBuf  ||  !CrowdBuf  ||
+        !CrowdWork  ||  !Dibuf1  ||  !Xbuf2  ||  !Ybuf2) {
+        return -1;
+    }
 
-    /*
-        intersecting a vertical edge in the middle
-    */
-        for (i=0; i<Nrow-1; i++) {
+    Nbuf1 = 0;
+    Nbuf2 = 0;
+    MaxBuf1 = src->MaxBuf1;
+    MaxBuf2 = src->MaxBuf2;
 
-            offset = i * Ncol;
+MSL
+    ContourData = (COntourOutputRec *)
+                   csw_Calloc (LINE_BUFFER_CHUNK * sizeof(COntourOutputRec));
+    if (!ContourData) {
+        return -1;
+    }
+    NconData = 0;
+    MaxConData = LINE_BUFFER_CHUNK;
 
-            for (j=1; j<Ncol-1; j++) {
+    return 1;
 
-                if (Vcrossing[offset+j]) {
-                    continue;
-                }
-            /*
-                If a fault intersects this side of the cell, don't start
-                a contour here.  The cell will eventually be entered from
-                another side not having a fault, or if all 4 sides are faulted,
-                no contours will go through the cell.
-            */
-                if (FaultColumnCrossings) {
-                    if (FaultColumnCrossings[offset+j] == 1) {
-                        continue;
-                    }
-                }
-                if (FaultNodeGraze) {
-                    if (FaultNodeGraze[offset+j] == 1  ||
-                        FaultNodeGraze[offset+j+Ncol] == 1) {
-                        continue;
-                    }
-                }
+}  /*  end of private InitTraceWorker function  */
 
-                z1 = Grid[offset+j];
-                z2 = Grid[offset+j+Ncol];
-                if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
-                    continue;
-                }
 
-                if (StepGridFlag) {
-                    if (StepGraze(z1,z2) == 1) continue;
-                }
-                else {
-                    if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
-                    dz = z1 - z2;
-                    if (dz < 0.0) dz = -dz;
-                    if (dz <= ztiny) continue;
-                }
 
-                istat = TraceCellToCell (i, j, 3, zlev);
-                if (istat == -1) {
-                    return -1;
-                }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
-                }
-MSL
-                istat = OutputContours ();
-                if (istat == -1) {
-                    return -1;
-                }
-            }
-        }
 
-    /*
-        intersecting a horizontal edge in the middle
-    */
-        for (i=1; i<Nrow-1; i++) {
 
-            offset = i * Ncol;
+/*
+  ****************************************************************
 
-            for (j=0; j<Ncol-1; j++) {
+                  F r e e T r a c e W o r k e r
 
-                if (Hcrossing[offset+j]) {
-                    continue;
-                }
-            /*
-                If a fault intersects this side of the cell, don't start
-                a contour here.  The cell will eventually be entered from
-                another side not having a fault, or if all 4 sides are faulted,
-                no contours will go through the cell.
-            */
-                if (FaultRowCrossings) {
-                    if (FaultRowCrossings[offset+j] == 1) {
-                        continue;
-                    }
-                }
-                if (FaultNodeGraze) {
-                    if (FaultNodeGraze[offset+j] == 1  ||
-                        FaultNodeGraze[offset+j+1] == 1) {
-                        continue;
-                    }
-                }
+  ****************************************************************
 
-                z1 = Grid[offset+j];
-                z2 = Grid[offset+j+1];
-                if (z1 >= ContourNullValue  ||  z2 >= ContourNullValue) {
-                    continue;
-                }
+    Free the memory owned by a tracing worker.  The arrays shared
+  with the source object are only unhooked, not freed.
 
-                if (StepGridFlag) {
-                    if (StepGraze(z1,z2) == 1) continue;
-                }
-                else {
-                    if ((zlev-z1)*(zlev-z2) >= 0.0f) continue;
-                    dz = z1 - z2;
-                    if (dz < 0.0) dz = -dz;
-                    if (dz <= ztiny) continue;
-                }
+*/
 
-                istat = TraceCellToCell (i, j, 0, zlev);
-                if (istat == -1) {
-                    return -1;
-                }
-                if (DoSmoothing) {
-                    istat = SmoothContour ();
-                    if (istat == -1) {
-                        return -1;
-                    }
-                }
-MSL
-                istat = OutputContours ();
-                if (istat == -1) {
-                    return -1;
-                }
-            }
-        }
+void CSWConCalc::FreeTraceWorker (void)
+{
+    int             i;
 
-    }  /*  end of loop through contour levels  */
+    Grid = NULL;
+    NoNullGrid = NULL;
+    OriginalGrid = NULL;
 
-    return 1;
+    BottomSide = NULL;
+    TopSide = NULL;
+    LeftSide = NULL;
+    RightSide = NULL;
 
-}  /*  end of private TraceContours function  */
+    SmoothFlags = NULL;
+    SmoothSubgrids = NULL;
+
+    BlockZmin = NULL;
+    BlockZmax = NULL;
+    BlockNull = NULL;
+
+    FaultCellCrossings = NULL;
+    FaultColumnCrossings = NULL;
+    FaultRowCrossings = NULL;
+    FaultNodeGraze = NULL;
+    ClosestFault = NULL;
+    FaultedFlag = 0;
+
+    for (i=0; i<NumRawLines; i++) {
+        csw_Free (RawLines[i].x);
+    }
+    csw_Free (RawLines);
+    RawLines = NULL;
+    NumRawLines = 0;
+    MaxRawLines = 0;
+
+    con_free_contours (ContourData, NconData);
+    ContourData = NULL;
+    NconData = 0;
+    MaxConData = 0;
+
+    FreeMem ();
+
+}  /*  end of private FreeTraceWorker function  */
 
 
 
@@ -2318,10 +3115,10 @@ int CSWConCalc::TraceCellToCell
 
 /*
     The crossing grids for this line tracing need to be
-    initialized to zero here.
+    initialized to zero here.  Only the entries set by the
+    previous line can be non zero.
 */
-    memset (Hcrossing2, 0, Ncol*Nrow*sizeof(MYSIGNED char));
-    memset (Vcrossing2, 0, Ncol*Nrow*sizeof(MYSIGNED char));
+    ClearCrossings (0);
 
 /*
     Find the starting point in the first grid cell.  Note that
@@ -3018,18 +3815,25 @@ int CSWConCalc::TraceCellToCell
         if (nextside == 0) {
             Hcrossing[k+Ncol] += (MYSIGNED char)1;
             Hcrossing2[k+Ncol] = (MYSIGNED char)1;
+            istat = AddCrossing (k + Ncol);
         }
         else if (nextside == 1) {
             Vcrossing[k] += (MYSIGNED char)1;
             Vcrossing2[k] = (MYSIGNED char)1;
+            istat = AddCrossing (-(k+1));
         }
         else if (nextside == 2) {
             Hcrossing[k] += (MYSIGNED char)1;
             Hcrossing2[k] = (MYSIGNED char)1;
+            istat = AddCrossing (k);
         }
         else {
             Vcrossing[k+1] += (MYSIGNED char)1;
             Vcrossing2[k+1] = (MYSIGNED char)1;
+            istat = AddCrossing (-(k+2));
+        }
+        if (istat == -1) {
+            return -1;
         }
 
     /*
@@ -3420,6 +4224,97 @@ MSL
 
 
 
+/*
+  ****************************************************************
+
+                      A d d C r o s s i n g
+
+  ****************************************************************
+
+    Remember a crossing grid entry set while tracing the current
+  level, so it can be zeroed without zeroing the whole grid.
+
+*/
+
+int CSWConCalc::AddCrossing (int kcross)
+{
+    int             *ibuf;
+
+    if (NumCross >= MaxCross) {
+        MaxCross += LINE_BUFFER_CHUNK;
+MSL
+        ibuf = (int *)csw_Realloc (CrossList, MaxCross * sizeof(int));
+        if (!ibuf) {
+            return -1;
+        }
+        CrossList = ibuf;
+    }
+
+    CrossList[NumCross] = kcross;
+    NumCross++;
+
+    return 1;
+
+}  /*  end of private AddCrossing function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                    C l e a r C r o s s i n g s
+
+  ****************************************************************
+
+    Zero the crossing grid entries set since the last time they were
+  cleared.  If levelflag is zero, only the Hcrossing2 and Vcrossing2
+  entries set by the previous line are zeroed.  If levelflag is not
+  zero, all of the entries set while tracing the level are zeroed
+  in all four crossing grids.
+
+*/
+
+void CSWConCalc::ClearCrossings (int levelflag)
+{
+    int             i, k;
+
+    if (levelflag) {
+        for (i=0; i<NumCross; i++) {
+            k = CrossList[i];
+            if (k >= 0) {
+                Hcrossing[k] = 0;
+                Hcrossing2[k] = 0;
+            }
+            else {
+                k = -k - 1;
+                Vcrossing[k] = 0;
+                Vcrossing2[k] = 0;
+            }
+        }
+        NumCross = 0;
+        CrossStart = 0;
+        return;
+    }
+
+    for (i=CrossStart; i<NumCross; i++) {
+        k = CrossList[i];
+        if (k >= 0) {
+            Hcrossing2[k] = 0;
+        }
+        else {
+            Vcrossing2[-k-1] = 0;
+        }
+    }
+    CrossStart = NumCross;
+
+}  /*  end of private ClearCrossings function  */
+
+
+
+
+
 
 /*
   ****************************************************************
@@ -3633,6 +4528,8 @@ int CSWConCalc::AdjustGridForContourLevel (CSW_F zlev)
             else {
                 Grid[i] = zlev - tiny;
             }
+
+            WidenBlockPyramid (i, Grid[i]);
         }
 
     }
@@ -3772,59 +4669,25 @@ int CSWConCalc::SmoothContour (void)
 /*
     If the contour line is very short, do not
     smooth it.
-*/
-    gpf_xandylimits (Xbuf1, Ybuf1, Nbuf1,
-                     &x1, &y1, &x2, &y2);
-    dx = x2 - x1;
-    dy = y2 - y1;
-
-    if (dx < Xspace / 5.0f  &&  dy < Yspace / 5.0f) {
-        memcpy (Xbuf2, Xbuf1, Nbuf1*sizeof(CSW_F));
-        memcpy (Ybuf2, Ybuf1, Nbuf1*sizeof(CSW_F));
-        Nbuf2 = Nbuf1;
-        return 1;
-    }
-
-/*
-    If the unsmoothed line has 19 or less points and is closed,
-    smooth the grid cells traversed by the line, unless
-    another line has already crossed the cell.  Basically,
-    the first contour to cross a currently unsmoothed cell
-    determines whether the cell will be smoothed or not.  All
-    contours drawn through the cell will be the same (i.e. all
-    smoothed or all unsmoothed).  If the contours were mixed,
-    then they would probably cross each other (a bad thing).
-*/
-    dx = Xbuf1[0] - Xbuf1[Nbuf1 -1];
-    dy = Ybuf1[0] - Ybuf1[Nbuf1 -1];
-    if (dx < 0.0f) dx = -dx;
-    if (dy < 0.0f) dy = -dy;
-    if (Nbuf1 < 20  &&  dx < tiny  &&  dy < tiny) {
-        for (i=0; i<Nbuf1-1; i++) {
-            k = CellBuf[i] % MAX_NODES;
-            k %= MAX_NODES;
-            if (SmoothFlags[k] == 0) {
-                SmoothFlags[k] = (MYSIGNED char)1;
-            }
-        }
+*/
+    gpf_xandylimits (Xbuf1, Ybuf1, Nbuf1,
+                     &x1, &y1, &x2, &y2);
+    dx = x2 - x1;
+    dy = y2 - y1;
+
+    if (dx < Xspace / 5.0f  &&  dy < Yspace / 5.0f) {
+        memcpy (Xbuf2, Xbuf1, Nbuf1*sizeof(CSW_F));
+        memcpy (Ybuf2, Ybuf1, Nbuf1*sizeof(CSW_F));
+        Nbuf2 = Nbuf1;
+        return 1;
     }
 
 /*
-    The first line drawn through the cells is not short and
-    connected, so the cells are set to -1 to keep them from
-    being smoothed by a future short connected contour.
+    Unless the flags have already been set from all of the lines,
+    set the smoothing flags of the cells this line goes through.
 */
-    else {
-        for (i=0; i<Nbuf1-1; i++) {
-            k = CellBuf[i];
-            if (k < 0) {
-                k = -k - 1;
-            }
-            k %= MAX_NODES;
-            if (SmoothFlags[k] == 0) {
-                SmoothFlags[k] = (MYSIGNED char)-1;
-            }
-        }
+    if (SmoothPrebuilt == 0) {
+        SetLineSmoothFlags (Xbuf1, Ybuf1, CellBuf, Nbuf1);
     }
 
 /*
@@ -3957,6 +4820,88 @@ int CSWConCalc::SmoothContour (void)
 
 
 
+/*
+  ****************************************************************
+
+                S e t L i n e S m o o t h F l a g s
+
+  ****************************************************************
+
+    Set the smoothing flags of the cells a contour line goes through.
+  A flag is only changed if no previous line has set it, so the flags
+  depend on the order the lines are done in.  Nothing is set for a
+  line too short to be smoothed.
+
+*/
+
+void CSWConCalc::SetLineSmoothFlags (CSW_F *xbuf, CSW_F *ybuf,
+                                     int *cellbuf, int nbuf)
+{
+    int              i, k;
+    CSW_F            dx, dy, tiny, x1, y1, x2, y2;
+
+    if (nbuf < 2) return;
+
+    tiny = (Xspace + Yspace) / 2000.f;
+
+    gpf_xandylimits (xbuf, ybuf, nbuf,
+                     &x1, &y1, &x2, &y2);
+    dx = x2 - x1;
+    dy = y2 - y1;
+
+    if (dx < Xspace / 5.0f  &&  dy < Yspace / 5.0f) {
+        return;
+    }
+
+/*
+    If the unsmoothed line has 19 or less points and is closed,
+    smooth the grid cells traversed by the line, unless
+    another line has already crossed the cell.  Basically,
+    the first contour to cross a currently unsmoothed cell
+    determines whether the cell will be smoothed or not.  All
+    contours drawn through the cell will be the same (i.e. all
+    smoothed or all unsmoothed).  If the contours were mixed,
+    then they would probably cross each other (a bad thing).
+*/
+    dx = xbuf[0] - xbuf[nbuf-1];
+    dy = ybuf[0] - ybuf[nbuf-1];
+    if (dx < 0.0f) dx = -dx;
+    if (dy < 0.0f) dy = -dy;
+    if (nbuf < 20  &&  dx < tiny  &&  dy < tiny) {
+        for (i=0; i<nbuf-1; i++) {
+            k = cellbuf[i] % MAX_NODES;
+            k %= MAX_NODES;
+            if (SmoothFlags[k] == 0) {
+                SmoothFlags[k] = (MYSIGNED char)1;
+            }
+        }
+    }
+
+/*
+    The first line drawn through the cells is not short and
+    connected, so the cells are set to -1 to keep them from
+    being smoothed by a future short connected contour.
+*/
+    else {
+        for (i=0; i<nbuf-1; i++) {
+            k = cellbuf[i];
+            if (k < 0) {
+                k = -k - 1;
+            }
+            k %= MAX_NODES;
+            if (SmoothFlags[k] == 0) {
+                SmoothFlags[k] = (MYSIGNED char)-1;
+            }
+        }
+    }
+
+}  /*  end of private SetLineSmoothFlags function  */
+
+
+
+
+
+
 /*
   ****************************************************************
 
@@ -3972,9 +4917,8 @@ int CSWConCalc::SmoothCell
                       (int node, int side1, int side2,
                        CSW_F xendin, CSW_F yendin)
 {
-    int           i, j, k, n, irow, jcol, good, istat, nr2, nc2;
-    int           i1, i2, j1, j2, offset;
-    CSW_F         xp[1000], yp[1000], xref, yref;
+    int           i, j, k, irow, jcol, good, istat, nr2, nc2;
+    CSW_F         xref, yref;
     CSW_F         x0, y0, dx, dy, xt, yt, z1, z2,
                   zlev, xend, yend, *zgrid, *zgridsav;
     CSW_F         zgridtmp[MAX_SUB_GRID_SIZE];
@@ -3990,49 +4934,10 @@ int CSWConCalc::SmoothCell
 */
     zlev = OutputZlev;
 
-/*
-    Create the subgrid using bicubic interpolation
-*/
-    i = node / Ncol;
-    j = node % Ncol;
-    irow = i;
-    jcol = j;
+    irow = node / Ncol;
+    jcol = node % Ncol;
     k = node;
 
-/*
- * If there are less than 4 columns or rows, skip this.
- */
-    if (Ncol < 4  ||  Nrow < 4) {
-        return -1;
-    }
-
-/*
-    If there are any null nodes in the bicubic area,
-    return -1 and use the unsmoothed line through the cell.
-*/
-    i1 = i - 1;
-    if (i1 < 0) i1 = 0;
-    j1 = j - 1;
-    if (j1 < 0) j1 = 0;
-    i2 = i1 + 3;
-    j2 = j1 + 3;
-    if (i2 > Nrow-1) {
-        i2 = Nrow-1;
-        i1 = i2 - 3;
-    }
-    if (j2 > Ncol-1) {
-        j2 = Ncol-1;
-        j1 = j2 - 3;
-    }
-    for (i=i1; i<=i2; i++) {
-        offset = i*Ncol;
-        for (j=j1; j<=j2; j++) {
-            if (NoNullGrid[offset+j] >= ContourNullValue) {
-                return -1;
-            }
-        }
-    }
-
     dx = Xspace / (CSW_F)(SubgridCols - 1);
     dy = Yspace / (CSW_F)(SubgridRows - 1);
     x0 = Xmin + jcol * Xspace - SmoothMargin * dx;
@@ -4051,53 +4956,15 @@ int CSWConCalc::SmoothCell
     }
 
     if (!SmoothSubgrids[k]) {
-        n = 0;
-        for (i=0; i<nr2; i++) {
-            yt = y0 + i * dy;
-            if (i == nr2 - 1)
-                yt = y0 + Yspace;
-            for (j=0; j<nc2; j++) {
-                yp[n] = yt;
-                xp[n] = x0 + j * dx;
-                if (j == nc2 - 1)
-                    xp[n] = x0 + Xspace;
-                n++;
-            }
-        }
-MSL
-        zgrid = (CSW_F *)csw_Malloc (n * sizeof(CSW_F));
-        if (!zgrid) {
+        if (SmoothPrebuilt) {
             return -1;
         }
-        if (FaultedFlag == 1) {
-            istat = grd_fault_ptr->con_faulted_bicub_interp (Grid, Ncol, Nrow, 1.e20f,
-                                              xref, yref, irow, jcol,
-                                              xp, yp, zgrid, n);
-            if (istat == -1) {
-                return -1;
-            }
-        }
-        else {
-            istat = grd_utils_ptr->grd_bicub_interp (xp, yp, zgrid, n, 0.0f,
-                                      NoNullGrid, Ncol, Nrow, 1,
-                                      Xmin, Ymin, Xmax, Ymax,
-                                      irow, jcol);
-            if (istat == -1) {
-                return -1;
-            }
-
-            zgrid[0] = Grid[irow*Ncol + jcol];
-            zgrid[nc2-1] = Grid[irow*Ncol + jcol + 1];
-            zgrid[(nr2-1)*nc2] = Grid[(irow+1)*Ncol + jcol];
-            zgrid[nr2*nc2-1] = Grid[(irow+1)*Ncol + jcol + 1];
+        SmoothSubgrids[k] = BuildSmoothSubgrid (k, xref, yref);
+        if (!SmoothSubgrids[k]) {
+            return -1;
         }
-
-        SmoothSubgrids[k] = zgrid;
-
-    }
-    else {
-        zgrid = SmoothSubgrids[k];
     }
+    zgrid = SmoothSubgrids[k];
 
 /*
     make a copy of the subgrid for adjustment.  zgridtmp is
@@ -4289,6 +5156,126 @@ MSL
 
 
 
+/*
+  ****************************************************************
+
+                B u i l d S m o o t h S u b g r i d
+
+  ****************************************************************
+
+    Create the subgrid used to smooth contours through a cell, using
+  bicubic interpolation.  The reference point is only used for a
+  faulted grid.  NULL is returned if the cell cannot be smoothed or
+  if memory cannot be allocated.
+
+*/
+
+CSW_F *CSWConCalc::BuildSmoothSubgrid (int node, CSW_F xref, CSW_F yref)
+{
+    int           i, j, n, irow, jcol, istat, nr2, nc2;
+    int           i1, i2, j1, j2, offset;
+    CSW_F         xp[1000], yp[1000];
+    CSW_F         x0, y0, dx, dy, yt, *zgrid;
+
+    i = node / Ncol;
+    j = node % Ncol;
+    irow = i;
+    jcol = j;
+
+/*
+ * If there are less than 4 columns or rows, skip this.
+ */
+    if (Ncol < 4  ||  Nrow < 4) {
+        return NULL;
+    }
+
+/*
+    If there are any null nodes in the bicubic area,
+    return -1 and use the unsmoothed line through the cell.
+*/
+    i1 = i - 1;
+    if (i1 < 0) i1 = 0;
+    j1 = j - 1;
+    if (j1 < 0) j1 = 0;
+    i2 = i1 + 3;
+    j2 = j1 + 3;
+    if (i2 > Nrow-1) {
+        i2 = Nrow-1;
+        i1 = i2 - 3;
+    }
+    if (j2 > Ncol-1) {
+        j2 = Ncol-1;
+        j1 = j2 - 3;
+    }
+    for (i=i1; i<=i2; i++) {
+        offset = i*Ncol;
+        for (j=j1; j<=j2; j++) {
+            if (NoNullGrid[offset+j] >= ContourNullValue) {
+                return NULL;
+            }
+        }
+    }
+
+    dx = Xspace / (CSW_F)(SubgridCols - 1);
+    dy = Yspace / (CSW_F)(SubgridRows - 1);
+    x0 = Xmin + jcol * Xspace - SmoothMargin * dx;
+    y0 = Ymin + irow * Yspace - SmoothMargin * dy;
+
+    nc2 = SubgridCols + SmoothMargin * 2;
+    nr2 = SubgridRows + SmoothMargin * 2;
+
+    n = 0;
+    for (i=0; i<nr2; i++) {
+        yt = y0 + i * dy;
+        if (i == nr2 - 1)
+            yt = y0 + Yspace;
+        for (j=0; j<nc2; j++) {
+            yp[n] = yt;
+            xp[n] = x0 + j * dx;
+            if (j == nc2 - 1)
+                xp[n] = x0 + Xspace;
+            n++;
+        }
+    }
+MSL
+    zgrid = (CSW_F *)csw_Malloc (n * sizeof(CSW_F));
+    if (!zgrid) {
+        return NULL;
+    }
+    if (FaultedFlag == 1) {
+        istat = grd_fault_ptr->con_faulted_bicub_interp (Grid, Ncol, Nrow, 1.e20f,
+                                          xref, yref, irow, jcol,
+                                          xp, yp, zgrid, n);
+        if (istat == -1) {
+            csw_Free (zgrid);
+            return NULL;
+        }
+    }
+    else {
+        istat = grd_utils_ptr->grd_bicub_interp (xp, yp, zgrid, n, 0.0f,
+                                  NoNullGrid, Ncol, Nrow, 1,
+                                  Xmin, Ymin, Xmax, Ymax,
+                                  irow, jcol);
+        if (istat == -1) {
+            csw_Free (zgrid);
+            return NULL;
+        }
+
+        zgrid[0] = Grid[irow*Ncol + jcol];
+        zgrid[nc2-1] = Grid[irow*Ncol + jcol + 1];
+        zgrid[(nr2-1)*nc2] = Grid[(irow+1)*Ncol + jcol];
+        zgrid[nr2*nc2-1] = Grid[(irow+1)*Ncol + jcol + 1];
+    }
+
+    return zgrid;
+
+}  /*  end of private BuildSmoothSubgrid function  */
+
+
+
+
+
+
 
 /*
   ****************************************************************
@@ -4841,6 +5828,20 @@ int CSWConCalc::OutputContours (void)
                 yptr = ybuf + first;
                 len = last - first;
 
+            /*
+                A streamed contour only needs its points for the
+                duration of the output function call, so the line
+                buffer points are used directly.
+            */
+                if (OutputFunc) {
+                    istat = PutInOutputStruct (xptr, yptr, len);
+                    if (istat == -1) {
+                        return -1;
+                    }
+                    first = last + 1;
+                    continue;
+                }
+
             /*
                 Note that the memory allocated below is put into the
                 COntourOutputRec structure.  The application must csw_Free
@@ -4889,7 +5890,7 @@ int CSWConCalc::PutInOutputStruct (CSW_F *xptr, CSW_F *yptr, int len)
 {
     CSW_F          zlev;
     double         xt, yt, x1, y1, x2, y2, dx, dy, a1, a2, ang;
-    int            col, row;
+    int            col, row, istat;
 
 /*
     Extend the number of output structures if needed
@@ -4962,17 +5963,65 @@ MSL
     ContourData[NconData].expect_double = 0;
     ContourData[NconData].faultflag = 0;
 
-    FormatNumber (OutputZlev + (CSW_F)GridShift, ContourLogBase,
-                  ContourData[NconData].text);
+    FormatNumber (OutputZlev + (CSW_F)GridShift, ContourLogBase,
+                  ContourData[NconData].text);
+
+/*
+    A streamed contour is passed to the output function now,
+    and its output structure is used again for the next one.
+*/
+    if (OutputFunc) {
+        istat = SendContour (ContourData + NconData);
+        return istat;
+    }
+
+/*
+    Increment the output counter and return success.
+*/
+    NconData++;
+
+    return 1;
+
+}  /*  end of private PutInOutputStruct function  */
+
+
+
+
 
 /*
-    Increment the output counter and return success.
+  ****************************************************************
+
+                       S e n d C o n t o u r
+
+  ****************************************************************
+
+    Pass a finished contour to the output function.  The points are
+  shifted in place, but they are still owned by the caller of this
+  function.  If the output function returns -1, OutputStopped is set
+  and -1 is returned.
+
 */
-    NconData++;
+
+int CSWConCalc::SendContour (COntourOutputRec *crec)
+{
+    int            i, istat;
+
+    if (OutputXshift != 0.0  ||  OutputYshift != 0.0) {
+        for (i=0; i<crec->npts; i++) {
+            crec->x[i] += (CSW_F)OutputXshift;
+            crec->y[i] += (CSW_F)OutputYshift;
+        }
+    }
+
+    istat = OutputFunc (crec, OutputFuncData);
+    if (istat == -1) {
+        OutputStopped = 1;
+        return -1;
+    }
 
     return 1;
 
-}  /*  end of private PutInOutputStruct function  */
+}  /*  end of private SendContour function  */
 
 
 
@@ -5772,7 +6821,7 @@ int CSWConCalc::con_calc_color_fills
      CSW_F scale, COntourFillRec **fills, int *nfills,
       COntourCalcOptions *options)
 {
-    int                  i, j, j0, k, n, offset, istat;
+    int                  i, j, j0, k, n, offset, istat, ib, jb;
     COnColor             *cband;
     CSW_F                xpoly[MAX_FILL_POLY], ypoly[MAX_FILL_POLY],
                          null, xt1, yt1, yt2, yfudge;
@@ -6129,19 +7178,52 @@ MSL
         return -1;
     }
 
+/*
+    Find the blocks of cells that only have a single color.
+    These do not need color band searches for their nodes,
+    and their cells can be passed over in the row traversal.
+*/
+    istat = BuildBlockPyramid (Grid, null);
+    if (istat != -1) {
+        istat = SetBlockColors ();
+    }
+    if (istat == -1) {
+        grd_utils_ptr->grd_set_err (1);
+        csw_Free (cband);
+        if (tgrid) csw_Free (tgrid);
+        if (infault) csw_Free (infault);
+        FreeMem ();
+        return -1;
+    }
+
 /*
     Fill in the color band grid.
 */
-    for (i=0; i<Ncol*Nrow; i++) {
-        if (Grid[i] > null) {
-            cband[i] = NO_COLOR_FLAG;
-            continue;
-        }
-        if (Grid[i] < FirstContour  ||  Grid[i] > LastContour) {
-            cband[i] = NO_COLOR_FLAG;
-            continue;
+    for (i=0; i<Nrow; i++) {
+        offset = i * Ncol;
+        ib = i;
+        if (ib > Nrow - 2) ib = Nrow - 2;
+        ib = (ib >> CELL_BLOCK_SHIFT) * BlockCols[0];
+        for (j=0; j<Ncol; j++) {
+            k = offset + j;
+            jb = j;
+            if (jb > Ncol - 2) jb = Ncol - 2;
+            jb >>= CELL_BLOCK_SHIFT;
+            if (BlockColor  &&  BlockColor[ib+jb] >= 0) {
+                cband[k] = BlockColor[ib+jb];
+                first = 0;
+                continue;
+            }
+            if (Grid[k] > null) {
+                cband[k] = NO_COLOR_FLAG;
+                continue;
+            }
+            if (Grid[k] < FirstContour  ||  Grid[k] > LastContour) {
+                cband[k] = NO_COLOR_FLAG;
+                continue;
+            }
+            cband[k] = FindColorBand (Grid[k]);
         }
-        cband[i] = FindColorBand (Grid[i]);
     }
 
 /*
@@ -6155,6 +7237,7 @@ MSL
     for (i=0; i<Nrow-1; i++) {
 
         offset = i * Ncol;
+        ib = (i >> CELL_BLOCK_SHIFT) * BlockCols[0];
         n = 0;
         yt1 = Ymin + i * Yspace;
         yt2 = yt1 + Yspace + yfudge;
@@ -6325,6 +7408,19 @@ MSL
                     n = 0;
                     continue;
                 }
+
+            /*
+                The rest of the cells in a single color block are the
+                same color as this cell, so they are added to the
+                current polygon without checking them.
+            */
+                if (BlockColor  &&  infault == NULL) {
+                    jb = j >> CELL_BLOCK_SHIFT;
+                    if (BlockColor[ib+jb] >= 0) {
+                        j = ((jb + 1) << CELL_BLOCK_SHIFT) - 1;
+                        if (j > Ncol - 2) j = Ncol - 2;
+                    }
+                }
             }
 
         /*
@@ -6484,6 +7580,105 @@ int CSWConCalc::SearchRawColorBands (CSW_F zval)
 
 
 
+
+/*
+  **************************************************************************
+
+                       S e t B l o c k C o l o r s
+
+  **************************************************************************
+
+    Set the BlockColor entry for each level zero block of the block
+  pyramid.  If every node in the block is certain to get the same color
+  band index from FindColorBand, the entry is that index.  Otherwise,
+  the entry is -1.  This is only done when the color bands are in
+  increasing order without overlaps, so a block range inside a single
+  band means all of the block nodes are inside the band.
+
+*/
+
+int CSWConCalc::SetBlockColors (void)
+{
+    int                i, nblock, color, ordered;
+    CSW_F              zmin, zmax;
+
+    csw_Free (BlockColor);
+    BlockColor = NULL;
+
+    if (BlockZmin == NULL) {
+        return 1;
+    }
+
+    nblock = BlockCols[0] * BlockRows[0];
+
+MSL
+    BlockColor = (int *)csw_Malloc (nblock * sizeof(int));
+    if (!BlockColor) {
+        return -1;
+    }
+
+    ordered = 1;
+    for (i=0; i<NColorBands; i++) {
+        if (ColorBandLow[i] >= ColorBandHigh[i]) {
+            ordered = 0;
+            break;
+        }
+        if (i > 0  &&  ColorBandLow[i] < ColorBandHigh[i-1]) {
+            ordered = 0;
+            break;
+        }
+    }
+
+    for (i=0; i<nblock; i++) {
+
+        BlockColor[i] = -1;
+        if (ordered == 0  ||  BlockNull[i]) {
+            continue;
+        }
+
+        zmin = BlockZmin[i];
+        zmax = BlockZmax[i];
+        if (zmin < FirstContour  ||  zmax > LastContour) {
+            continue;
+        }
+
+        if (ZeroFillColor != -1) {
+            if (ContourThicknessFlag == CON_POSITIVE_THICKNESS  &&
+                zmin <= 0.0) {
+                continue;
+            }
+            if (ContourThicknessFlag == CON_NEGATIVE_THICKNESS  &&
+                zmax >= 0.0) {
+                continue;
+            }
+        }
+
+    /*
+        A node exactly at the bottom of a band is also at the top of
+        the band below it, so the block must be strictly inside the
+        band unless it is the first band.
+    */
+        color = SearchRawColorBands (zmax);
+        if (color < 0) {
+            continue;
+        }
+        if (zmin < ColorBandLow[color]) {
+            continue;
+        }
+        if (zmin == ColorBandLow[color]  &&  color > 0) {
+            continue;
+        }
+
+        BlockColor[i] = color;
+    }
+
+    return 1;
+
+}  /*  end of private SetBlockColors function  */
+
+
+
+
 /*
   *****************************************************************************
 
@@ -7610,40 +8805,335 @@ int CSWConCalc::ShiftInputGrid (CSW_F *grid, int ncol, int nrow)
 /*
     Make sure the shift value is an even multiple of the contour interval.
 */
-    if (ContourInterval > 0.0f) {
-        itmp = (int)((CSW_F)d3 / ContourInterval);
-        d3 = itmp * ContourInterval;
-        while (d3 >= d1) {
-            d3 -= ContourInterval;
+    if (ContourInterval > 0.0f) {
+        itmp = (int)((CSW_F)d3 / ContourInterval);
+        d3 = itmp * ContourInterval;
+        while (d3 >= d1) {
+            d3 -= ContourInterval;
+        }
+    }
+
+/*
+    Shift the grid.
+*/
+    for (i=0; i<n; i++) {
+        if (grid[i] >= ContourNullValue)
+            continue;
+        grid[i] -= (CSW_F)d3;
+    }
+
+    FirstContour -= (CSW_F)d3;
+    LastContour -= (CSW_F)d3;
+
+    if (BaseGridValue > -1.e20  &&  BaseGridValue < 1.e20) {
+        BaseGridValue -= (CSW_F)d3;
+    }
+    if (TopGridValue > -1.e20  &&  TopGridValue < 1.e20) {
+        TopGridValue -= (CSW_F)d3;
+    }
+
+    GridShift = d3;
+
+    return 1;
+
+}
+
+/*  end of private ShiftInputGrid function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                 B u i l d B l o c k P y r a m i d
+
+  ****************************************************************
+
+    Build the block min/max pyramid for the current Ncol by Nrow
+  grid.  Nodes at or above nullvalue are not used in the block
+  ranges, but a level zero block with any such node has its
+  BlockNull flag set.  A block with no valid nodes has a min
+  larger than its max, so no level is ever inside its range.
+
+*/
+
+int CSWConCalc::BuildBlockPyramid (CSW_F *grid, CSW_F nullvalue)
+{
+    int             i, j, lev, nc, nr, ntot, ib, jb,
+                    i1, i2, j1, j2, offset, kb, kc;
+    CSW_F           zt, zmin, zmax;
+    char            nflag;
+
+    FreeBlockPyramid ();
+
+    if (Ncol < 2  ||  Nrow < 2) {
+        return 1;
+    }
+
+/*
+    Find the size of each level.  The top level is a single block.
+*/
+    nc = (Ncol - 1 + CELL_BLOCK_SIZE - 1) >> CELL_BLOCK_SHIFT;
+    nr = (Nrow - 1 + CELL_BLOCK_SIZE - 1) >> CELL_BLOCK_SHIFT;
+    ntot = 0;
+    lev = 0;
+    for (;;) {
+        BlockCols[lev] = nc;
+        BlockRows[lev] = nr;
+        BlockStart[lev] = ntot;
+        ntot += nc * nr;
+        lev++;
+        if ((nc == 1  &&  nr == 1)  ||  lev >= MAX_CELL_BLOCK_LEVELS) {
+            break;
+        }
+        nc = (nc + 1) / 2;
+        nr = (nr + 1) / 2;
+    }
+    BlockLevels = lev;
+
+MSL
+    BlockZmin = (CSW_F *)csw_Malloc (ntot * 2 * sizeof(CSW_F));
+    if (!BlockZmin) {
+        return -1;
+    }
+    BlockZmax = BlockZmin + ntot;
+
+MSL
+    BlockNull = (char *)csw_Malloc (BlockCols[0] * BlockRows[0] * sizeof(char));
+    if (!BlockNull) {
+        FreeBlockPyramid ();
+        return -1;
+    }
+
+MSL
+    LevelSpans = (int *)csw_Malloc (BlockCols[0] * 2 * sizeof(int));
+    if (!LevelSpans) {
+        FreeBlockPyramid ();
+        return -1;
+    }
+
+/*
+    The level zero blocks use the grid nodes directly.
+*/
+    for (ib=0; ib<BlockRows[0]; ib++) {
+        i1 = ib << CELL_BLOCK_SHIFT;
+        i2 = i1 + CELL_BLOCK_SIZE;
+        if (i2 > Nrow - 1) i2 = Nrow - 1;
+        for (jb=0; jb<BlockCols[0]; jb++) {
+            j1 = jb << CELL_BLOCK_SHIFT;
+            j2 = j1 + CELL_BLOCK_SIZE;
+            if (j2 > Ncol - 1) j2 = Ncol - 1;
+            zmin = 1.e30f;
+            zmax = -1.e30f;
+            nflag = 0;
+            for (i=i1; i<=i2; i++) {
+                offset = i * Ncol;
+                for (j=j1; j<=j2; j++) {
+                    zt = grid[offset+j];
+                    if (zt >= nullvalue) {
+                        nflag = 1;
+                        continue;
+                    }
+                    if (zt < zmin) zmin = zt;
+                    if (zt > zmax) zmax = zt;
+                }
+            }
+            kb = ib * BlockCols[0] + jb;
+            BlockZmin[kb] = zmin;
+            BlockZmax[kb] = zmax;
+            BlockNull[kb] = nflag;
+        }
+    }
+
+/*
+    Each higher level block combines up to 2 by 2 blocks
+    from the level below it.
+*/
+    for (lev=1; lev<BlockLevels; lev++) {
+        for (ib=0; ib<BlockRows[lev]; ib++) {
+            for (jb=0; jb<BlockCols[lev]; jb++) {
+                zmin = 1.e30f;
+                zmax = -1.e30f;
+                for (i=ib*2; i<=ib*2+1  &&  i<BlockRows[lev-1]; i++) {
+                    for (j=jb*2; j<=jb*2+1  &&  j<BlockCols[lev-1]; j++) {
+                        kc = BlockStart[lev-1] + i * BlockCols[lev-1] + j;
+                        if (BlockZmin[kc] < zmin) zmin = BlockZmin[kc];
+                        if (BlockZmax[kc] > zmax) zmax = BlockZmax[kc];
+                    }
+                }
+                kb = BlockStart[lev] + ib * BlockCols[lev] + jb;
+                BlockZmin[kb] = zmin;
+                BlockZmax[kb] = zmax;
+            }
+        }
+    }
+
+    return 1;
+
+}  /*  end of private BuildBlockPyramid function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                  F r e e B l o c k P y r a m i d
+
+  ****************************************************************
+
+*/
+
+void CSWConCalc::FreeBlockPyramid (void)
+{
+    csw_Free (BlockZmin);
+    csw_Free (BlockNull);
+    csw_Free (BlockColor);
+    csw_Free (LevelSpans);
+    BlockZmin = NULL;
+    BlockZmax = NULL;
+    BlockNull = NULL;
+    BlockColor = NULL;
+    LevelSpans = NULL;
+    BlockLevels = 0;
+
+}  /*  end of private FreeBlockPyramid function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                 W i d e n B l o c k P y r a m i d
+
+  ****************************************************************
+
+    A grid node has been changed to zval.  Widen the ranges of the
+  blocks holding the cells that use the node, at all levels, so
+  they still include the node.  The ranges are never narrowed, so
+  they can only be larger than the actual node ranges.
+
+*/
+
+void CSWConCalc::WidenBlockPyramid (int node, CSW_F zval)
+{
+    int             i, j, irow, jcol, ib, jb, lev, kb;
+
+    if (BlockZmin == NULL) {
+        return;
+    }
+
+    irow = node / Ncol;
+    jcol = node % Ncol;
+
+    for (i=irow-1; i<=irow; i++) {
+        if (i < 0  ||  i >= Nrow - 1) continue;
+        for (j=jcol-1; j<=jcol; j++) {
+            if (j < 0  ||  j >= Ncol - 1) continue;
+            ib = i >> CELL_BLOCK_SHIFT;
+            jb = j >> CELL_BLOCK_SHIFT;
+            for (lev=0; lev<BlockLevels; lev++) {
+                kb = BlockStart[lev] + (ib >> lev) * BlockCols[lev] + (jb >> lev);
+                if (zval < BlockZmin[kb]) BlockZmin[kb] = zval;
+                if (zval > BlockZmax[kb]) BlockZmax[kb] = zval;
+            }
+        }
+    }
+
+}  /*  end of private WidenBlockPyramid function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                    F i n d L e v e l S p a n s
+
+  ****************************************************************
+
+    Find the cells in a row of cells that can have a contour at zlev
+  crossing them.  The cells are returned as pairs of first and last
+  plus one columns in the spans array, in left to right order.  The
+  number of pairs is returned.  A cell is not in a span only if all
+  of the nodes in its level zero block are on the same side of zlev
+  or exactly at zlev.  Without a pyramid, the whole row is one span.
+
+*/
+
+int CSWConCalc::FindLevelSpans (int irow, CSW_F zlev, int *spans)
+{
+    int             lev, jb, ib, kb, j1, j2, nspan, nstack;
+    int             stack[MAX_CELL_BLOCK_LEVELS * 4];
+
+    if (BlockZmin == NULL  ||  spans == NULL) {
+        if (spans) {
+            spans[0] = 0;
+            spans[1] = Ncol - 1;
         }
+        return 1;
     }
 
 /*
-    Shift the grid.
+    Descend the pyramid from the top block, checking the blocks
+    of each level that are in the row.  The stack has the level
+    and block column of blocks to check, with the leftmost on top.
 */
-    for (i=0; i<n; i++) {
-        if (grid[i] >= ContourNullValue)
-            continue;
-        grid[i] -= (CSW_F)d3;
-    }
+    nspan = 0;
+    stack[0] = BlockLevels - 1;
+    stack[1] = 0;
+    nstack = 2;
 
-    FirstContour -= (CSW_F)d3;
-    LastContour -= (CSW_F)d3;
+    while (nstack > 0) {
 
-    if (BaseGridValue > -1.e20  &&  BaseGridValue < 1.e20) {
-        BaseGridValue -= (CSW_F)d3;
-    }
-    if (TopGridValue > -1.e20  &&  TopGridValue < 1.e20) {
-        TopGridValue -= (CSW_F)d3;
-    }
+        nstack -= 2;
+        lev = stack[nstack];
+        jb = stack[nstack+1];
 
-    GridShift = d3;
+        ib = irow >> (CELL_BLOCK_SHIFT + lev);
+        kb = BlockStart[lev] + ib * BlockCols[lev] + jb;
+        if (!(BlockZmin[kb] < zlev  &&  zlev < BlockZmax[kb])) {
+            continue;
+        }
 
-    return 1;
+        if (lev > 0) {
+            if (jb * 2 + 1 < BlockCols[lev-1]) {
+                stack[nstack] = lev - 1;
+                stack[nstack+1] = jb * 2 + 1;
+                nstack += 2;
+            }
+            stack[nstack] = lev - 1;
+            stack[nstack+1] = jb * 2;
+            nstack += 2;
+            continue;
+        }
 
-}
+    /*
+        Add the level zero block cells to the spans,
+        joining them to the previous span if possible.
+    */
+        j1 = jb << CELL_BLOCK_SHIFT;
+        j2 = j1 + CELL_BLOCK_SIZE;
+        if (j2 > Ncol - 1) j2 = Ncol - 1;
+        if (nspan > 0  &&  spans[nspan*2-1] == j1) {
+            spans[nspan*2-1] = j2;
+        }
+        else {
+            spans[nspan*2] = j1;
+            spans[nspan*2+1] = j2;
+            nspan++;
+        }
+    }
 
-/*  end of private ShiftInputGrid function  */
+    return nspan;
+
+}  /*  end of private FindLevelSpans function  */
 
 
 
@@ -8684,6 +10174,427 @@ int CSWConCalc::con_clip_contours_to_polygon
 
 
 
+/*
+ *********************************************************************************
+
+              c o n _ b u i l d _ c o n t o u r _ p y r a m i d
+
+ *********************************************************************************
+
+  Build a level of detail pyramid from a set of contour lines.  Level zero of
+  the pyramid is a copy of the input contours.  Each coarser level keeps every
+  other contour level of the level below it and thins the points of each line
+  to a tolerance twice as large as the level below.  The spacing parameter is
+  the distance between points of the input lines (usually the grid cell size).
+  Level k is thinned to half of spacing times 2 to the k power, so it can be
+  drawn wherever a display pixel is at least that large without visible change.
+
+  The kept contour levels are counted from the first major level, so major
+  contours survive the longest as the pyramid gets coarser.  Closed lines that
+  thin down to less than 4 points are smaller than the tolerance and they are
+  left out of that level.
+
+  All levels are returned in the single pyramid array.  The level_start array
+  must have room for nlevels + 1 values.  The contours for level k are in the
+  pyramid array from level_start[k] up to, but not including, level_start[k+1].
+  Ownership of the pyramid array is relinquished to the calling routine, which
+  should free it with con_free_contours.
+
+*/
+
+int CSWConCalc::con_build_contour_pyramid
+          (COntourOutputRec *contours, int ncontours,
+           CSW_F spacing, int nlevels,
+           COntourOutputRec **pyramid, int *npyramid,
+           int *level_start)
+{
+    COntourOutputRec       *c1, *c2, *conout = NULL, *ctmp;
+    CSW_F                  *zlist = NULL;
+    CSW_F                  tolerance, tiny;
+    char                   *keep = NULL;
+    int                    *stack = NULL;
+    int                    i, j, n, ido, lev, nz, nkeep, maxline,
+                           maxout, nconout, anchor, step, rank, closed;
+
+    bool     bsuccess = false;
+
+    auto fscope = [&]()
+    {
+        csw_Free (zlist);
+        csw_Free (keep);
+        csw_Free (stack);
+        if (bsuccess == false) {
+            con_free_contours (conout, nconout);
+        }
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    nconout = 0;
+
+/*
+    Initialize output in case of error.
+*/
+    if (pyramid == NULL  ||  npyramid == NULL  ||  level_start == NULL) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+    *pyramid = NULL;
+    *npyramid = 0;
+
+    if (contours == NULL  ||  nlevels < 1) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    for (lev=0; lev<=nlevels; lev++) {
+        level_start[lev] = 0;
+    }
+
+    if (ncontours < 1) {
+        bsuccess = true;
+        return 1;
+    }
+
+/*
+    Find the sorted list of distinct contour levels and
+    the longest input line.
+*/
+MSL
+    zlist = (CSW_F *)csw_Malloc (ncontours * sizeof(CSW_F));
+    if (zlist == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    maxline = 2;
+    for (ido=0; ido<ncontours; ido++) {
+        zlist[ido] = contours[ido].zvalue;
+        if (contours[ido].npts > maxline) {
+            maxline = contours[ido].npts;
+        }
+    }
+
+    std::sort (zlist, zlist + ncontours);
+
+    tiny = (zlist[ncontours-1] - zlist[0]) / 1.e6f;
+    nz = 1;
+    for (ido=1; ido<ncontours; ido++) {
+        if (zlist[ido] - zlist[nz-1] > tiny) {
+            zlist[nz] = zlist[ido];
+            nz++;
+        }
+    }
+
+/*
+    Return the index of a contour level in the distinct level list.
+*/
+    auto level_rank = [&](CSW_F zval) -> int
+    {
+        int    lo, hi, mid;
+
+        lo = 0;
+        hi = nz - 1;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (zlist[mid] < zval - tiny) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return lo;
+    };
+
+    anchor = 0;
+    for (ido=0; ido<ncontours; ido++) {
+        if (contours[ido].major) {
+            anchor = level_rank (contours[ido].zvalue);
+            break;
+        }
+    }
+
+/*
+    Allocate work space for thinning the lines.
+*/
+MSL
+    keep = (char *)csw_Malloc (maxline * sizeof(char));
+    if (keep == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+MSL
+    stack = (int *)csw_Malloc (2 * maxline * sizeof(int));
+    if (stack == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+/*
+    Allocate as many output records as there are input records.
+    This will be expanded if needed.
+*/
+    maxout = ncontours * 2;
+    if (maxout < 20) {
+        maxout = 20;
+    }
+MSL
+    conout = (COntourOutputRec *)csw_Calloc (maxout * sizeof(COntourOutputRec));
+    if (conout == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+/*
+    Fill in each level of the pyramid.
+*/
+    for (lev=0; lev<nlevels; lev++) {
+
+        level_start[lev] = nconout;
+        step = 1 << lev;
+        tolerance = spacing * (CSW_F)step / 2.0f;
+        if (lev == 0) {
+            tolerance = 0.0f;
+        }
+
+        for (ido=0; ido<ncontours; ido++) {
+
+            c1 = contours + ido;
+            if (c1->npts < 2  ||  c1->x == NULL  ||  c1->y == NULL) {
+                continue;
+            }
+
+            rank = level_rank (c1->zvalue) - anchor;
+            rank %= step;
+            if (rank != 0) {
+                continue;
+            }
+
+            n = c1->npts;
+            if (tolerance > 0.0f) {
+                nkeep = ThinContourLine (c1->x, c1->y, n, tolerance,
+                                         keep, stack);
+            }
+            else {
+                memset (keep, 1, n * sizeof(char));
+                nkeep = n;
+            }
+
+            closed = 0;
+            if (c1->x[0] == c1->x[n-1]  &&  c1->y[0] == c1->y[n-1]) {
+                closed = 1;
+            }
+            if (nkeep < 2  ||  (closed  &&  nkeep < 4)) {
+                continue;
+            }
+
+            if (nconout >= maxout) {
+                maxout += maxout / 2 + 20;
+                ctmp = (COntourOutputRec *)csw_Realloc
+                    (conout, maxout * sizeof(COntourOutputRec));
+                if (ctmp == NULL) {
+                    grd_utils_ptr->grd_set_err (1);
+                    return -1;
+                }
+                conout = ctmp;
+            }
+
+            c2 = conout + nconout;
+            memcpy (c2, c1, sizeof(COntourOutputRec));
+MSL
+            c2->x = (CSW_F *)csw_Malloc (2 * nkeep * sizeof(CSW_F));
+            if (c2->x == NULL) {
+                grd_utils_ptr->grd_set_err (1);
+                return -1;
+            }
+            c2->y = c2->x + nkeep;
+            c2->npts = nkeep;
+
+            j = 0;
+            for (i=0; i<n; i++) {
+                if (keep[i]) {
+                    c2->x[j] = c1->x[i];
+                    c2->y[j] = c1->y[i];
+                    j++;
+                }
+            }
+            nconout++;
+
+        }
+
+    }
+
+    level_start[nlevels] = nconout;
+
+    if (nconout < 1) {
+        con_free_contours (conout, 0);
+        conout = NULL;
+    }
+
+    *pyramid = conout;
+    *npyramid = nconout;
+
+    bsuccess = true;
+
+    return 1;
+
+}  /* end of function con_build_contour_pyramid */
+
+
+
+/*
+  ****************************************************************
+
+                  T h i n C o n t o u r L i n e
+
+  ****************************************************************
+
+    Flag the points of a line that are needed to keep the thinned
+    line within tolerance of the original line.  This uses the
+    Douglas-Peucker method with an explicit stack of point index
+    pairs, which needs room for 2 * npts values.  The end points
+    are always kept.  The number of points flagged in the keep
+    array is returned.
+
+*/
+
+int CSWConCalc::ThinContourLine (CSW_F *x, CSW_F *y, int npts,
+                                 CSW_F tolerance,
+                                 char *keep, int *stack)
+{
+    int            i, i1, i2, imax, nstack, nkeep;
+    CSW_F          dx, dy, px, py, len2, dist2, dmax, tol2;
+
+    memset (keep, 0, npts * sizeof(char));
+    keep[0] = 1;
+    keep[npts-1] = 1;
+    if (npts < 3) {
+        return npts;
+    }
+
+    tol2 = tolerance * tolerance;
+
+    stack[0] = 0;
+    stack[1] = npts - 1;
+    nstack = 2;
+
+    while (nstack > 0) {
+
+        nstack--;
+        i2 = stack[nstack];
+        nstack--;
+        i1 = stack[nstack];
+
+        if (i2 - i1 < 2) {
+            continue;
+        }
+
+    /*
+        Find the point farthest from the line between the end points
+        of this span.  If the end points are the same (a closed line)
+        the distance from the end point is used.
+    */
+        dx = x[i2] - x[i1];
+        dy = y[i2] - y[i1];
+        len2 = dx * dx + dy * dy;
+
+        dmax = -1.0f;
+        imax = -1;
+        for (i=i1+1; i<i2; i++) {
+            px = x[i] - x[i1];
+            py = y[i] - y[i1];
+            if (len2 > 0.0f) {
+                dist2 = px * dy - py * dx;
+                dist2 = dist2 * dist2 / len2;
+            }
+            else {
+                dist2 = px * px + py * py;
+            }
+            if (dist2 > dmax) {
+                dmax = dist2;
+                imax = i;
+            }
+        }
+
+        if (imax < 0  ||  dmax <= tol2) {
+            continue;
+        }
+
+        keep[imax] = 1;
+        stack[nstack] = i1;
+        stack[nstack+1] = imax;
+        stack[nstack+2] = imax;
+        stack[nstack+3] = i2;
+        nstack += 4;
+
+    }
+
+    nkeep = 0;
+    for (i=0; i<npts; i++) {
+        if (keep[i]) nkeep++;
+    }
+
+    return nkeep;
+
+}  /*  end of private ThinContourLine function  */
+
+
+
+/*
+  ****************************************************************
+
+            c o n _ g e t _ c o n t o u r _ l e v e l s
+
+  ****************************************************************
+
+    Return the contour levels used by the most recent contour
+    calculation, split into minor and major lists the same way
+    as the minor_contours and major_contours members of the calc
+    options structure.  Feeding the lists back as specific levels
+    lets a sub area of the same grid be contoured with exactly the
+    same levels, even if the interval was picked automatically.
+    Zero is returned if no contours have been calculated yet.
+
+*/
+
+int CSWConCalc::con_get_contour_levels (CSW_F *minor, int *nminor,
+                                        CSW_F *major, int *nmajor,
+                                        int maxlevels)
+{
+    int            i;
+    CSW_F          zt;
+
+    *nminor = 0;
+    *nmajor = 0;
+
+    if (Ncvals < 1) {
+        return 0;
+    }
+
+    for (i=0; i<Ncvals; i++) {
+        zt = Cvals[i].z;
+        if (zt > 1.e20f) continue;
+        zt += (CSW_F)GridShift;
+        if (Cvals[i].major) {
+            if (*nmajor < maxlevels) {
+                major[*nmajor] = zt;
+                (*nmajor)++;
+            }
+        }
+        else {
+            if (*nminor < maxlevels) {
+                minor[*nminor] = zt;
+                (*nminor)++;
+            }
+        }
+    }
+
+    return 1;
+
+}  /*  end of function con_get_contour_levels  */
+
+
+
 /*
  *************************************************************************************
 
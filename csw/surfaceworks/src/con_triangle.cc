@@ -21,8 +21,11 @@
 #include <math.h>
 #include <assert.h>
 
+#include <algorithm>
+
 #include "csw/utils/include/csw_.h"
 #include "csw/utils/private_include/csw_scope.h"
+#include "csw/utils/private_include/csw_parallel.h"
 
 #include "csw/surfaceworks/private_include/grd_fault.h"
 #include "csw/surfaceworks/private_include/grd_triangle_class.h"
@@ -571,7 +574,7 @@ int CSWConTriangle::con_contours_from_trimesh
                        int *numcontours,
                        COntourCalcOptions *options)
 {
-    int                i, istat, ival;
+    int                istat, ival;
 
     *contours = NULL;
     *numcontours = 0;
@@ -582,22 +585,22 @@ int CSWConTriangle::con_contours_from_trimesh
     };
     CSWScopeGuard func_scope_guard (fscope);
 
-    XconWork = (double *)csw_Malloc (numedges * 2 * sizeof(double));
-    if (!XconWork) {
-        return -1;
-    }
-    YconWork = XconWork + numedges;
-    NumConWork = 0;
-    MaxConWork = numedges;
-    ZvalSave = (double *)csw_Malloc (numnodes * sizeof(double));
-    if (!ZvalSave) {
-        return -1;
-    }
-
     con_calc_ptr->con_set_calc_options (options);
 
-    for (i=0; i<numnodes; i++) {
-        ZvalSave[i] = nodes[i].z;
+/*
+ * The tracing only needs the node coordinates and the connectivity,
+ * so a compact copy of the trimesh is used.  The node z values are
+ * adjusted in the copy, so the z values of the input nodes are not
+ * changed.
+ */
+    istat = grd_triangle_ptr->grd_build_compact_trimesh (
+        nodes, numnodes,
+        edges, numedges,
+        triangles, numtriangles,
+        &Cmesh);
+    if (istat == -1) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
 
     NodeList = nodes;
@@ -659,12 +662,15 @@ int CSWConTriangle::con_contours_from_trimesh
     }
 
     ContourBase = options->base_value;
+    ContourThreads = options->num_threads;
 
     ContourLines = NULL;
     NumContourLines = 0;
-    MaxContourLines = 0;
 
-    CalcContours ();
+    istat = CalcContours ();
+    if (istat == -1) {
+        return -1;
+    }
 
     *contours = ContourLines;
     *numcontours = NumContourLines;
@@ -688,16 +694,10 @@ int CSWConTriangle::con_contours_from_trimesh
 
 void CSWConTriangle::FreeMem (void)
 {
-    if (XconWork != NULL) {
-        csw_Free (XconWork);
+    FreeLevels ();
+    if (grd_triangle_ptr != NULL) {
+        grd_triangle_ptr->grd_free_compact_trimesh (&Cmesh);
     }
-    if (ZvalSave != NULL) {
-        csw_Free (ZvalSave);
-    }
-
-    XconWork = NULL;
-    YconWork = NULL;
-    ZvalSave = NULL;
 
     return;
 
@@ -713,70 +713,409 @@ void CSWConTriangle::FreeMem (void)
 
  *****************************************************************************
 
-    Trace all contour levels from the min to the max.
+    Trace all contour levels from the min to the max.  The edges are
+    first bucketed by the levels their z ranges cross, so each level
+    only looks at its own edges.  The levels do not share any tracing
+    state, so they are traced on up to ContourThreads threads.  The
+    lines are always output in level order, regardless of the number
+    of threads used.
 
 */
 
 int CSWConTriangle::CalcContours (void)
 {
-    int           i, istat, ival;
-    double        tiny;
+    int               i, istat, nthread, maxedge, ntot;
+    char              *tflags;
+    double            *xywork;
+    LEvelTraceStruct  *lt;
+
+    tflags = NULL;
+    xywork = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (tflags);
+        csw_Free (xywork);
+        FreeLevels ();
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    istat = BuildContourLevels ();
+    if (istat == -1) {
+        return -1;
+    }
+    if (NumLevels < 1) {
+        return 1;
+    }
+
+    istat = BuildLevelEdgeLists ();
+    if (istat == -1) {
+        return -1;
+    }
+
+/*
+ * Each thread needs its own edge flags and contour work arrays.
+ * A single contour line cannot have more points than its level
+ * has edges, plus one to close it.
+ */
+    maxedge = 0;
+    for (i=0; i<NumLevels; i++) {
+        if (LevelTrace[i].nedge > maxedge) {
+            maxedge = LevelTrace[i].nedge;
+        }
+    }
+    maxedge += 2;
+
+    nthread = CSWParallel::NumThreads (ContourThreads);
+    if (nthread > NumLevels) nthread = NumLevels;
+
+    tflags = (char *)csw_Calloc (nthread * (NumEdges + 1) * sizeof(char));
+    xywork = (double *)csw_Malloc (nthread * maxedge * 2 * sizeof(double));
+    if (tflags == NULL  ||  xywork == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    auto ftrace = [&](int ilevel, int ithread)
+    {
+        LEvelTraceStruct    *ltr;
+
+        ltr = LevelTrace + ilevel;
+        ltr->etflag = tflags + ithread * (NumEdges + 1);
+        ltr->xwork = xywork + ithread * maxedge * 2;
+        ltr->ywork = ltr->xwork + maxedge;
+        ltr->maxwork = maxedge;
+
+        ltr->istat = TraceContourLevel (ltr);
+
+        ltr->etflag = NULL;
+        ltr->xwork = NULL;
+        ltr->ywork = NULL;
+    };
+
+    CSWParallel::ForEach (nthread, NumLevels, ftrace);
+
+/*
+ * Move the lines from each level to the output list.
+ */
+    ntot = 0;
+    for (i=0; i<NumLevels; i++) {
+        lt = LevelTrace + i;
+        if (lt->istat == -1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        ntot += lt->nlines;
+    }
+    if (ntot < 1) {
+        return 1;
+    }
+
+    ContourLines = (COntourOutputRec *)csw_Malloc
+        (ntot * sizeof(COntourOutputRec));
+    if (ContourLines == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    ntot = 0;
+    for (i=0; i<NumLevels; i++) {
+        lt = LevelTrace + i;
+        if (lt->nlines > 0) {
+            memcpy (ContourLines + ntot, lt->lines,
+                    lt->nlines * sizeof(COntourOutputRec));
+            ntot += lt->nlines;
+        }
+        csw_Free (lt->lines);
+        lt->lines = NULL;
+        lt->nlines = 0;
+        lt->maxlines = 0;
+    }
+    NumContourLines = ntot;
+
+    return 1;
+
+}  /* end of private CalcContours function */
+
+
+
+
+/*
+ *****************************************************************************
+
+                 B u i l d C o n t o u r L e v e l s
+
+ *****************************************************************************
+
+    Fill in the LevelTrace array with one structure for each contour
+    level, in the order the levels are output.  For a contour interval,
+    the levels are calculated by the same repeated addition from the
+    minimum that has always been used.
+
+*/
+
+int CSWConTriangle::BuildContourLevels (void)
+{
+    int               i, n, ival;
+    double            level, tiny;
+    LEvelTraceStruct  *lt;
+
+    FreeLevels ();
+    LevelAdjust = 0.0;
+    LevelFudge = 0.0;
 
 /*
-    Do specifically designated contour levels.
+    Do specifically designated contour levels.  The node values
+    close to each level are adjusted on the fly while tracing.
 */
     if (ContourInterval <= 0.0) {
-        MajorFlag = 1;
+        n = Nmajor + Nminor;
+        if (n < 1) {
+            return 1;
+        }
+        LevelTrace = (LEvelTraceStruct *)csw_Calloc
+            (n * sizeof(LEvelTraceStruct));
+        if (LevelTrace == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        lt = LevelTrace;
         for (i=0; i<Nmajor; i++) {
-            ContourLevel = MajorList[i];
-            AdjustNodeValues ();
-            istat = TraceContourLevel ();
-            if (istat == -1) {
-                return -1;
-            }
+            lt->level = MajorList[i];
+            lt->major = 1;
+            lt++;
         }
-        MajorFlag = 0;
         for (i=0; i<Nminor; i++) {
-            ContourLevel = MinorList[i];
-            AdjustNodeValues ();
-            istat = TraceContourLevel ();
-            if (istat == -1) {
-                return -1;
-            }
+            lt->level = MinorList[i];
+            lt->major = 0;
+            lt++;
         }
+        NumLevels = n;
+        LevelAdjust = ZvalAdjust;
+        LevelFudge = ZvalAdjust * 5.0;
+        return 1;
     }
 
 /*
     Or, do a contour interval.
 */
-    else {
-        tiny = ContourInterval / 10.0;
-        AdjustNodesForInterval ();
-        ContourLevel = ContourMin;
-        for (;;) {
-            if (ContourLevel > ContourMax) {
-                break;
-            }
-            if (ContourLevel < 0.0) {
-                ival = (int)((ContourLevel - ContourBase - tiny) / ContourInterval);
-            }
-            else {
-                ival = (int)((ContourLevel - ContourBase + tiny) / ContourInterval);
-            }
-            MajorFlag = 0;
-            if (ival % MajorInterval == 0) {
-                MajorFlag = 1;
-            }
-            istat = TraceContourLevel ();
-            if (istat == -1) {
-                return -1;
-            }
-            ContourLevel += ContourInterval;
+    AdjustNodesForInterval ();
+
+    n = 0;
+    level = ContourMin;
+    while (level <= ContourMax) {
+        n++;
+        level += ContourInterval;
+    }
+    if (n < 1) {
+        return 1;
+    }
+
+    LevelTrace = (LEvelTraceStruct *)csw_Calloc
+        (n * sizeof(LEvelTraceStruct));
+    if (LevelTrace == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    tiny = ContourInterval / 10.0;
+    level = ContourMin;
+    for (i=0; i<n; i++) {
+        lt = LevelTrace + i;
+        if (level < 0.0) {
+            ival = (int)((level - ContourBase - tiny) / ContourInterval);
         }
+        else {
+            ival = (int)((level - ContourBase + tiny) / ContourInterval);
+        }
+        lt->level = level;
+        lt->major = 0;
+        if (MajorInterval > 0  &&  ival % MajorInterval == 0) {
+            lt->major = 1;
+        }
+        level += ContourInterval;
     }
+    NumLevels = n;
 
     return 1;
-}
+
+}  /* end of private BuildContourLevels function */
+
+
+
+
+/*
+ *****************************************************************************
+
+                 B u i l d L e v e l E d g e L i s t s
+
+ *****************************************************************************
+
+    Bucket the trimesh edges by the contour levels they can cross.  The
+    levels inside the z range of each edge are found by a binary search
+    of the sorted levels, so the cost is proportional to the number of
+    edge crossings rather than the number of edges times the number of
+    levels.  The edges are listed in ascending order for each level,
+    which is the order a full scan of the edges would visit them.
+
+*/
+
+int CSWConTriangle::BuildLevelEdgeLists (void)
+{
+    int               i, k, k1, k2, *sindex, *fill;
+    double            *slevel;
+    long              ntot;
+    LEvelTraceStruct  *lt;
+
+    sindex = NULL;
+    slevel = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (sindex);
+        csw_Free (slevel);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    sindex = (int *)csw_Malloc (NumLevels * 2 * sizeof(int));
+    slevel = (double *)csw_Malloc (NumLevels * sizeof(double));
+    if (sindex == NULL  ||  slevel == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    fill = sindex + NumLevels;
+
+    for (i=0; i<NumLevels; i++) {
+        sindex[i] = i;
+    }
+    std::stable_sort (sindex, sindex + NumLevels,
+        [&](int a, int b) {
+            return LevelTrace[a].level < LevelTrace[b].level;
+        });
+    for (i=0; i<NumLevels; i++) {
+        slevel[i] = LevelTrace[sindex[i]].level;
+    }
+
+/*
+ * Find the range of sorted levels strictly inside the z range of
+ * an edge.  If specific levels are being traced, a node can be
+ * moved up by LevelFudge for some levels, so the top of the range
+ * is extended by that much.  Edges with null nodes never cross.
+ */
+    auto frange = [&](int iedge, int *kk1, int *kk2) -> int
+    {
+        double      z1, z2, zt;
+
+        z1 = Cmesh.z[Cmesh.enodes[iedge*2]];
+        z2 = Cmesh.z[Cmesh.enodes[iedge*2+1]];
+
+        if (NullValue > 0.0) {
+            if (z1 >= NullValue  ||  z2 >= NullValue) return 0;
+        }
+        else {
+            if (z1 <= NullValue  ||  z2 <= NullValue) return 0;
+        }
+
+        if (z1 > z2) {
+            zt = z1;
+            z1 = z2;
+            z2 = zt;
+        }
+        if (z2 - z1 + LevelFudge <= Ztiny) return 0;
+        z2 += LevelFudge;
+
+        *kk1 = (int)(std::upper_bound (slevel, slevel + NumLevels, z1) - slevel);
+        *kk2 = (int)(std::lower_bound (slevel, slevel + NumLevels, z2) - slevel);
+        if (*kk1 >= *kk2) return 0;
+
+        return 1;
+    };
+
+    for (i=0; i<NumEdges; i++) {
+        if (frange (i, &k1, &k2) == 0) continue;
+        for (k=k1; k<k2; k++) {
+            LevelTrace[sindex[k]].nedge++;
+        }
+    }
+
+    ntot = 0;
+    for (i=0; i<NumLevels; i++) {
+        lt = LevelTrace + i;
+        lt->start = ntot;
+        ntot += lt->nedge;
+    }
+
+/*
+ * The memory functions take an int size.
+ */
+    if (ntot * (long)sizeof(int) > 2000000000L) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    if (ntot < 1) {
+        return 1;
+    }
+
+    LevelEdges = (int *)csw_Malloc (ntot * sizeof(int));
+    if (LevelEdges == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    memset (fill, 0, NumLevels * sizeof(int));
+    for (i=0; i<NumEdges; i++) {
+        if (frange (i, &k1, &k2) == 0) continue;
+        for (k=k1; k<k2; k++) {
+            lt = LevelTrace + sindex[k];
+            LevelEdges[lt->start + fill[sindex[k]]] = i;
+            fill[sindex[k]]++;
+        }
+    }
+
+    return 1;
+
+}  /* end of private BuildLevelEdgeLists function */
+
+
+
+
+/*
+ *****************************************************************************
+
+                         F r e e L e v e l s
+
+ *****************************************************************************
+
+    Free the level trace structures, any lines still attached to them
+    and the level edge lists.
+
+*/
+
+void CSWConTriangle::FreeLevels (void)
+{
+    int               i, j;
+    LEvelTraceStruct  *lt;
+
+    if (LevelTrace != NULL) {
+        for (i=0; i<NumLevels; i++) {
+            lt = LevelTrace + i;
+            if (lt->lines == NULL) continue;
+            for (j=0; j<lt->nlines; j++) {
+                csw_Free (lt->lines[j].x);
+            }
+            csw_Free (lt->lines);
+        }
+        csw_Free (LevelTrace);
+    }
+    csw_Free (LevelEdges);
+
+    LevelTrace = NULL;
+    LevelEdges = NULL;
+    NumLevels = 0;
+
+    return;
+
+}  /* end of private FreeLevels function */
 
 
 
@@ -791,75 +1130,91 @@ int CSWConTriangle::CalcContours (void)
  *********************************************************************************
 
     Trace all contours for a single contour level through a triangular mesh.
+    Only the edges in the bucket for the level are visited.  The edge flags
+    set while tracing are cleared before returning, so the flag array can
+    be reused for the next level done by the same thread.
 */
 
-int CSWConTriangle::TraceContourLevel (void)
+int CSWConTriangle::TraceContourLevel (LEvelTraceStruct *lt)
 {
-    int               i, istat;
-    EDgeStruct        *etmp;
+    int               i, k, istat;
+    int               *elist;
+    char              *etflag;
 
-    for (i=0; i<NumEdges; i++) {
-        EdgeList[i].tflag = 0;
-    }
+    elist = LevelEdges + lt->start;
+    etflag = lt->etflag;
 
 /*
     First, trace all contours that originate with an edge
     which only has a single triangle attached to it.
     These will be unclosed contours.
 */
-    for (i=0; i<NumEdges; i++) {
-        etmp = EdgeList + i;
-        if (etmp->tflag) {
+    for (k=0; k<lt->nedge; k++) {
+        i = elist[k];
+        if (etflag[i]) {
             continue;
         }
-        if (etmp->tri2 >= 0) {
+        if (Cmesh.etris[i*2+1] >= 0) {
             continue;
         }
-        istat = EdgeZrange (etmp);
+        istat = EdgeZrange (i, lt->level);
         if (istat == 0) {
             continue;
         }
 
-        TraceSingleContour (etmp);
+        istat = TraceSingleContour (i, lt);
+        if (istat == -1) {
+            return -1;
+        }
     }
 
 /*
     Trace any contours that start or end on faults.
 */
-    TracingFaultFlag = 1;
-    for (i=0; i<NumEdges; i++) {
-        etmp = EdgeList + i;
-        if (etmp->tflag) {
+    lt->tracing_fault = 1;
+    for (k=0; k<lt->nedge; k++) {
+        i = elist[k];
+        if (etflag[i]) {
             continue;
         }
-        if (etmp->flag == 0) {
+        if (Cmesh.eflags[i] == 0) {
             continue;
         }
-        istat = EdgeZrange (etmp);
+        istat = EdgeZrange (i, lt->level);
         if (istat == 0) {
             continue;
         }
 
-        TraceSingleContour (etmp);
+        istat = TraceSingleContour (i, lt);
+        if (istat == -1) {
+            return -1;
+        }
     }
-    TracingFaultFlag = 0;
+    lt->tracing_fault = 0;
 
 /*
     Next, trace any closed contours for this level.
     In this pass, any edge not already used is eligible
     as the start of a contour.
 */
-    for (i=0; i<NumEdges; i++) {
-        etmp = EdgeList + i;
-        if (etmp->tflag) {
+    for (k=0; k<lt->nedge; k++) {
+        i = elist[k];
+        if (etflag[i]) {
             continue;
         }
-        istat = EdgeZrange (etmp);
+        istat = EdgeZrange (i, lt->level);
         if (istat == 0) {
             continue;
         }
 
-        TraceSingleContour (etmp);
+        istat = TraceSingleContour (i, lt);
+        if (istat == -1) {
+            return -1;
+        }
+    }
+
+    for (k=0; k<lt->nedge; k++) {
+        etflag[elist[k]] = 0;
     }
 
     return 1;
@@ -877,45 +1232,49 @@ int CSWConTriangle::TraceContourLevel (void)
 
 */
 
-int CSWConTriangle::TraceSingleContour (EDgeStruct *estart)
+int CSWConTriangle::TraceSingleContour (int estart, LEvelTraceStruct *lt)
 {
-    int                next, t1, t2, first;
-    EDgeStruct         *enow, *exitedge;
+    int                next, t1, t2, first, enow, exitedge;
+    int                *etris;
 
-    NumConWork = 0;
-    next = estart->tri1;
+    etris = Cmesh.etris;
+
+    lt->nwork = 0;
+    next = etris[estart*2];
     enow = estart;
-    AddEdgePoint (estart);
+    AddEdgePoint (estart, lt);
 
     first = 1;
     for (;;) {
 
         if (next < 0) break;
-        exitedge = FindExitEdge (enow, TriangleList + next);
-        if (exitedge == NULL) {
-            if (TracingFaultFlag  &&  first == 1  &&  next == estart->tri1) {
-                next = estart->tri2;
+        exitedge = FindExitEdge (enow, next, lt);
+        if (exitedge < 0) {
+            if (lt->tracing_fault  &&  first == 1  &&
+                next == etris[estart*2]) {
+                next = etris[estart*2+1];
                 continue;
             }
             break;
         }
-        if (TracingFaultFlag == 1  &&
-            exitedge->flag == GRD_TRIMESH_INSIDE_FAULT) {
-            if (next == estart->tri2) break;
+        if (lt->tracing_fault == 1  &&
+            Cmesh.eflags[exitedge] == GRD_TRIMESH_INSIDE_FAULT) {
+            if (next == etris[estart*2+1]) break;
             if (first == 0) break;
-            if (NumConWork > 1) break;
-            next = estart->tri2;
+            if (lt->nwork > 1) break;
+            next = etris[estart*2+1];
             continue;
         }
-        AddEdgePoint (exitedge);
+        if (lt->nwork >= lt->maxwork) break;
+        AddEdgePoint (exitedge, lt);
         if (exitedge == estart) break;
         if (first) {
-            SetDownhill (estart, exitedge);
+            SetDownhill (estart, exitedge, lt);
             first = 0;
         }
-        if (exitedge->flag != 0) break;
-        t1 = exitedge->tri1;
-        t2 = exitedge->tri2;
+        if (Cmesh.eflags[exitedge] != 0) break;
+        t1 = etris[exitedge*2];
+        t2 = etris[exitedge*2+1];
         if (t1 != next) {
             next = t1;
         }
@@ -926,9 +1285,7 @@ int CSWConTriangle::TraceSingleContour (EDgeStruct *estart)
         enow = exitedge;
     }
 
-    OutputContourLine ();
-
-    return 1;
+    return OutputContourLine (lt);
 }
 
 
@@ -947,46 +1304,27 @@ int CSWConTriangle::TraceSingleContour (EDgeStruct *estart)
 
 */
 
-EDgeStruct *CSWConTriangle::FindExitEdge
-                                (EDgeStruct *enow,
-                                 TRiangleStruct *tnow)
+int CSWConTriangle::FindExitEdge (int enow, int tnow, LEvelTraceStruct *lt)
 {
-    EDgeStruct        *etmp;
+    int               k, etmp;
+    int               *tedges;
 
-    etmp = EdgeList + tnow->edge1;
-    if (etmp != enow) {
-        if (enow->flag != 0  &&  etmp->flag != 0) {
-        }
-        else {
-            if (EdgeZrange(etmp) == 1) {
-                return etmp;
-            }
-        }
-    }
+    tedges = Cmesh.tedges + tnow * 3;
 
-    etmp = EdgeList + tnow->edge2;
-    if (etmp != enow) {
-        if (enow->flag != 0  &&  etmp->flag != 0) {
-        }
-        else {
-            if (EdgeZrange(etmp) == 1) {
-                return etmp;
-            }
+    for (k=0; k<3; k++) {
+        etmp = tedges[k];
+        if (etmp == enow) {
+            continue;
         }
-    }
-
-    etmp = EdgeList + tnow->edge3;
-    if (etmp != enow) {
-        if (enow->flag != 0  &&  etmp->flag != 0) {
+        if (Cmesh.eflags[enow] != 0  &&  Cmesh.eflags[etmp] != 0) {
+            continue;
         }
-        else {
-            if (EdgeZrange(etmp) == 1) {
-                return etmp;
-            }
+        if (EdgeZrange(etmp, lt->level) == 1) {
+            return etmp;
         }
     }
 
-    return NULL;
+    return -1;
 }
 
 
@@ -1005,32 +1343,32 @@ EDgeStruct *CSWConTriangle::FindExitEdge
 
 */
 
-void CSWConTriangle::AddEdgePoint (EDgeStruct *enow)
+void CSWConTriangle::AddEdgePoint (int enow, LEvelTraceStruct *lt)
 {
-    NOdeStruct        *nptr;
+    int               n1, n2;
     double            x1, y1, z1, x2, y2, z2,
                       xt, yt, pct;
 
-    nptr = NodeList + enow->node1;
-    x1 = nptr->x;
-    y1 = nptr->y;
-    z1 = nptr->z;
-    nptr = NodeList + enow->node2;
-    x2 = nptr->x;
-    y2 = nptr->y;
-    z2 = nptr->z;
+    n1 = Cmesh.enodes[enow*2];
+    n2 = Cmesh.enodes[enow*2+1];
+    x1 = Cmesh.x[n1];
+    y1 = Cmesh.y[n1];
+    z1 = NodeZ (n1, lt->level);
+    x2 = Cmesh.x[n2];
+    y2 = Cmesh.y[n2];
+    z2 = NodeZ (n2, lt->level);
 
-    pct = (ContourLevel - z1) / (z2 - z1);
+    pct = (lt->level - z1) / (z2 - z1);
 
     xt = x1 + pct * (x2 - x1);
     yt = y1 + pct * (y2 - y1);
 
-    XconWork[NumConWork] = xt;
-    YconWork[NumConWork] = yt;
+    lt->xwork[lt->nwork] = xt;
+    lt->ywork[lt->nwork] = yt;
 
-    NumConWork++;
+    lt->nwork++;
 
-    enow->tflag = 1;
+    lt->etflag[enow] = 1;
 
     return;
 }
@@ -1038,6 +1376,7 @@ void CSWConTriangle::AddEdgePoint (EDgeStruct *enow)
 
 
 
+
 /*
  *************************************************************************
 
@@ -1058,7 +1397,7 @@ int CSWConTriangle::PointLimits (void)
     z2 = -1.e30;
 
     for (i=0; i<NumNodes; i++) {
-        zt = NodeList[i].z;
+        zt = Cmesh.z[i];
         if (zt >= NullValue) continue;
         if (zt < z1) z1 = zt;
         if (zt > z2) z2 = zt;
@@ -1086,54 +1425,54 @@ int CSWConTriangle::PointLimits (void)
 
  ***************************************************************************
 
-  Add a contour line to the output array of contour lines.
+  Add a contour line to the output lines of the level being traced.
 
 */
 
-int CSWConTriangle::OutputContourLine (void)
+int CSWConTriangle::OutputContourLine (LEvelTraceStruct *lt)
 {
-    int              i;
+    int              i, nwork;
     CSW_F            *fx, *fy;
     COntourOutputRec *crec;
 
     int              do_write;
     double           v6[6];
 
-    if (NumConWork < 2) return 1;
+    nwork = lt->nwork;
+    if (nwork < 2) return 1;
 
-    if (NumContourLines >= MaxContourLines) {
-        MaxContourLines += CONTOUR_LINE_CHUNK;
-        ContourLines = (COntourOutputRec *)csw_Realloc
-                 (ContourLines, MaxContourLines*sizeof(COntourOutputRec));
-        if (!ContourLines) {
+    if (lt->nlines >= lt->maxlines) {
+        lt->maxlines += CONTOUR_LINE_CHUNK;
+        crec = (COntourOutputRec *)csw_Realloc
+                 (lt->lines, lt->maxlines*sizeof(COntourOutputRec));
+        if (!crec) {
             return -1;
         }
+        lt->lines = crec;
     }
 
-    crec = ContourLines + NumContourLines;
-    NumContourLines++;
-
-    crec->zvalue = (CSW_F)ContourLevel;
-    con_calc_ptr->con_format_number (crec->zvalue, (CSW_F)LogBase, crec->text);
-    crec->npts = NumConWork;
-
-    fx = (CSW_F *)csw_Malloc (NumConWork * 2 * sizeof(CSW_F));
+    fx = (CSW_F *)csw_Malloc (nwork * 2 * sizeof(CSW_F));
     if (fx == NULL) {
-        grd_utils_ptr->grd_set_err (1);
         return -1;
     }
-    fy = fx + NumConWork;
+    fy = fx + nwork;
 
-    for (i=0; i<NumConWork; i++) {
-        fx[i] = (CSW_F)XconWork[i];
-        fy[i] = (CSW_F)YconWork[i];
+    for (i=0; i<nwork; i++) {
+        fx[i] = (CSW_F)lt->xwork[i];
+        fy[i] = (CSW_F)lt->ywork[i];
     }
 
+    crec = lt->lines + lt->nlines;
+    lt->nlines++;
+
+    crec->zvalue = (CSW_F)lt->level;
+    con_calc_ptr->con_format_number (crec->zvalue, (CSW_F)LogBase, crec->text);
+    crec->npts = nwork;
     crec->x = fx;
     crec->y = fy;
-    crec->major = (char)MajorFlag;
-    crec->downhill = (char)DownhillFlag;
-    crec->closure = (char)ClosureFlag;
+    crec->major = (char)lt->major;
+    crec->downhill = (char)lt->downhill;
+    crec->closure = (char)lt->closure;
     crec->local_min_max = 0;
     crec->expect_double = 0;
     crec->faultflag = 0;
@@ -1142,10 +1481,10 @@ int CSWConTriangle::OutputContourLine (void)
 
     do_write = csw_GetDoWrite ();
     if (do_write == 1) {
-        grd_fileio_ptr->grd_write_points (XconWork,
-                         YconWork,
-                         YconWork,
-                         NumConWork,
+        grd_fileio_ptr->grd_write_points (lt->xwork,
+                         lt->ywork,
+                         lt->ywork,
+                         nwork,
                          (char *)"contour.xyz");
         grd_fileio_ptr->grd_write_text_tri_mesh_file (
                          0, v6,
@@ -1164,34 +1503,32 @@ int CSWConTriangle::OutputContourLine (void)
 /*
  *****************************************************************************
 
-                     A d j u s t N o d e V a l u e s
+                              N o d e Z
 
  *****************************************************************************
 
-    Adjust any node z values that are almost exactly on a contour level.
+    Return the z value of a node as seen by the specified contour level.
+    When specific contour levels are traced, a node almost exactly on the
+    level is moved up slightly so the contour does not pass through the
+    node.  This is done here rather than in the trimesh copy because
+    several levels may be traced at the same time.
 
 */
 
-int CSWConTriangle::AdjustNodeValues (void)
+double CSWConTriangle::NodeZ (int inode, double level)
 {
-    int                       i;
     double                    z1, zt;
-    double                    tiny, fudge;
 
-    tiny = ZvalAdjust;
-    fudge = tiny * 5.0;
+    z1 = Cmesh.z[inode];
+    if (LevelAdjust <= 0.0) return z1;
+    if (z1 > NullValue) return z1;
 
-    for (i=0; i<NumNodes; i++) {
-        NodeList[i].z = ZvalSave[i];
-        z1 = NodeList[i].z;
-        if (z1 > NullValue) continue;
-        zt = z1 - ContourLevel;
-        if (zt > -tiny  &&  zt < tiny) {
-            NodeList[i].z = z1 + fudge;
-        }
+    zt = z1 - level;
+    if (zt > -LevelAdjust  &&  zt < LevelAdjust) {
+        z1 += LevelFudge;
     }
 
-    return 1;
+    return z1;
 }
 
 
@@ -1203,20 +1540,17 @@ int CSWConTriangle::AdjustNodeValues (void)
 
  ****************************************************************************
 
-  Return 1 if the specified edge has a z range which bounds the current
+  Return 1 if the specified edge has a z range which bounds the specified
   contour level.  Return zero if not.
 
 */
 
-int CSWConTriangle::EdgeZrange (EDgeStruct *e)
+int CSWConTriangle::EdgeZrange (int iedge, double level)
 {
-    NOdeStruct     *nptr;
     double         z1, z2, dz;
 
-    nptr = NodeList + e->node1;
-    z1 = nptr->z;
-    nptr = NodeList + e->node2;
-    z2 = nptr->z;
+    z1 = NodeZ (Cmesh.enodes[iedge*2], level);
+    z2 = NodeZ (Cmesh.enodes[iedge*2+1], level);
 
     if (NullValue > 0.0) {
         if (z1 >= NullValue  ||  z2 >= NullValue) return 0;
@@ -1225,7 +1559,7 @@ int CSWConTriangle::EdgeZrange (EDgeStruct *e)
         if (z1 <= NullValue  ||  z2 <= NullValue) return 0;
     }
 
-    if ((z1 - ContourLevel) * (ContourLevel - z2) <= 0.0) return 0;
+    if ((z1 - level) * (level - z2) <= 0.0) return 0;
 
     dz = z1 - z2;
     if (dz < 0.0) dz = -dz;
@@ -1258,30 +1592,33 @@ int CSWConTriangle::EdgeZrange (EDgeStruct *e)
 
 */
 
-void CSWConTriangle::SetDownhill (EDgeStruct *e1, EDgeStruct *e2)
+void CSWConTriangle::SetDownhill (int e1, int e2, LEvelTraceStruct *lt)
 {
     int                 common_node, orientation;
+    int                 *en1, *en2;
     double              x1, y1, x2, y2, x3, y3, zt, area;
 
 /*
     First, get the segment points and the common node point.
 */
-    x1 = XconWork[0];
-    y1 = YconWork[0];
-    x2 = XconWork[1];
-    y2 = YconWork[1];
-    if (e1->node1 == e2->node1) {
-        common_node = e1->node1;
-    }
-    else if (e1->node1 == e2->node2) {
-        common_node = e1->node1;
+    x1 = lt->xwork[0];
+    y1 = lt->ywork[0];
+    x2 = lt->xwork[1];
+    y2 = lt->ywork[1];
+    en1 = Cmesh.enodes + e1 * 2;
+    en2 = Cmesh.enodes + e2 * 2;
+    if (en1[0] == en2[0]) {
+        common_node = en1[0];
+    }
+    else if (en1[0] == en2[1]) {
+        common_node = en1[0];
     }
     else {
-        common_node = e1->node2;
+        common_node = en1[1];
     }
-    x3 = NodeList[common_node].x;
-    y3 = NodeList[common_node].y;
-    zt = NodeList[common_node].z;
+    x3 = Cmesh.x[common_node];
+    y3 = Cmesh.y[common_node];
+    zt = NodeZ (common_node, lt->level);
 
 /*
     If the triangle area is positive, the orientation is
@@ -1295,11 +1632,11 @@ void CSWConTriangle::SetDownhill (EDgeStruct *e1, EDgeStruct *e2)
         orientation = 1;
     }
 
-    if (zt < ContourLevel) {
-        DownhillFlag = -orientation;
+    if (zt < lt->level) {
+        lt->downhill = -orientation;
     }
     else {
-        DownhillFlag = orientation;
+        lt->downhill = orientation;
     }
 
     return;
@@ -1340,8 +1677,8 @@ int CSWConTriangle::SetContourLimits (void)
 
     nlist = 0;
     for (i=0; i<NumNodes; i++) {
-        if (NodeList[i].deleted) continue;
-        zlist[nlist] = (CSW_F)NodeList[i].z;
+        if (Cmesh.ndeleted[i]) continue;
+        zlist[nlist] = (CSW_F)Cmesh.z[i];
         nlist++;
     }
 
@@ -1388,7 +1725,7 @@ void CSWConTriangle::AdjustNodesForInterval (void)
     fudge = ZvalAdjust * 5.0;
 
     for (i=0; i<NumNodes; i++) {
-        z = NodeList[i].z;
+        z = Cmesh.z[i];
         if (z > NullValue) continue;
         ival = (int)((z - ContourBase) / ContourInterval);
         zt1 = ival * ContourInterval;
@@ -1401,7 +1738,7 @@ void CSWConTriangle::AdjustNodesForInterval (void)
         dz3 = z - zt3;
         if (dz3 < 0.0) dz3 = -dz3;
         if (dz1 <= ZvalAdjust  ||  dz2 <= ZvalAdjust  ||  dz3 <= ZvalAdjust) {
-            NodeList[i].z += fudge;
+            Cmesh.z[i] += fudge;
         }
     }
 
@@ -2241,103 +2578,73 @@ double CSWConTriangle::EdgeLength (int iedge)
 
 int CSWConTriangle::CalcNodeNormals (void)
 {
-    int              i, n1, n2, n3,
-                     count;
-    TRiNormStruct    *norm, *norm2;
-    TRiangleStruct   *tptr;
+    int              i, count, *ncount = NULL;
+    double           *nnx = NULL, *nny, *nnz;
+    TRiNormStruct    *norm;
     NOdeStruct       *nptr;
 
+
+    auto fscope = [&]()
+    {
+        csw_Free (nnx);
+        csw_Free (ncount);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+
 /*
  * Make sure the node normals are cleaned up.
  */
     CleanupNodeNormals ();
 
+    if (NumNodes < 1) {
+        return 1;
+    }
+
 /*
- * Sum the count and normals arrays whenever a node
- * is used in a triangle.
+ * Sum the count and normals of the triangles using each node.
+ * This is done in parallel by the trimesh object.
  */
-    for (i=0; i<NumTriangles; i++) {
-
-        tptr = TriangleList + i;
-        if (tptr->deleted == 1) continue;
-        norm = tptr->norm;
-        if (norm == NULL) continue;
-
-        grd_triangle_ptr->grd_get_nodes_for_triangle (
-            tptr, EdgeList,
-            &n1, &n2, &n3);
-        if (n1 < 0  ||  n2 < 0  ||  n3 < 0) {
-            assert (0);
-        }
-
-        nptr = NodeList + n1;
-        norm2 = nptr->norm;
-        if (norm2 == NULL) {
-            norm2 = (TRiNormStruct *)csw_Calloc (sizeof(TRiNormStruct));
-        }
-        if (norm2 == NULL) {
-            CleanupNodeNormals ();
-            return -1;
-        }
-        nptr->norm = norm2;
-        norm2->nx += norm->nx;
-        norm2->ny += norm->ny;
-        norm2->nz += norm->nz;
-        norm2->count++;
-
-        nptr = NodeList + n2;
-        norm2 = nptr->norm;
-        if (norm2 == NULL) {
-            norm2 = (TRiNormStruct *)csw_Calloc (sizeof(TRiNormStruct));
-        }
-        if (norm2 == NULL) {
-            CleanupNodeNormals ();
-            return -1;
-        }
-        nptr->norm = norm2;
-        norm2->nx += norm->nx;
-        norm2->ny += norm->ny;
-        norm2->nz += norm->nz;
-        norm2->count++;
-
-        nptr = NodeList + n3;
-        norm2 = nptr->norm;
-        if (norm2 == NULL) {
-            norm2 = (TRiNormStruct *)csw_Calloc (sizeof(TRiNormStruct));
-        }
-        if (norm2 == NULL) {
-            CleanupNodeNormals ();
-            return -1;
-        }
-        nptr->norm = norm2;
-        norm2->nx += norm->nx;
-        norm2->ny += norm->ny;
-        norm2->nz += norm->nz;
-        norm2->count++;
-
+    nnx = (double *)csw_Malloc (NumNodes * 3 * sizeof(double));
+    ncount = (int *)csw_Malloc (NumNodes * sizeof(int));
+    if (nnx == NULL  ||  ncount == NULL) {
+        return -1;
     }
+    nny = nnx + NumNodes;
+    nnz = nny + NumNodes;
+
+    grd_triangle_ptr->grd_sum_node_normals (
+        NumNodes,
+        EdgeList,
+        TriangleList, NumTriangles,
+        NULL, NULL, NULL,
+        nnx, nny, nnz, ncount);
 
 /*
  * Calculate averages at each node that is used in
- * at least one triangle.
+ * at least one triangle.  A deleted node used by a
+ * triangle gets the sums, but is not averaged.
  */
     for (i=0; i<NumNodes; i++) {
         nptr = NodeList + i;
-        if (nptr->deleted == 1) continue;
-        if (nptr->norm == NULL) {
-            nptr->norm = (TRiNormStruct *)csw_Calloc (sizeof(TRiNormStruct));
-            if (nptr->norm == NULL) {
-                CleanupNodeNormals ();
-                return -1;
-            }
-            nptr->norm->nz = 1.0;
+        count = ncount[i];
+        if (nptr->deleted == 1  &&  count == 0) continue;
+        norm = (TRiNormStruct *)csw_Calloc (sizeof(TRiNormStruct));
+        if (norm == NULL) {
+            CleanupNodeNormals ();
+            return -1;
+        }
+        nptr->norm = norm;
+        norm->count = count;
+        if (nptr->deleted == 1) {
+            norm->nx = nnx[i];
+            norm->ny = nny[i];
+            norm->nz = nnz[i];
         }
-        norm = nptr->norm;
-        if (norm->count > 0) {
-            count = norm->count;
-            norm->nx /= count;
-            norm->ny /= count;
-            norm->nz /= count;
+        else if (count > 0) {
+            norm->nx = nnx[i] / count;
+            norm->ny = nny[i] / count;
+            norm->nz = nnz[i] / count;
         }
         else {
             norm->nx = 0.0;
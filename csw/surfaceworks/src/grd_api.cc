@@ -31,6 +31,7 @@
 
 #include "csw/utils/include/csw_.h"
 #include "csw/utils/private_include/csw_scope.h"
+#include "csw/utils/private_include/csw_parallel.h"
 #include "csw/utils/private_include/simulP.h"
 #include "csw/utils/private_include/gpf_utils.h"
 
@@ -89,38 +90,812 @@ void CSWGrdAPI::grd_SetNoisyDataFlag (int ndf) {
 
 
 
+
+/*
+  ****************************************************************
+
+             g r d _ B e g i n C a l c S e s s i o n
+
+  ****************************************************************
+
+  function name:    grd_BeginCalcSession            (int)
+
+  call sequence:    grd_BeginCalcSession ()
+
+  purpose:          Start a gridding session.  While the session is
+                    active, the data tables and trend surface derived
+                    from the input points are kept between grd_CalcGrid
+                    calls.  Repeated calls with the same points, faults
+                    and grid geometry skip rebuilding them, so only
+                    changing options such as min/max clipping or the
+                    boundary margins is much faster.  Faulted grids do
+                    not use the session.
+
+  return value:     Always 1.
+
+*/
+
+int CSWGrdAPI::grd_BeginCalcSession (void)
+{
+    int           istat;
+
+    istat = grd_calc_obj->grd_begin_calc_session ();
+    return istat;
+
+}  /*  end of function grd_BeginCalcSession  */
+
+
+
+
+/*
+  ****************************************************************
+
+               g r d _ E n d C a l c S e s s i o n
+
+  ****************************************************************
+
+  function name:    grd_EndCalcSession              (int)
+
+  call sequence:    grd_EndCalcSession ()
+
+  purpose:          End the current gridding session and free the
+                    data kept by it.
+
+  return value:     Always 1.
+
+*/
+
+int CSWGrdAPI::grd_EndCalcSession (void)
+{
+    int           istat;
+
+    istat = grd_calc_obj->grd_end_calc_session ();
+    return istat;
+
+}  /*  end of function grd_EndCalcSession  */
+
+
+
+
+/*
+  ****************************************************************
+
+              g r d _ S e t C a l c O p t i o n s
+
+  ****************************************************************
+
+  function name:    grd_SetCalcOptions               (int)
+
+  call sequence:    grx_SetCalcOption (options)
+
+  purpose:          Set all options prior to calling grd_CalcGrid.
+
+  return value:     status code
+
+                    1 = success
+                   -1 = unknown tag
+
+  calling parameters:
+
+    options    r  GRidCalcOptions*   Pointer to grid option structure.
+
+*/
+
+int CSWGrdAPI::grd_SetCalcOptions (GRidCalcOptions *options)
+{
+    int           istat;
+
+    istat = grd_calc_obj->grd_set_calc_options (options);
+    return istat;
+
+}  /*  end of function grd_SetCalcOptions  */
+
+
+
+
+/*
+  ****************************************************************
+
+           g r d _ D e f a u l t C a l c O p t i o n s
+
+  ****************************************************************
+
+  function name:    grd_DefaultCalcOptions               (int)
+
+  call sequence:    grx_DefaultCalcOption (options)
+
+  purpose:          Default all options prior to calling grd_CalcGrid.
+
+  return value:     status code
+
+                    1 = success
+                   -1 = unknown tag
+
+  calling parameters:
+
+    options    r  GRidCalcOptions*   Pointer to grid option structure.
+
+*/
+
+int CSWGrdAPI::grd_DefaultCalcOptions (GRidCalcOptions *options)
+{
+    int           istat;
+
+    istat = grd_calc_obj->grd_default_calc_options (options);
+    return istat;
+
+}  /*  end of function grd_DefaultCalcOptions  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                     g r d _ C a l c G r i d
+
+  ****************************************************************
+
+  function name:    grd_CalcGrid              (int)
+
+  call sequence:    grd_CalcGrid (x, y, z, error, npts,
+                                  grid, mask, report, ncol, nrow,
+                                  x1, y1, x2, y2,
+                                  faults, nfaults, options)
+
+  purpose:          Calculate a uniform grid by interpolating the
+                    specified data points.  The errors between input
+                    points and the grid's estimate can be returned
+                    in the error array.  A mask specifying which
+                    grid points are outside the data area or
+                    inside but far from control points can also
+                    be returned in the mask array.  This function only
+                    supports non faulted continuous surfaces.
+
+                    The grid must have at least 2 columns and 2 rows.
+                    The upper limit of grid size is controlled by available
+                    virtual memory.  The algorithm needs workspace about 5
+                    times the size of the grid, plus workspace about twice
+                    the size of the data array.  For example, calculating
+                    a 1000 by 1000 grid from 100000 points would need about
+                    21 to 22 megabytes of work space.  Memory allocation errors
+                    are generally caused by grids too large for available
+                    memory.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           1 = memory allocation error
+                    2 = A NULL x, y, z, or grid array is specified.
+                    3 = A wild parameter was encountered.
+                    4 = ncol or nrow is less than 2
+                    5 = x2 less than x1 or y2 less than y1
+                    6 = npts less than 3
+                    7 = number of points actually in the data area
+                        is less than 3
+                    8 = The points are distributed in a manner that
+                        cannot be fit with a trend surface (probably
+                        all points are coincident or colinear).
+                    9 = The fault data are inconsistent.  Either faults is not
+                        null and nfaults is zero, or faults is NULL and nfaults
+                        is greater than zero.
+                    11= Too many (>5000) points lie almost exactly on top of
+                        a fault.
+                    99 = The range of the x and or y values is too small
+                        relative to the values to support CSW_F arithmetic.
+
+
+  calling parameters:
+
+    x        r    CSW_F*    Array of x coordinates
+    y        r    CSW_F*    Array of y coordinates
+    z        r    CSW_F*    Array of z values at the x,y coordinates
+    error    w    CSW_F*    Optional array to receive errors at the
+                                input points.  Set to NULL if not wanted.
+    npts     r    int           Number of points in x, y, z and error.
+    grid     w    CSW_F*    Array to receive the grid values.
+    mask     w    char*         Optional array to receive a mask specifying
+                                whether a grid node is outside the data
+                                area, inside and well defined, or inside
+                                and poorly defined.  A well defined node
+                                has a mask value of zero.  A node outside
+                                the data area has a mask value of 1.  A
+                                poorly defined inside node has a mask
+                                value of 2.  Specify a NULL pointer to
+                                disable this feature.
+    report   w    char**        If this is not null a report of the grid
+                                vital statistics is returned in the pointer.
+    ncol     r    int           Number of columns in the grid and mask.
+    nrow     r    int           Number of rows in the grid and mask.
+    x1       r    CSW_F     Minimum x coordinate of the grid.
+    y1       r    CSW_F     Minimum y coordinate of the grid.
+    x2       r    CSW_F     Maximum x coordinate of the grid.
+    y2       r    CSW_F     Maximum y coordinate of the grid.
+    faults   r    FAultLineStruct*
+                                List of fault lines structures.
+    nfaults  r    int           Number of fault line structures.
+    options  r    GRidCalcOptions*
+                                Optional option record pointer.  If NULL,
+                                the global option state is used.  If not
+                                NULL, options are taken from this structure
+                                for this calculation only.
+
+
+*/
+
+int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npts,
+                  CSW_F *grid, char *mask, char **report, int ncol, int nrow,
+                  CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+                  FAultLineStruct *faults, int nfaults,
+                  GRidCalcOptions *options)
+{
+    int           istat, fsave, i;
+    CSW_F         xmin, ymin;
+
+
+    if (npts < -WildInt  ||  npts > WildInt) {
+        grd_utils_obj.grd_set_err (3);
+        return -1;
+    }
+
+    if (grid == NULL) {
+        grd_utils_obj.grd_set_err (2);
+        return -1;
+    }
+
+/*
+    check the range of the input x and y values to see
+    if it can support CSW_F precision arithmetic.
+*/
+    istat = csw_CheckRange (x, npts);
+    if (!istat) {
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    istat = csw_CheckRange (y, npts);
+    if (!istat) {
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    if (faults  &&  nfaults < 1) {
+        grd_utils_obj.grd_set_err (9);
+        return -1;
+    }
+
+    if (!faults  &&  nfaults > 0) {
+        grd_utils_obj.grd_set_err (9);
+        return -1;
+    }
+
+/*
+    subtract minimum x and y values from point arrays
+*/
+    xmin = 1.e30f;
+    ymin = 1.e30f;
+    for (i=0; i<npts; i++) {
+        if (x[i] < xmin) xmin = x[i];
+        if (y[i] < ymin) ymin = y[i];
+    }
+
+    for (i=0; i<npts; i++) {
+        x[i] -= xmin;
+        y[i] -= ymin;
+    }
+    x1 -= xmin;
+    y1 -= ymin;
+    x2 -= xmin;
+    y2 -= ymin;
+
+    grd_calc_obj->grd_set_output_shifts (xmin, ymin);
+
+/*
+    Define the fault vectors and set the faulting option.
+*/
+    fsave = 0;
+    grd_fault_obj.grd_free_faults ();
+    if (faults  &&  nfaults > 0) {
+
+        istat = grd_fault_obj.grd_define_and_shift_fault_vectors (faults, nfaults, xmin, ymin);
+        if (istat == -1) {
+            return -1;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 1, 0.0f);
+        if (options) {
+            fsave = options->faulted_flag;
+            options->faulted_flag = 1;
+        }
+    }
+
+    istat = grd_calc_obj->grd_calc_grid (x, y, z, error, npts,
+                           grid, mask, report, ncol, nrow,
+                           x1, y1, x2, y2, options);
+
+    if (istat == -1  &&  options) {
+        options->error_number = grd_GetErr ();
+    }
+
+    if (faults  &&  nfaults > 0) {
+        if (options) {
+            options->faulted_flag = fsave;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 0, 0.0f);
+    }
+
+    grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
+
+    for (i=0; i<npts; i++) {
+        x[i] += xmin;
+        y[i] += ymin;
+    }
+
+    return istat;
+
+}  /*  end of function grd_CalcGrid  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                g r d _ C a l c G r i d T i l e d
+
+  ****************************************************************
+
+  function name:    grd_CalcGridTiled         (int)
+
+  call sequence:    grd_CalcGridTiled (x, y, z, npts,
+                                       filename, comment, ncol, nrow,
+                                       x1, y1, x2, y2,
+                                       faults, nfaults,
+                                       tile_size, options)
+
+  purpose:          Calculate a grid that is too large to fit in memory
+                    and write it, with its mask, to a grid file that can
+                    be read with grd_ReadFile.  The grid is calculated a
+                    tile at a time, with each tile extended by a halo of
+                    overlapping nodes, and each finished tile is written
+                    to scratch files right away.  The workspace needed is
+                    about what grd_CalcGrid needs for a single tile plus
+                    its halo, plus scratch disk space of about 9 bytes per
+                    grid node in the current directory.
+
+                    The nodes at the tile seams are not exactly the same
+                    as a single grd_CalcGrid result.  Where the nodes are
+                    surrounded by data they match to about 0.1 percent of
+                    the z range of the data.  Near the edge of the data and
+                    outside of it, they can differ by a few percent.  See
+                    grd_calc_grid_tiled in grd_calc.cc for details.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           Same as grd_CalcGrid, plus the file errors from
+                    grd_WriteFile.
+
+  calling parameters:
+
+    x          r    CSW_F*    Array of x coordinates
+    y          r    CSW_F*    Array of y coordinates
+    z          r    CSW_F*    Array of z values at the x,y coordinates
+    npts       r    int       Number of points in x, y, and z.
+    filename   r    char*     Grid file to write, relative to the current
+                              directory.
+    comment    r    char*     Optional comment up to 200 bytes long.
+    ncol       r    int       Number of columns in the grid.
+    nrow       r    int       Number of rows in the grid.
+    x1         r    CSW_F     Minimum x coordinate of the grid.
+    y1         r    CSW_F     Minimum y coordinate of the grid.
+    x2         r    CSW_F     Maximum x coordinate of the grid.
+    y2         r    CSW_F     Maximum y coordinate of the grid.
+    faults     r    FAultLineStruct*
+                              List of fault lines structures.
+    nfaults    r    int       Number of fault line structures.
+    tile_size  r    int       Number of rows and columns in each tile,
+                              or zero for the default of 1000.
+    options    r    GRidCalcOptions*
+                              Optional option record pointer, as for
+                              grd_CalcGrid.
+
+*/
+
+int CSWGrdAPI::grd_CalcGridTiled (CSW_F *x, CSW_F *y, CSW_F *z, int npts,
+                  const char *filename, const char *comment,
+                  int ncol, int nrow,
+                  CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+                  FAultLineStruct *faults, int nfaults,
+                  int tile_size, GRidCalcOptions *options)
+{
+    int           istat, fsave, i;
+    CSW_F         xmin, ymin;
+
+
+    if (npts < -WildInt  ||  npts > WildInt) {
+        grd_utils_obj.grd_set_err (3);
+        return -1;
+    }
+
+    if (x == NULL  ||  y == NULL  ||  z == NULL  ||  filename == NULL) {
+        grd_utils_obj.grd_set_err (2);
+        return -1;
+    }
+
+/*
+    check the range of the input x and y values to see
+    if it can support CSW_F precision arithmetic.
+*/
+    istat = csw_CheckRange (x, npts);
+    if (!istat) {
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    istat = csw_CheckRange (y, npts);
+    if (!istat) {
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    if (faults  &&  nfaults < 1) {
+        grd_utils_obj.grd_set_err (9);
+        return -1;
+    }
+
+    if (!faults  &&  nfaults > 0) {
+        grd_utils_obj.grd_set_err (9);
+        return -1;
+    }
+
+/*
+    subtract minimum x and y values from point arrays
+*/
+    xmin = 1.e30f;
+    ymin = 1.e30f;
+    for (i=0; i<npts; i++) {
+        if (x[i] < xmin) xmin = x[i];
+        if (y[i] < ymin) ymin = y[i];
+    }
+
+    for (i=0; i<npts; i++) {
+        x[i] -= xmin;
+        y[i] -= ymin;
+    }
+    x1 -= xmin;
+    y1 -= ymin;
+    x2 -= xmin;
+    y2 -= ymin;
+
+    grd_calc_obj->grd_set_output_shifts (xmin, ymin);
+
+/*
+    Define the fault vectors and set the faulting option.
+*/
+    fsave = 0;
+    grd_fault_obj.grd_free_faults ();
+    if (faults  &&  nfaults > 0) {
+
+        istat = grd_fault_obj.grd_define_and_shift_fault_vectors (faults, nfaults, xmin, ymin);
+        if (istat == -1) {
+            grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
+            for (i=0; i<npts; i++) {
+                x[i] += xmin;
+                y[i] += ymin;
+            }
+            return -1;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 1, 0.0f);
+        if (options) {
+            fsave = options->faulted_flag;
+            options->faulted_flag = 1;
+        }
+    }
+
+    istat = grd_calc_obj->grd_calc_grid_tiled (x, y, z, npts,
+                           filename, comment, ncol, nrow,
+                           x1, y1, x2, y2, tile_size, options);
+
+    if (istat == -1  &&  options) {
+        options->error_number = grd_GetErr ();
+    }
+
+    if (faults  &&  nfaults > 0) {
+        if (options) {
+            options->faulted_flag = fsave;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 0, 0.0f);
+    }
+
+    grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
+
+    for (i=0; i<npts; i++) {
+        x[i] += xmin;
+        y[i] += ymin;
+    }
+
+    return istat;
+
+}  /*  end of function grd_CalcGridTiled  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+             g r d _ B e g i n P o i n t S t r e a m
+
+  ****************************************************************
+
+  function name:    grd_BeginPointStream      (int)
+
+  call sequence:    grd_BeginPointStream (npts_hint)
+
+  purpose:          Start adding points for a grid calculation a chunk
+                    at a time.  Use grd_AddPointChunk to add each chunk
+                    and grd_CalcGridFromStream to calculate the grid.
+                    The points are copied into a single internal set of
+                    arrays that is also used as the gridding work data,
+                    so very large point sets do not need to be loaded
+                    into application arrays first.  The memory needed
+                    for the points is 12 bytes per point, plus growth
+                    space if npts_hint is too small.  Any points from
+                    a previous stream are discarded.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           1 = memory allocation error
+
+  calling parameters:
+
+    npts_hint  r    int       Expected total number of points, or zero
+                              if not known.  The internal arrays are
+                              allocated for this many points.
+
+*/
+
+int CSWGrdAPI::grd_BeginPointStream (int npts_hint)
+{
+    int           istat;
+
+    if (npts_hint < 0  ||  npts_hint > WildInt) {
+        npts_hint = 0;
+    }
+
+    istat = grd_calc_obj->grd_begin_point_stream (npts_hint);
+    return istat;
+
+}  /*  end of function grd_BeginPointStream  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                g r d _ A d d P o i n t C h u n k
+
+  ****************************************************************
+
+  function name:    grd_AddPointChunk         (int)
+
+  call sequence:    grd_AddPointChunk (x, y, z, npts)
+
+  purpose:          Add a chunk of points to the stream started by
+                    grd_BeginPointStream.  The points are copied, so
+                    the application can reuse its arrays for the next
+                    chunk as soon as this returns.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           1 = memory allocation error
+                    2 = No stream is active or a NULL array was specified.
+                    3 = npts is negative or the total number of points
+                        is too large.
+
+  calling parameters:
+
+    x        r    CSW_F*    Array of x coordinates
+    y        r    CSW_F*    Array of y coordinates
+    z        r    CSW_F*    Array of z values at the x,y coordinates
+    npts     r    int       Number of points in x, y and z.
+
+*/
+
+int CSWGrdAPI::grd_AddPointChunk (CSW_F *x, CSW_F *y, CSW_F *z, int npts)
+{
+    int           istat;
+
+    istat = grd_calc_obj->grd_add_point_chunk (x, y, z, npts);
+    return istat;
+
+}  /*  end of function grd_AddPointChunk  */
+
+
+
+
+
 /*
   ****************************************************************
 
-              g r d _ S e t C a l c O p t i o n s
+           g r d _ C a l c G r i d F r o m S t r e a m
+
+  ****************************************************************
+
+  function name:    grd_CalcGridFromStream    (int)
+
+  call sequence:    grd_CalcGridFromStream (error,
+                                            grid, mask, report, ncol, nrow,
+                                            x1, y1, x2, y2,
+                                            faults, nfaults, options)
+
+  purpose:          Calculate a grid from all of the points added to the
+                    current point stream.  The result is the same as
+                    grd_CalcGrid called with all of the points in the
+                    order they were added.  The stream is ended and its
+                    points are freed whether or not the calculation
+                    succeeds.  Use grd_GetPointStreamCount to find how
+                    large the error array needs to be.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           Same as grd_CalcGrid.  Error 2 is also returned if
+                    no point stream is active.
+
+  calling parameters:
+
+    error    w    CSW_F*    Optional array to receive errors at the
+                            points, in the order they were added.
+                            Set to NULL if not wanted.
+
+    The other parameters are the same as for grd_CalcGrid.
+
+*/
+
+int CSWGrdAPI::grd_CalcGridFromStream (CSW_F *error,
+                  CSW_F *grid, char *mask, char **report, int ncol, int nrow,
+                  CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+                  FAultLineStruct *faults, int nfaults,
+                  GRidCalcOptions *options)
+{
+    int           istat, fsave, i, npts;
+    CSW_F         xmin, ymin, xmax, ymax, *x, *y, *z;
+
+
+    istat = grd_calc_obj->grd_get_point_stream (&x, &y, &z, &npts,
+                                                &xmin, &ymin, &xmax, &ymax);
+    if (istat == -1) {
+        grd_utils_obj.grd_set_err (2);
+        return -1;
+    }
+
+    if (grid == NULL) {
+        grd_calc_obj->grd_end_point_stream ();
+        grd_utils_obj.grd_set_err (2);
+        return -1;
+    }
+
+/*
+    check the range of the input x and y values to see
+    if it can support CSW_F precision arithmetic.
+*/
+    istat = csw_CheckRange (x, npts);
+    if (istat) {
+        istat = csw_CheckRange (y, npts);
+    }
+    if (!istat) {
+        grd_calc_obj->grd_end_point_stream ();
+        grd_utils_obj.grd_set_err (99);
+        return -1;
+    }
+
+    if ((faults  &&  nfaults < 1)  ||  (!faults  &&  nfaults > 0)) {
+        grd_calc_obj->grd_end_point_stream ();
+        grd_utils_obj.grd_set_err (9);
+        return -1;
+    }
+
+/*
+    Subtract the minimum x and y values from the stream points.
+    The stream owns these points and frees them when the grid is
+    done, so they do not need to be shifted back.
+*/
+    for (i=0; i<npts; i++) {
+        x[i] -= xmin;
+        y[i] -= ymin;
+    }
+    x1 -= xmin;
+    y1 -= ymin;
+    x2 -= xmin;
+    y2 -= ymin;
+
+    grd_calc_obj->grd_set_output_shifts (xmin, ymin);
+
+/*
+    Define the fault vectors and set the faulting option.
+*/
+    fsave = 0;
+    grd_fault_obj.grd_free_faults ();
+    if (faults  &&  nfaults > 0) {
+
+        istat = grd_fault_obj.grd_define_and_shift_fault_vectors (faults, nfaults, xmin, ymin);
+        if (istat == -1) {
+            grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
+            grd_calc_obj->grd_end_point_stream ();
+            return -1;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 1, 0.0f);
+        if (options) {
+            fsave = options->faulted_flag;
+            options->faulted_flag = 1;
+        }
+    }
+
+    istat = grd_calc_obj->grd_calc_grid_from_stream (error,
+                           grid, mask, report, ncol, nrow,
+                           x1, y1, x2, y2, options);
+
+    if (istat == -1  &&  options) {
+        options->error_number = grd_GetErr ();
+    }
+
+    if (faults  &&  nfaults > 0) {
+        if (options) {
+            options->faulted_flag = fsave;
+        }
+        grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 0, 0.0f);
+    }
 
-  ****************************************************************
+    grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
 
-  function name:    grd_SetCalcOptions               (int)
+    return istat;
 
-  call sequence:    grx_SetCalcOption (options)
+}  /*  end of function grd_CalcGridFromStream  */
 
-  purpose:          Set all options prior to calling grd_CalcGrid.
 
-  return value:     status code
 
-                    1 = success
-                   -1 = unknown tag
 
-  calling parameters:
 
-    options    r  GRidCalcOptions*   Pointer to grid option structure.
+/*
+  ****************************************************************
+
+           g r d _ G e t P o i n t S t r e a m C o u n t
+
+  ****************************************************************
+
+  Return the number of points added to the current point stream,
+  or -1 if no stream is active.
 
 */
 
-int CSWGrdAPI::grd_SetCalcOptions (GRidCalcOptions *options)
+int CSWGrdAPI::grd_GetPointStreamCount (void)
 {
-    int           istat;
+    int           istat, npts;
+    CSW_F         *x, *y, *z, xmin, ymin, xmax, ymax;
 
-    istat = grd_calc_obj->grd_set_calc_options (options);
-    return istat;
+    istat = grd_calc_obj->grd_get_point_stream (&x, &y, &z, &npts,
+                                                &xmin, &ymin, &xmax, &ymax);
+    if (istat == -1) {
+        return -1;
+    }
+
+    return npts;
+
+}  /*  end of function grd_GetPointStreamCount  */
 
-}  /*  end of function grd_SetCalcOptions  */
 
 
 
@@ -128,35 +903,53 @@ int CSWGrdAPI::grd_SetCalcOptions (GRidCalcOptions *options)
 /*
   ****************************************************************
 
-           g r d _ D e f a u l t C a l c O p t i o n s
+              g r d _ E n d P o i n t S t r e a m
 
   ****************************************************************
 
-  function name:    grd_DefaultCalcOptions               (int)
+  Discard the current point stream without calculating a grid.
+  Always returns 1.
 
-  call sequence:    grx_DefaultCalcOption (options)
+*/
 
-  purpose:          Default all options prior to calling grd_CalcGrid.
+int CSWGrdAPI::grd_EndPointStream (void)
+{
+    int           istat;
 
-  return value:     status code
+    istat = grd_calc_obj->grd_end_point_stream ();
+    return istat;
 
-                    1 = success
-                   -1 = unknown tag
+}  /*  end of function grd_EndPointStream  */
 
-  calling parameters:
 
-    options    r  GRidCalcOptions*   Pointer to grid option structure.
+
+
+
+/*
+  ****************************************************************
+
+        g r d _ S e t F a u l t I n d e x C a c h e S i z e
+
+  ****************************************************************
+
+  When faults are used, the fault index grids built for a grid
+  calculation are kept so that later calculations with the same
+  faults and the same grid geometry can reuse them.  This sets the
+  maximum number of bytes used for these saved indices.  The least
+  recently used indices are discarded when the limit is reached.
+  A value of zero or less turns off the reuse and frees any saved
+  indices.  The default is 100 million bytes.  Always returns 1.
 
 */
 
-int CSWGrdAPI::grd_DefaultCalcOptions (GRidCalcOptions *options)
+int CSWGrdAPI::grd_SetFaultIndexCacheSize (long nbytes)
 {
     int           istat;
 
-    istat = grd_calc_obj->grd_default_calc_options (options);
+    istat = grd_fault_obj.grd_set_fault_index_cache_size (nbytes);
     return istat;
 
-}  /*  end of function grd_DefaultCalcOptions  */
+}  /*  end of function grd_SetFaultIndexCacheSize  */
 
 
 
@@ -165,100 +958,74 @@ int CSWGrdAPI::grd_DefaultCalcOptions (GRidCalcOptions *options)
 /*
   ****************************************************************
 
-                     g r d _ C a l c G r i d
+                g r d _ C a l c G r i d M u l t i
 
   ****************************************************************
 
-  function name:    grd_CalcGrid              (int)
-
-  call sequence:    grd_CalcGrid (x, y, z, error, npts,
-                                  grid, mask, report, ncol, nrow,
-                                  x1, y1, x2, y2,
-                                  faults, nfaults, options)
-
-  purpose:          Calculate a uniform grid by interpolating the
-                    specified data points.  The errors between input
-                    points and the grid's estimate can be returned
-                    in the error array.  A mask specifying which
-                    grid points are outside the data area or
-                    inside but far from control points can also
-                    be returned in the mask array.  This function only
-                    supports non faulted continuous surfaces.
-
-                    The grid must have at least 2 columns and 2 rows.
-                    The upper limit of grid size is controlled by available
-                    virtual memory.  The algorithm needs workspace about 5
-                    times the size of the grid, plus workspace about twice
-                    the size of the data array.  For example, calculating
-                    a 1000 by 1000 grid from 100000 points would need about
-                    21 to 22 megabytes of work space.  Memory allocation errors
-                    are generally caused by grids too large for available
-                    memory.
-
-  return value:     status code
-                    -1 = error
-                     1 = success
-
-  errors:           1 = memory allocation error
-                    2 = A NULL x, y, z, or grid array is specified.
-                    3 = A wild parameter was encountered.
-                    4 = ncol or nrow is less than 2
-                    5 = x2 less than x1 or y2 less than y1
-                    6 = npts less than 3
-                    7 = number of points actually in the data area
-                        is less than 3
-                    8 = The points are distributed in a manner that
-                        cannot be fit with a trend surface (probably
-                        all points are coincident or colinear).
-                    9 = The fault data are inconsistent.  Either faults is not
-                        null and nfaults is zero, or faults is NULL and nfaults
-                        is greater than zero.
-                    11= Too many (>5000) points lie almost exactly on top of
-                        a fault.
-                    99 = The range of the x and or y values is too small
-                        relative to the values to support CSW_F arithmetic.
+  function name:    grd_CalcGridMulti         (int)
 
+  call sequence:    grd_CalcGridMulti (x, y, zlist, nattr, npts,
+                                       grids, masks, ncol, nrow,
+                                       x1, y1, x2, y2,
+                                       faults, nfaults, options)
+
+  purpose:          Calculate grids for several attributes (horizons,
+                    porosity, thickness and so on) that are all sampled
+                    at the same x, y locations.  The data and search
+                    tables only depend on the point locations and the
+                    grid geometry, so the local point lists found for
+                    the first attribute are reused for the others.
+                    Each grid is the same as what a separate
+                    grd_CalcGrid call would give for its attribute.
+
+                    The lists are not reused for faulted, anisotropic
+                    or preferred strike calculations, or when control
+                    points are set.  In those cases this is the same
+                    as calling grd_CalcGrid for each attribute.
+
+                    If the options ask for more than one thread, the
+                    attributes are instead calculated at the same time,
+                    one per thread, each by its own set of grid
+                    objects.  This is not done for faulted grids, when
+                    options is NULL, or when control points, control
+                    surfaces or other saved settings are in use.  The
+                    grids are the same either way.
+
+  return value:     1 on success, -1 on error.  The error numbers are
+                    the same as for grd_CalcGrid.
 
   calling parameters:
 
-    x        r    CSW_F*    Array of x coordinates
-    y        r    CSW_F*    Array of y coordinates
-    z        r    CSW_F*    Array of z values at the x,y coordinates
-    error    w    CSW_F*    Optional array to receive errors at the
-                                input points.  Set to NULL if not wanted.
-    npts     r    int           Number of points in x, y, z and error.
-    grid     w    CSW_F*    Array to receive the grid values.
-    mask     w    char*         Optional array to receive a mask specifying
-                                whether a grid node is outside the data
-                                area, inside and well defined, or inside
-                                and poorly defined.  A well defined node
-                                has a mask value of zero.  A node outside
-                                the data area has a mask value of 1.  A
-                                poorly defined inside node has a mask
-                                value of 2.  Specify a NULL pointer to
-                                disable this feature.
-    report   w    char**        If this is not null a report of the grid
-                                vital statistics is returned in the pointer.
-    ncol     r    int           Number of columns in the grid and mask.
-    nrow     r    int           Number of rows in the grid and mask.
-    x1       r    CSW_F     Minimum x coordinate of the grid.
-    y1       r    CSW_F     Minimum y coordinate of the grid.
-    x2       r    CSW_F     Maximum x coordinate of the grid.
-    y2       r    CSW_F     Maximum y coordinate of the grid.
+    x        r    CSW_F*        Array of x coordinates
+    y        r    CSW_F*        Array of y coordinates
+    zlist    r    CSW_F**       Array of nattr pointers, each to the npts
+                                z values of one attribute.
+    nattr    r    int           Number of attributes.
+    npts     r    int           Number of points in x, y and each z array.
+    grids    w    CSW_F**       Array of nattr pointers, each to an array
+                                that receives the grid for one attribute.
+    masks    w    char**        Optional array of nattr pointers to mask
+                                arrays, as described for grd_CalcGrid.
+                                Either the array or any of its members
+                                can be NULL.
+    ncol     r    int           Number of columns in each grid.
+    nrow     r    int           Number of rows in each grid.
+    x1       r    CSW_F         Minimum x coordinate of the grids.
+    y1       r    CSW_F         Minimum y coordinate of the grids.
+    x2       r    CSW_F         Maximum x coordinate of the grids.
+    y2       r    CSW_F         Maximum y coordinate of the grids.
     faults   r    FAultLineStruct*
                                 List of fault lines structures.
     nfaults  r    int           Number of fault line structures.
     options  r    GRidCalcOptions*
-                                Optional option record pointer.  If NULL,
-                                the global option state is used.  If not
-                                NULL, options are taken from this structure
-                                for this calculation only.
-
+                                Optional option record pointer, as
+                                described for grd_CalcGrid.
 
 */
 
-int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npts,
-                  CSW_F *grid, char *mask, char **report, int ncol, int nrow,
+int CSWGrdAPI::grd_CalcGridMulti (CSW_F *x, CSW_F *y, CSW_F **zlist,
+                  int nattr, int npts,
+                  CSW_F **grids, char **masks, int ncol, int nrow,
                   CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
                   FAultLineStruct *faults, int nfaults,
                   GRidCalcOptions *options)
@@ -267,12 +1034,13 @@ int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npt
     CSW_F         xmin, ymin;
 
 
-    if (npts < -WildInt  ||  npts > WildInt) {
+    if (npts < -WildInt  ||  npts > WildInt  ||
+        nattr < -WildInt  ||  nattr > WildInt) {
         grd_utils_obj.grd_set_err (3);
         return -1;
     }
 
-    if (grid == NULL) {
+    if (x == NULL  ||  y == NULL  ||  zlist == NULL  ||  grids == NULL) {
         grd_utils_obj.grd_set_err (2);
         return -1;
     }
@@ -333,6 +1101,11 @@ int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npt
 
         istat = grd_fault_obj.grd_define_and_shift_fault_vectors (faults, nfaults, xmin, ymin);
         if (istat == -1) {
+            grd_calc_obj->grd_set_output_shifts (0.0, 0.0);
+            for (i=0; i<npts; i++) {
+                x[i] += xmin;
+                y[i] += ymin;
+            }
             return -1;
         }
         grd_calc_obj->grd_set_calc_option (GRD_FAULTED_GRID_FLAG, 1, 0.0f);
@@ -342,9 +1115,19 @@ int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npt
         }
     }
 
-    istat = grd_calc_obj->grd_calc_grid (x, y, z, error, npts,
-                           grid, mask, report, ncol, nrow,
-                           x1, y1, x2, y2, options);
+    istat = 0;
+    if (faults == NULL  ||  nfaults < 1) {
+        istat = CalcGridMultiParallel (x, y, zlist, nattr, npts,
+                                       grids, masks, ncol, nrow,
+                                       x1, y1, x2, y2, xmin, ymin,
+                                       options);
+    }
+
+    if (istat == 0) {
+        istat = grd_calc_obj->grd_calc_grid_multi (x, y, zlist, nattr, npts,
+                               grids, masks, ncol, nrow,
+                               x1, y1, x2, y2, options);
+    }
 
     if (istat == -1  &&  options) {
         options->error_number = grd_GetErr ();
@@ -366,7 +1149,160 @@ int CSWGrdAPI::grd_CalcGrid (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *error, int npt
 
     return istat;
 
-}  /*  end of function grd_CalcGrid  */
+}  /*  end of function grd_CalcGridMulti  */
+
+
+
+
+/*
+  ****************************************************************
+
+            C a l c G r i d M u l t i P a r a l l e l
+
+  ****************************************************************
+
+    Calculate the attributes of grd_CalcGridMulti at the same time,
+  one attribute per thread.  Each thread uses its own CSWGrdAPI
+  object, since the calc, trend surface and arithmetic objects all
+  keep state during a grid calculation.  This object is used by the
+  first thread.  Any threads beyond one per attribute are given to
+  the row loops inside each attribute's calculation.  The x and y
+  arrays must already be shifted by xmin and ymin.
+
+    The local point lists are not shared between the attributes
+  here, but with two or more threads running whole attributes at
+  once is faster than sharing the lists.  The memory used is about
+  that of a single grid calculation times the number of threads.
+
+    Returns zero without doing anything if the grids need to be
+  calculated one at a time.  That is the case if there is only one
+  thread or one attribute, if no options structure is specified, or
+  if the calc object has saved settings (control points, control
+  surfaces and so on) that the extra objects would not have.  The
+  caller does faulted grids one at a time as well.  Otherwise this
+  returns 1 on success or -1 on error.
+
+*/
+
+int CSWGrdAPI::CalcGridMultiParallel
+                 (CSW_F *x, CSW_F *y, CSW_F **zlist,
+                  int nattr, int npts,
+                  CSW_F **grids, char **masks, int ncol, int nrow,
+                  CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+                  CSW_F xmin, CSW_F ymin,
+                  GRidCalcOptions *options)
+{
+    int                 i, nthreads, nwork;
+    int                 *status = NULL, *errnum = NULL;
+    CSWGrdAPI           **workers = NULL;
+    GRidCalcOptions     wopt;
+
+    nwork = 0;
+
+    auto fscope = [&]()
+    {
+        if (workers != NULL) {
+            for (i=1; i<nwork; i++) {
+                delete workers[i];
+            }
+        }
+        csw_Free (workers);
+        csw_Free (status);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    if (options == NULL  ||  zlist == NULL  ||  grids == NULL  ||
+        nattr < 2) {
+        return 0;
+    }
+
+    nthreads = CSWParallel::NumThreads (options->num_threads);
+    if (nthreads < 2) {
+        return 0;
+    }
+
+    if (grd_calc_obj->grd_uses_saved_settings ()  ||
+        csw_GetDoWrite () == 1) {
+        return 0;
+    }
+
+    for (i=0; i<nattr; i++) {
+        if (zlist[i] == NULL  ||  grids[i] == NULL) {
+            return 0;
+        }
+    }
+
+    status = (int *)csw_Calloc (nattr * 2 * sizeof(int));
+    if (status == NULL) {
+        grd_utils_obj.grd_set_err (1);
+        return -1;
+    }
+    errnum = status + nattr;
+
+    nwork = nthreads;
+    if (nwork > nattr) nwork = nattr;
+
+    workers = (CSWGrdAPI **)csw_Calloc (nwork * sizeof(CSWGrdAPI *));
+    if (workers == NULL) {
+        nwork = 0;
+        grd_utils_obj.grd_set_err (1);
+        return -1;
+    }
+
+    workers[0] = this;
+    for (i=1; i<nwork; i++) {
+        workers[i] = new (std::nothrow) CSWGrdAPI ();
+        if (workers[i] == NULL) {
+            grd_utils_obj.grd_set_err (1);
+            return -1;
+        }
+        workers[i]->grd_calc_obj->grd_set_output_shifts (xmin, ymin);
+    }
+
+/*
+    The grids are the same for any number of row threads, so the
+    threads that are left over can be used for the rows.
+*/
+    wopt = *options;
+    wopt.num_threads = nthreads / nwork;
+
+/*
+    Each task calculates one attribute with the object for its
+    thread.  The x, y and option data are only read.
+*/
+    auto fattr = [&](int itask, int ithread)
+    {
+        int            ist;
+        char           *mask;
+        CSWGrdAPI      *wp;
+
+        wp = workers[ithread];
+        mask = NULL;
+        if (masks != NULL) {
+            mask = masks[itask];
+        }
+        ist = wp->grd_calc_obj->grd_calc_grid
+                   (x, y, zlist[itask], NULL, npts,
+                    grids[itask], mask, NULL,
+                    ncol, nrow, x1, y1, x2, y2, &wopt);
+        status[itask] = ist;
+        if (ist == -1) {
+            errnum[itask] = wp->grd_utils_obj.grd_get_err ();
+        }
+    };
+
+    CSWParallel::ForEach (nwork, nattr, fattr);
+
+    for (i=0; i<nattr; i++) {
+        if (status[i] == -1) {
+            grd_utils_obj.grd_set_err (errnum[i]);
+            return -1;
+        }
+    }
+
+    return 1;
+
+}  /*  end of private CalcGridMultiParallel function  */
 
 
 
@@ -1593,11 +2529,13 @@ int CSWGrdAPI::grd_Version (char *buff)
 
                     This is nearly identical to grd_CalcGrid, except that the
                     x, y, z and grid corners are specified as doubles rather
-                    than CSW_Fs.  This function just shifts the x,y points
-                    to be relative to their minimums and then converts them to
-                    CSW_F arrays for regular gridding.  As such, the final
-                    grid is still single precision, but large x and y coordinates
-                    can be handled.
+                    than CSW_Fs.  This function shifts the x,y points to be
+                    relative to their minimums (and back again when done) and
+                    grids them.  CSW_F is double, so the calculation is done
+                    in double precision and the shifted points are used without
+                    copying them (except for faulted grids).  The application
+                    does not need to shift large coordinates, such as UTM
+                    values, itself before calling this function.
 
   return value:     status code
                     -1 = error
@@ -4153,7 +5091,7 @@ int CSWGrdAPI::grd_Triangulate  (double *xpts, double *ypts, double *zpts, int n
                       TRiangleStruct **triangles_out,
                       int *num_nodes_out, int *num_edges_out, int *num_triangles_out)
 {
-    int                    istat;
+    int                    istat, nthread;
 
 /*
  * !!!! debug only
@@ -4162,14 +5100,21 @@ int CSWGrdAPI::grd_Triangulate  (double *xpts, double *ypts, double *zpts, int n
     int                    do_write;
 
 /*
- * First, calculate the trimesh without constraints.
+ * First, calculate the trimesh without constraints.  If constraints
+ * are added afterwards, the points are done with a single thread so
+ * the constrained trimesh is the same as the single thread trimesh.
  */
+    nthread = grd_triangle_obj.get()->grd_get_trimesh_threads ();
+    if (xlines != NULL  &&  nlines > 0) {
+        grd_triangle_obj.get()->grd_set_trimesh_threads (0);
+    }
     grd_triangle_obj.get()->grd_set_shifts_for_debug (0.0, 0.0);
     istat = grd_triangle_obj.get()->grd_calc_trimesh  (xpts, ypts, zpts, npts,
                                NULL, NULL, NULL,
                                NULL, NULL, 0,
                                nodes_out, edges_out, triangles_out,
                                num_nodes_out, num_edges_out, num_triangles_out);
+    grd_triangle_obj.get()->grd_set_trimesh_threads (nthread);
     if (istat == -1) {
         return -1;
     }
@@ -4300,6 +5245,22 @@ int CSWGrdAPI::grd_CalcTriMeshFromGrid (CSW_F *grid, int nc, int nr,
         }
     }
 
+/*
+ * The adaptive style only uses the grid nodes needed to stay within
+ * the tolerance set by grd_SetTriMeshGridTolerance.
+ */
+    if (trimesh_style == GRD_ADAPTIVE) {
+        istat = grd_triangle_obj.get()->grd_calc_tri_mesh_from_grid (
+                                 grid, nc, nr,
+                                 x1, y1, x2, y2,
+                                 xlines, ylines, zlines,
+                                 linepoints, ltypes, nlines,
+                                 trimesh_style,
+                                 nodes_out, edges_out, triangles_out,
+                                 num_nodes_out, num_edges_out, num_triangles_out);
+        return istat;
+    }
+
 /*
  * Calculate an unconstrained trimesh from the grid.
  */
@@ -5032,7 +5993,44 @@ int CSWGrdAPI::grd_CalcTriMeshDips (NOdeStruct *nodes, int numnodes,
                                     direction, amplitude);
     return istat;
 
-}  /* end of function grd_CalcTriMeshDips */
+}  /* end of function grd_CalcTriMeshDips */
+
+
+
+
+/*
+ ***************************************************************************************
+
+                   g r d _ C a l c T r i M e s h N o r m a l s
+
+ ***************************************************************************************
+
+  Calculate the unit normal of each triangle and the average normal at each
+  node into flat arrays.  The tnx, tny and tnz arrays need num_triangles
+  values and the nnx, nny and nnz arrays need numnodes values.  Either set
+  can be NULL.  Deleted triangles, triangles with null corners and deleted
+  nodes get 1.e30.  The norm pointers in the trimesh are not used or changed.
+  The number of threads used is set with grd_SetTriMeshThreads.
+
+*/
+
+int CSWGrdAPI::grd_CalcTriMeshNormals (NOdeStruct *nodes, int numnodes,
+                         EDgeStruct *edges, int numedges,
+                         TRiangleStruct *triangles, int numtriangles,
+                         double *tnx, double *tny, double *tnz,
+                         double *nnx, double *nny, double *nnz)
+{
+    int                istat;
+
+    istat = grd_triangle_obj.get()->grd_calc_trimesh_normal_arrays (
+                                    nodes, numnodes,
+                                    edges, numedges,
+                                    triangles, numtriangles,
+                                    tnx, tny, tnz,
+                                    nnx, nny, nnz);
+    return istat;
+
+}  /* end of function grd_CalcTriMeshNormals */
 
 
 
@@ -5516,6 +6514,406 @@ int CSWGrdAPI::grd_SetPolyConstraintFlag (int val)
 
 
 
+/*
+ ***********************************************************************************
+
+                g r d _ S e t T r i M e s h I n s e r t i o n
+
+ ***********************************************************************************
+
+  Select how grd_Triangulate and the other trimesh calculations insert
+  their points.  GRD_SUBDIVIDE_INSERTION (the default) splits each
+  triangle with a point inside it and then swaps edges over the whole
+  trimesh, repeating until all points are used.  GRD_SORTED_INSERTION
+  inserts the points one at a time in Hilbert curve order, finds the
+  triangle for each by walking from the previous one, and only swaps
+  edges around the new node.  The sorted method is much faster for large
+  numbers of points.  The two methods use the same edge swapping criteria,
+  but they do not produce exactly the same trimesh.  Any other value
+  selects GRD_SUBDIVIDE_INSERTION.  Always returns 1.
+
+*/
+
+int CSWGrdAPI::grd_SetTriMeshInsertion (int method)
+{
+    grd_triangle_obj.get()->grd_set_trimesh_insertion (method);
+    return 1;
+}
+
+
+
+
+
+/*
+ ***********************************************************************************
+
+                  g r d _ S e t T r i M e s h T h r e a d s
+
+ ***********************************************************************************
+
+  Set the number of threads used by grd_Triangulate and the other trimesh
+  calculations from points.  With more than one thread, the points are
+  split into vertical strips, each strip is triangulated on its own thread,
+  and the strips are joined along their shared edges.  A value of zero or
+  one (the default) uses a single thread and a negative value uses all of
+  the available cores.  If there are constraint lines, if there are too
+  few points, or if the strips cannot be joined, a single thread is used.
+  Without constraint lines the result is a valid trimesh with the same
+  nodes, but it is not exactly the same as the single thread trimesh.
+  Always returns 1.
+
+*/
+
+int CSWGrdAPI::grd_SetTriMeshThreads (int nthreads)
+{
+    grd_triangle_obj.get()->grd_set_trimesh_threads (nthreads);
+    return 1;
+}
+
+
+
+
+
+/*
+ ***********************************************************************************
+
+            g r d _ S e t T r i M e s h B u l k C o n s t r a i n t s
+
+ ***********************************************************************************
+
+  Set to 1 to use the bulk cleanup after constraint lines are added to a
+  trimesh, or to zero (the default) for the original cleanup.  The original
+  cleanup starts over after each zero area triangle it removes, which is
+  very slow when there are thousands of fault or boundary lines.  The bulk
+  cleanup removes all of the zero area triangles it finds in each sweep
+  over the trimesh, and it skips triangles that cannot be removed.  The
+  result is a valid trimesh, but it is not exactly the same as the one
+  from the original cleanup.  Any other value selects zero.  Always
+  returns 1.
+
+*/
+
+int CSWGrdAPI::grd_SetTriMeshBulkConstraints (int flag)
+{
+    grd_triangle_obj.get()->grd_set_bulk_constraints (flag);
+    return 1;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+             g r d _ S e t T r i M e s h G r i d T o l e r a n c e
+
+ ***********************************************************************************
+
+  Set the vertical tolerance used when a trimesh is calculated from a grid
+  with the GRD_ADAPTIVE style.  The trimesh will be within this distance of
+  every non null grid node, using as few of the grid nodes as it can.  A
+  value of zero or less (the default) uses a thousandth of the z range of
+  the grid.  Always returns 1.
+
+*/
+
+int CSWGrdAPI::grd_SetTriMeshGridTolerance (double ztol)
+{
+    grd_triangle_obj.get()->grd_set_adaptive_grid_tolerance (ztol);
+    return 1;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+               g r d _ S e t T r i M e s h V a l i d a t i o n
+
+ ***********************************************************************************
+
+  Select the checks done on trimeshes as they are calculated.  The checks
+  print any problems they find to standard output.  GRD_VALIDATE_NONE
+  (the default) does no checks.  GRD_VALIDATE_TOPOLOGY checks that the
+  edges of each triangle connect and link back to the triangle, which
+  takes time proportional to the number of triangles.  GRD_VALIDATE_FULL
+  also checks that no edges cross each other, that the constraint lines
+  are on edges, and the shapes of the triangles.  Values outside of this
+  range are clipped to it.  Setting the level also sets the validation
+  times to zero.  Always returns 1.
+
+*/
+
+int CSWGrdAPI::grd_SetTriMeshValidation (int level)
+{
+    grd_triangle_obj.get()->grd_set_trimesh_validation (level);
+    return 1;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+            g r d _ G e t T r i M e s h V a l i d a t i o n T i m e s
+
+ ***********************************************************************************
+
+  Return the wall clock seconds spent in the topology checks and in the
+  full level geometry checks since the validation level was last set.
+  Returns 1 on success or -1 if either pointer is NULL.
+
+*/
+
+int CSWGrdAPI::grd_GetTriMeshValidationTimes (double *topo_time,
+                                              double *full_time)
+{
+    if (topo_time == NULL  ||  full_time == NULL) {
+        grd_utils_obj.grd_set_err (2);
+        return -1;
+    }
+
+    grd_triangle_obj.get()->grd_get_trimesh_validation_times
+        (topo_time, full_time);
+    return 1;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+                   g r d _ B e g i n T r i M e s h E d i t
+
+ ***********************************************************************************
+
+  Start an edit session on a copy of the specified trimesh.  The edit
+  functions below change the session trimesh by only repairing the
+  triangles around each edit, which is much faster than calculating the
+  trimesh again.  Each edit returns the triangles it made or modified in
+  a changed list, which is only valid until the next edit.  Only one
+  session at a time is kept, and beginning a new session ends the old
+  one.  Returns 1 on success or -1 on an error.
+
+*/
+
+int CSWGrdAPI::grd_BeginTriMeshEdit (NOdeStruct *nodes, int numnodes,
+                                     EDgeStruct *edges, int numedges,
+                                     TRiangleStruct *triangles, int numtriangles)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_begin_trimesh_edit
+        (nodes, numnodes, edges, numedges, triangles, numtriangles);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+                     g r d _ E n d T r i M e s h E d i t
+
+ ***********************************************************************************
+
+  End the edit session and return the edited trimesh, with the deleted
+  elements removed.  The returned arrays must be csw_Free'd by the caller.
+  If any of the output pointers are NULL, the session trimesh is discarded.
+
+*/
+
+int CSWGrdAPI::grd_EndTriMeshEdit (NOdeStruct **nodes_out, int *num_nodes_out,
+                                   EDgeStruct **edges_out, int *num_edges_out,
+                                   TRiangleStruct **triangles_out,
+                                   int *num_triangles_out)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_end_trimesh_edit
+        (nodes_out, num_nodes_out, edges_out, num_edges_out,
+         triangles_out, num_triangles_out);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+                     g r d _ G e t T r i M e s h E d i t
+
+ ***********************************************************************************
+
+  Return pointers to the current session trimesh without ending the
+  session.  The arrays still belong to the session, are only valid until
+  the next edit and have the deleted elements flagged but not removed.
+
+*/
+
+int CSWGrdAPI::grd_GetTriMeshEdit (NOdeStruct **nodes_out, int *num_nodes_out,
+                                   EDgeStruct **edges_out, int *num_edges_out,
+                                   TRiangleStruct **triangles_out,
+                                   int *num_triangles_out)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_get_trimesh_edit
+        (nodes_out, num_nodes_out, edges_out, num_edges_out,
+         triangles_out, num_triangles_out);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+               g r d _ E d i t T r i M e s h I n s e r t N o d e
+
+ ***********************************************************************************
+
+  Insert a node into the edit session trimesh.  The node number is
+  returned in nodenum.  Returns 1 on success, zero if the point is
+  outside of the trimesh or -1 on an error.
+
+*/
+
+int CSWGrdAPI::grd_EditTriMeshInsertNode (double x, double y, double z,
+                                          int *nodenum,
+                                          int **changed, int *nchanged)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_edit_insert_node
+        (x, y, z, nodenum, changed, nchanged);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+               g r d _ E d i t T r i M e s h D e l e t e N o d e
+
+ ***********************************************************************************
+
+  Delete a node from the edit session trimesh.  Returns 1 on success,
+  zero if the node could not be deleted or -1 on an error.
+
+*/
+
+int CSWGrdAPI::grd_EditTriMeshDeleteNode (int nodenum,
+                                          int **changed, int *nchanged)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_edit_delete_node
+        (nodenum, changed, nchanged);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+                 g r d _ E d i t T r i M e s h M o v e N o d e
+
+ ***********************************************************************************
+
+  Move a node of the edit session trimesh, keeping its node number.
+  Returns 1 on success, zero if the node could not be moved or -1
+  on an error.
+
+*/
+
+int CSWGrdAPI::grd_EditTriMeshMoveNode (int nodenum,
+                                        double x, double y, double z,
+                                        int **changed, int *nchanged)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_edit_move_node
+        (nodenum, x, y, z, changed, nchanged);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+            g r d _ E d i t T r i M e s h I n s e r t S e g m e n t
+
+ ***********************************************************************************
+
+  Insert a constraint segment into the edit session trimesh.  The end
+  point node numbers are returned in node1 and node2.  The flag is the
+  same as a line flag for grd_Triangulate.  Returns 1 on success, zero
+  if the segment could not be inserted or -1 on an error.
+
+*/
+
+int CSWGrdAPI::grd_EditTriMeshInsertSegment (double x1, double y1, double z1,
+                                             double x2, double y2, double z2,
+                                             int flag, int *node1, int *node2,
+                                             int **changed, int *nchanged)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_edit_insert_segment
+        (x1, y1, z1, x2, y2, z2, flag, node1, node2, changed, nchanged);
+
+    return istat;
+}
+
+
+
+
+/*
+ ***********************************************************************************
+
+            g r d _ E d i t T r i M e s h D e l e t e S e g m e n t
+
+ ***********************************************************************************
+
+  Remove the constraint from the edge between two nodes of the edit
+  session trimesh.  Returns 1 on success, zero if there is no such
+  constraint edge or -1 on an error.
+
+*/
+
+int CSWGrdAPI::grd_EditTriMeshDeleteSegment (int node1, int node2,
+                                             int **changed, int *nchanged)
+{
+    int                   istat;
+
+    istat = grd_triangle_obj.get()->grd_edit_delete_segment
+        (node1, node2, changed, nchanged);
+
+    return istat;
+}
+
+
+
+
 /*
  **********************************************************************************
 
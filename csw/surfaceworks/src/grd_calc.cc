@@ -22,8 +22,13 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
 #include "csw/utils/include/csw_.h"
 #include "csw/utils/private_include/csw_scope.h"
+#include "csw/utils/private_include/csw_parallel.h"
 
 #include "csw/utils/private_include/simulP.h"
 
@@ -35,6 +40,7 @@
 #include "csw/surfaceworks/private_include/grd_triangle_class.h"
 #include "csw/surfaceworks/private_include/grd_utils.h"
 #include "csw/surfaceworks/private_include/grd_calc.h"
+#include "csw/surfaceworks/private_include/grd_simd.h"
 
 
 
@@ -95,6 +101,8 @@ int CSWGrdCalc::grd_set_calc_option
         OptDefaultSizeMultiplier = 1;
         DefaultSizeMultiplier = 1;
         OptTriangulateFlag = 0;
+        OptNumThreads = 0;
+        OptSearchEngine = GRD_CELL_LIST_ENGINE;
     }
 
     else if (tag == GRD_PREFERRED_STRIKE) {
@@ -188,6 +196,16 @@ int CSWGrdCalc::grd_set_calc_option
         OptWorkMargin = ival;
     }
 
+    else if (tag == GRD_NUM_THREADS) {
+        if (ival < -1) ival = -1;
+        OptNumThreads = ival;
+    }
+
+    else if (tag == GRD_SEARCH_ENGINE) {
+        if (ival != GRD_PACKED_BUCKET_ENGINE) ival = GRD_CELL_LIST_ENGINE;
+        OptSearchEngine = ival;
+    }
+
     else {
         grd_utils_ptr->grd_set_err (2);
         return -1;
@@ -239,6 +257,8 @@ int CSWGrdCalc::grd_set_calc_options (GRidCalcOptions *options)
     grd_set_calc_option (GRD_FAULTED_GRID_FLAG, options->faulted_flag, 0.0f);
     grd_set_calc_option (GRD_TRIANGULATE_FLAG, options->triangulate_flag, 0.0f);
     grd_set_calc_option (GRD_WORK_MARGIN, options->work_margin, 0.0f);
+    grd_set_calc_option (GRD_NUM_THREADS, options->num_threads, 0.0f);
+    grd_set_calc_option (GRD_SEARCH_ENGINE, options->search_engine, 0.0f);
 
     return 1;
 
@@ -285,6 +305,8 @@ int CSWGrdCalc::grd_default_calc_options (GRidCalcOptions *options)
     options->faulted_flag = 0;
     options->triangulate_flag = 0;
     options->work_margin = -1;
+    options->num_threads = 0;
+    options->search_engine = GRD_CELL_LIST_ENGINE;
 
     options->error_number = 0;
 
@@ -299,229 +321,258 @@ int CSWGrdCalc::grd_default_calc_options (GRidCalcOptions *options)
 /*
   ****************************************************************
 
-            g r d _ s e t _ c o n t r o l _ p o i n t s
+          g r d _ b e g i n _ c a l c _ s e s s i o n
 
   ****************************************************************
 
-  function name:      grd_set_control_points          (int)
+  Start a gridding session.  While the session is active, the data
+  tables, distance table and trend surface derived from the input
+  points are kept after each grd_calc_grid call.  A later call with
+  the same points, the same internal grid geometry and the same
+  options that affect these tables reuses them instead of building
+  them again.  Options that only affect the later stages (min/max
+  clipping, boundary margins, report lines, thread count, etc.) can
+  be changed between calls without losing the cached tables.
 
-  call sequence:      grd_set_controlPoints (list, nlist)
+  Faulted, vertical fault and control point calculations do not
+  use the session cache.
 
-  purpose:            Set up control points for subsequent grid
-                      calculations.  Control points specify that
-                      the grid must be less than a value, greater than
-                      a value, or between two values at a location.
-                      They do not say exactly what the value should be
-                      at the location.  The type member of the control
-                      point structure specifies the greater than, less
-                      than or between behavior. (1 = greater than,
-                      2 = less than, 3 = between).
+  Any data from a previous session is discarded.  Always returns 1.
 
-  return value:       1 on success
-                      -1 on error
+*/
+
+int CSWGrdCalc::grd_begin_calc_session (void)
+{
+
+    FreeSessionData ();
+    Session.active = 1;
+
+    return 1;
+
+}  /*  end of function grd_begin_calc_session  */
 
-  errors:             1 = memory allocation failure
 
-  calling parameters:
 
-    list    r    GRidControlPoint*     Array of control point structures.
-    nlist   r    int                   Number of structure.
 
-        note:  To disable the control point usage, set list to NULL or
-               set nlist to zero.
+
+/*
+  ****************************************************************
+
+            g r d _ e n d _ c a l c _ s e s s i o n
+
+  ****************************************************************
+
+  End the current gridding session and free the cached data.
+  Always returns 1.
 
 */
 
-int CSWGrdCalc::grd_set_control_points (GRidControlPoint *list, int nlist)
+int CSWGrdCalc::grd_end_calc_session (void)
 {
-    int                     i, n;
 
-    if (ControlPoints != NULL) {
-        csw_Free (ControlPoints);
-        ControlPoints = NULL;
-        NumControlPoints = 0;
-    }
+    FreeSessionData ();
 
-    if (list == NULL  ||  nlist == 0) {
-        return 1;
-    }
+    return 1;
 
-    ControlPoints = (GRidControlPoint *)csw_Calloc (nlist * sizeof(GRidControlPoint));
-    if (ControlPoints == NULL) {
+}  /*  end of function grd_end_calc_session  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+           g r d _ b e g i n _ p o i n t _ s t r e a m
+
+  ****************************************************************
+
+  Start collecting points for a streamed grid calculation.  The
+  points are added in chunks by grd_add_point_chunk and the grid
+  is calculated from them by grd_calc_grid_from_stream.  The points
+  are copied into arrays owned by the stream, and those arrays are
+  used directly by the grid calculation, so the caller does not need
+  to keep all of the points in memory and the points are only stored
+  once.
+
+  If the total number of points is known (or can be estimated), it
+  should be specified as npts_hint.  The arrays are allocated for
+  that many points up front, so they do not need to be grown while
+  the chunks are added.  If npts_hint is zero or less, the arrays
+  are grown as needed.
+
+  Any points from a previous stream are discarded.
+
+  return value:    1 on success
+                  -1 on a memory allocation error (error 1)
+
+*/
+
+int CSWGrdCalc::grd_begin_point_stream (int npts_hint)
+{
+    int            nmax;
+
+    grd_end_point_stream ();
+
+    nmax = npts_hint;
+    if (nmax < 1000) nmax = 1000;
+
+MSL
+    Stream.x = (CSW_F *)csw_Malloc (nmax * sizeof(CSW_F));
+MSL
+    Stream.y = (CSW_F *)csw_Malloc (nmax * sizeof(CSW_F));
+MSL
+    Stream.z = (CSW_F *)csw_Malloc (nmax * sizeof(CSW_F));
+    if (Stream.x == NULL  ||  Stream.y == NULL  ||  Stream.z == NULL) {
+        grd_end_point_stream ();
         grd_utils_ptr->grd_set_err (1);
         return -1;
     }
 
-    n = 0;
-    for (i=0; i<nlist; i++) {
-        if (list[i].type < GRD_CONTROL_GREATER  ||
-            list[i].type > GRD_CONTROL_BETWEEN) {
-            continue;
-        }
-        if (list[i].type == GRD_CONTROL_BETWEEN) {
-            if (list[i].z1 >= list[i].z2) {
-                continue;
-            }
-        }
-        memcpy ((char *)(ControlPoints+n), (char *)(list+i), sizeof(GRidControlPoint));
-        n++;
-    }
-
-    if (n == 0) {
-        csw_Free (ControlPoints);
-        ControlPoints = NULL;
-        NumControlPoints = 0;
-    }
+    Stream.active = 1;
+    Stream.npts = 0;
+    Stream.maxpts = nmax;
+    Stream.xmin = 1.e30f;
+    Stream.ymin = 1.e30f;
+    Stream.xmax = -1.e30f;
+    Stream.ymax = -1.e30f;
 
-    NumControlPoints = n;
     return 1;
 
-}  /*  end of function grd_set_control_points  */
+}  /*  end of function grd_begin_point_stream  */
 
 
 
 
 
 /*
-  ****************************************************************************
+  ****************************************************************
 
-                g r d _ s e t _ c o n t r o l _ s u r f a c e
+             g r d _ a d d _ p o i n t _ c h u n k
 
-  ****************************************************************************
+  ****************************************************************
 
-    Set up or unset a control surface for subsequent grid calculations.
+  Append a chunk of points to the current point stream.  The caller
+  can reuse or free its x, y and z arrays as soon as this returns.
+  If the stream arrays are full, they are grown by half of their
+  current size (or more if the chunk needs it).
+
+  return value:    1 on success
+                  -1 on error
+
+  errors:          1 = memory allocation error
+                   2 = no stream is active or a NULL array was specified
+                   3 = npts is negative or the total number of points
+                       is too large
 
 */
 
-int CSWGrdCalc::grd_set_control_surface
-                    (CSW_F *grid, int ncol, int nrow,
-                     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2, int type)
+int CSWGrdCalc::grd_add_point_chunk (CSW_F *x, CSW_F *y, CSW_F *z, int npts)
 {
-    bool csuccess = false;
-    bool bsuccess = false;
-    bool tsuccess = false;
-
-    auto fscope = [&]()
-    {
-        if (csuccess == false) {
-            csw_Free (ConformalGrid.grid);
-            ConformalGrid.grid = NULL;
-        }
-        if (bsuccess == false) {
-            csw_Free (BaselapGrid.grid);
-            BaselapGrid.grid = NULL;
-        }
-        if (tsuccess == false) {
-            csw_Free (TruncationGrid.grid);
-            TruncationGrid.grid = NULL;
-        }
-    };
-    CSWScopeGuard func_scope_guard (fscope);
+    int            i, n, nmax;
+    CSW_F          *xt, *yt, *zt;
 
+    if (Stream.active == 0  ||  x == NULL  ||  y == NULL  ||  z == NULL) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
 
-    if (grid != NULL) {
-        if (x1 >= x2  ||  y1 >= y2) {
-            grd_utils_ptr->grd_set_err (3);
-            return -1;
-        }
+    if (npts < 0  ||  npts > WildInteger - Stream.npts) {
+        grd_utils_ptr->grd_set_err (3);
+        return -1;
     }
 
-    if (type == GRD_CONFORMABLE) {
+    if (npts == 0) {
+        return 1;
+    }
 
-        if (grid == NULL) {
-            ConformalFlag = 0;
-            return 1;
+/*
+    Grow the arrays if needed.
+*/
+    n = Stream.npts + npts;
+    if (n > Stream.maxpts) {
+        nmax = Stream.maxpts + Stream.maxpts / 2;
+        if (nmax < n) nmax = n;
+        if (nmax > WildInteger) nmax = WildInteger;
+        xt = (CSW_F *)csw_Realloc (Stream.x, nmax * sizeof(CSW_F));
+        if (xt == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
         }
-        if (ConformalGrid.grid) {
-            csw_Free (ConformalGrid.grid);
-            ConformalGrid.grid = NULL;
+        Stream.x = xt;
+        yt = (CSW_F *)csw_Realloc (Stream.y, nmax * sizeof(CSW_F));
+        if (yt == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
         }
-        ConformalGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
-        if (ConformalGrid.grid == NULL) {
+        Stream.y = yt;
+        zt = (CSW_F *)csw_Realloc (Stream.z, nmax * sizeof(CSW_F));
+        if (zt == NULL) {
             grd_utils_ptr->grd_set_err (1);
             return -1;
         }
-        memcpy (ConformalGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
-        ConformalGrid.ncol = ncol;
-        ConformalGrid.nrow = nrow;
-        ConformalGrid.x1 = x1;
-        ConformalGrid.y1 = y1;
-        ConformalGrid.x2 = x2;
-        ConformalGrid.y2 = y2;
-        ConformalFlag = 1;
-
-        csuccess = true;
+        Stream.z = zt;
+        Stream.maxpts = nmax;
+    }
 
-        return 1;
+    memcpy (Stream.x + Stream.npts, x, npts * sizeof(CSW_F));
+    memcpy (Stream.y + Stream.npts, y, npts * sizeof(CSW_F));
+    memcpy (Stream.z + Stream.npts, z, npts * sizeof(CSW_F));
 
+    for (i=0; i<npts; i++) {
+        if (x[i] < Stream.xmin) Stream.xmin = x[i];
+        if (y[i] < Stream.ymin) Stream.ymin = y[i];
+        if (x[i] > Stream.xmax) Stream.xmax = x[i];
+        if (y[i] > Stream.ymax) Stream.ymax = y[i];
     }
 
-    if (type == GRD_BASELAP) {
+    Stream.npts = n;
 
-        if (grid == NULL) {
-            BaselapFlag = 0;
-            return 1;
-        }
-        if (BaselapGrid.grid) {
-            csw_Free (BaselapGrid.grid);
-            BaselapGrid.grid = NULL;
-        }
-        BaselapGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
-        if (BaselapGrid.grid == NULL) {
-            grd_utils_ptr->grd_set_err (1);
-            return -1;
-        }
-        memcpy (BaselapGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
-        BaselapGrid.ncol = ncol;
-        BaselapGrid.nrow = nrow;
-        BaselapGrid.x1 = x1;
-        BaselapGrid.y1 = y1;
-        BaselapGrid.x2 = x2;
-        BaselapGrid.y2 = y2;
-        BaselapFlag = 1;
+    return 1;
 
-        bsuccess = true;
+}  /*  end of function grd_add_point_chunk  */
 
-        return 1;
 
-    }
 
-    if (type == GRD_TRUNCATION) {
 
-        if (grid == NULL) {
-            TruncationFlag = 0;
-            return 1;
-        }
-        if (TruncationGrid.grid) {
-            csw_Free (TruncationGrid.grid);
-            TruncationGrid.grid = NULL;
-        }
-        TruncationGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
-        if (TruncationGrid.grid == NULL) {
-            grd_utils_ptr->grd_set_err (1);
-            return -1;
-        }
-        memcpy (TruncationGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
-        TruncationGrid.ncol = ncol;
-        TruncationGrid.nrow = nrow;
-        TruncationGrid.x1 = x1;
-        TruncationGrid.y1 = y1;
-        TruncationGrid.x2 = x2;
-        TruncationGrid.y2 = y2;
-        TruncationFlag = 1;
 
-        tsuccess = true;
+/*
+  ****************************************************************
 
-        return 1;
+            g r d _ g e t _ p o i n t _ s t r e a m
 
-    }
+  ****************************************************************
 
-    grd_utils_ptr->grd_set_err (2);
+  Return pointers to the point arrays of the current stream along
+  with the number of points and their x and y limits.  The arrays
+  still belong to the stream.  The caller may change the values in
+  them (for example, to shift the points), but it must not free them.
+  Returns -1 if no stream is active or 1 otherwise.
 
-    return -1;
+*/
 
-}  /*  end of function grd_set_control_surface  */
+int CSWGrdCalc::grd_get_point_stream (CSW_F **x, CSW_F **y, CSW_F **z,
+                                      int *npts,
+                                      CSW_F *xmin, CSW_F *ymin,
+                                      CSW_F *xmax, CSW_F *ymax)
+{
+
+    if (Stream.active == 0) {
+        return -1;
+    }
+
+    *x = Stream.x;
+    *y = Stream.y;
+    *z = Stream.z;
+    *npts = Stream.npts;
+    *xmin = Stream.xmin;
+    *ymin = Stream.ymin;
+    *xmax = Stream.xmax;
+    *ymax = Stream.ymax;
 
+    return 1;
+
+}  /*  end of function grd_get_point_stream  */
 
 
 
@@ -530,1639 +581,3436 @@ int CSWGrdCalc::grd_set_control_surface
 /*
   ****************************************************************
 
-                     g r d _ c a l c _ g r i d
+         g r d _ c a l c _ g r i d _ f r o m _ s t r e a m
 
   ****************************************************************
 
-  function name:    grd_calc_grid              (int)
+  Calculate a grid from the points in the current stream.  This is
+  the same as grd_calc_grid using the stream points, except that the
+  stream arrays are used as the calculation data without copying
+  them.  The z values in the stream may be changed by the calculation
+  (for example by clipping to the hard min and max), so the stream is
+  ended, and its points freed, when the calculation is done.  If the
+  err array is not NULL, it must have room for the number of points
+  in the stream.
 
-  call sequence:    grd_calc_grid (x, y, z, err, npts,
-                                   grid, mask, report, ncol, nrow,
-                                   x1, y1, x2, y2, options)
+  The return value and errors are the same as for grd_calc_grid,
+  with error 2 if no stream is active.
 
-  purpose:          Calculate a uniform grid by interpolating the
-                    specified data points.  The errors between input
-                    points and the grid's estimate can be returned
-                    in the error array.  A mask specifying which
-                    grid points are outside the data area or
-                    inside but far from control points can also
-                    be returned in the mask array.  This function only
-                    supports non faulted continuous surfaces.
--
-                    The grid must have at least 8 columns and 8 rows.
-                    The upper limit of grid size is controlled by available
-                    virtual memory.  The algorithm needs workspace about 5
-                    times the size of the grid, plus workspace about twice
-                    the size of the data array.  For example, calculating
-                    a 1000 by 1000 grid from 100000 points would need about
-                    43 to 44 megabytes of work space.  Memory allocation errors
-                    are generally caused by grids too large for available
-                    memory.
+*/
 
-  return value:     status code
-                    -1 = error
-                     1 = success
+int CSWGrdCalc::grd_calc_grid_from_stream
+    (CSW_F *err,
+     CSW_F *in_grid, char *in_mask, char **report,
+     int ncol, int nrow,
+     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+     GRidCalcOptions *options)
+{
+    int            istat;
 
-  errors:           1 = memory allocation error
-                    2 = A NULL x, y, z, or grid array is specified.
-                    3 = A wild parameter was encountered.
-                    4 = ncol or nrow is less than 2
-                    5 = x2 less than x1 or y2 less than y1
-                    6 = npts less than 1
-                    7 = number of points actually in the data area
-                        is less than 1
-                    8 = The points are distributed in a manner that
-                        cannot be fit with a trend surface (probably
-                        all points are coincident or colinear).
-                    9 = One of the x, y or z points is bad (less than
-                        -1.e20 or greater than 1.e20).
+    auto fscope = [&]()
+    {
+        InputOwnedFlag = 0;
+        grd_end_point_stream ();
+    };
+    CSWScopeGuard func_scope_guard (fscope);
 
+    if (Stream.active == 0) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
 
-  calling parameters:
+    InputOwnedFlag = 1;
+    istat = grd_calc_grid (Stream.x, Stream.y, Stream.z, err, Stream.npts,
+                           in_grid, in_mask, report, ncol, nrow,
+                           x1, y1, x2, y2, options);
 
-    x        r    CSW_F*    Array of x coordinates
-    y        r    CSW_F*    Array of y coordinates
-    z        r    CSW_F*    Array of z values at the x,y coordinates
-    err      w    CSW_F*    Optional array to receive errors at the
-                            input points.  Set to NULL if not wanted.
-    npts     r    int       Number of points in x, y, z and error.
-    in_grid  w    CSW_F*    Array to receive the grid values.
-    mask     w    char*     Optional array to receive a mask specifying
-                            whether a grid node is outside the data
-                            area, inside and well defined, or inside
-                            and poorly defined.  A well defined node
-                            has a mask value of zero.  A node outside
-                            the data area has a mask value of 1.  A
-                            poorly defined inside node has a mask
-                            value of 2.  Specify a NULL pointer to
-                            disable this feature.
-    report   w    char**    If this is not NULL, a report is written
-                            into space allocated by the funtion.
-    ncol     r    int       Number of columns in the grid and mask.
-    nrow     r    int       Number of rows in the grid and mask.
-    x1       r    CSW_F     Minimum x coordinate of the grid.
-    y1       r    CSW_F     Minimum y coordinate of the grid.
-    x2       r    CSW_F     Maximum x coordinate of the grid.
-    y2       r    CSW_F     Maximum y coordinate of the grid.
-    options  r    GRidCalcOptions
-                            Optional grid calc option structure.
+    return istat;
+
+}  /*  end of function grd_calc_grid_from_stream  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+             g r d _ e n d _ p o i n t _ s t r e a m
+
+  ****************************************************************
+
+  Discard the current point stream and free its points.
+  Always returns 1.
 
 */
 
-int CSWGrdCalc::grd_calc_grid
-    (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *err, int npts,
-     CSW_F *in_grid, char *in_mask, char **report, int ncol, int nrow,
-     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
-     GRidCalcOptions *options)
+int CSWGrdCalc::grd_end_point_stream (void)
 {
-    int       n, i, j, k, k2, istat, ismooth, nbins, offset;
-    CSW_F     savsmooth, datax1, datay1, datax2, datay2, margin1;
-    int       orig_ncol, orig_nrow, ncolr, nrowr, idenom, resampleflag;
-    int       dpsav, fault_resampleflag, pre_fault_ncol, pre_fault_nrow;
-    CSW_F     x1r, y1r, x2r, y2r,
-              *newgrid = NULL, *local_grid = NULL, *grid = NULL;
-    char      *newmask = NULL, *local_mask = NULL, *mask = NULL;
-    CSW_F     tiny, ftmp, xt1, yt1, xt2, yt2, xyratio;
-    CSW_F     xmarg, ymarg, orig_min_val, orig_max_val;
-    FAultLineStruct   *faults = NULL;
-    int       nfaults, fistat;
-    int       recalc_grid_flag, erflag;
-    double    node_ratio, smooth_mult;
-    int       num_pre_pass1;
-    int       do_write;
-    char      fname[200];
 
+    csw_Free (Stream.x);
+    csw_Free (Stream.y);
+    csw_Free (Stream.z);
+    memset (&Stream, 0, sizeof(Stream));
 
-    auto fscope = [&]()
-    {
-        csw_Free (local_mask);
-        csw_Free (local_grid);
-        csw_Free (newgrid);
-        csw_Free (newmask);
-        FreeMem ();
-    };
+    return 1;
+
+}  /*  end of function grd_end_point_stream  */
 
 
-    CSWScopeGuard func_scope_guard (fscope);
 
 
 
 /*
-    check obvious errors in input parameters
+  ****************************************************************
+
+             g r d _ c a l c _ g r i d _ m u l t i
+
+  ****************************************************************
+
+  Calculate a grid for each of several attributes measured at the
+  same x, y locations.  zlist[k] has the npts values for attribute k,
+  grids[k] gets its grid and masks[k] gets its mask.  The masks
+  array, or any member of it, can be NULL.  The other parameters are
+  the same as for grd_calc_grid.
+
+  The attributes are calculated one at a time, but the local point
+  lists found for the first attribute are recorded and replayed for
+  the later attributes whenever the data and search tables are the
+  same.  The grids are identical to what separate grd_calc_grid calls
+  would produce.  When threads are available, grd_CalcGridMulti in
+  the API calculates the attributes at the same time on separate
+  objects and does not use this function.
+
+  Returns 1 on success or -1 on error.
+
 */
-    if (ncol < -WildInteger  ||  ncol > WildInteger  ||
-        nrow < -WildInteger  ||  nrow > WildInteger  ||
-        x1 < -WildFloat  ||  x1 > WildFloat  ||
-        y1 < -WildFloat  ||  y1 > WildFloat ||
-        x2 < -WildFloat  ||  x2 > WildFloat ||
-        y2 < -WildFloat  ||  y2 > WildFloat) {
-        grd_utils_ptr->grd_set_err (3);
-        return -1;
-    }
 
-    if (x == NULL  ||  y == NULL  ||  z == NULL) {
-        grd_utils_ptr->grd_set_err (2);
-        return -1;
-    }
+int CSWGrdCalc::grd_calc_grid_multi
+    (CSW_F *x, CSW_F *y, CSW_F **zlist, int nattr, int npts,
+     CSW_F **grids, char **masks,
+     int ncol, int nrow,
+     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+     GRidCalcOptions *options)
+{
+    int            i, istat;
+    char           *mask;
 
-    if (ncol < MIN_COLS_GCALC  ||  nrow < MIN_ROWS_GCALC) {
-        grd_utils_ptr->grd_set_err (4);
-        return -1;
-    }
+    auto fscope = [&]()
+    {
+        FreeSharedSearch ();
+    };
+    CSWScopeGuard func_scope_guard (fscope);
 
-    if (x2 <= x1  ||  y2 <= y1) {
-        grd_utils_ptr->grd_set_err (5);
+    if (zlist == NULL  ||  grids == NULL) {
+        grd_utils_ptr->grd_set_err (2);
         return -1;
     }
 
-    if (npts < 1) {
+    if (nattr < 1) {
         grd_utils_ptr->grd_set_err (6);
         return -1;
     }
 
-/*
- * Check for bad values on x, y and z data.  This check is based on allowing
- * a map to stretch from pole to pole in millimeters, which would be 10 billion
- * millimeters and then adding a couple of orders of magnitude for good measure.
- */
-    if (x1 < -1.e12  ||  x1 > 1.e12  ||
-        y1 < -1.e12  ||  y1 > 1.e12 ||
-        x2 < -1.e12  ||  x2 > 1.e12 ||
-        y2 < -1.e12  ||  y2 > 1.e12) {
-        grd_utils_ptr->grd_set_err (3);
-        return -1;
+    for (i=0; i<nattr; i++) {
+        if (zlist[i] == NULL  ||  grids[i] == NULL) {
+            grd_utils_ptr->grd_set_err (2);
+            return -1;
+        }
     }
 
-    for (i=0; i<npts; i++) {
-        if (x[i] < -1.e12  ||  x[i] > 1.e12  ||
-            y[i] < -1.e12  ||  y[i] > 1.e12  ||
-            z[i] < -1.e12  ||  z[i] > 1.e12) {
-            grd_utils_ptr->grd_set_err (9);
+    FreeSharedSearch ();
+
+    for (i=0; i<nattr; i++) {
+        SharedSearch.mode = (i == 0) ? 1 : 2;
+        SharedSearch.ibuild = 0;
+        SharedSearch.itable = -1;
+        mask = NULL;
+        if (masks != NULL) {
+            mask = masks[i];
+        }
+        istat = grd_calc_grid (x, y, zlist[i], NULL, npts,
+                               grids[i], mask, NULL,
+                               ncol, nrow, x1, y1, x2, y2, options);
+        if (istat == -1) {
             return -1;
         }
     }
 
+    return 1;
 
+}  /*  end of function grd_calc_grid_multi  */
 
-/*
- * !!!! debug only
- */
-    do_write = csw_GetDoWrite ();
-    if (do_write == 1) {
-        strcpy (fname, "grid_input.xyz");
-        grd_fileio_ptr->grd_write_float_points (x, y, z, npts, fname);
-    }
 
 
-    PointNodeRatio = (double)npts / (double)(ncol * nrow);
 
-    grid = in_grid;
-    mask = in_mask;
-    local_grid = NULL;
-    local_mask = NULL;
 
 /*
-    Check if all the values are the same.
-*/
-    istat = csw_CheckRangeZero (z, npts);
-    FlatGridFlag = 0;
-    if (istat == 0) {
-        FlatGridFlag = 1;
-        StepGridFlag = 0;
-        ThicknessFlag = 0;
-    }
+  ****************************************************************
 
-    if (npts < 2) {
-        FlatGridFlag = 1;
-    }
+         g r d _ u s e s _ s a v e d _ s e t t i n g s
 
-/*
-    If there are control points, reset the flat grid flag to zero
-    if any of the control point limits are violated by the flat
-    grid value.
-*/
-    if (NumControlPoints > 0  &&  FlatGridFlag == 1) {
-        istat = CheckFlatControl (x, y, z, npts);
-        if (istat == 0) {
-            FlatGridFlag = 0;
-            if (NumFlatControl < MAX_CONTROL  &&  ConformalFlag == 0) {
-                x = Xcontrol;
-                y = Ycontrol;
-                z = Zcontrol;
-                npts = NumFlatControl;
-            }
-        }
-    }
+  ****************************************************************
 
-/*
-    If there is a conformal shaping surface, set the flat flag to zero.
-*/
-    if (ConformalFlag) FlatGridFlag = 0;
+  Return 1 if a grid calculation on this object depends on settings
+  made before the call, other than the output shifts and the option
+  values that are also in a GRidCalcOptions structure.  These are
+  the control points, control surfaces, conformable surface, noisy
+  data flag, debug output flag and calculation session data.  A new
+  CSWGrdCalc object with the same options and output shifts gives
+  the same grid as this one only if this returns zero.
 
-/*
-    Calculate the number of bins to use for
-    global anisotropy.
 */
-    nbins = (ncol + nrow) / 4;
-    if (nbins < 20) nbins = 20;
-    if (nbins > 500) nbins = 500;
 
-/*
-    Transfer either the global or structure options to the working
-    option set.
-*/
-    if (options == NULL) {
-        PreferredStrike = OptPreferredStrike;
-        OutsideBoundaryMargin = OptOutsideBoundaryMargin;
-        InsideBoundaryMargin = OptInsideBoundaryMargin;
-        ReportLines = OptReportLines;
-        GridMinValue = OptGridMinValue;
-        GridMaxValue = OptGridMaxValue;
-        HardMinValue = OptHardMinValue;
-        HardMaxValue = OptHardMaxValue;
-        AnisotropyFlag = OptAnisotropyFlag;
-        DistancePower = OptDistancePower;
-        if (DistancePower == 0) DistancePower = 2;
-        StrikePower = OptStrikePower;
-        NumLocalPoints = OptNumLocalPoints;
-        LocalSearchPattern = OptLocalSearchPattern;
-        MaxSearchDistance = OptMaxSearchDistance;
-        FastGridFlag = OptFastGridFlag;
-        ThicknessFlag = OptThicknessFlag;
-        StepGridFlag = OptStepGridFlag;
-        WorkMargin = OptWorkMargin;
-        FaultedFlag = OptFaultedFlag;
-        TriangulateFlag = OptTriangulateFlag;
-        DefaultSizeMultiplier = OptDefaultSizeMultiplier;
-        MovingAvgOnly = 0;
+int CSWGrdCalc::grd_uses_saved_settings (void)
+{
+
+    if (NumControlPoints > 0  ||
+        ConformalFlag  ||  BaselapFlag  ||  TruncationFlag  ||
+        ConformableFlag  ||  NoisyDataFlag  ||
+        debug_output_flag  ||  Session.active) {
+        return 1;
     }
 
-    else {
-        PreferredStrike = (CSW_F)options->preferred_strike;
-        OutsideBoundaryMargin = options->outside_margin;
-        InsideBoundaryMargin = options->inside_margin;
-        ReportLines = options->report_lines;
+    return 0;
+
+}  /*  end of function grd_uses_saved_settings  */
 
-        GridMinValue = options->min_value;
-        GridMaxValue = options->max_value;
-        HardMinValue = options->hard_min;
-        HardMaxValue = options->hard_max;
-        AnisotropyFlag = options->anisotropy_flag;
-        DistancePower = options->distance_power;
-        if (DistancePower == 0) DistancePower = 2;
-        StrikePower = options->strike_power;
-        NumLocalPoints = options->num_local_points;
-        LocalSearchPattern = options->local_search_pattern;
-        MaxSearchDistance = options->max_search_distance;
-        FastGridFlag = options->fast_flag;
-        ThicknessFlag = options->thickness_flag;
-        StepGridFlag = options->step_flag;
-        WorkMargin = options->work_margin;
-        FaultedFlag = options->faulted_flag;
-        TriangulateFlag = options->triangulate_flag;;
-        DefaultSizeMultiplier = 1;
-        MovingAvgOnly = options->moving_avg_only;
-    }
 
-/*
- * Extract the NoTrendFlag from the TriangulateFlag value.
- */
-    erflag = TriangulateFlag / 1000;
-    NoTrendFlag = (TriangulateFlag % 1000) / 100;
-    TriangulateFlag = TriangulateFlag % 100;
-    EmptyRegionFlag = 1;
-    if (erflag == 1) EmptyRegionFlag = 0;
 
-    VerticalFaultFlag = 0;
-    if (TriangulateFlag == 6) {
-        TriangulateFlag = 3;
-        VerticalFaultFlag = 1;
-        EmptyRegionFlag = 1;
-        AnisotropyFlag = 0;
-        PreferredStrike = -1000.0f;
-    }
-    else {
-        if (AnisotropyFlag == 1  ||  PreferredStrike >= 0.0) {
-            TriangulateFlag = 0;
-        }
-    }
 
-/*
- * If a vertical fault is being calculated, and the z values are
- * very small relative to the xy range, then the vertical fault
- * is planar and, since the z values represent distance from the
- * plane, a grid set to all zeros is returned.
- */
-    if (VerticalFaultFlag == 1) {
-        Zmin = 1.e30f;
-        Zmax = -1.e30f;
-        for (i=0; i<npts; i++) {
-            if (z[i] < Zmin) Zmin = z[i];
-            if (z[i] > Zmax) Zmax = z[i];
-        }
-        xt1 = Zmax - Zmin;
-        xt2 = (x2 - x1);
-        if (y2 - y1 > xt2) xt2 = y2 - y1;
-        if (xt2 > 1000 * xt1) {
-            memset (in_grid, 0, ncol * nrow * sizeof(CSW_F));
-            if (in_mask) {
-                memset (in_mask, 0, ncol * nrow * sizeof(char));
-            }
-            if (err) {
-                memset (err, 0, npts * sizeof(CSW_F));
-            }
-            return 1;
-        }
-    }
 
 /*
-    Change any garbage option values to their defaults.
-*/
-    if (PreferredStrike < 0.0f) PreferredStrike += 360.0f;
-    if (PreferredStrike < 0  ||  PreferredStrike > 360) PreferredStrike = -1000.0f;
-    if (OutsideBoundaryMargin < 1) OutsideBoundaryMargin = 1;
+  ****************************************************************
 
-  /*
-   * Previously, if the inside boundary margin was less than 2, the default value
-   * of 10 was used.  Now, any InsideBoundaryMargin value 1 or greater is accepted.
-   * Values less than 2 will make ugly maps, but that is the application code's
-   * responsibility to avoid if it chooses to do so.
-   */
-    if (InsideBoundaryMargin < 1) InsideBoundaryMargin = 1;
+            g r d _ s e t _ c o n t r o l _ p o i n t s
 
-    if (ReportLines < 1) ReportLines = 20;
-    if (AnisotropyFlag < 1  ||  AnisotropyFlag > 2) AnisotropyFlag = 0;
-    if (DistancePower < 2) DistancePower = 2;
-    if (DistancePower > 6) DistancePower = 6;
-    if (DistancePower == 3) DistancePower = 2;
-    if (DistancePower == 5) DistancePower = 4;
-    if (StrikePower < 2) StrikePower = 2;
-    if (StrikePower > 6) StrikePower = 6;
-    if (StrikePower == 3) StrikePower = 4;
-    if (StrikePower == 5) StrikePower = 6;
-    if (NumLocalPoints < 1  ||  NumLocalPoints > MAX_LOCAL) NumLocalPoints = MAX_LOCAL;
-    if (LocalSearchPattern < 1  ||  LocalSearchPattern > 3) LocalSearchPattern = 1;
-    if (WorkMargin < 0) WorkMargin = -1;
-    if (GridMinValue >= GridMaxValue) {
-        GridMinValue = -1.e30f;
-        GridMaxValue = 1.e30f;
-    }
-    if (GridMinValue > 1.e20f) {
-        GridMinValue = -1.e30f;
-    }
-    if (GridMaxValue < -1.e20f) {
-        GridMaxValue = 1.e30f;
-    }
+  ****************************************************************
 
-    if (GridMinValue < HardMinValue) GridMinValue = HardMinValue;
-    if (GridMaxValue > HardMaxValue) GridMaxValue = HardMaxValue;
+  function name:      grd_set_control_points          (int)
 
-    orig_min_val = GridMinValue;
-    orig_max_val = GridMaxValue;
+  call sequence:      grd_set_controlPoints (list, nlist)
 
-    if (ThicknessFlag == GRD_POSITIVE_THICKNESS) {
-        GridMinValue = -1.e30f;
-    }
-    if (ThicknessFlag == GRD_NEGATIVE_THICKNESS) {
-        GridMaxValue = 1.e30f;
-    }
+  purpose:            Set up control points for subsequent grid
+                      calculations.  Control points specify that
+                      the grid must be less than a value, greater than
+                      a value, or between two values at a location.
+                      They do not say exactly what the value should be
+                      at the location.  The type member of the control
+                      point structure specifies the greater than, less
+                      than or between behavior. (1 = greater than,
+                      2 = less than, 3 = between).
 
-/*
-    Turn off preferred strike and anisotropy for fast grid flag.
-*/
-    if (FastGridFlag) {
-        AnisotropyFlag = 0;
-        PreferredStrike = -1000.0f;
-    }
+  return value:       1 on success
+                      -1 on error
 
-/*
-    Reset some options if the step grid flag is set.
-*/
-    if (StepGridFlag) {
-        AnisotropyFlag = 0;
-        PreferredStrike = -1000.0f;
-        MaxSearchDistance = 1.e30f;
-        InsideBoundaryMargin = 100000;
-        LocalSearchPattern = GRD_RADIAL_SEARCH;
-        NumLocalPoints = 100;
-        ThicknessFlag = 0;
-    }
+  errors:             1 = memory allocation failure
 
-/*
-    Turn off anisotropy if the grid is flat.
-*/
-    if (FlatGridFlag == 1) {
-        AnisotropyFlag = 0;
-        PreferredStrike = -1000.0f;
-    }
+  calling parameters:
 
-/*
-    If a preferred strike has been explicitly specified,
-    set the anisotropy flag to zero.
-*/
-    if (PreferredStrike >= 0.0f) {
-        AnisotropyFlag = 0;
-    }
+    list    r    GRidControlPoint*     Array of control point structures.
+    nlist   r    int                   Number of structure.
 
-/*
-    If there are 2 points, turn off anisotropy if it is on.
-    Also, generate a third point in a position where a plane
-    can be calculated between the 2 points.  The plane will
-    represent the gradient along a line between the 2 points.
-*/
-    GPFCalcdraw     gpf_calcdraw_obj;
-    OrigNdata = npts;
-    if (npts == 2) {
-        AnisotropyFlag = 0;
-        PreferredStrike = -1000.0f;
-        gpf_calcdraw_obj.gpf_shortperpbisector
-            (x[0], y[0], x[1], y[1], &xt1, &yt1, &xt2, &yt2);
-        memcpy (Xsmall, x, 2 * sizeof(CSW_F));
-        memcpy (Ysmall, y, 2 * sizeof(CSW_F));
-        memcpy (Zsmall, z, 2 * sizeof(CSW_F));
-        Xsmall[2] = xt2;
-        Ysmall[2] = yt2;
-        Zsmall[2] = (Zsmall[0] + Zsmall[1]) / 2.0f;
-        npts = 3;
-        x = Xsmall;
-        y = Ysmall;
-        z = Zsmall;
-    }
+        note:  To disable the control point usage, set list to NULL or
+               set nlist to zero.
 
-/*
-    Save some of the parameters in private class variables.
 */
-    OrigXmin = Xmin = x1;
-    OrigYmin = Ymin = y1;
-    OrigXmax = Xmax = x2;
-    OrigYmax = Ymax = y2;
-    ReportNcol = ncol;
-    ReportNrow = nrow;
 
-/*
-    Find the "optimum" number of rows and columns given
-    the data distribution.  If the requested number is
-    far different, use the optimal and then, at the end
-    of the grid calculation, resample to the requested
-    geometry.
-*/
-    x1r = x1;
-    y1r = y1;
-    x2r = x2;
-    y2r = y2;
+int CSWGrdCalc::grd_set_control_points (GRidControlPoint *list, int nlist)
+{
+    int                     i, n;
 
-    pre_fault_nrow = nrow;
-    pre_fault_ncol = ncol;
-    fault_resampleflag = 0;
-    if (FaultedFlag) {
-        while (ncol < 4  ||  nrow < 4) {
-            ncol *= 2;
-            nrow *= 2;
-            fault_resampleflag = 1;
-        }
+    if (ControlPoints != NULL) {
+        csw_Free (ControlPoints);
+        ControlPoints = NULL;
+        NumControlPoints = 0;
     }
-    orig_nrow = nrow;
-    orig_ncol = ncol;
 
-    if (fault_resampleflag == 1) {
-        local_grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
-        if (local_grid == NULL) {
-            grd_utils_ptr->grd_set_err (1);
-            return -1;
+    if (list == NULL  ||  nlist == 0) {
+        return 1;
+    }
+
+    ControlPoints = (GRidControlPoint *)csw_Calloc (nlist * sizeof(GRidControlPoint));
+    if (ControlPoints == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    n = 0;
+    for (i=0; i<nlist; i++) {
+        if (list[i].type < GRD_CONTROL_GREATER  ||
+            list[i].type > GRD_CONTROL_BETWEEN) {
+            continue;
         }
-        if (mask) {
-            local_mask = (char *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
-            if (local_mask == NULL) {
-                grd_utils_ptr->grd_set_err (1);
-                return -1;
+        if (list[i].type == GRD_CONTROL_BETWEEN) {
+            if (list[i].z1 >= list[i].z2) {
+                continue;
             }
         }
-        grid = local_grid;
-        mask = local_mask;
+        memcpy ((char *)(ControlPoints+n), (char *)(list+i), sizeof(GRidControlPoint));
+        n++;
+    }
+
+    if (n == 0) {
+        csw_Free (ControlPoints);
+        ControlPoints = NULL;
+        NumControlPoints = 0;
+    }
+
+    NumControlPoints = n;
+    return 1;
+
+}  /*  end of function grd_set_control_points  */
+
+
+
+
+
+/*
+  ****************************************************************************
+
+                g r d _ s e t _ c o n t r o l _ s u r f a c e
+
+  ****************************************************************************
+
+    Set up or unset a control surface for subsequent grid calculations.
+
+*/
+
+int CSWGrdCalc::grd_set_control_surface
+                    (CSW_F *grid, int ncol, int nrow,
+                     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2, int type)
+{
+    bool csuccess = false;
+    bool bsuccess = false;
+    bool tsuccess = false;
+
+    auto fscope = [&]()
+    {
+        if (csuccess == false) {
+            csw_Free (ConformalGrid.grid);
+            ConformalGrid.grid = NULL;
+        }
+        if (bsuccess == false) {
+            csw_Free (BaselapGrid.grid);
+            BaselapGrid.grid = NULL;
+        }
+        if (tsuccess == false) {
+            csw_Free (TruncationGrid.grid);
+            TruncationGrid.grid = NULL;
+        }
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+
+    if (grid != NULL) {
+        if (x1 >= x2  ||  y1 >= y2) {
+            grd_utils_ptr->grd_set_err (3);
+            return -1;
+        }
+    }
+
+    if (type == GRD_CONFORMABLE) {
+
+        if (grid == NULL) {
+            ConformalFlag = 0;
+            return 1;
+        }
+        if (ConformalGrid.grid) {
+            csw_Free (ConformalGrid.grid);
+            ConformalGrid.grid = NULL;
+        }
+        ConformalGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
+        if (ConformalGrid.grid == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        memcpy (ConformalGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
+        ConformalGrid.ncol = ncol;
+        ConformalGrid.nrow = nrow;
+        ConformalGrid.x1 = x1;
+        ConformalGrid.y1 = y1;
+        ConformalGrid.x2 = x2;
+        ConformalGrid.y2 = y2;
+        ConformalFlag = 1;
+
+        csuccess = true;
+
+        return 1;
+
+    }
+
+    if (type == GRD_BASELAP) {
+
+        if (grid == NULL) {
+            BaselapFlag = 0;
+            return 1;
+        }
+        if (BaselapGrid.grid) {
+            csw_Free (BaselapGrid.grid);
+            BaselapGrid.grid = NULL;
+        }
+        BaselapGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
+        if (BaselapGrid.grid == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        memcpy (BaselapGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
+        BaselapGrid.ncol = ncol;
+        BaselapGrid.nrow = nrow;
+        BaselapGrid.x1 = x1;
+        BaselapGrid.y1 = y1;
+        BaselapGrid.x2 = x2;
+        BaselapGrid.y2 = y2;
+        BaselapFlag = 1;
+
+        bsuccess = true;
+
+        return 1;
+
+    }
+
+    if (type == GRD_TRUNCATION) {
+
+        if (grid == NULL) {
+            TruncationFlag = 0;
+            return 1;
+        }
+        if (TruncationGrid.grid) {
+            csw_Free (TruncationGrid.grid);
+            TruncationGrid.grid = NULL;
+        }
+        TruncationGrid.grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
+        if (TruncationGrid.grid == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        memcpy (TruncationGrid.grid, grid, ncol*nrow*sizeof(CSW_F));
+        TruncationGrid.ncol = ncol;
+        TruncationGrid.nrow = nrow;
+        TruncationGrid.x1 = x1;
+        TruncationGrid.y1 = y1;
+        TruncationGrid.x2 = x2;
+        TruncationGrid.y2 = y2;
+        TruncationFlag = 1;
+
+        tsuccess = true;
+
+        return 1;
+
+    }
+
+    grd_utils_ptr->grd_set_err (2);
+
+    return -1;
+
+}  /*  end of function grd_set_control_surface  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+                     g r d _ c a l c _ g r i d
+
+  ****************************************************************
+
+  function name:    grd_calc_grid              (int)
+
+  call sequence:    grd_calc_grid (x, y, z, err, npts,
+                                   grid, mask, report, ncol, nrow,
+                                   x1, y1, x2, y2, options)
+
+  purpose:          Calculate a uniform grid by interpolating the
+                    specified data points.  The errors between input
+                    points and the grid's estimate can be returned
+                    in the error array.  A mask specifying which
+                    grid points are outside the data area or
+                    inside but far from control points can also
+                    be returned in the mask array.  This function only
+                    supports non faulted continuous surfaces.
+-
+                    The grid must have at least 8 columns and 8 rows.
+                    The upper limit of grid size is controlled by available
+                    virtual memory.  The algorithm needs workspace about 5
+                    times the size of the grid, plus workspace about twice
+                    the size of the data array.  For example, calculating
+                    a 1000 by 1000 grid from 100000 points would need about
+                    43 to 44 megabytes of work space.  Memory allocation errors
+                    are generally caused by grids too large for available
+                    memory.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           1 = memory allocation error
+                    2 = A NULL x, y, z, or grid array is specified.
+                    3 = A wild parameter was encountered.
+                    4 = ncol or nrow is less than 2
+                    5 = x2 less than x1 or y2 less than y1
+                    6 = npts less than 1
+                    7 = number of points actually in the data area
+                        is less than 1
+                    8 = The points are distributed in a manner that
+                        cannot be fit with a trend surface (probably
+                        all points are coincident or colinear).
+                    9 = One of the x, y or z points is bad (less than
+                        -1.e20 or greater than 1.e20).
+
+
+  calling parameters:
+
+    x        r    CSW_F*    Array of x coordinates
+    y        r    CSW_F*    Array of y coordinates
+    z        r    CSW_F*    Array of z values at the x,y coordinates
+    err      w    CSW_F*    Optional array to receive errors at the
+                            input points.  Set to NULL if not wanted.
+    npts     r    int       Number of points in x, y, z and error.
+    in_grid  w    CSW_F*    Array to receive the grid values.
+    mask     w    char*     Optional array to receive a mask specifying
+                            whether a grid node is outside the data
+                            area, inside and well defined, or inside
+                            and poorly defined.  A well defined node
+                            has a mask value of zero.  A node outside
+                            the data area has a mask value of 1.  A
+                            poorly defined inside node has a mask
+                            value of 2.  Specify a NULL pointer to
+                            disable this feature.
+    report   w    char**    If this is not NULL, a report is written
+                            into space allocated by the funtion.
+    ncol     r    int       Number of columns in the grid and mask.
+    nrow     r    int       Number of rows in the grid and mask.
+    x1       r    CSW_F     Minimum x coordinate of the grid.
+    y1       r    CSW_F     Minimum y coordinate of the grid.
+    x2       r    CSW_F     Maximum x coordinate of the grid.
+    y2       r    CSW_F     Maximum y coordinate of the grid.
+    options  r    GRidCalcOptions
+                            Optional grid calc option structure.
+
+*/
+
+int CSWGrdCalc::grd_calc_grid
+    (CSW_F *x, CSW_F *y, CSW_F *z, CSW_F *err, int npts,
+     CSW_F *in_grid, char *in_mask, char **report, int ncol, int nrow,
+     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+     GRidCalcOptions *options)
+{
+    int       n, i, j, k, k2, istat, ismooth, nbins, offset;
+    CSW_F     savsmooth, datax1, datay1, datax2, datay2, margin1;
+    int       orig_ncol, orig_nrow, ncolr, nrowr, idenom, resampleflag;
+    int       dpsav, fault_resampleflag, pre_fault_ncol, pre_fault_nrow;
+    CSW_F     x1r, y1r, x2r, y2r,
+              *newgrid = NULL, *local_grid = NULL, *grid = NULL;
+    char      *newmask = NULL, *local_mask = NULL, *mask = NULL;
+    CSW_F     tiny, ftmp, xt1, yt1, xt2, yt2, xyratio;
+    CSW_F     xmarg, ymarg, orig_min_val, orig_max_val;
+    FAultLineStruct   *faults = NULL;
+    int       nfaults, fistat;
+    int       recalc_grid_flag, erflag;
+    double    node_ratio, smooth_mult;
+    int       num_pre_pass1;
+    int       do_write;
+    char      fname[200];
+    CSW_F     *zsave = NULL, ssave, psave;
+    int       nsave, asave, esave, empty_hit;
+    double    tbegin, tstart;
+
+
+    auto fscope = [&]()
+    {
+        csw_Free (zsave);
+        csw_Free (local_mask);
+        csw_Free (local_grid);
+        csw_Free (newgrid);
+        csw_Free (newmask);
+        FreeMem ();
+    };
+
+
+    CSWScopeGuard func_scope_guard (fscope);
+
+    memset (&PhaseTimes, 0, sizeof(PhaseTimes));
+    tbegin = WallTime ();
+
+
+/*
+    check obvious errors in input parameters
+*/
+    if (ncol < -WildInteger  ||  ncol > WildInteger  ||
+        nrow < -WildInteger  ||  nrow > WildInteger  ||
+        x1 < -WildFloat  ||  x1 > WildFloat  ||
+        y1 < -WildFloat  ||  y1 > WildFloat ||
+        x2 < -WildFloat  ||  x2 > WildFloat ||
+        y2 < -WildFloat  ||  y2 > WildFloat) {
+        grd_utils_ptr->grd_set_err (3);
+        return -1;
+    }
+
+    if (x == NULL  ||  y == NULL  ||  z == NULL) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    if (ncol < MIN_COLS_GCALC  ||  nrow < MIN_ROWS_GCALC) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+    if (x2 <= x1  ||  y2 <= y1) {
+        grd_utils_ptr->grd_set_err (5);
+        return -1;
+    }
+
+    if (npts < 1) {
+        grd_utils_ptr->grd_set_err (6);
+        return -1;
+    }
+
+/*
+ * Check for bad values on x, y and z data.  This check is based on allowing
+ * a map to stretch from pole to pole in millimeters, which would be 10 billion
+ * millimeters and then adding a couple of orders of magnitude for good measure.
+ */
+    if (x1 < -1.e12  ||  x1 > 1.e12  ||
+        y1 < -1.e12  ||  y1 > 1.e12 ||
+        x2 < -1.e12  ||  x2 > 1.e12 ||
+        y2 < -1.e12  ||  y2 > 1.e12) {
+        grd_utils_ptr->grd_set_err (3);
+        return -1;
+    }
+
+    for (i=0; i<npts; i++) {
+        if (x[i] < -1.e12  ||  x[i] > 1.e12  ||
+            y[i] < -1.e12  ||  y[i] > 1.e12  ||
+            z[i] < -1.e12  ||  z[i] > 1.e12) {
+            grd_utils_ptr->grd_set_err (9);
+            return -1;
+        }
+    }
+
+
+
+/*
+ * !!!! debug only
+ */
+    do_write = csw_GetDoWrite ();
+    if (do_write == 1) {
+        strcpy (fname, "grid_input.xyz");
+        grd_fileio_ptr->grd_write_float_points (x, y, z, npts, fname);
+    }
+
+
+    PointNodeRatio = (double)npts / (double)(ncol * nrow);
+
+    grid = in_grid;
+    mask = in_mask;
+    local_grid = NULL;
+    local_mask = NULL;
+
+/*
+    Check if all the values are the same.
+*/
+    istat = csw_CheckRangeZero (z, npts);
+    FlatGridFlag = 0;
+    if (istat == 0) {
+        FlatGridFlag = 1;
+        StepGridFlag = 0;
+        ThicknessFlag = 0;
+    }
+
+    if (npts < 2) {
+        FlatGridFlag = 1;
+    }
+
+/*
+    If there are control points, reset the flat grid flag to zero
+    if any of the control point limits are violated by the flat
+    grid value.
+*/
+    if (NumControlPoints > 0  &&  FlatGridFlag == 1) {
+        istat = CheckFlatControl (x, y, z, npts);
+        if (istat == 0) {
+            FlatGridFlag = 0;
+            if (NumFlatControl < MAX_CONTROL  &&  ConformalFlag == 0) {
+                x = Xcontrol;
+                y = Ycontrol;
+                z = Zcontrol;
+                npts = NumFlatControl;
+            }
+        }
+    }
+
+/*
+    If there is a conformal shaping surface, set the flat flag to zero.
+*/
+    if (ConformalFlag) FlatGridFlag = 0;
+
+/*
+    Calculate the number of bins to use for
+    global anisotropy.
+*/
+    nbins = (ncol + nrow) / 4;
+    if (nbins < 20) nbins = 20;
+    if (nbins > 500) nbins = 500;
+
+/*
+    Transfer either the global or structure options to the working
+    option set.
+*/
+    if (options == NULL) {
+        PreferredStrike = OptPreferredStrike;
+        OutsideBoundaryMargin = OptOutsideBoundaryMargin;
+        InsideBoundaryMargin = OptInsideBoundaryMargin;
+        ReportLines = OptReportLines;
+        GridMinValue = OptGridMinValue;
+        GridMaxValue = OptGridMaxValue;
+        HardMinValue = OptHardMinValue;
+        HardMaxValue = OptHardMaxValue;
+        AnisotropyFlag = OptAnisotropyFlag;
+        DistancePower = OptDistancePower;
+        if (DistancePower == 0) DistancePower = 2;
+        StrikePower = OptStrikePower;
+        NumLocalPoints = OptNumLocalPoints;
+        LocalSearchPattern = OptLocalSearchPattern;
+        MaxSearchDistance = OptMaxSearchDistance;
+        FastGridFlag = OptFastGridFlag;
+        ThicknessFlag = OptThicknessFlag;
+        StepGridFlag = OptStepGridFlag;
+        WorkMargin = OptWorkMargin;
+        FaultedFlag = OptFaultedFlag;
+        TriangulateFlag = OptTriangulateFlag;
+        DefaultSizeMultiplier = OptDefaultSizeMultiplier;
+        MovingAvgOnly = 0;
+        NumThreads = OptNumThreads;
+        SearchEngine = OptSearchEngine;
+    }
+
+    else {
+        PreferredStrike = (CSW_F)options->preferred_strike;
+        OutsideBoundaryMargin = options->outside_margin;
+        InsideBoundaryMargin = options->inside_margin;
+        ReportLines = options->report_lines;
+
+        GridMinValue = options->min_value;
+        GridMaxValue = options->max_value;
+        HardMinValue = options->hard_min;
+        HardMaxValue = options->hard_max;
+        AnisotropyFlag = options->anisotropy_flag;
+        DistancePower = options->distance_power;
+        if (DistancePower == 0) DistancePower = 2;
+        StrikePower = options->strike_power;
+        NumLocalPoints = options->num_local_points;
+        LocalSearchPattern = options->local_search_pattern;
+        MaxSearchDistance = options->max_search_distance;
+        FastGridFlag = options->fast_flag;
+        ThicknessFlag = options->thickness_flag;
+        StepGridFlag = options->step_flag;
+        WorkMargin = options->work_margin;
+        FaultedFlag = options->faulted_flag;
+        TriangulateFlag = options->triangulate_flag;;
+        DefaultSizeMultiplier = 1;
+        MovingAvgOnly = options->moving_avg_only;
+        NumThreads = options->num_threads;
+        SearchEngine = options->search_engine;
+    }
+
+/*
+ * Extract the NoTrendFlag from the TriangulateFlag value.
+ */
+    erflag = TriangulateFlag / 1000;
+    NoTrendFlag = (TriangulateFlag % 1000) / 100;
+    TriangulateFlag = TriangulateFlag % 100;
+    EmptyRegionFlag = 1;
+    if (erflag == 1) EmptyRegionFlag = 0;
+
+    VerticalFaultFlag = 0;
+    if (TriangulateFlag == 6) {
+        TriangulateFlag = 3;
+        VerticalFaultFlag = 1;
+        EmptyRegionFlag = 1;
+        AnisotropyFlag = 0;
+        PreferredStrike = -1000.0f;
+    }
+    else {
+        if (AnisotropyFlag == 1  ||  PreferredStrike >= 0.0) {
+            TriangulateFlag = 0;
+        }
+    }
+
+/*
+ * If a vertical fault is being calculated, and the z values are
+ * very small relative to the xy range, then the vertical fault
+ * is planar and, since the z values represent distance from the
+ * plane, a grid set to all zeros is returned.
+ */
+    if (VerticalFaultFlag == 1) {
+        Zmin = 1.e30f;
+        Zmax = -1.e30f;
+        for (i=0; i<npts; i++) {
+            if (z[i] < Zmin) Zmin = z[i];
+            if (z[i] > Zmax) Zmax = z[i];
+        }
+        xt1 = Zmax - Zmin;
+        xt2 = (x2 - x1);
+        if (y2 - y1 > xt2) xt2 = y2 - y1;
+        if (xt2 > 1000 * xt1) {
+            memset (in_grid, 0, ncol * nrow * sizeof(CSW_F));
+            if (in_mask) {
+                memset (in_mask, 0, ncol * nrow * sizeof(char));
+            }
+            if (err) {
+                memset (err, 0, npts * sizeof(CSW_F));
+            }
+            return 1;
+        }
+    }
+
+/*
+    Change any garbage option values to their defaults.
+*/
+    if (PreferredStrike < 0.0f) PreferredStrike += 360.0f;
+    if (PreferredStrike < 0  ||  PreferredStrike > 360) PreferredStrike = -1000.0f;
+    if (OutsideBoundaryMargin < 1) OutsideBoundaryMargin = 1;
+
+  /*
+   * Previously, if the inside boundary margin was less than 2, the default value
+   * of 10 was used.  Now, any InsideBoundaryMargin value 1 or greater is accepted.
+   * Values less than 2 will make ugly maps, but that is the application code's
+   * responsibility to avoid if it chooses to do so.
+   */
+    if (InsideBoundaryMargin < 1) InsideBoundaryMargin = 1;
+
+    if (ReportLines < 1) ReportLines = 20;
+    if (AnisotropyFlag < 1  ||  AnisotropyFlag > 2) AnisotropyFlag = 0;
+    if (DistancePower < 2) DistancePower = 2;
+    if (DistancePower > 6) DistancePower = 6;
+    if (DistancePower == 3) DistancePower = 2;
+    if (DistancePower == 5) DistancePower = 4;
+    if (StrikePower < 2) StrikePower = 2;
+    if (StrikePower > 6) StrikePower = 6;
+    if (StrikePower == 3) StrikePower = 4;
+    if (StrikePower == 5) StrikePower = 6;
+    if (NumLocalPoints < 1  ||  NumLocalPoints > MAX_LOCAL) NumLocalPoints = MAX_LOCAL;
+    if (LocalSearchPattern < 1  ||  LocalSearchPattern > 3) LocalSearchPattern = 1;
+    if (WorkMargin < 0) WorkMargin = -1;
+    if (GridMinValue >= GridMaxValue) {
+        GridMinValue = -1.e30f;
+        GridMaxValue = 1.e30f;
+    }
+    if (GridMinValue > 1.e20f) {
+        GridMinValue = -1.e30f;
+    }
+    if (GridMaxValue < -1.e20f) {
+        GridMaxValue = 1.e30f;
+    }
+
+    if (GridMinValue < HardMinValue) GridMinValue = HardMinValue;
+    if (GridMaxValue > HardMaxValue) GridMaxValue = HardMaxValue;
+
+    orig_min_val = GridMinValue;
+    orig_max_val = GridMaxValue;
+
+    if (ThicknessFlag == GRD_POSITIVE_THICKNESS) {
+        GridMinValue = -1.e30f;
+    }
+    if (ThicknessFlag == GRD_NEGATIVE_THICKNESS) {
+        GridMaxValue = 1.e30f;
+    }
+
+/*
+    Turn off preferred strike and anisotropy for fast grid flag.
+*/
+    if (FastGridFlag) {
+        AnisotropyFlag = 0;
+        PreferredStrike = -1000.0f;
+    }
+
+/*
+    Reset some options if the step grid flag is set.
+*/
+    if (StepGridFlag) {
+        AnisotropyFlag = 0;
+        PreferredStrike = -1000.0f;
+        MaxSearchDistance = 1.e30f;
+        InsideBoundaryMargin = 100000;
+        LocalSearchPattern = GRD_RADIAL_SEARCH;
+        NumLocalPoints = 100;
+        ThicknessFlag = 0;
+    }
+
+/*
+    Turn off anisotropy if the grid is flat.
+*/
+    if (FlatGridFlag == 1) {
+        AnisotropyFlag = 0;
+        PreferredStrike = -1000.0f;
+    }
+
+/*
+    If a preferred strike has been explicitly specified,
+    set the anisotropy flag to zero.
+*/
+    if (PreferredStrike >= 0.0f) {
+        AnisotropyFlag = 0;
+    }
+
+/*
+    If there are 2 points, turn off anisotropy if it is on.
+    Also, generate a third point in a position where a plane
+    can be calculated between the 2 points.  The plane will
+    represent the gradient along a line between the 2 points.
+*/
+    GPFCalcdraw     gpf_calcdraw_obj;
+    OrigNdata = npts;
+    if (npts == 2) {
+        AnisotropyFlag = 0;
+        PreferredStrike = -1000.0f;
+        gpf_calcdraw_obj.gpf_shortperpbisector
+            (x[0], y[0], x[1], y[1], &xt1, &yt1, &xt2, &yt2);
+        memcpy (Xsmall, x, 2 * sizeof(CSW_F));
+        memcpy (Ysmall, y, 2 * sizeof(CSW_F));
+        memcpy (Zsmall, z, 2 * sizeof(CSW_F));
+        Xsmall[2] = xt2;
+        Ysmall[2] = yt2;
+        Zsmall[2] = (Zsmall[0] + Zsmall[1]) / 2.0f;
+        npts = 3;
+        x = Xsmall;
+        y = Ysmall;
+        z = Zsmall;
+    }
+
+/*
+    Save some of the parameters in private class variables.
+*/
+    OrigXmin = Xmin = x1;
+    OrigYmin = Ymin = y1;
+    OrigXmax = Xmax = x2;
+    OrigYmax = Ymax = y2;
+    ReportNcol = ncol;
+    ReportNrow = nrow;
+
+/*
+    Find the "optimum" number of rows and columns given
+    the data distribution.  If the requested number is
+    far different, use the optimal and then, at the end
+    of the grid calculation, resample to the requested
+    geometry.
+*/
+    x1r = x1;
+    y1r = y1;
+    x2r = x2;
+    y2r = y2;
+
+    pre_fault_nrow = nrow;
+    pre_fault_ncol = ncol;
+    fault_resampleflag = 0;
+    if (FaultedFlag) {
+        while (ncol < 4  ||  nrow < 4) {
+            ncol *= 2;
+            nrow *= 2;
+            fault_resampleflag = 1;
+        }
+    }
+    orig_nrow = nrow;
+    orig_ncol = ncol;
+
+    if (fault_resampleflag == 1) {
+        local_grid = (CSW_F *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
+        if (local_grid == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        if (mask) {
+            local_mask = (char *)csw_Malloc (ncol * nrow * sizeof(CSW_F));
+            if (local_mask == NULL) {
+                grd_utils_ptr->grd_set_err (1);
+                return -1;
+            }
+        }
+        grid = local_grid;
+        mask = local_mask;
     }
 
     ncolr = ncol;
     nrowr = nrow;
 
-    resampleflag = 0;
-    newgrid = NULL;
-    newmask = NULL;
-    idenom = ncol * nrow / 100000;
-    if (idenom < 4)
-        idenom = 4;
-    if (idenom > 7)
-        idenom = 7;
+    resampleflag = 0;
+    newgrid = NULL;
+    newmask = NULL;
+    idenom = ncol * nrow / 100000;
+    if (idenom < 4)
+        idenom = 4;
+    if (idenom > 7)
+        idenom = 7;
+
+    recalc_grid_flag = 0;
+    if (DefaultSizeMultiplier < 1) DefaultSizeMultiplier = 1;
+    if (StepGridFlag == 0  &&  FlatGridFlag == 0) {
+        istat = CheckForNodePoints (x, y, npts,
+                                    (double)x1r, (double)y1r,
+                                    (double)x2r, (double)y2r,
+                                    ncolr, nrowr);
+        if (istat == 0) {
+            grd_utils_ptr->grd_recommended_size (x, y, npts, 0,
+                                  &x1r, &y1r, &x2r, &y2r,
+                                  &ncolr, &nrowr);
+            ncolr *= DefaultSizeMultiplier;
+            nrowr *= DefaultSizeMultiplier;
+        }
+        else {
+            recalc_grid_flag = 1;
+        }
+        if (FaultedFlag) {
+            while (ncolr < 4  ||  nrowr < 4) {
+                ncolr *= 2;
+                nrowr *= 2;
+            }
+        }
+        if (ConformalFlag == 1) {
+            while (ncolr < ConformalGrid.ncol / 2  &&
+                   nrowr < ConformalGrid.nrow / 2) {
+                ncolr *= 3;
+                nrowr *= 3;
+                ncolr /= 2;
+                nrowr /= 2;
+            }
+        }
+        if (DistancePower == 6) {
+            ncolr *= 3;
+            nrowr *= 3;
+            ncolr /= 2;
+            nrowr /= 2;
+        }
+        xt1 = (x2 - x1) / (CSW_F)(ncol - 1);
+        yt1 = (y2 - y1) / (CSW_F)(nrow - 1);
+        if (yt1 != 0.0f) {
+            xyratio = xt1 / yt1;
+        }
+        else if (xt1 != 0.0f) {
+            xyratio = yt1 / xt1;
+        }
+        else {
+            xyratio = 1.0f;
+        }
+
+        if (ncolr < ncol * 3 / idenom  ||  nrowr < nrow * 3 / idenom  ||
+            xyratio < 0.99f  ||  xyratio > 1.01f) {
+            ncol = ncolr * idenom / 3;
+            nrow = nrowr * idenom / 3;
+            if (xyratio >= 0.99f  &&  xyratio <= 1.01f) {
+                if (ncol > orig_ncol)
+                    ncol = orig_ncol;
+                if (nrow > orig_nrow)
+                    nrow = orig_nrow;
+            }
+            else {
+                xt1 = (xt1 + yt1) / 2.0f;
+                i = (int)((y2 - y1) / xt1);
+                if (i < 2) i = 2;
+                j = (int)((x2 - x1) / xt1);
+                if (j < 2) j = 2;
+                if (i*j > orig_ncol*orig_nrow) {
+                    ftmp = (CSW_F)(orig_ncol*orig_nrow) / (CSW_F)(i*j);
+                    i = (int)((CSW_F)i * ftmp);
+                    j = (int)((CSW_F)j * ftmp);
+                    if (i < 2) i = 2;
+                    if (j < 2) j = 2;
+                }
+                if (ncol*nrow > orig_ncol*orig_nrow) {
+                    ncol = j;
+                    nrow = i;
+                }
+            }
+MSL
+            newgrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
+            if (!newgrid) {
+                grd_utils_ptr->grd_set_err (1);
+                return -1;
+            }
+            if (mask) {
+MSL
+                newmask = (char *)csw_Malloc (orig_ncol * orig_nrow * sizeof(char));
+                if (!newmask) {
+                    grd_utils_ptr->grd_set_err (1);
+                    return -1;
+                }
+            }
+            resampleflag = 1;
+        }
+    }
+
+    OrigNcol = ncol;
+    OrigNrow = nrow;
+    Ncol = ncol;
+    Nrow = nrow;
+    Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
+    Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
+
+  /*
+   * If x spacing or y spacing is
+   * ridiculously large, return an error 3, for a wild parameter.
+   * The cutoffs are based on .01 * spacing squared being a
+   * reasonable float number.
+   */
+    if (Xspace > 1.e8  ||  Yspace > 1.e8)  {
+        grd_utils_ptr->grd_set_err (3);
+        return -1;
+    }
+    OrigXdata = x;
+    OrigYdata = y;
+    OrigZdata = z;
+    OrigNdata = npts;
+    Xdata = x;
+    Ydata = y;
+
+/*
+ * Bug 8290,  A copy of the Z array is made, so the clipping to
+ *            hard min and max will not affect the original data.
+ *            The points of a stream are owned by this object and
+ *            are freed after the calculation, so they are used
+ *            without a copy.
+ */
+    if (InputOwnedFlag == 1) {
+        Zdata = z;
+        FreeZdataFlag = 0;
+    }
+    else {
+        Zdata = (CSW_F *)csw_Malloc (npts * sizeof(CSW_F));
+        FreeZdataFlag = 1;
+        if (Zdata == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        memcpy (Zdata, z, npts * sizeof(CSW_F));
+    }
+
+    Ndata = npts;
+    MaxData = Ndata;
+    Extension = 4;
+
+    Zmin = 1.e30f;
+    Zmax = -1.e30f;
+    for (i=0; i<Ndata; i++) {
+/*
+ * Bug 8290, if the z data is outside of the hard data limits,
+ *           clip it to the hard data limits.
+ */
+        if (Zdata[i] > HardMaxValue) Zdata[i] = HardMaxValue;
+        if (Zdata[i] < HardMinValue) Zdata[i] = HardMinValue;
+
+        if (Zdata[i] < Zmin) Zmin = Zdata[i];
+        if (Zdata[i] > Zmax) Zmax = Zdata[i];
+    }
+    Zrange = Zmax - Zmin;
+    TinySum = Zrange / 100000.0f;
+    if (TinySum > 1.e-10) TinySum = 1.e-10f;
+
+    MaxNodeDistance = 100000;
+    if (MaxSearchDistance / (Xspace + Yspace) < 50000) {
+        MaxNodeDistance = (int) (MaxSearchDistance / (Xspace + Yspace));
+        MaxNodeDistance *= 2;
+        MaxNodeDistance++;
+    }
+    if (MaxNodeDistance < 1) {
+        MaxNodeDistance = 1;
+    }
+
+/*
+    set the skip factor for the coarse grid
+*/
+    Ncoarse = 1;
+    if (Ncol + Nrow > 12)  Ncoarse = 2;
+    if (Ncol + Nrow > 70)  Ncoarse = 4;
+    if (Ncol + Nrow > 192)  Ncoarse = 8;
+    if (Ncol + Nrow > 384)  Ncoarse = 16;
+    if (Ncol + Nrow > 1536)  Ncoarse = 32;
+    if (Ncol + Nrow > 3072)  Ncoarse = 64;
+    if (Ncol + Nrow > 6144)  Ncoarse = 128;
+    if (Ncol + Nrow > 12288)  Ncoarse = 256;
+
+    if (TriangulateFlag != 4  &&  Ndata > Ncol*Nrow/2) {
+         Ncoarse /= 2;
+    }
+
+    if (Ncoarse < 1) Ncoarse = 1;
+
+    if (Ndata == 3) Ncoarse = 1;
+
+/*
+    Set the smoothing factor based on the number of points
+    in the input data set.
+*/
+    SmoothingFactor = 3.0f;
+    if (npts > 2000) SmoothingFactor = 6.0f;
+    if (npts > 5000) SmoothingFactor = 10.0f;
+    if (npts > 10000) SmoothingFactor = 12.0f;
+    if (FastGridFlag) {
+        SmoothingFactor -= 2.0f;
+        if (SmoothingFactor < 2) SmoothingFactor = 2.0f;
+    }
+
+/*
+    If the margin size is much greater than the data limits
+    use the data limits.  If less than zero, use 2 coarse
+    grid cells.
+*/
+    grd_utils_ptr->grd_limits_xy (x, y, npts,
+                   &datax1, &datay1, &datax2, &datay2);
+    if (datax1 > x1) datax1 = x1;
+    if (datay1 > y1) datay1 = y1;
+    if (datax2 < x2) datax2 = x2;
+    if (datay2 < y2) datay2 = y2;
+    DXmin = datax1;
+    DYmin = datay1;
+    DXmax = datax2;
+    DYmax = datay2;
+    margin1 = x1 - datax1 + y1 - datay1 + datax2 - x2 + datay2 - y2;
+    margin1 /= 2;
+    margin1 /= (Xspace + Yspace);
+    margin1 += 0.5f;
+    if (WorkMargin > 2 * (int)margin1) {
+        WorkMargin = (int)margin1;
+    }
+    if (WorkMargin < 0) {
+        WorkMargin = 4 * Ncoarse;
+        xmarg = WorkMargin * Xspace;
+        ymarg = WorkMargin * Yspace;
+        while (DXmin < x1 - xmarg  ||  DYmin < y1 - ymarg  ||
+               DXmax > x2 + xmarg  ||  DYmax > y2 + ymarg) {
+            WorkMargin *= 2;
+            if (WorkMargin >= 8 * Ncoarse) {
+                break;
+            }
+            xmarg = WorkMargin * Xspace;
+            ymarg = WorkMargin * Yspace;
+        }
+    }
+    if (WorkMargin < Ncoarse) {
+        WorkMargin = Ncoarse;
+    }
+
+/*
+    Expand the grid limits used internally so that an integral number of coarse
+    grid cells are present in the calculated grid.  The internal grid is
+    copied to the output grid at the end, with appropriate offsets being
+    used in the copy operation.
+*/
+WorkMargin = 4 * Ncoarse;
+if (WorkMargin < 16) WorkMargin = 16;
+    ismooth = (int) (SmoothingFactor + .5f);
+    grd_utils_ptr->grd_expand_limits (x1, y1, x2, y2, ncol, nrow, Ncoarse, WorkMargin,
+                       &Xmin, &Ymin, &Xmax, &Ymax,
+                       &Ncol, &Nrow, &ColZero, &RowZero);
+
+    Nccol = Ncol / Ncoarse + 1;
+    Ncrow = Nrow / Ncoarse + 1;
+    if (Ncoarse == 1) {
+        Nccol = Ncol;
+        Ncrow = Nrow;
+    }
+
+/*
+    Make sure the coarse grid is no larger than 128 rows
+    or columns.
+*/
+    while (Nccol > 128  ||  Ncrow > 128) {
+        Ncoarse *= 2;
+        grd_utils_ptr->grd_expand_limits (x1, y1, x2, y2, ncol, nrow, Ncoarse, WorkMargin,
+                           &Xmin, &Ymin, &Xmax, &Ymax,
+                           &Ncol, &Nrow, &ColZero, &RowZero);
+        Nccol = Ncol / Ncoarse + 1;
+        Ncrow = Nrow / Ncoarse + 1;
+    }
+    NcoarseOrig = Ncoarse;
+
+/*
+    Count the number of points in the area of interest and
+    return error 7 if there is less than 1.
+*/
+    n = 0;
+    for (i=0; i<npts; i++) {
+        if (x[i] < OrigXmin  ||  x[i] > OrigXmax  ||
+            y[i] < OrigYmin  ||  y[i] > OrigYmax) {
+            continue;
+        }
+        n = 1;
+        break;
+    }
+
+    if (n < 1) {
+        grd_utils_ptr->grd_set_err (7);
+        TinySum = 0.0;
+        return -1;
+    }
+
+/*
+    If there are an absurdly large number of grid nodes relative
+    to the number of data points, set a private class variable that will
+    greatly increase the search distances used in the coarse grid
+    node calculation.
+*/
+    Ndivide = 1;
+    if (n < ncol * nrow / 10000) {
+        Ndivide = 4;
+    }
+    else if (n < ncol * nrow / 1000) {
+        Ndivide = 2;
+    }
+
+    if (StepGridFlag == 1) {
+        Ndivide = 1;
+    }
+
+/*
+    If the program is in parameter error simulation mode,
+    return success (which is not expected) here.
+*/
+    if (grd_utils_ptr->grd_simulation()) {
+        TinySum = 0.0;
+        return 1;
+    }
+
+/*
+    If the thickness flag is set, check for zero or negative data values.
+    If none are found, do not use thickness gridding.
+*/
+    OriginalThicknessFlag = ThicknessFlag;
+    if (ThicknessFlag == 1) {
+        CheckForZeroThickness ();
+    }
+
+/*
+    Create index grids for looking up fault vectors.
+*/
+    faults = NULL;
+    nfaults = 0;
+    if (FaultedFlag) {
+        grd_fault_ptr->grd_set_fault_zlimits (Zmin, Zmax);
+        grd_fault_ptr->grd_extend_faults_to_margins (OrigXmin, OrigYmin,
+                                      OrigXmax, OrigYmax,
+                                      Xmin, Ymin,
+                                      Xmax, Ymax);
+        grd_fault_ptr->grd_set_fault_index_extent (Ncoarse);
+        istat = grd_fault_ptr->grd_build_fault_indices (NULL, Ncol, Nrow, Xmin, Ymin, Xmax, Ymax);
+        grd_fault_ptr->grd_set_fault_index_extent (1);
+        if (istat == -1) {
+            grd_utils_ptr->grd_set_err (1);
+            TinySum = 0.0;
+            return -1;
+        }
+        istat = grd_fault_ptr->grd_get_current_fault_structs (&faults, &nfaults);
+        if (istat == -1) {
+            grd_utils_ptr->grd_set_err (1);
+            TinySum = 0.0;
+            return -1;
+        }
+        do_write = csw_GetDoWrite ();
+        if (do_write) {
+            grd_WriteFaultLines (
+                faults, nfaults, (char *)"currentfaults.xyz");
+        }
+
+        istat = grd_fault_ptr->grd_set_fault_data_grazing (Xdata, Ydata, Ndata);
+        if (istat == -1) {
+            grd_utils_ptr->grd_set_err (11);
+            TinySum = 0.0;
+            return -1;
+        }
+        grd_fault_ptr->grd_get_closest_fault_ptr (&ClosestFault);
+
+        OrigIdata = (int *)csw_Malloc (OrigNdata * sizeof(int));
+        if (!OrigIdata) {
+            TinySum = 0.0;
+            return -1;
+        }
+
+        if (FreeZdataFlag == 1) {
+            csw_Free (Zdata);
+            Zdata = NULL;
+            FreeZdataFlag = 0;
+        }
+        Xdata = (CSW_F *)csw_Malloc (OrigNdata * 3 * sizeof(CSW_F));
+        if (!Xdata) {
+            Xdata = OrigXdata;
+        }
+        else {
+            Ydata = Xdata + OrigNdata;
+            Zdata = Ydata + OrigNdata;
+            Ndata = 0;
+            for (i=0; i<OrigNdata; i++) {
+                if (OrigXdata[i] < 1.e30) {
+                    Xdata[Ndata] = OrigXdata[i];
+                    Ydata[Ndata] = OrigYdata[i];
+                    Zdata[Ndata] = OrigZdata[i];
+                    OrigIdata[Ndata] = i;
+                    Ndata++;
+                }
+            }
+        }
+    /*
+     * Only do anisotropy on faulted grids if there are a lot of data points
+     * relative to the number of fault vectors.
+     */
+        if (nfaults > 0) {
+            if ((double)OrigNdata / (double)nfaults < 5.0  ||  npts < 10) {
+                AnisotropyFlag = 0;
+                AnisotropyRatio = 1.0f;
+                PreferredStrike = -1000.0f;
+            }
+        }
+    }
+
+/*
+ * Make a copy of the data if this is a vertical fault surface.
+ */
+    if (VerticalFaultFlag == 1) {
+
+        OrigIdata = (int *)csw_Malloc (OrigNdata * sizeof(int));
+        if (!OrigIdata) {
+            TinySum = 0.0;
+            return -1;
+        }
+
+        MaxData = OrigNdata * 16;
+        if (FreeZdataFlag) {
+            csw_Free (Zdata);
+            Zdata = NULL;
+            FreeZdataFlag = 0;
+        }
+        Xdata = (CSW_F *)csw_Malloc (MaxData * 3 * sizeof(CSW_F));
+        if (!Xdata) {
+            grd_utils_ptr->grd_set_err (1);
+            TinySum = 0.0;
+            return -1;
+        }
+        else {
+            Ydata = Xdata + MaxData;
+            Zdata = Ydata + MaxData;
+            Ndata = 0;
+            for (i=0; i<OrigNdata; i++) {
+                if (OrigXdata[i] < 1.e30) {
+                    Xdata[Ndata] = OrigXdata[i];
+                    Ydata[Ndata] = OrigYdata[i];
+                    Zdata[Ndata] = OrigZdata[i];
+                    OrigIdata[Ndata] = i;
+                    Ndata++;
+                }
+            }
+        }
+    }
+
+/*
+    If global anisotropy calculations are wanted and also there
+    is no preferred strike specified, calculate a preferred strike
+    and strike power using the global anisotropy algorithm.
+*/
+    AnisotropyRatio = 1.0f;
+    if (PreferredStrike < 0.0f  &&  AnisotropyFlag == GRD_GLOBAL_ANISOTROPY) {
+        tiny = (x2 - x1 + y2 - y1) / 100.0f;
+        istat = grd_utils_ptr->grd_colinear_check (Xdata, Ydata, Ndata, tiny, NULL);
+        if (istat == 0) {
+            for (;;) {
+                istat = grd_stats_ptr->grd_global_anisotropy
+                        (Xdata, Ydata, Zdata, npts, nbins,
+                         &PreferredStrike, &StrikePower, &AnisotropyRatio, ThicknessFlag);
+                if (PreferredStrike < 0  &&  PreferredStrike >= -200) {
+                    PreferredStrike += 360.0f;
+                }
+                if (istat == -2) {
+                    if (nbins <= 10) break;
+                    nbins -= 5;
+                    continue;
+                }
+                else {
+                    break;
+                }
+            }
+        }
+        else {
+            AnisotropyFlag = 0;
+            PreferredStrike = -1000.0f;
+        }
+        if (PreferredStrike < 0.0f) {
+            AnisotropyFlag = 0;
+        }
+        if (PreferredStrike >= 0.0  &&  StrikePower > 3) {
+            AnisotropyFlag = 0;
+        }
+    }
+    if (AnisotropyRatio < 1.0f) AnisotropyRatio = 1.0f;
+
+/*
+ *  Use triangulation to add some points to empty regions
+ *  of the area of interest.  These points are used to
+ *  build the EmptyAreaGrid.  If this grid is not NULL,
+ *  it is used in extending the coarse grid nodes into
+ *  empty areas.  A gridding session may already have the
+ *  EmptyAreaGrid for the same data and options.
+ */
+    do_write = csw_GetDoWrite ();
+    if (do_write == 1) {
+        grd_fileio_ptr->grd_write_float_points (
+            Xdata, Ydata, Zdata, Ndata,
+            (char *)"pre_empty.xyz");
+    }
+
+    num_pre_pass1 = Ndata;
+    esave = AnisotropyFlag;
+    empty_hit = LoadSessionEmptyArea ();
+    if (empty_hit == 0) {
+        AddPointsToEmptyRegions ();
+    }
+
+    if (do_write == 1) {
+        grd_fileio_ptr->grd_write_float_points (
+            Xdata, Ydata, Zdata, Ndata,
+            (char *)"post_empty.xyz");
+    }
+
+/*
+    If a gridding session has tables built from the same data
+    and geometry, use them.
+*/
+    tstart = WallTime ();
+    istat = LoadSessionTables ();
+    if (istat == -1) {
+        TinySum = 0.0;
+        return -1;
+    }
+
+    if (istat == 0) {
+
+    /*
+        The session tables need the z values from before the
+        data table is built.
+    */
+        nsave = NoisyDataFlag;
+        if (SessionTablesUsable ()) {
+            zsave = (CSW_F *)csw_Malloc (Ndata * sizeof(CSW_F));
+            if (zsave != NULL) {
+                memcpy (zsave, Zdata, Ndata * sizeof(CSW_F));
+            }
+        }
+
+    /*
+        Allocate the workspace and set up the data tables used for
+        rapid lookup of local points at grid nodes.  An error returned
+        by this function indicates a memory allocation error.
+    */
+        istat = SetupDataTable (0, 1);
+        if (istat == -1) {
+            TinySum = 0.0;
+            return -1;
+        }
+
+    /*
+        Create a table that has the distance to the closest
+        data point at each grid node.  This distance is expressed
+        in number of grid cells.  It is used to speed up searches
+        only.  The function always returns 1, so I don't check
+        the return status.
+    */
+        SetupDistanceTable ();
+
+        if (zsave != NULL) {
+            SaveSessionTables (zsave, nsave);
+            csw_Free (zsave);
+            zsave = NULL;
+        }
+    }
+
+    if (empty_hit == 0) {
+        SaveSessionEmptyArea (esave);
+    }
+
+    StartSharedSearch ();
+
+/*
+    If the local anisotropy flag is turned on,
+    calculate the local anisotropy grids.
+*/
+    if (PreferredStrike < 0.0f  &&  AnisotropyFlag == GRD_LOCAL_ANISOTROPY) {
+        CalcLocalAnisotropy ();
+    }
+
+/*
+    Calculate a second order trend surface and a plane.
+    Use the plane unless the second order fit is far better
+    than the plane fit.
+*/
+    if (FlatGridFlag == 0) {
+        if (LoadSessionTrend () == 0) {
+            asave = AnisotropyFlag;
+            ssave = SmoothingFactor;
+            psave = PreferredStrike;
+            istat = FitBestTrendSurface ();
+            if (istat == -1) {
+                if (grd_utils_ptr->grd_get_err() == 3) grd_utils_ptr->grd_set_err (8);
+                TinySum = 0.0;
+                return -1;
+            }
+            SaveSessionTrend (asave, ssave, psave);
+        }
+    }
+
+/*
+    A flat grid also has a flat trend surface grid.
+*/
+    else {
+        for (i=0; i<Nccol*Ncrow; i++) {
+            TrendGrid[i] = Zdata[0];
+        }
+    }
+
+    PhaseTimes.tables = WallTime () - tstart;
+
+/*
+    If there is a conformal shaping surface, resample it to the
+    same geometry as the work grid being calculated.
+*/
+    BuildShapeGrid ();
+
+/*
+    Change the TrendDistance based on how well the trend surface fits.
+    For a better fit, the trend surface is used closer to data.
+*/
+    TrendDistance = (int) ((Xrange + Yrange) / ((Xspace + Yspace) * 5.0f));
+    if (FaultedFlag) TrendDistance *= 4;
+    TrendPointErrors ();
+
+/*
+    Calculate coarse grid nodes based on local data where the node
+    has a sufficient local data population.
+*/
+    tstart = WallTime ();
+    if (FlatGridFlag == 0) {
+        CoincidentDistance = (Xspace + Yspace) / 20.0f;
+        CalcLocalNodes ();
+    }
+    CoincidentDistance = 0.0;
+
+/*
+ * If additional points were created to highlight a preferred
+ * strike direction, redo the data table and distance table
+ * without these points.
+ */
+   if (num_pre_pass1 != Ndata) {
+        Ndata = num_pre_pass1;
+        istat = SetupDataTable (0, 0);
+        if (istat == -1) {
+            TinySum = 0.0;
+            return -1;
+        }
+
+        SetupDistanceTable ();
+        StartSharedSearch ();
+    }
+
+    do_write = csw_GetDoWrite ();
+    if (do_write == 1) {
+        grd_triangle_ptr->grd_WriteXYZGridFile (
+            (char *)"localnodes.xyz",
+            Grid, Ncol, Nrow, Ncoarse,
+            Xmin, Ymin, Xmax, Ymax);
+    }
+
+/*
+ * Calculate a measure of grid sparseness, ie nodes per
+ * data point.  For sparser grids, more smoothing is done.
+ */
+    node_ratio = (double)(Ncol * Nrow) / (double)Ndata;
+    smooth_mult = node_ratio / 36.0;
+
+/*
+    Use the trend surface for coarse nodes
+    very far from data points.
+*/
+    if (FlatGridFlag == 0  &&  NoisyDataFlag == 0) {
+        AssignTrendNodes ();
+    }
+
+/*
+    Assign elevations to all perimeter nodes that
+    have not already been calculated.  This is
+    accomplished by linear interpolation between
+    calculated nodes on the perimeter.  This is done
+    at the coarse grid interval.
+*/
+    if (FlatGridFlag == 0) FillInPerimeter ();
+
+/*
+    fill in the rest of the coarse grid nodes.
+*/
+    if (FlatGridFlag == 0) FillInCoarse ();
+
+    if (StepGridFlag == 0  &&  Ndata > 3) {
+
+    /*
+        Smooth the coarse grid lightly.
+    */
+        savsmooth = SmoothingFactor;
+        SmoothingFactor = 1.0f;
+        SmoothingFactor *= (CSW_F)smooth_mult;
+        if (SmoothingFactor > 3) SmoothingFactor = 3;
+        if (PreferredStrike >= 0  ||  AnisotropyFlag) {
+            StrikeSmoothGrid ();
+        }
+        else {
+            SimpleSmoothGrid ();
+        }
+
+    /*
+        Perform more smoothing passes which do not effect
+        nodes very close to data.
+    */
+        ismooth = (int)(SmoothingFactor + 1.5f);
+        SmoothingFactor = 1.0f / DistancePower;
+        SmoothingFactor *= (CSW_F)smooth_mult;
+        if (SmoothingFactor > 5) SmoothingFactor = 5;
+        if (DistancePower == 6  &&  Ncoarse == 1) {
+            ismooth = 0;
+        }
+        ismooth = ismooth * (TriangulateFlag + 1);
+        for (i=0; i<ismooth/2; i++) {
+            if (PreferredStrike >= 0  ||  AnisotropyFlag) {
+                StrikeSmoothGrid ();
+            }
+            else {
+                SimpleSmoothGrid ();
+            }
+        }
+        SmoothingFactor = savsmooth;
+    }
+
+    if (do_write == 1) {
+        grd_triangle_ptr->grd_WriteXYZGridFile (
+            (char *)"smoothnodes.xyz",
+            Grid, Ncol, Nrow, Ncoarse,
+            Xmin, Ymin, Xmax, Ymax);
+    }
+    PhaseTimes.coarse = WallTime () - tstart;
+
+/*
+    The initial coarse grid is now complete.  The
+    final grid is calculated by iteratively correcting
+    for errors and subdividing the coarse grid until
+    the final grid is obtained.
+*/
+    if (FlatGridFlag == 0  &&  Ndata > 3) {
+        if (StepGridFlag == 0) {
+            IterateToFinalGrid ();
+        }
+        else {
+            FillInStepGrid ();
+            SmoothStepGrid ();
+        }
+    }
+
+/*
+    If the distance power is 6, do a special median filter to
+    sharpen up the features.
+*/
+    if (DistancePower == 6) {
+        istat = MedianFilter ();
+        if (istat == -1) {
+            TinySum = 0.0;
+            return -1;
+        }
+        MedianFlag = 1;
+        DistancePower = 2;
+        AdjustForErrors ();
+        MedianFlag = 0;
+        DistancePower = 6;
+    }
+
+/*
+    Final smoothing pass.
+*/
+    dpsav = DistancePower;
+    if (StepGridFlag == 0  &&  FlatGridFlag == 0  &&  Ndata > 3) {
+        savsmooth = SmoothingFactor;
+        SmoothingFactor = -1.0f;
+        ismooth = (int)(SmoothingFactor + 3.5f);
+        ismooth /= 3;
+        if (DistancePower > 3) ismooth--;
+        if (DistancePower > 5) ismooth--;
+        if (ismooth < 1) ismooth = 1;
+        if (ConformalFlag == 1  &&  UseShapeGrid == 1) {
+            ismooth++;
+        }
+        if (DistancePower == 6  &&  Ncoarse == 1) {
+            ismooth = 1;
+            DistancePower = 2;
+        }
+        if (recalc_grid_flag == 1) {
+            ismooth = 1;
+        }
+        ismooth = ismooth * (TriangulateFlag + 1);
+        for (i=0; i<ismooth; i++) {
+            if (PreferredStrike >= 0.0f  &&  AnisotropyFlag == 0  &&  StrikePower > 2) {
+                if (StrikePower > 4) {
+                    StrikeSmoothGrid ();
+                }
+                else {
+                    if (i == 0) {
+                        StrikeSmoothGrid ();
+                    }
+                    else {
+                        SimpleSmoothGrid ();
+                    }
+                }
+            }
+            else {
+                SimpleSmoothGrid ();
+            }
+        }
+        SmoothingFactor = savsmooth;
+    }
+    DistancePower = dpsav;
 
-    recalc_grid_flag = 0;
-    if (DefaultSizeMultiplier < 1) DefaultSizeMultiplier = 1;
+/*
+    Clip to min max if needed.
+*/
     if (StepGridFlag == 0  &&  FlatGridFlag == 0) {
-        istat = CheckForNodePoints (x, y, npts,
-                                    (double)x1r, (double)y1r,
-                                    (double)x2r, (double)y2r,
-                                    ncolr, nrowr);
-        if (istat == 0) {
-            grd_utils_ptr->grd_recommended_size (x, y, npts, 0,
-                                  &x1r, &y1r, &x2r, &y2r,
-                                  &ncolr, &nrowr);
-            ncolr *= DefaultSizeMultiplier;
-            nrowr *= DefaultSizeMultiplier;
+        ClipToMinMax ();
+    }
+
+/*
+    If the mask array is not NULL, calculate the grid mask.
+*/
+    if (mask) {
+        MaskBadNodes ();
+    }
+
+/*
+    Special case for a flat grid (all same value).
+*/
+    if (FlatGridFlag == 1) {
+        grd_utils_ptr->grd_constant_grid (Grid, NULL, Ncol, Nrow, z[0]);
+        if (err) {
+            memset (err, 0, npts*sizeof(CSW_F));
+        }
+        memset (Zerr, 0, npts * sizeof(CSW_F));
+        memset (ZerrBC, 0, npts * sizeof(CSW_F));
+    }
+
+
+/*
+ * special debug stuff.
+ */
+    do_write = csw_GetDoWrite ();
+    if (do_write) {
+        grd_triangle_ptr->grd_WriteXYZGridFile ((char *)"pre_resamp.grd",
+                     Grid, Ncol, Nrow, 1,
+                     Xmin, Ymin, Xmax, Ymax);
+    }
+
+/*
+    Copy the grid and mask into the output space.
+*/
+    j = 0;
+    for (i=RowZero; i<RowZero+OrigNrow; i++) {
+        k = i * Ncol + ColZero;
+        k2 = j * OrigNcol;
+        j++;
+        memcpy (grid+k2, Grid+k, OrigNcol*sizeof(CSW_F));
+        if (mask) {
+            memcpy (mask+k2, NodeMask+k, OrigNcol*sizeof(char));
+        }
+    }
+
+/*
+    Resample back to the requested geometry if needed.
+*/
+    if (resampleflag == 1) {
+        if (DistancePower != 6) {
+            grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
+                               x1, y1, x2, y2,
+                               faults, nfaults,
+                               newgrid, newmask, orig_ncol, orig_nrow,
+                               x1, y1, x2, y2, GRD_BICUBIC);
         }
         else {
-            recalc_grid_flag = 1;
+            grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
+                               x1, y1, x2, y2,
+                               faults, nfaults,
+                               newgrid, newmask, orig_ncol, orig_nrow,
+                               x1, y1, x2, y2, GRD_BILINEAR);
+        }
+        ncol = orig_ncol;
+        nrow = orig_nrow;
+        Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
+        Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
+        memcpy (grid, newgrid, ncol*nrow*sizeof(CSW_F)); /*lint !e668*/
+        csw_Free (newgrid);
+        newgrid = NULL;
+        if (mask) {
+            memcpy (mask, newmask, ncol*nrow*sizeof(char)); /*lint !e668*/
+            csw_Free (newmask);
+            newmask = NULL;
+        }
+        if (FlatGridFlag == 1) {
+            grd_utils_ptr->grd_constant_grid (grid, NULL, ncol, nrow, z[0]);
+        }
+    }
+
+/*
+    Resample again if a very small grid was expanded to help the faulted calculations.
+*/
+    if (fault_resampleflag == 1) {
+        grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
+                           x1, y1, x2, y2,
+                           faults, nfaults,
+                           in_grid, in_mask, pre_fault_ncol, pre_fault_nrow,
+                           x1, y1, x2, y2, GRD_BICUBIC);
+        ncol = pre_fault_ncol;
+        nrow = pre_fault_nrow;
+        Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
+        Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
+        if (FlatGridFlag == 1) {
+            grd_utils_ptr->grd_constant_grid (in_grid, NULL, ncol, nrow, z[0]);
+        }
+        grid = in_grid;
+        mask = in_mask;
+        orig_ncol = pre_fault_ncol;
+        orig_nrow = pre_fault_nrow;
+        ncol = orig_ncol;
+        nrow = orig_nrow;
+        csw_Free (local_grid);
+        csw_Free (local_mask);
+        local_grid = NULL;
+        local_mask = NULL;
+    }
+
+    if (faults) {
+        grd_fault_ptr->grd_free_fault_line_structs (faults, nfaults);
+        faults = NULL;
+        nfaults = 0;
+    }
+
+/*
+    If the BaselapFlag is true, clip the grid to the baselap surface.
+*/
+    if (BaselapFlag == 1) {
+        ClippingGrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
+        if (!ClippingGrid) {
+            grd_utils_ptr->grd_set_err (1);
+            TinySum = 0.0;
+            return -1;
+        }
+        grd_arith_ptr->grd_resample_grid (BaselapGrid.grid,
+                           NULL,
+                           BaselapGrid.ncol,
+                           BaselapGrid.nrow,
+                           BaselapGrid.x1,
+                           BaselapGrid.y1,
+                           BaselapGrid.x2,
+                           BaselapGrid.y2,
+                           NULL, 0,
+                           ClippingGrid, NULL, orig_ncol, orig_nrow,
+                           OrigXmin, OrigYmin, OrigXmax, OrigYmax, GRD_BICUBIC);
+        for (k=0; k<orig_ncol*orig_nrow; k++) {
+            if (grid[k] < ClippingGrid[k]) {
+                grid[k] = ClippingGrid[k];
+                if (mask) {
+                    mask[k] = GRD_MASK_INVALID_OUTSIDE;
+                }
+            }
+        }
+        csw_Free (ClippingGrid);
+        ClippingGrid = NULL;
+    }
+
+/*
+    If the TruncationFlag is true, clip the grid to the truncation surface.
+*/
+    if (TruncationFlag == 1) {
+        ClippingGrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
+        if (!ClippingGrid) {
+            grd_utils_ptr->grd_set_err (1);
+            TinySum = 0.0;
+            return -1;
+        }
+        grd_arith_ptr->grd_resample_grid (TruncationGrid.grid,
+                           NULL,
+                           TruncationGrid.ncol,
+                           TruncationGrid.nrow,
+                           TruncationGrid.x1,
+                           TruncationGrid.y1,
+                           TruncationGrid.x2,
+                           TruncationGrid.y2,
+                           NULL, 0,
+                           ClippingGrid, NULL, orig_ncol, orig_nrow,
+                           OrigXmin, OrigYmin, OrigXmax, OrigYmax, GRD_BICUBIC);
+        for (k=0; k<orig_ncol*orig_nrow; k++) {
+            if (grid[k] > ClippingGrid[k]) {
+                grid[k] = ClippingGrid[k];
+                if (mask) {
+                    mask[k] = GRD_MASK_INVALID_OUTSIDE;
+                }
+            }
         }
+        csw_Free (ClippingGrid);
+        ClippingGrid = NULL;
+    }
+
+/*
+ * Clip the output grid to any min and max specified in the options.
+ * The min or max may have been changed for a thickness grid so they
+ * are reset prior to the clipping.
+ */
+    if (GridMinValue < orig_min_val) GridMinValue = orig_min_val;
+    if (GridMaxValue > orig_max_val) GridMaxValue = orig_max_val;
+
+    ClipOutputGridToMinMax (grid, ncol, nrow);
+
+/*
+ * The grid is now finished and stored in the grid array (same as in_grid).
+ * The remainder of this function is used for error estimation at input points
+ * and for report generation.
+ */
+    if (err) {
+
+        fistat = 0;
         if (FaultedFlag) {
-            while (ncolr < 4  ||  nrowr < 4) {
-                ncolr *= 2;
-                nrowr *= 2;
+            fistat = grd_fault_ptr->grd_build_fault_indices (
+                grid, ncol, nrow,
+                OrigXmin, OrigYmin, OrigXmax, OrigYmax);
+        }
+        if (FaultedFlag  &&  fistat == 1) {
+            if (ncol > 3  &&  nrow > 3) {
+                istat = grd_fault_ptr->grd_build_fault_indices (
+                    grid, ncol, nrow,
+                    OrigXmin, OrigYmin, OrigXmax, OrigYmax);
+                grd_fault_ptr->grd_back_interpolate_faulted (grid, ncol, nrow,
+                                              OrigXmin, OrigYmin, OrigXmax, OrigYmax,
+                                              Xdata, Ydata, Zerr, Ndata,
+                                              GRD_BILINEAR);
+            }
+            else {
+                for (i=0; i<Ndata; i++) {
+                    Zerr[i] = 1.e30f;
+                }
+            }
+        }
+        else {
+            grd_arith_ptr->grd_back_interpolate (grid, ncol, nrow,
+                                  OrigXmin, OrigYmin, OrigXmax, OrigYmax,
+                                  NULL, 0,
+                                  Xdata, Ydata, Zerr, Ndata, GRD_BILINEAR);
+        }
+        MaxError = -1.e30f;
+        for (i=0; i<Ndata; i++) {
+            if (Zerr[i] < 1.e20f) {
+                Zerr[i] -= Zdata[i];
+                ftmp = Zerr[i];
+                if (ftmp < 0.0f)
+                    ftmp = - ftmp;
+                if (ftmp > MaxError)
+                    MaxError = ftmp;
             }
-        }
-        if (ConformalFlag == 1) {
-            while (ncolr < ConformalGrid.ncol / 2  &&
-                   nrowr < ConformalGrid.nrow / 2) {
-                ncolr *= 3;
-                nrowr *= 3;
-                ncolr /= 2;
-                nrowr /= 2;
+            else {
+                Zerr[i] = 0.0f;
             }
         }
-        if (DistancePower == 6) {
-            ncolr *= 3;
-            nrowr *= 3;
-            ncolr /= 2;
-            nrowr /= 2;
-        }
-        xt1 = (x2 - x1) / (CSW_F)(ncol - 1);
-        yt1 = (y2 - y1) / (CSW_F)(nrow - 1);
-        if (yt1 != 0.0f) {
-            xyratio = xt1 / yt1;
-        }
-        else if (xt1 != 0.0f) {
-            xyratio = yt1 / xt1;
+        if (FaultedFlag  &&  fistat == 1) {
+            if (ncol > 3  &&  nrow > 3) {
+                grd_fault_ptr->grd_back_interpolate_faulted (grid, ncol, nrow,
+                                              OrigXmin, OrigYmin, OrigXmax, OrigYmax,
+                                              Xdata, Ydata, ZerrBC, Ndata, GRD_BICUBIC);
+            }
+            else {
+                for (i=0; i<Ndata; i++) {
+                    ZerrBC[i] = 1.e30f;
+                }
+            }
         }
         else {
-            xyratio = 1.0f;
+            grd_arith_ptr->grd_back_interpolate (grid, ncol, nrow,
+                                  OrigXmin, OrigYmin, OrigXmax, OrigYmax,
+                                  NULL, 0,
+                                  Xdata, Ydata, ZerrBC, Ndata, GRD_BICUBIC);
         }
-
-        if (ncolr < ncol * 3 / idenom  ||  nrowr < nrow * 3 / idenom  ||
-            xyratio < 0.99f  ||  xyratio > 1.01f) {
-            ncol = ncolr * idenom / 3;
-            nrow = nrowr * idenom / 3;
-            if (xyratio >= 0.99f  &&  xyratio <= 1.01f) {
-                if (ncol > orig_ncol)
-                    ncol = orig_ncol;
-                if (nrow > orig_nrow)
-                    nrow = orig_nrow;
+        for (i=0; i<Ndata; i++) {
+            if (ZerrBC[i] < 1.e20f) {
+                ZerrBC[i] -= Zdata[i];
             }
             else {
-                xt1 = (xt1 + yt1) / 2.0f;
-                i = (int)((y2 - y1) / xt1);
-                if (i < 2) i = 2;
-                j = (int)((x2 - x1) / xt1);
-                if (j < 2) j = 2;
-                if (i*j > orig_ncol*orig_nrow) {
-                    ftmp = (CSW_F)(orig_ncol*orig_nrow) / (CSW_F)(i*j);
-                    i = (int)((CSW_F)i * ftmp);
-                    j = (int)((CSW_F)j * ftmp);
-                    if (i < 2) i = 2;
-                    if (j < 2) j = 2;
-                }
-                if (ncol*nrow > orig_ncol*orig_nrow) {
-                    ncol = j;
-                    nrow = i;
-                }
-            }
-MSL
-            newgrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
-            if (!newgrid) {
-                grd_utils_ptr->grd_set_err (1);
-                return -1;
+                ZerrBC[i] = 0.0f;
             }
-            if (mask) {
-MSL
-                newmask = (char *)csw_Malloc (orig_ncol * orig_nrow * sizeof(char));
-                if (!newmask) {
-                    grd_utils_ptr->grd_set_err (1);
-                    return -1;
+        }
+
+    /*
+        Copy the errors to the output array if needed.
+    */
+        if (FlatGridFlag == 0) {
+            memcpy (err, Zerr, npts*sizeof(CSW_F));
+        }
+    }
+
+/*
+    Generate a report if needed.
+*/
+    PhaseTimes.total = WallTime () - tbegin;
+    PhaseTimes.nthreads = CSWParallel::NumThreads (NumThreads);
+    if (report) {
+
+    /*
+        Find grid min/max for report.
+    */
+        if (FlatGridFlag == 0) {
+            Gmin = 1.e30f;
+            Gmax = -1.e30f;
+            for (i=0; i<nrow; i++) {
+                offset = i * ncol;
+                for (j=0; j<ncol; j++) {
+                    k = offset + j;
+                    if (grid[k] < Gmin) {
+                        Gmin = grid[k];
+                        Rminrow = i;
+                        Rmincol = j;
+                        Rgxmin = OrigXmin + j * Xspace;
+                        Rgymin = OrigYmin + i * Yspace;
+                    }
+                    if (grid[k] > Gmax) {
+                        Gmax = grid[k];
+                        Rmaxrow = i;
+                        Rmaxcol = j;
+                        Rgxmax = OrigXmin + j * Xspace;
+                        Rgymax = OrigYmin + i * Yspace;
+                    }
                 }
             }
-            resampleflag = 1;
+        }
+        else {
+            Gmin = z[0];
+            Gmax = z[0];
+        }
+
+    /*
+        Write the report to a string and return it in the report pointer.
+    */
+        GenerateReport (report);
+    }
+
+/*
+    Make sure the points that were set as nearly on top of faults
+    are reset back to their original coordinates.
+*/
+    if (FaultedFlag) {
+        grd_fault_ptr->grd_reset_fault_data_grazing (x, NULL, NULL);
+    }
+
+    if (in_mask) {
+        if ((int)in_mask[0] == -3) {
+            in_mask[0] = -3;
         }
     }
 
-    OrigNcol = ncol;
-    OrigNrow = nrow;
-    Ncol = ncol;
-    Nrow = nrow;
-    Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
-    Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
+/*
+    thats all folks.
+*/
+    TinySum = 0.0;
+    return 1;
 
-  /*
-   * If x spacing or y spacing is
-   * ridiculously large, return an error 3, for a wild parameter.
-   * The cutoffs are based on .01 * spacing squared being a
-   * reasonable float number.
-   */
-    if (Xspace > 1.e8  ||  Yspace > 1.e8)  {
+}  /*  end of function grd_calc_grid  */
+
+
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+               g r d _ c a l c _ g r i d _ t i l e d
+
+  ****************************************************************
+
+  function name:    grd_calc_grid_tiled        (int)
+
+  call sequence:    grd_calc_grid_tiled (x, y, z, npts,
+                                         filename, comment,
+                                         ncol, nrow,
+                                         x1, y1, x2, y2,
+                                         tile_size, options)
+
+  purpose:          Calculate a grid that may be too large to fit in
+                    memory and write it to a grid file.  The grid is
+                    split into square tiles of tile_size by tile_size
+                    nodes.  Each tile is calculated by grd_calc_grid
+                    from the points near it, on a grid that extends
+                    past the tile by a halo of extra nodes.  Only the
+                    nodes inside the tile are kept, and they are sent
+                    to the grid file writer as soon as the tile is
+                    done.  The memory needed is about what
+                    grd_calc_grid needs for a single tile plus its
+                    halo, no matter how big the full grid is.  The
+                    points are sorted once into bins the size of a
+                    tile, so each tile only looks at the points in the
+                    bins near it.
+-
+                    The halo is at least the outside boundary margin
+                    option (so the mask near the data is the same as
+                    for a single grid) and at least the maximum search
+                    distance option.  If there is no maximum search
+                    distance, the halo is set from the data density so
+                    that it holds about num_local_points points.  The
+                    halo is never more than tile_size.
+-
+                    The tiles are not exactly the same as a single grid
+                    calculation, since the trend surface and the grid
+                    smoothing in each tile only see the data near the
+                    tile.  Where the nodes are surrounded by data, the
+                    tile seams match a single grid to within about 0.1
+                    percent of the data z range.  Within a halo width
+                    of the edge of the data, and outside of the data,
+                    the differences can be a few percent of the z range
+                    and the mask can differ by a node or so.  Tiles that
+                    have no data anywhere in their halo are written as
+                    outside (mask value 1) null nodes.  If the whole
+                    grid fits in a single tile, the result is the same
+                    as grd_calc_grid.
+
+  return value:     status code
+                    -1 = error
+                     1 = success
+
+  errors:           1 = memory allocation error or disk write error
+                    2 = A NULL x, y, z or file name is specified or
+                        the file (or a scratch file) cannot be created.
+                    3 = A wild parameter was encountered.
+                    4 = ncol or nrow is less than 2, or the grid is too
+                        large for the grid file format.
+                    5 = x2 less than x1 or y2 less than y1
+                    6 = npts less than 1
+                    Any error from grd_calc_grid for a tile.
+
+  calling parameters:
+
+    x          r    CSW_F*   Array of x coordinates
+    y          r    CSW_F*   Array of y coordinates
+    z          r    CSW_F*   Array of z values at the x,y coordinates
+    npts       r    int      Number of points in x, y and z.
+    filename   r    char*    Name of the grid file to write.
+    comment    r    char*    Optional comment for the grid file.
+    ncol       r    int      Number of columns in the grid.
+    nrow       r    int      Number of rows in the grid.
+    x1         r    CSW_F    Minimum x coordinate of the grid.
+    y1         r    CSW_F    Minimum y coordinate of the grid.
+    x2         r    CSW_F    Maximum x coordinate of the grid.
+    y2         r    CSW_F    Maximum y coordinate of the grid.
+    tile_size  r    int      Number of rows and columns in each tile.
+                             Use zero or less for the default of 1000.
+    options    r    GRidCalcOptions
+                             Optional grid calc option structure.
+
+*/
+
+int CSWGrdCalc::grd_calc_grid_tiled
+    (CSW_F *x, CSW_F *y, CSW_F *z, int npts,
+     const char *filename, const char *comment,
+     int ncol, int nrow,
+     CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+     int tile_size, GRidCalcOptions *options)
+{
+    int       i, k, n, istat, halo, margin, nlocal, inside, gridtype;
+    int       row0, col0, brow, bcol, hr0, hr1, hc0, hc1,
+              tncol, tnrow, roff, coff, maxtile;
+    int       j, bsize, nbcol, nbrow, nbin, bc0, bc1, br0, br1, ib, jb;
+    CSW_F     xsp, ysp, tx1, ty1, tx2, ty2, dx1, dy1, dx2, dy2, msd;
+    double    ppn, dt, bw, bh;
+    CSW_F     *tx = NULL, *ty = NULL, *tz = NULL, *tgrid = NULL;
+    char      *tmask = NULL;
+    int       *binstart = NULL, *binpts = NULL, *tidx = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (tx);
+        csw_Free (binstart);
+        csw_Free (tgrid);
+        csw_Free (tmask);
+        grd_fileio_ptr->grd_end_tiled_file (0);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+/*
+    check obvious errors in input parameters
+*/
+    if (ncol < -WildInteger  ||  ncol > WildInteger  ||
+        nrow < -WildInteger  ||  nrow > WildInteger  ||
+        x1 < -WildFloat  ||  x1 > WildFloat  ||
+        y1 < -WildFloat  ||  y1 > WildFloat ||
+        x2 < -WildFloat  ||  x2 > WildFloat ||
+        y2 < -WildFloat  ||  y2 > WildFloat) {
         grd_utils_ptr->grd_set_err (3);
         return -1;
     }
-    OrigXdata = x;
-    OrigYdata = y;
-    OrigZdata = z;
-    OrigNdata = npts;
-    Xdata = x;
-    Ydata = y;
 
-/*
- * Bug 8290,  A copy of the Z array is made, so the clipping to
- *            hard min and max will not affect the original data.
- */
-    Zdata = (CSW_F *)csw_Malloc (npts * sizeof(CSW_F));
-    FreeZdataFlag = 1;
-    if (Zdata == NULL) {
-        grd_utils_ptr->grd_set_err (1);
+    if (x == NULL  ||  y == NULL  ||  z == NULL  ||  filename == NULL) {
+        grd_utils_ptr->grd_set_err (2);
         return -1;
     }
-    memcpy (Zdata, z, npts * sizeof(CSW_F));
-
-    Ndata = npts;
-    MaxData = Ndata;
-    Extension = 4;
 
-    Zmin = 1.e30f;
-    Zmax = -1.e30f;
-    for (i=0; i<Ndata; i++) {
-/*
- * Bug 8290, if the z data is outside of the hard data limits,
- *           clip it to the hard data limits.
- */
-        if (Zdata[i] > HardMaxValue) Zdata[i] = HardMaxValue;
-        if (Zdata[i] < HardMinValue) Zdata[i] = HardMinValue;
-
-        if (Zdata[i] < Zmin) Zmin = Zdata[i];
-        if (Zdata[i] > Zmax) Zmax = Zdata[i];
+    if (ncol < MIN_COLS_GCALC  ||  nrow < MIN_ROWS_GCALC) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
     }
-    Zrange = Zmax - Zmin;
-    TinySum = Zrange / 100000.0f;
-    if (TinySum > 1.e-10) TinySum = 1.e-10f;
 
-    MaxNodeDistance = 100000;
-    if (MaxSearchDistance / (Xspace + Yspace) < 50000) {
-        MaxNodeDistance = (int) (MaxSearchDistance / (Xspace + Yspace));
-        MaxNodeDistance *= 2;
-        MaxNodeDistance++;
+    if (x2 <= x1  ||  y2 <= y1) {
+        grd_utils_ptr->grd_set_err (5);
+        return -1;
     }
-    if (MaxNodeDistance < 1) {
-        MaxNodeDistance = 1;
+
+    if (npts < 1) {
+        grd_utils_ptr->grd_set_err (6);
+        return -1;
     }
 
+    if (tile_size < 1) tile_size = DEFAULT_TILE_SIZE;
+    if (tile_size < MIN_COLS_GCALC) tile_size = MIN_COLS_GCALC;
+
 /*
-    set the skip factor for the coarse grid
+    Get the options that decide the halo size and the file type.
 */
-    Ncoarse = 1;
-    if (Ncol + Nrow > 12)  Ncoarse = 2;
-    if (Ncol + Nrow > 70)  Ncoarse = 4;
-    if (Ncol + Nrow > 192)  Ncoarse = 8;
-    if (Ncol + Nrow > 384)  Ncoarse = 16;
-    if (Ncol + Nrow > 1536)  Ncoarse = 32;
-    if (Ncol + Nrow > 3072)  Ncoarse = 64;
-    if (Ncol + Nrow > 6144)  Ncoarse = 128;
-    if (Ncol + Nrow > 12288)  Ncoarse = 256;
-
-    if (TriangulateFlag != 4  &&  Ndata > Ncol*Nrow/2) {
-         Ncoarse /= 2;
+    if (options == NULL) {
+        margin = OptOutsideBoundaryMargin;
+        msd = OptMaxSearchDistance;
+        nlocal = OptNumLocalPoints;
+        gridtype = GRD_NORMAL_GRID_FILE;
+        if (OptThicknessFlag) gridtype = GRD_THICKNESS_GRID_FILE;
+        if (OptStepGridFlag) gridtype = GRD_STEP_GRID_FILE;
+    }
+    else {
+        margin = options->outside_margin;
+        msd = options->max_search_distance;
+        nlocal = options->num_local_points;
+        gridtype = GRD_NORMAL_GRID_FILE;
+        if (options->thickness_flag) gridtype = GRD_THICKNESS_GRID_FILE;
+        if (options->step_flag) gridtype = GRD_STEP_GRID_FILE;
     }
 
-    if (Ncoarse < 1) Ncoarse = 1;
+    if (margin < 1) margin = 1;
+    if (nlocal < 1  ||  nlocal > MAX_LOCAL) nlocal = MAX_LOCAL;
 
-    if (Ndata == 3) Ncoarse = 1;
+    xsp = (x2 - x1) / (CSW_F)(ncol - 1);
+    ysp = (y2 - y1) / (CSW_F)(nrow - 1);
 
 /*
-    Set the smoothing factor based on the number of points
-    in the input data set.
+    Find the halo size in nodes.
 */
-    SmoothingFactor = 3.0f;
-    if (npts > 2000) SmoothingFactor = 6.0f;
-    if (npts > 5000) SmoothingFactor = 10.0f;
-    if (npts > 10000) SmoothingFactor = 12.0f;
-    if (FastGridFlag) {
-        SmoothingFactor -= 2.0f;
-        if (SmoothingFactor < 2) SmoothingFactor = 2.0f;
+    halo = margin;
+    if (msd > 0.0f  &&  msd < 1.e20f) {
+        dt = msd;
+        dt /= (xsp < ysp) ? xsp : ysp;
+    }
+    else {
+        ppn = (double)npts / ((double)ncol * (double)nrow);
+        dt = sqrt ((double)nlocal / (ppn * 3.14159));
+    }
+    if (dt >= (double)tile_size) {
+        halo = tile_size;
+    }
+    else if ((int)dt + 1 > halo) {
+        halo = (int)dt + 1;
     }
+    if (halo < MIN_TILE_HALO) halo = MIN_TILE_HALO;
+    if (halo > tile_size) halo = tile_size;
 
 /*
-    If the margin size is much greater than the data limits
-    use the data limits.  If less than zero, use 2 coarse
-    grid cells.
+    Allocate space for the data near a tile and for the
+    tile grid with its halo.
 */
-    grd_utils_ptr->grd_limits_xy (x, y, npts,
-                   &datax1, &datay1, &datax2, &datay2);
-    if (datax1 > x1) datax1 = x1;
-    if (datay1 > y1) datay1 = y1;
-    if (datax2 < x2) datax2 = x2;
-    if (datay2 < y2) datay2 = y2;
-    DXmin = datax1;
-    DYmin = datay1;
-    DXmax = datax2;
-    DYmax = datay2;
-    margin1 = x1 - datax1 + y1 - datay1 + datax2 - x2 + datay2 - y2;
-    margin1 /= 2;
-    margin1 /= (Xspace + Yspace);
-    margin1 += 0.5f;
-    if (WorkMargin > 2 * (int)margin1) {
-        WorkMargin = (int)margin1;
-    }
-    if (WorkMargin < 0) {
-        WorkMargin = 4 * Ncoarse;
-        xmarg = WorkMargin * Xspace;
-        ymarg = WorkMargin * Yspace;
-        while (DXmin < x1 - xmarg  ||  DYmin < y1 - ymarg  ||
-               DXmax > x2 + xmarg  ||  DYmax > y2 + ymarg) {
-            WorkMargin *= 2;
-            if (WorkMargin >= 8 * Ncoarse) {
-                break;
-            }
-            xmarg = WorkMargin * Xspace;
-            ymarg = WorkMargin * Yspace;
-        }
-    }
-    if (WorkMargin < Ncoarse) {
-        WorkMargin = Ncoarse;
+MSL
+    tx = (CSW_F *)csw_Malloc (npts * 3 * sizeof(CSW_F));
+    if (tx == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
+    ty = tx + npts;
+    tz = ty + npts;
 
 /*
-    Expand the grid limits used internally so that an integral number of coarse
-    grid cells are present in the calculated grid.  The internal grid is
-    copied to the output grid at the end, with appropriate offsets being
-    used in the copy operation.
+    The points are put into bins of bsize by bsize nodes.  This is
+    the tile size unless that would make more bins than points.
 */
-WorkMargin = 4 * Ncoarse;
-if (WorkMargin < 16) WorkMargin = 16;
-    ismooth = (int) (SmoothingFactor + .5f);
-    grd_utils_ptr->grd_expand_limits (x1, y1, x2, y2, ncol, nrow, Ncoarse, WorkMargin,
-                       &Xmin, &Ymin, &Xmax, &Ymax,
-                       &Ncol, &Nrow, &ColZero, &RowZero);
+    bsize = tile_size;
+    for (;;) {
+        nbcol = (ncol + bsize - 1) / bsize;
+        nbrow = (nrow + bsize - 1) / bsize;
+        if ((double)nbcol * (double)nbrow <= (double)npts + 1.0) {
+            break;
+        }
+        bsize *= 2;
+    }
+    nbin = nbcol * nbrow;
+    bw = (double)xsp * bsize;
+    bh = (double)ysp * bsize;
 
-    Nccol = Ncol / Ncoarse + 1;
-    Ncrow = Nrow / Ncoarse + 1;
-    if (Ncoarse == 1) {
-        Nccol = Ncol;
-        Ncrow = Nrow;
+MSL
+    binstart = (int *)csw_Malloc ((nbin + 1 + 2 * npts) * sizeof(int));
+    if (binstart == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
+    binpts = binstart + nbin + 1;
+    tidx = binpts + npts;
 
 /*
-    Make sure the coarse grid is no larger than 128 rows
-    or columns.
+    Find the bin column or row of a distance from the grid
+    origin.  Points outside of the grid go in the edge bins.
 */
-    while (Nccol > 128  ||  Ncrow > 128) {
-        Ncoarse *= 2;
-        grd_utils_ptr->grd_expand_limits (x1, y1, x2, y2, ncol, nrow, Ncoarse, WorkMargin,
-                           &Xmin, &Ymin, &Xmax, &Ymax,
-                           &Ncol, &Nrow, &ColZero, &RowZero);
-        Nccol = Ncol / Ncoarse + 1;
-        Ncrow = Nrow / Ncoarse + 1;
-    }
-    NcoarseOrig = Ncoarse;
+    auto fbin = [](double dist, double width, int nb) -> int
+    {
+        dist /= width;
+        if (dist < 0.0) return 0;
+        if (dist >= (double)(nb - 1)) return nb - 1;
+        return (int)dist;
+    };
 
 /*
-    Count the number of points in the area of interest and
-    return error 7 if there is less than 1.
+    Count the points in each bin and then list the points of
+    each bin in their original order.  The bin of each point
+    is kept in tidx until the lists are filled.
 */
-    n = 0;
+    memset (binstart, 0, (nbin + 1) * sizeof(int));
     for (i=0; i<npts; i++) {
-        if (x[i] < OrigXmin  ||  x[i] > OrigXmax  ||
-            y[i] < OrigYmin  ||  y[i] > OrigYmax) {
-            continue;
-        }
-        n = 1;
-        break;
+        k = fbin ((double)y[i] - y1, bh, nbrow) * nbcol +
+            fbin ((double)x[i] - x1, bw, nbcol);
+        tidx[i] = k;
+        binstart[k+1]++;
+    }
+    for (k=0; k<nbin; k++) {
+        binstart[k+1] += binstart[k];
     }
+    for (i=0; i<npts; i++) {
+        k = tidx[i];
+        binpts[binstart[k]] = i;
+        binstart[k]++;
+    }
+    for (k=nbin; k>0; k--) {
+        binstart[k] = binstart[k-1];
+    }
+    binstart[0] = 0;
 
-    if (n < 1) {
-        grd_utils_ptr->grd_set_err (7);
-        TinySum = 0.0;
+    maxtile = tile_size + 2 * halo;
+    if (maxtile > ncol) {
+        k = ncol;
+    }
+    else {
+        k = maxtile;
+    }
+    if (maxtile > nrow) {
+        k *= nrow;
+    }
+    else {
+        k *= maxtile;
+    }
+
+MSL
+    tgrid = (CSW_F *)csw_Malloc (k * sizeof(CSW_F));
+    if (tgrid == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+MSL
+    tmask = (char *)csw_Malloc (k * sizeof(char));
+    if (tmask == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    istat = grd_fileio_ptr->grd_begin_tiled_file (
+        filename, comment, ncol, nrow,
+        (double)x1 + XOutputShift, (double)y1 + YOutputShift,
+        (double)x2 + XOutputShift, (double)y2 + YOutputShift,
+        gridtype, tile_size);
+    if (istat == -1) {
         return -1;
     }
 
 /*
-    If there are an absurdly large number of grid nodes relative
-    to the number of data points, set a private class variable that will
-    greatly increase the search distances used in the coarse grid
-    node calculation.
+    Calculate the tiles a band of rows at a time.
 */
-    Ndivide = 1;
-    if (n < ncol * nrow / 10000) {
-        Ndivide = 4;
+    for (row0=0; row0<nrow; row0+=tile_size) {
+
+        brow = nrow - row0;
+        if (brow > tile_size) brow = tile_size;
+        hr0 = row0 - halo;
+        if (hr0 < 0) hr0 = 0;
+        hr1 = row0 + brow - 1 + halo;
+        if (hr1 > nrow - 1) hr1 = nrow - 1;
+        tnrow = hr1 - hr0 + 1;
+        roff = row0 - hr0;
+
+        ty1 = y1 + hr0 * ysp;
+        ty2 = y1 + hr1 * ysp;
+        if (hr1 == nrow - 1) ty2 = y2;
+
+        for (col0=0; col0<ncol; col0+=tile_size) {
+
+            bcol = ncol - col0;
+            if (bcol > tile_size) bcol = tile_size;
+            hc0 = col0 - halo;
+            if (hc0 < 0) hc0 = 0;
+            hc1 = col0 + bcol - 1 + halo;
+            if (hc1 > ncol - 1) hc1 = ncol - 1;
+            tncol = hc1 - hc0 + 1;
+            coff = col0 - hc0;
+
+            tx1 = x1 + hc0 * xsp;
+            tx2 = x1 + hc1 * xsp;
+            if (hc1 == ncol - 1) tx2 = x2;
+
+        /*
+            Use the points within another halo of the tile grid,
+            so the nodes in the tile grid halo have data on both
+            sides of them where possible.
+        */
+            dx1 = tx1 - halo * xsp;
+            dy1 = ty1 - halo * ysp;
+            dx2 = tx2 + halo * xsp;
+            dy2 = ty2 + halo * ysp;
+            if (tncol == ncol  &&  tnrow == nrow) {
+                dx1 = -1.e30f;
+                dy1 = -1.e30f;
+                dx2 = 1.e30f;
+                dy2 = 1.e30f;
+            }
+
+        /*
+            Collect the points in the bins that overlap the data
+            area, and put them back in their original order so the
+            tile gets the same points in the same order as from a
+            scan of all the points.
+        */
+            bc0 = fbin ((double)dx1 - x1, bw, nbcol);
+            bc1 = fbin ((double)dx2 - x1, bw, nbcol);
+            br0 = fbin ((double)dy1 - y1, bh, nbrow);
+            br1 = fbin ((double)dy2 - y1, bh, nbrow);
+
+            n = 0;
+            for (jb=br0; jb<=br1; jb++) {
+                for (ib=bc0; ib<=bc1; ib++) {
+                    k = jb * nbcol + ib;
+                    for (j=binstart[k]; j<binstart[k+1]; j++) {
+                        i = binpts[j];
+                        if (x[i] < dx1  ||  x[i] > dx2  ||
+                            y[i] < dy1  ||  y[i] > dy2) {
+                            continue;
+                        }
+                        tidx[n] = i;
+                        n++;
+                    }
+                }
+            }
+            if (bc1 > bc0  ||  br1 > br0) {
+                std::sort (tidx, tidx + n);
+            }
+
+            inside = 0;
+            for (j=0; j<n; j++) {
+                i = tidx[j];
+                tx[j] = x[i];
+                ty[j] = y[i];
+                tz[j] = z[i];
+                if (x[i] >= tx1  &&  x[i] <= tx2  &&
+                    y[i] >= ty1  &&  y[i] <= ty2) {
+                    inside = 1;
+                }
+            }
+
+        /*
+            If there is no data in the tile grid, the whole tile is
+            farther than the outside margin from any data, so it is
+            null and outside.
+        */
+            if (inside == 0) {
+                for (i=0; i<bcol*brow; i++) {
+                    tgrid[i] = 1.e30f;
+                    tmask[i] = 1;
+                }
+            }
+            else {
+                istat = grd_calc_grid (tx, ty, tz, NULL, n,
+                                       tgrid, tmask, NULL,
+                                       tncol, tnrow,
+                                       tx1, ty1, tx2, ty2,
+                                       options);
+                if (istat == -1) {
+                    return -1;
+                }
+
+            /*
+                Pack the tile nodes, without the halo, at
+                the start of the tile grid and mask.
+            */
+                for (i=0; i<brow; i++) {
+                    k = (i + roff) * tncol + coff;
+                    memmove (tgrid + i * bcol, tgrid + k, bcol * sizeof(CSW_F));
+                    memmove (tmask + i * bcol, tmask + k, bcol * sizeof(char));
+                }
+            }
+
+            istat = grd_fileio_ptr->grd_put_tiled_block (
+                tgrid, tmask, bcol, brow, col0);
+            if (istat == -1) {
+                return -1;
+            }
+        }
+
+        istat = grd_fileio_ptr->grd_end_tiled_band (brow);
+        if (istat == -1) {
+            return -1;
+        }
     }
-    else if (n < ncol * nrow / 1000) {
-        Ndivide = 2;
+
+    istat = grd_fileio_ptr->grd_end_tiled_file (1);
+
+    return istat;
+
+}  /*  end of function grd_calc_grid_tiled  */
+
+
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+                   S e t u p D a t a T a b l e
+
+  ****************************************************************
+
+    Set up the DataTable grid and the link list of pointers to
+  data points that occupy each grid cell.
+
+*/
+
+int CSWGrdCalc::SetupDataTable (int zflag, int first)
+{
+    int            *lastpoint = NULL, icc, icr, ic, ir, idx, izc, izr,
+                   i, ncells, nmean, zeroflag;
+    int            idxc;
+    CSW_F          x1, y1, x2, y2, xspacec, yspacec;
+    CSW_F          xt, yt;
+    CSW_F          *bin_min = NULL, *bin_max = NULL;
+
+    bool      bsuccess = false;
+
+    auto fscope = [&]()
+    {
+        csw_Free (lastpoint);
+        csw_Free (bin_min);
+        if (bsuccess == false) {
+            FreeMem ();
+        }
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+
+    zeroflag = 0;
+    if (zflag == 1  &&  ThicknessFlag == 1) zeroflag = 1;
+
+    if (first == 1) {
+        if (AllocateWorkSpace () == -1) {
+            return -1;
+        }
     }
 
-    if (StepGridFlag == 1) {
-        Ndivide = 1;
+/*
+    allocate a temporary array to use while building
+    the link lists for data in each cell
+*/
+MSL
+    lastpoint = (int *)csw_Malloc (Ncol * Nrow * sizeof(int));
+    if (!lastpoint) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
 
 /*
-    If the program is in parameter error simulation mode,
-    return success (which is not expected) here.
+    initialize some of the workspace arrays
 */
-    if (grd_utils_ptr->grd_simulation()) {
-        TinySum = 0.0;
-        return 1;
+    for (i=0; i<Ncol*Nrow; i++) {
+        DataTable[i] = -1;
     }
+    memset ((char *)ClosestPoint, 0, Ncol*Nrow*sizeof(int));
+    memset ((char *)Icoarse, 0, Nccol*Ncrow*sizeof(char));
+    memset ((char *)ZeroCoarse, 0, Nccol*Ncrow*sizeof(char));
 
 /*
-    If the thickness flag is set, check for zero or negative data values.
-    If none are found, do not use thickness gridding.
+  Allocate and initialize the nosy data bins (min and max in each bin).
 */
-    OriginalThicknessFlag = ThicknessFlag;
-    if (ThicknessFlag == 1) {
-        CheckForZeroThickness ();
+    bool bnoise = false;
+    if (NoisyDataFlag == 0) {
+      bin_min = (CSW_F *)csw_Malloc (Nccol * Ncrow * 2 * sizeof(CSW_F));
+      if (bin_min == NULL) {
+        return -1;
+      }
+      bin_max = bin_min + Nccol * Ncrow;
+      for (i=0; i<Nccol * Ncrow; i++) {
+        bin_min[i] = 1.e30;
+        bin_max[i] = -1.e30;
+      }
+      bnoise = true;
     }
 
 /*
-    Create index grids for looking up fault vectors.
+    build the data table and link list
 */
-    faults = NULL;
-    nfaults = 0;
-    if (FaultedFlag) {
-        grd_fault_ptr->grd_set_fault_zlimits (Zmin, Zmax);
-        grd_fault_ptr->grd_extend_faults_to_margins (OrigXmin, OrigYmin,
-                                      OrigXmax, OrigYmax,
-                                      Xmin, Ymin,
-                                      Xmax, Ymax);
-        grd_fault_ptr->grd_set_fault_index_extent (Ncoarse);
-        istat = grd_fault_ptr->grd_build_fault_indices (NULL, Ncol, Nrow, Xmin, Ymin, Xmax, Ymax);
-        grd_fault_ptr->grd_set_fault_index_extent (1);
-        if (istat == -1) {
-            grd_utils_ptr->grd_set_err (1);
-            TinySum = 0.0;
-            return -1;
-        }
-        istat = grd_fault_ptr->grd_get_current_fault_structs (&faults, &nfaults);
-        if (istat == -1) {
-            grd_utils_ptr->grd_set_err (1);
-            TinySum = 0.0;
-            return -1;
-        }
-        do_write = csw_GetDoWrite ();
-        if (do_write) {
-            grd_WriteFaultLines (
-                faults, nfaults, (char *)"currentfaults.xyz");
-        }
+    Zmin = 1.e30f;
+    Zmax = -1.e30f;
+    x1 = 1.e30f;
+    y1 = 1.e30f;
+    x2 = -1.e30f;
+    y2 = -1.e30f;
+    Zmean = 0.0f;
+    nmean = 0;
+    ncells = 0;
+    xspacec = Xspace * Ncoarse;
+    yspacec = Yspace * Ncoarse;
 
-        istat = grd_fault_ptr->grd_set_fault_data_grazing (Xdata, Ydata, Ndata);
-        if (istat == -1) {
-            grd_utils_ptr->grd_set_err (11);
-            TinySum = 0.0;
-            return -1;
-        }
-        grd_fault_ptr->grd_get_closest_fault_ptr (&ClosestFault);
+    for (i=0; i<Ndata; i++) {
 
-        OrigIdata = (int *)csw_Malloc (OrigNdata * sizeof(int));
-        if (!OrigIdata) {
-            TinySum = 0.0;
-            return -1;
-        }
+        if (Xdata[i] < x1) x1 = Xdata[i];
+        if (Ydata[i] < y1) y1 = Ydata[i];
+        if (Xdata[i] > x2) x2 = Xdata[i];
+        if (Ydata[i] > y2) y2 = Ydata[i];
 
-        if (FreeZdataFlag == 1) {
-            csw_Free (Zdata);
-            Zdata = NULL;
-            FreeZdataFlag = 0;
-        }
-        Xdata = (CSW_F *)csw_Malloc (OrigNdata * 3 * sizeof(CSW_F));
-        if (!Xdata) {
-            Xdata = OrigXdata;
-        }
-        else {
-            Ydata = Xdata + OrigNdata;
-            Zdata = Ydata + OrigNdata;
-            Ndata = 0;
-            for (i=0; i<OrigNdata; i++) {
-                if (OrigXdata[i] < 1.e30) {
-                    Xdata[Ndata] = OrigXdata[i];
-                    Ydata[Ndata] = OrigYdata[i];
-                    Zdata[Ndata] = OrigZdata[i];
-                    OrigIdata[Ndata] = i;
-                    Ndata++;
+    /*
+        If the thickness flag is set, no negative z values are allowed.
+    */
+        if (ThicknessFlag == 1) {
+            if (Zdata[i] < 0.0f) Zdata[i] = 0.0f;
+
+        /*
+            Set the closest node in the coarse zero grid to 1.
+            This is used to control extrapolation from the non
+            zero data area.
+        */
+            if (Zdata[i] <= 0.0f  &&  first == 1) {
+                izc = (int) ((Xdata[i] - Xmin) / xspacec + 0.5f);
+                izr = (int) ((Ydata[i] - Ymin) / yspacec + 0.5f);
+                if (izc >= 0  &&  izr >= 0  &&  izc < Nccol  &&  izr < Ncrow) {
+                    ZeroCoarse[izr*Nccol + izc] = 1;
                 }
             }
         }
+
     /*
-     * Only do anisotropy on faulted grids if there are a lot of data points
-     * relative to the number of fault vectors.
-     */
-        if (nfaults > 0) {
-            if ((double)OrigNdata / (double)nfaults < 5.0  ||  npts < 10) {
-                AnisotropyFlag = 0;
-                AnisotropyRatio = 1.0f;
-                PreferredStrike = -1000.0f;
-            }
+        If the zeroflag is set, no zero or very near zero
+        values are indexed.
+    */
+        if (zeroflag == 1  &&  Zdata[i] <= 0.0f) {
+            continue;
         }
-    }
-
-/*
- * Make a copy of the data if this is a vertical fault surface.
- */
-    if (VerticalFaultFlag == 1) {
 
-        OrigIdata = (int *)csw_Malloc (OrigNdata * sizeof(int));
-        if (!OrigIdata) {
-            TinySum = 0.0;
-            return -1;
+        if (Xdata[i] < Xmin  ||  Xdata[i] > Xmax  ||
+            Ydata[i] < Ymin  ||  Ydata[i] > Ymax) {
+        /*
+         * Bug 9735 fix, update z limits even if the point
+         * is not in the area of interest.
+         */
+            if (Zdata != NULL) {
+                if (Zdata[i] < Zmin) Zmin = Zdata[i];
+                if (Zdata[i] > Zmax) Zmax = Zdata[i];
+            }
+            AddToExtraPoints (i);
+            continue;
         }
 
-        MaxData = OrigNdata * 16;
-        if (FreeZdataFlag) {
-            csw_Free (Zdata);
-            Zdata = NULL;
-            FreeZdataFlag = 0;
+        if (Zdata[i] < Zmin) {
+            Zmin = Zdata[i];
+            Rxmin = Xdata[i];
+            Rymin = Ydata[i];
         }
-        Xdata = (CSW_F *)csw_Malloc (MaxData * 3 * sizeof(CSW_F));
-        if (!Xdata) {
-            grd_utils_ptr->grd_set_err (1);
-            TinySum = 0.0;
-            return -1;
+        if (Zdata[i] > Zmax) {
+            Zmax = Zdata[i];
+            Rxmax = Xdata[i];
+            Rymax = Ydata[i];
         }
-        else {
-            Ydata = Xdata + MaxData;
-            Zdata = Ydata + MaxData;
-            Ndata = 0;
-            for (i=0; i<OrigNdata; i++) {
-                if (OrigXdata[i] < 1.e30) {
-                    Xdata[Ndata] = OrigXdata[i];
-                    Ydata[Ndata] = OrigYdata[i];
-                    Zdata[Ndata] = OrigZdata[i];
-                    OrigIdata[Ndata] = i;
-                    Ndata++;
-                }
+        Zmean += Zdata[i];
+        nmean++;
+
+    /*
+        which detail grid cell holds the point
+    */
+        ic = (int) ((Xdata[i] - Xmin) / Xspace);
+        if (ic < 0  ||  ic >= Ncol) {
+        /*
+         * Bug 9735 fix, update z limits even if the point
+         * is not in the area of interest.
+         */
+            if (Zdata != NULL) {
+                if (Zdata[i] < Zmin) Zmin = Zdata[i];
+                if (Zdata[i] > Zmax) Zmax = Zdata[i];
             }
+            AddToExtraPoints (i);
+            continue;
         }
-    }
-
-/*
-    If global anisotropy calculations are wanted and also there
-    is no preferred strike specified, calculate a preferred strike
-    and strike power using the global anisotropy algorithm.
-*/
-    AnisotropyRatio = 1.0f;
-    if (PreferredStrike < 0.0f  &&  AnisotropyFlag == GRD_GLOBAL_ANISOTROPY) {
-        tiny = (x2 - x1 + y2 - y1) / 100.0f;
-        istat = grd_utils_ptr->grd_colinear_check (Xdata, Ydata, Ndata, tiny, NULL);
-        if (istat == 0) {
-            for (;;) {
-                istat = grd_stats_ptr->grd_global_anisotropy
-                        (Xdata, Ydata, Zdata, npts, nbins,
-                         &PreferredStrike, &StrikePower, &AnisotropyRatio, ThicknessFlag);
-                if (PreferredStrike < 0  &&  PreferredStrike >= -200) {
-                    PreferredStrike += 360.0f;
-                }
-                if (istat == -2) {
-                    if (nbins <= 10) break;
-                    nbins -= 5;
-                    continue;
-                }
-                else {
-                    break;
-                }
+        ir = (int) ((Ydata[i] - Ymin) / Yspace);
+        if (ir < 0  ||  ir >= Nrow) {
+        /*
+         * Bug 9735 fix, update z limits even if the point
+         * is not in the area of interest.
+         */
+            if (Zdata != NULL) {
+                if (Zdata[i] < Zmin) Zmin = Zdata[i];
+                if (Zdata[i] > Zmax) Zmax = Zdata[i];
             }
+            AddToExtraPoints (i);
+            continue;
+        }
+
+    /*
+        set the coarse grid cell to occupied
+    */
+        icc = ic / Ncoarse;
+        icr = ir / Ncoarse;
+        idxc = Nccol * icr + icc;
+        *(Icoarse + idxc) = 1;
+
+    /*
+        Set the detail grid data table and link list
+    */
+        idx = ic + Ncol * ir;
+        if (DataTable[idx] == -1) {
+            DataTable[idx] = i;
+            LinkList[i] = -1;
+            ncells++;
         }
         else {
-            AnisotropyFlag = 0;
-            PreferredStrike = -1000.0f;
-        }
-        if (PreferredStrike < 0.0f) {
-            AnisotropyFlag = 0;
+            LinkList[lastpoint[idx]] = i;
+            LinkList[i] = -1;
         }
-        if (PreferredStrike >= 0.0  &&  StrikePower > 3) {
-            AnisotropyFlag = 0;
+        lastpoint[idx] = i;
+
+    /*
+       Update the bin min and max values.
+    */
+        if (bnoise) {
+          CSW_F  zt = Zdata[i];
+          if (zt < 1.e20  &&  zt > -1.e20) {
+            if (zt < bin_min[idxc]) bin_min[idxc] = zt;
+            if (zt > bin_max[idxc]) bin_max[idxc] = zt;
+          }
         }
+
     }
-    if (AnisotropyRatio < 1.0f) AnisotropyRatio = 1.0f;
 
 /*
- *  Use triangulation to add some points to empty regions
- *  of the area of interest.  These points are used to
- *  build the EmptyAreaGrid.  If this grid is not NULL,
- *  it is used in extending the coarse grid nodes into
- *  empty areas.
+ * Check if data are noisy.  This is pretty much empirical.
  */
-    do_write = csw_GetDoWrite ();
-    if (do_write == 1) {
-        grd_fileio_ptr->grd_write_float_points (
-            Xdata, Ydata, Zdata, Ndata,
-            (char *)"pre_empty.xyz");
+    if (bnoise && Zmax > Zmin) {
+      CSW_F zt;
+      int ng4 = 0;
+      CSW_F  zr4 = (Zmax - Zmin) / 3.0;
+      for (i=0; i<Nccol*Ncrow; i++) {
+        if (bin_min[i] < bin_max[i]) {
+          zt = bin_max[i] - bin_min[i];
+          if (zt > zr4) {
+            ng4++;
+          }
+        }
+      }
+      if (ng4 > Nccol * Ncrow / 10) {
+        CSW_F  nprat = (CSW_F)Ndata / 100000.0;
+        if (nprat > 1.5) nprat = 1.5;
+        if (nprat < .05) nprat = .05;
+        CSW_F  drat = (CSW_F)ng4 / (CSW_F)(Nccol * Ncrow);
+        NoisyDataFlag = (int)(drat * 10.0 * nprat + 1.5);
+      }
     }
-
-    num_pre_pass1 = Ndata;
-    AddPointsToEmptyRegions ();
-
-    if (do_write == 1) {
-        grd_fileio_ptr->grd_write_float_points (
-            Xdata, Ydata, Zdata, Ndata,
-            (char *)"post_empty.xyz");
+    else {
+      if (NoisyDataFlag == 1) NoisyDataFlag = 10;
     }
 
 /*
-    Allocate the workspace and set up the data tables used for
-    rapid lookup of local points at grid nodes.  An error returned
-    by this function indicates a memory allocation error.
-*/
-    istat = SetupDataTable (0, 1);
-    if (istat == -1) {
-        TinySum = 0.0;
-        return -1;
-    }
+ * Add the control points if specified.
+ */
+    if (UseControlInDataTable == 1) {
 
-/*
-    Create a table that has the distance to the closest
-    data point at each grid node.  This distance is expressed
-    in number of grid cells.  It is used to speed up searches
-    only.  The function always returns 1, so I don't check
-    the return status.
-*/
-    SetupDistanceTable ();
+        for (i=0; i<NumControlPoints; i++) {
 
-/*
-    If the local anisotropy flag is turned on,
-    calculate the local anisotropy grids.
-*/
-    if (PreferredStrike < 0.0f  &&  AnisotropyFlag == GRD_LOCAL_ANISOTROPY) {
-        CalcLocalAnisotropy ();
+            xt = ControlPoints[i].x;
+            yt = ControlPoints[i].y;
+
+            if (xt < Xmin  ||  xt > Xmax  ||
+                yt < Ymin  ||  yt > Ymax) {
+                continue;
+            }
+
+        /*
+            which detail grid cell holds the point
+        */
+            ic = (int) ((xt - Xmin) / Xspace);
+            if (ic < 0  ||  ic >= Ncol) {
+                continue;
+            }
+            ir = (int) ((yt - Ymin) / Yspace);
+            if (ir < 0  ||  ir >= Nrow) {
+                continue;
+            }
+
+        /*
+            set the coarse grid cell to occupied
+        */
+            icc = ic / Ncoarse;
+            icr = ir / Ncoarse;
+            *(Icoarse + icc + Nccol * icr) = 1;
+
+        /*
+            Set the detail grid data table and link list
+        */
+            idx = ic + Ncol * ir;
+            if (DataTable[idx] == -1) {
+                DataTable[idx] = i;
+                LinkList[i] = -1;
+                ncells++;
+            }
+            else {
+                LinkList[lastpoint[idx]] = i;
+                LinkList[i] = -1;
+            }
+            lastpoint[idx] = i;
+        }
+
+    } /* end of control point if block */
+
+    if (x1 < OrigXmin) x1 = OrigXmin;
+    if (x2 > OrigXmax) x2 = OrigXmax;
+    if (y1 < OrigYmin) y1 = OrigYmin;
+    if (y2 > OrigYmax) y2 = OrigYmax;
+    Xrange = x2 - x1;
+    Yrange = y2 - y1;
+    Zrange = Zmax - Zmin;
+    if (ThicknessFlag == 1) {
+        Zrange = Zmax;
+    }
+    ZminusVal = Zrange / 2.0f;
+    ZminusVal = -ZminusVal;
+    Ztiny = Zrange / 100000.0f;
+    if (nmean > 0) {
+        Zmean /= (CSW_F)nmean;
+    }
+    if (Zrange <= 0.0) {
+        FlatGridFlag = 1;
     }
 
 /*
-    Calculate a second order trend surface and a plane.
-    Use the plane unless the second order fit is far better
-    than the plane fit.
+    The point density is used to determine how far
+    to extend the coarse grid outward from well controlled
+    areas.  The extension is done after the local nodes
+    are calculated by extrapolating local node gradients
+    to neighboring uncalculated nodes.
 */
-    if (FlatGridFlag == 0) {
-        istat = FitBestTrendSurface ();
-        if (istat == -1) {
-            if (grd_utils_ptr->grd_get_err() == 3) grd_utils_ptr->grd_set_err (8);
-            TinySum = 0.0;
-            return -1;
-        }
-    }
+    PointDensity = (CSW_F)ncells / (CSW_F)(OrigNcol * OrigNrow);
 
 /*
-    A flat grid also has a flat trend surface grid.
+    Pack the link lists if the packed bucket search is used.
 */
-    else {
-        for (i=0; i<Nccol*Ncrow; i++) {
-            TrendGrid[i] = Zdata[0];
+    if (SearchEngine == GRD_PACKED_BUCKET_ENGINE) {
+        if (SetupPackedBuckets () == -1) {
+            return -1;
         }
     }
 
-/*
-    If there is a conformal shaping surface, resample it to the
-    same geometry as the work grid being calculated.
-*/
-    BuildShapeGrid ();
+    bsuccess = true;
+
+    return 1;
+
+
+}  /*  end of private SetupDataTable function  */
+
+
+
 
-/*
-    Change the TrendDistance based on how well the trend surface fits.
-    For a better fit, the trend surface is used closer to data.
-*/
-    TrendDistance = (int) ((Xrange + Yrange) / ((Xspace + Yspace) * 5.0f));
-    if (FaultedFlag) TrendDistance *= 4;
-    TrendPointErrors ();
 
 /*
-    Calculate coarse grid nodes based on local data where the node
-    has a sufficient local data population.
+  ****************************************************************
+
+               A l l o c a t e W o r k S p a c e
+
+  ****************************************************************
+
+    Allocate the private work arrays, assign the various pointers
+  into them and initialize the grid to all nulls.  This is done
+  once for each grid calculation, by SetupDataTable or when the
+  data tables are restored from a gridding session.
+
 */
-    if (FlatGridFlag == 0) {
-        CoincidentDistance = (Xspace + Yspace) / 20.0f;
-        CalcLocalNodes ();
-    }
-    CoincidentDistance = 0.0;
 
-/*
- * If additional points were created to highlight a preferred
- * strike direction, redo the data table and distance table
- * without these points.
- */
-   if (num_pre_pass1 != Ndata) {
-        Ndata = num_pre_pass1;
-        istat = SetupDataTable (0, 0);
-        if (istat == -1) {
-            TinySum = 0.0;
-            return -1;
-        }
+int CSWGrdCalc::AllocateWorkSpace (void)
+{
+    int            i, nmax;
 
-        SetupDistanceTable ();
+    nmax = Ncol * Nrow * 5 + Nccol * Ncrow * 6 + Ndata * 2;
+MSL
+    Grid = (CSW_F *)csw_Malloc (nmax * sizeof (CSW_F));
+    if (!Grid) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
 
-    do_write = csw_GetDoWrite ();
-    if (do_write == 1) {
-        grd_triangle_ptr->grd_WriteXYZGridFile (
-            (char *)"localnodes.xyz",
-            Grid, Ncol, Nrow, Ncoarse,
-            Xmin, Ymin, Xmax, Ymax);
+    nmax = Ncol * Nrow * 2 + Ndata + 2 * Nrow;
+MSL
+    DataTable = (int *)csw_Malloc (nmax * sizeof(int));
+    if (!DataTable) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
 
-/*
- * Calculate a measure of grid sparseness, ie nodes per
- * data point.  For sparser grids, more smoothing is done.
- */
-    node_ratio = (double)(Ncol * Nrow) / (double)Ndata;
-    smooth_mult = node_ratio / 36.0;
+    nmax = 2 * Nccol * Ncrow + 2 * Ncol * Nrow;
+MSL
+    Icoarse = (char *)csw_Calloc (nmax * sizeof(char));
+    if (!Icoarse) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
 
 /*
-    Use the trend surface for coarse nodes
-    very far from data points.
+    assign various pointers into the allocated space.
 */
-    if (FlatGridFlag == 0  &&  NoisyDataFlag == 0) {
-        AssignTrendNodes ();
+    Gwork1 = Grid + Ncol * Nrow;
+    Gwork2 = Gwork1 + Ncol * Nrow;
+    Gwork3 = Gwork2 + Ncol * Nrow;
+    TrendGrid = Gwork3 + Ncol * Nrow;
+    AratioGrid = TrendGrid + Nccol * Ncrow;
+    AnisoStrike = AratioGrid + Nccol * Ncrow;
+    AnisoPower = AnisoStrike + Nccol *Ncrow;
+    Zerr = AnisoPower + Nccol * Ncrow;
+    ZerrBC = Zerr + Ndata;
+    ShapeGrid = ZerrBC + Ndata;
+    DifferenceGrid = ShapeGrid + Ncol * Nrow;
+
+    ClosestPoint = DataTable + Ncol * Nrow;
+    LinkList = ClosestPoint + Ncol * Nrow;
+    Left = LinkList + Ndata;
+    Right = Left + Nrow;
+
+    NodeMask = Icoarse + Nccol * Ncrow;
+    ZeroCoarse = NodeMask + Ncol * Nrow;
+
+    for (i=0; i<Ncol*Nrow; i++) {
+        Grid[i] = 1.e30f;
     }
 
-/*
-    Assign elevations to all perimeter nodes that
-    have not already been calculated.  This is
-    accomplished by linear interpolation between
-    calculated nodes on the perimeter.  This is done
-    at the coarse grid interval.
-*/
-    if (FlatGridFlag == 0) FillInPerimeter ();
+    return 1;
+
+}  /*  end of private AllocateWorkSpace function  */
+
+
+
 
 /*
-    fill in the rest of the coarse grid nodes.
+  ****************************************************************
+
+              S e t u p P a c k e d B u c k e t s
+
+  ****************************************************************
+
+    Copy the DataTable link lists into contiguous per cell buckets
+  and build the tables used to skip over empty cells along grid
+  rows and columns.  The point order in each cell is the same as
+  in the link lists, so the packed search collects exactly the
+  same points as the link list search.  With clustered data most
+  detail cells are empty, and skipping them is where the packed
+  search saves its time.
+
 */
-    if (FlatGridFlag == 0) FillInCoarse ();
 
-    if (StepGridFlag == 0  &&  Ndata > 3) {
+int CSWGrdCalc::SetupPackedBuckets (void)
+{
+    int            i, j, k, n, ipt, ncell, npacked, nmax, next;
 
-    /*
-        Smooth the coarse grid lightly.
-    */
-        savsmooth = SmoothingFactor;
-        SmoothingFactor = 1.0f;
-        SmoothingFactor *= (CSW_F)smooth_mult;
-        if (SmoothingFactor > 3) SmoothingFactor = 3;
-        if (PreferredStrike >= 0  ||  AnisotropyFlag) {
-            StrikeSmoothGrid ();
-        }
-        else {
-            SimpleSmoothGrid ();
-        }
+    FreePackedBuckets ();
 
-    /*
-        Perform more smoothing passes which do not effect
-        nodes very close to data.
-    */
-        ismooth = (int)(SmoothingFactor + 1.5f);
-        SmoothingFactor = 1.0f / DistancePower;
-        SmoothingFactor *= (CSW_F)smooth_mult;
-        if (SmoothingFactor > 5) SmoothingFactor = 5;
-        if (DistancePower == 6  &&  Ncoarse == 1) {
-            ismooth = 0;
-        }
-        ismooth = ismooth * (TriangulateFlag + 1);
-        for (i=0; i<ismooth/2; i++) {
-            if (PreferredStrike >= 0  ||  AnisotropyFlag) {
-                StrikeSmoothGrid ();
-            }
-            else {
-                SimpleSmoothGrid ();
-            }
+    ncell = Ncol * Nrow;
+
+    npacked = 0;
+    for (k=0; k<ncell; k++) {
+        ipt = DataTable[k];
+        while (ipt >= 0) {
+            npacked++;
+            ipt = LinkList[ipt];
         }
-        SmoothingFactor = savsmooth;
     }
 
-    if (do_write == 1) {
-        grd_triangle_ptr->grd_WriteXYZGridFile (
-            (char *)"smoothnodes.xyz",
-            Grid, Ncol, Nrow, Ncoarse,
-            Xmin, Ymin, Xmax, Ymax);
+    nmax = 3 * ncell + 2 + npacked;
+MSL
+    PackedStart = (int *)csw_Malloc (nmax * sizeof(int));
+    if (!PackedStart) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
     }
+    PackedRowNext = PackedStart + ncell + 1;
+    PackedColNext = PackedRowNext + ncell + 1;
+    PackedPoints = PackedColNext + ncell;
 
 /*
-    The initial coarse grid is now complete.  The
-    final grid is calculated by iteratively correcting
-    for errors and subdividing the coarse grid until
-    the final grid is obtained.
+    Fill in the buckets.
 */
-    if (FlatGridFlag == 0  &&  Ndata > 3) {
-        if (StepGridFlag == 0) {
-            IterateToFinalGrid ();
-        }
-        else {
-            FillInStepGrid ();
-            SmoothStepGrid ();
+    n = 0;
+    for (k=0; k<ncell; k++) {
+        PackedStart[k] = n;
+        ipt = DataTable[k];
+        while (ipt >= 0) {
+            PackedPoints[n] = ipt;
+            n++;
+            ipt = LinkList[ipt];
         }
     }
+    PackedStart[ncell] = n;
 
 /*
-    If the distance power is 6, do a special median filter to
-    sharpen up the features.
+    Next occupied cell along each row.  The sentinel at the
+    end of the row is the first cell of the next row, which
+    is always past the end of any search segment in the row.
 */
-    if (DistancePower == 6) {
-        istat = MedianFilter ();
-        if (istat == -1) {
-            TinySum = 0.0;
-            return -1;
+    PackedRowNext[ncell] = ncell;
+    for (i=0; i<Nrow; i++) {
+        k = i * Ncol;
+        next = k + Ncol;
+        for (j=Ncol-1; j>=0; j--) {
+            if (DataTable[k+j] >= 0) {
+                next = k + j;
+            }
+            PackedRowNext[k+j] = next;
         }
-        MedianFlag = 1;
-        DistancePower = 2;
-        AdjustForErrors ();
-        MedianFlag = 0;
-        DistancePower = 6;
     }
 
 /*
-    Final smoothing pass.
+    Next occupied row along each column.
 */
-    dpsav = DistancePower;
-    if (StepGridFlag == 0  &&  FlatGridFlag == 0  &&  Ndata > 3) {
-        savsmooth = SmoothingFactor;
-        SmoothingFactor = -1.0f;
-        ismooth = (int)(SmoothingFactor + 3.5f);
-        ismooth /= 3;
-        if (DistancePower > 3) ismooth--;
-        if (DistancePower > 5) ismooth--;
-        if (ismooth < 1) ismooth = 1;
-        if (ConformalFlag == 1  &&  UseShapeGrid == 1) {
-            ismooth++;
-        }
-        if (DistancePower == 6  &&  Ncoarse == 1) {
-            ismooth = 1;
-            DistancePower = 2;
-        }
-        if (recalc_grid_flag == 1) {
-            ismooth = 1;
-        }
-        ismooth = ismooth * (TriangulateFlag + 1);
-        for (i=0; i<ismooth; i++) {
-            if (PreferredStrike >= 0.0f  &&  AnisotropyFlag == 0  &&  StrikePower > 2) {
-                if (StrikePower > 4) {
-                    StrikeSmoothGrid ();
-                }
-                else {
-                    if (i == 0) {
-                        StrikeSmoothGrid ();
-                    }
-                    else {
-                        SimpleSmoothGrid ();
-                    }
-                }
-            }
-            else {
-                SimpleSmoothGrid ();
+    for (j=0; j<Ncol; j++) {
+        next = Nrow;
+        for (i=Nrow-1; i>=0; i--) {
+            k = i * Ncol + j;
+            if (DataTable[k] >= 0) {
+                next = i;
             }
+            PackedColNext[k] = next;
         }
-        SmoothingFactor = savsmooth;
     }
-    DistancePower = dpsav;
 
-/*
-    Clip to min max if needed.
-*/
-    if (StepGridFlag == 0  &&  FlatGridFlag == 0) {
-        ClipToMinMax ();
-    }
+    return 1;
+
+}  /*  end of private SetupPackedBuckets function  */
+
 
-/*
-    If the mask array is not NULL, calculate the grid mask.
-*/
-    if (mask) {
-        MaskBadNodes ();
-    }
 
 /*
-    Special case for a flat grid (all same value).
+  ****************************************************************
+
+               F r e e P a c k e d B u c k e t s
+
+  ****************************************************************
+
+    Free the packed bucket arrays.
+
 */
-    if (FlatGridFlag == 1) {
-        grd_utils_ptr->grd_constant_grid (Grid, NULL, Ncol, Nrow, z[0]);
-        if (err) {
-            memset (err, 0, npts*sizeof(CSW_F));
-        }
-        memset (Zerr, 0, npts * sizeof(CSW_F));
-        memset (ZerrBC, 0, npts * sizeof(CSW_F));
-    }
+
+void CSWGrdCalc::FreePackedBuckets (void)
+{
+
+    csw_Free (PackedStart);
+    PackedStart = NULL;
+    PackedPoints = NULL;
+    PackedRowNext = NULL;
+    PackedColNext = NULL;
+
+    return;
+
+}  /*  end of private FreePackedBuckets function  */
+
 
 
-/*
- * special debug stuff.
- */
-    do_write = csw_GetDoWrite ();
-    if (do_write) {
-        grd_triangle_ptr->grd_WriteXYZGridFile ((char *)"pre_resamp.grd",
-                     Grid, Ncol, Nrow, 1,
-                     Xmin, Ymin, Xmax, Ymax);
-    }
 
 /*
-    Copy the grid and mask into the output space.
+  ****************************************************************
+
+             S e s s i o n T a b l e s U s a b l e
+
+  ****************************************************************
+
+    Return 1 if the current calculation can use the gridding session
+  data tables, or zero if not.  The faulted and vertical fault
+  calculations change the data arrays and depend on the fault
+  indices, and control points are put into the data table on some
+  passes, so these cases always build their tables from scratch.
+
 */
-    j = 0;
-    for (i=RowZero; i<RowZero+OrigNrow; i++) {
-        k = i * Ncol + ColZero;
-        k2 = j * OrigNcol;
-        j++;
-        memcpy (grid+k2, Grid+k, OrigNcol*sizeof(CSW_F));
-        if (mask) {
-            memcpy (mask+k2, NodeMask+k, OrigNcol*sizeof(char));
-        }
+
+int CSWGrdCalc::SessionTablesUsable (void)
+{
+
+    if (Session.active == 0) {
+        return 0;
     }
 
-/*
-    Resample back to the requested geometry if needed.
-*/
-    if (resampleflag == 1) {
-        if (DistancePower != 6) {
-            grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
-                               x1, y1, x2, y2,
-                               faults, nfaults,
-                               newgrid, newmask, orig_ncol, orig_nrow,
-                               x1, y1, x2, y2, GRD_BICUBIC);
-        }
-        else {
-            grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
-                               x1, y1, x2, y2,
-                               faults, nfaults,
-                               newgrid, newmask, orig_ncol, orig_nrow,
-                               x1, y1, x2, y2, GRD_BILINEAR);
-        }
-        ncol = orig_ncol;
-        nrow = orig_nrow;
-        Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
-        Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
-        memcpy (grid, newgrid, ncol*nrow*sizeof(CSW_F)); /*lint !e668*/
-        csw_Free (newgrid);
-        newgrid = NULL;
-        if (mask) {
-            memcpy (mask, newmask, ncol*nrow*sizeof(char)); /*lint !e668*/
-            csw_Free (newmask);
-            newmask = NULL;
-        }
-        if (FlatGridFlag == 1) {
-            grd_utils_ptr->grd_constant_grid (grid, NULL, ncol, nrow, z[0]);
-        }
+    if (FaultedFlag  ||  VerticalFaultFlag  ||
+        NumControlPoints > 0  ||  UseControlInDataTable) {
+        return 0;
     }
 
+    return 1;
+
+}  /*  end of private SessionTablesUsable function  */
+
+
+
+
 /*
-    Resample again if a very small grid was expanded to help the faulted calculations.
-*/
-    if (fault_resampleflag == 1) {
-        grd_arith_ptr->grd_resample_grid (grid, mask, ncol, nrow,
-                           x1, y1, x2, y2,
-                           faults, nfaults,
-                           in_grid, in_mask, pre_fault_ncol, pre_fault_nrow,
-                           x1, y1, x2, y2, GRD_BICUBIC);
-        ncol = pre_fault_ncol;
-        nrow = pre_fault_nrow;
-        Xspace = (x2 - x1) / (CSW_F)(ncol - 1);
-        Yspace = (y2 - y1) / (CSW_F)(nrow - 1);
-        if (FlatGridFlag == 1) {
-            grd_utils_ptr->grd_constant_grid (in_grid, NULL, ncol, nrow, z[0]);
-        }
-        grid = in_grid;
-        mask = in_mask;
-        orig_ncol = pre_fault_ncol;
-        orig_nrow = pre_fault_nrow;
-        ncol = orig_ncol;
-        nrow = orig_nrow;
-        csw_Free (local_grid);
-        csw_Free (local_mask);
-        local_grid = NULL;
-        local_mask = NULL;
+  ****************************************************************
+
+            S e s s i o n T a b l e K e y M a t c h e s
+
+  ****************************************************************
+
+    Return 1 if the gridding session has valid data tables that were
+  calculated from the same points and geometry as the current
+  calculation, or zero if not.  The Zdata values must still be the
+  values from before the data table is set up.
+
+*/
+
+int CSWGrdCalc::SessionTableKeyMatches (void)
+{
+    size_t         nbytes;
+
+    if (SessionTablesUsable () == 0  ||  Session.table_valid == 0) {
+        return 0;
     }
 
-    if (faults) {
-        grd_fault_ptr->grd_free_fault_line_structs (faults, nfaults);
-        faults = NULL;
-        nfaults = 0;
+    if (Session.ndata != Ndata  ||
+        Session.ncol != Ncol  ||  Session.nrow != Nrow  ||
+        Session.nccol != Nccol  ||  Session.ncrow != Ncrow  ||
+        Session.ncoarse != Ncoarse  ||
+        Session.orig_ncol != OrigNcol  ||  Session.orig_nrow != OrigNrow  ||
+        Session.thickness_flag != ThicknessFlag  ||
+        Session.noisy_in != NoisyDataFlag  ||
+        Session.search_engine != SearchEngine) {
+        return 0;
     }
 
-/*
-    If the BaselapFlag is true, clip the grid to the baselap surface.
-*/
-    if (BaselapFlag == 1) {
-        ClippingGrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
-        if (!ClippingGrid) {
-            grd_utils_ptr->grd_set_err (1);
-            TinySum = 0.0;
-            return -1;
-        }
-        grd_arith_ptr->grd_resample_grid (BaselapGrid.grid,
-                           NULL,
-                           BaselapGrid.ncol,
-                           BaselapGrid.nrow,
-                           BaselapGrid.x1,
-                           BaselapGrid.y1,
-                           BaselapGrid.x2,
-                           BaselapGrid.y2,
-                           NULL, 0,
-                           ClippingGrid, NULL, orig_ncol, orig_nrow,
-                           OrigXmin, OrigYmin, OrigXmax, OrigYmax, GRD_BICUBIC);
-        for (k=0; k<orig_ncol*orig_nrow; k++) {
-            if (grid[k] < ClippingGrid[k]) {
-                grid[k] = ClippingGrid[k];
-                if (mask) {
-                    mask[k] = GRD_MASK_INVALID_OUTSIDE;
-                }
-            }
-        }
-        csw_Free (ClippingGrid);
-        ClippingGrid = NULL;
+    if (Session.xmin != Xmin  ||  Session.ymin != Ymin  ||
+        Session.xmax != Xmax  ||  Session.ymax != Ymax  ||
+        Session.xspace != Xspace  ||  Session.yspace != Yspace  ||
+        Session.orig_xmin != OrigXmin  ||  Session.orig_ymin != OrigYmin  ||
+        Session.orig_xmax != OrigXmax  ||  Session.orig_ymax != OrigYmax) {
+        return 0;
     }
 
-/*
-    If the TruncationFlag is true, clip the grid to the truncation surface.
-*/
-    if (TruncationFlag == 1) {
-        ClippingGrid = (CSW_F *)csw_Malloc (orig_ncol * orig_nrow * sizeof(CSW_F));
-        if (!ClippingGrid) {
-            grd_utils_ptr->grd_set_err (1);
-            TinySum = 0.0;
-            return -1;
-        }
-        grd_arith_ptr->grd_resample_grid (TruncationGrid.grid,
-                           NULL,
-                           TruncationGrid.ncol,
-                           TruncationGrid.nrow,
-                           TruncationGrid.x1,
-                           TruncationGrid.y1,
-                           TruncationGrid.x2,
-                           TruncationGrid.y2,
-                           NULL, 0,
-                           ClippingGrid, NULL, orig_ncol, orig_nrow,
-                           OrigXmin, OrigYmin, OrigXmax, OrigYmax, GRD_BICUBIC);
-        for (k=0; k<orig_ncol*orig_nrow; k++) {
-            if (grid[k] > ClippingGrid[k]) {
-                grid[k] = ClippingGrid[k];
-                if (mask) {
-                    mask[k] = GRD_MASK_INVALID_OUTSIDE;
-                }
-            }
-        }
-        csw_Free (ClippingGrid);
-        ClippingGrid = NULL;
+    nbytes = Ndata * sizeof(CSW_F);
+    if (memcmp (Session.xdata, Xdata, nbytes) != 0  ||
+        memcmp (Session.ydata, Ydata, nbytes) != 0  ||
+        memcmp (Session.zdata_in, Zdata, nbytes) != 0) {
+        return 0;
     }
 
-/*
- * Clip the output grid to any min and max specified in the options.
- * The min or max may have been changed for a thickness grid so they
- * are reset prior to the clipping.
- */
-    if (GridMinValue < orig_min_val) GridMinValue = orig_min_val;
-    if (GridMaxValue > orig_max_val) GridMaxValue = orig_max_val;
+    return 1;
 
-    ClipOutputGridToMinMax (grid, ncol, nrow);
+}  /*  end of private SessionTableKeyMatches function  */
 
-/*
- * The grid is now finished and stored in the grid array (same as in_grid).
- * The remainder of this function is used for error estimation at input points
- * and for report generation.
- */
-    if (err) {
 
-        fistat = 0;
-        if (FaultedFlag) {
-            fistat = grd_fault_ptr->grd_build_fault_indices (
-                grid, ncol, nrow,
-                OrigXmin, OrigYmin, OrigXmax, OrigYmax);
-        }
-        if (FaultedFlag  &&  fistat == 1) {
-            if (ncol > 3  &&  nrow > 3) {
-                istat = grd_fault_ptr->grd_build_fault_indices (
-                    grid, ncol, nrow,
-                    OrigXmin, OrigYmin, OrigXmax, OrigYmax);
-                grd_fault_ptr->grd_back_interpolate_faulted (grid, ncol, nrow,
-                                              OrigXmin, OrigYmin, OrigXmax, OrigYmax,
-                                              Xdata, Ydata, Zerr, Ndata,
-                                              GRD_BILINEAR);
-            }
-            else {
-                for (i=0; i<Ndata; i++) {
-                    Zerr[i] = 1.e30f;
-                }
-            }
-        }
-        else {
-            grd_arith_ptr->grd_back_interpolate (grid, ncol, nrow,
-                                  OrigXmin, OrigYmin, OrigXmax, OrigYmax,
-                                  NULL, 0,
-                                  Xdata, Ydata, Zerr, Ndata, GRD_BILINEAR);
-        }
-        MaxError = -1.e30f;
-        for (i=0; i<Ndata; i++) {
-            if (Zerr[i] < 1.e20f) {
-                Zerr[i] -= Zdata[i];
-                ftmp = Zerr[i];
-                if (ftmp < 0.0f)
-                    ftmp = - ftmp;
-                if (ftmp > MaxError)
-                    MaxError = ftmp;
-            }
-            else {
-                Zerr[i] = 0.0f;
-            }
-        }
-        if (FaultedFlag  &&  fistat == 1) {
-            if (ncol > 3  &&  nrow > 3) {
-                grd_fault_ptr->grd_back_interpolate_faulted (grid, ncol, nrow,
-                                              OrigXmin, OrigYmin, OrigXmax, OrigYmax,
-                                              Xdata, Ydata, ZerrBC, Ndata, GRD_BICUBIC);
-            }
-            else {
-                for (i=0; i<Ndata; i++) {
-                    ZerrBC[i] = 1.e30f;
-                }
-            }
-        }
-        else {
-            grd_arith_ptr->grd_back_interpolate (grid, ncol, nrow,
-                                  OrigXmin, OrigYmin, OrigXmax, OrigYmax,
-                                  NULL, 0,
-                                  Xdata, Ydata, ZerrBC, Ndata, GRD_BICUBIC);
-        }
-        for (i=0; i<Ndata; i++) {
-            if (ZerrBC[i] < 1.e20f) {
-                ZerrBC[i] -= Zdata[i];
-            }
-            else {
-                ZerrBC[i] = 0.0f;
-            }
-        }
 
-    /*
-        Copy the errors to the output array if needed.
-    */
-        if (FlatGridFlag == 0) {
-            memcpy (err, Zerr, npts*sizeof(CSW_F));
-        }
-    }
 
 /*
-    Generate a report if needed.
+  ****************************************************************
+
+                L o a d S e s s i o n T a b l e s
+
+  ****************************************************************
+
+    If the gridding session has data tables calculated from the same
+  points and geometry as the current calculation, allocate the work
+  space and copy the tables into it.  This replaces the SetupDataTable
+  and SetupDistanceTable calls at the start of the calculation.
+
+    Returns 1 if the tables were loaded, zero if they need to be
+  calculated or -1 on a memory allocation failure.
+
 */
-    if (report) {
 
-    /*
-        Find grid min/max for report.
-    */
-        if (FlatGridFlag == 0) {
-            Gmin = 1.e30f;
-            Gmax = -1.e30f;
-            for (i=0; i<nrow; i++) {
-                offset = i * ncol;
-                for (j=0; j<ncol; j++) {
-                    k = offset + j;
-                    if (grid[k] < Gmin) {
-                        Gmin = grid[k];
-                        Rminrow = i;
-                        Rmincol = j;
-                        Rgxmin = OrigXmin + j * Xspace;
-                        Rgymin = OrigYmin + i * Yspace;
-                    }
-                    if (grid[k] > Gmax) {
-                        Gmax = grid[k];
-                        Rmaxrow = i;
-                        Rmaxcol = j;
-                        Rgxmax = OrigXmin + j * Xspace;
-                        Rgymax = OrigYmin + i * Yspace;
-                    }
-                }
-            }
-        }
-        else {
-            Gmin = z[0];
-            Gmax = z[0];
-        }
+int CSWGrdCalc::LoadSessionTables (void)
+{
+    size_t         nbytes;
 
-    /*
-        Write the report to a string and return it in the report pointer.
-    */
-        GenerateReport (report);
+    Session.table_hit = 0;
+
+    if (SessionTableKeyMatches () == 0) {
+        return 0;
     }
 
 /*
-    Make sure the points that were set as nearly on top of faults
-    are reset back to their original coordinates.
+    The key matches, so use the saved tables.
 */
-    if (FaultedFlag) {
-        grd_fault_ptr->grd_reset_fault_data_grazing (x, NULL, NULL);
+    nbytes = Ndata * sizeof(CSW_F);
+
+    if (AllocateWorkSpace () == -1) {
+        return -1;
     }
 
-    if (in_mask) {
-        if ((int)in_mask[0] == -3) {
-            in_mask[0] = -3;
+    memcpy (DataTable, Session.itable, Session.nitable * sizeof(int));
+    memcpy (Icoarse, Session.ctable, Session.nctable * sizeof(char));
+    memcpy (Zdata, Session.zdata_out, nbytes);
+
+    csw_Free (ExtraPoints);
+    ExtraPoints = NULL;
+    Nextra = 0;
+    if (Session.nextra > 0) {
+        ExtraPoints = (int *)csw_Malloc (Ndata * sizeof(int));
+        if (ExtraPoints == NULL) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        memcpy (ExtraPoints, Session.extra, Session.nextra * sizeof(int));
+        Nextra = Session.nextra;
+    }
+
+    FlatGridFlag = Session.flat_grid_flag;
+    NoisyDataFlag = Session.noisy_data_flag;
+    PointDensity = Session.point_density;
+    Rxmin = Session.rxmin;
+    Rymin = Session.rymin;
+    Rxmax = Session.rxmax;
+    Rymax = Session.rymax;
+    Xrange = Session.xrange;
+    Yrange = Session.yrange;
+    Zmin = Session.zmin;
+    Zmax = Session.zmax;
+    Zmean = Session.zmean;
+    ZminusVal = Session.zminus_val;
+    Zrange = Session.zrange;
+    Ztiny = Session.ztiny;
+
+    if (SearchEngine == GRD_PACKED_BUCKET_ENGINE) {
+        if (SetupPackedBuckets () == -1) {
+            return -1;
         }
     }
 
+    Session.table_hit = 1;
+
+    return 1;
+
+}  /*  end of private LoadSessionTables function  */
+
+
+
+
 /*
-    thats all folks.
+  ****************************************************************
+
+                S a v e S e s s i o n T a b l e s
+
+  ****************************************************************
+
+    Copy the data tables and their key values into the gridding
+  session.  This is called right after the tables have been built.
+  The z values and noisy data flag from before the tables were
+  built are in zin and noisy_in, since SetupDataTable may change
+  both of them.  If memory cannot be allocated for the copies,
+  the session tables are simply marked as not valid.
+
 */
-    TinySum = 0.0;
-    return 1;
 
-}  /*  end of function grd_calc_grid  */
+void CSWGrdCalc::SaveSessionTables (CSW_F *zin, int noisy_in)
+{
+    size_t         nbytes;
+    int            ntot;
+
+    if (SessionTablesUsable () == 0) {
+        return;
+    }
 
+    FreeSessionData ();
+    Session.active = 1;
 
+    Session.nitable = Ncol * Nrow * 2 + Ndata + 2 * Nrow;
+    Session.nctable = 2 * Nccol * Ncrow + 2 * Ncol * Nrow;
+    nbytes = Ndata * sizeof(CSW_F);
 
+    ntot = Ndata * 4;
+    Session.xdata = (CSW_F *)csw_Malloc (ntot * sizeof(CSW_F));
+    Session.itable = (int *)csw_Malloc ((Session.nitable + Ndata) * sizeof(int));
+    Session.ctable = (char *)csw_Malloc (Session.nctable * sizeof(char));
+    if (Session.xdata == NULL  ||  Session.itable == NULL  ||
+        Session.ctable == NULL) {
+        FreeSessionData ();
+        Session.active = 1;
+        return;
+    }
+    Session.ydata = Session.xdata + Ndata;
+    Session.zdata_in = Session.ydata + Ndata;
+    Session.zdata_out = Session.zdata_in + Ndata;
+    Session.extra = Session.itable + Session.nitable;
+
+    memcpy (Session.xdata, Xdata, nbytes);
+    memcpy (Session.ydata, Ydata, nbytes);
+    memcpy (Session.zdata_in, zin, nbytes);
+    memcpy (Session.zdata_out, Zdata, nbytes);
+    memcpy (Session.itable, DataTable, Session.nitable * sizeof(int));
+    memcpy (Session.ctable, Icoarse, Session.nctable * sizeof(char));
+    Session.nextra = 0;
+    if (ExtraPoints != NULL  &&  Nextra > 0) {
+        memcpy (Session.extra, ExtraPoints, Nextra * sizeof(int));
+        Session.nextra = Nextra;
+    }
+
+    Session.ndata = Ndata;
+    Session.ncol = Ncol;
+    Session.nrow = Nrow;
+    Session.nccol = Nccol;
+    Session.ncrow = Ncrow;
+    Session.ncoarse = Ncoarse;
+    Session.orig_ncol = OrigNcol;
+    Session.orig_nrow = OrigNrow;
+    Session.thickness_flag = ThicknessFlag;
+    Session.noisy_in = noisy_in;
+    Session.search_engine = SearchEngine;
+    Session.xmin = Xmin;
+    Session.ymin = Ymin;
+    Session.xmax = Xmax;
+    Session.ymax = Ymax;
+    Session.xspace = Xspace;
+    Session.yspace = Yspace;
+    Session.orig_xmin = OrigXmin;
+    Session.orig_ymin = OrigYmin;
+    Session.orig_xmax = OrigXmax;
+    Session.orig_ymax = OrigYmax;
+
+    Session.flat_grid_flag = FlatGridFlag;
+    Session.noisy_data_flag = NoisyDataFlag;
+    Session.point_density = PointDensity;
+    Session.rxmin = Rxmin;
+    Session.rymin = Rymin;
+    Session.rxmax = Rxmax;
+    Session.rymax = Rymax;
+    Session.xrange = Xrange;
+    Session.yrange = Yrange;
+    Session.zmin = Zmin;
+    Session.zmax = Zmax;
+    Session.zmean = Zmean;
+    Session.zminus_val = ZminusVal;
+    Session.zrange = Zrange;
+    Session.ztiny = Ztiny;
+
+    Session.table_valid = 1;
+
+    return;
 
+}  /*  end of private SaveSessionTables function  */
 
 
 
@@ -2170,397 +4018,210 @@ if (WorkMargin < 16) WorkMargin = 16;
 /*
   ****************************************************************
 
-                   S e t u p D a t a T a b l e
+              L o a d S e s s i o n E m p t y A r e a
 
   ****************************************************************
 
-    Set up the DataTable grid and the link list of pointers to
-  data points that occupy each grid cell.
+    If the session data tables match the current data and the empty
+  area grid was made with the same option values, copy the saved
+  empty area grid instead of calling AddPointsToEmptyRegions.  This
+  must be called before the data table is set up.  Returns 1 if the
+  empty area grid was loaded or zero if it needs to be calculated.
 
 */
 
-int CSWGrdCalc::SetupDataTable (int zflag, int first)
+int CSWGrdCalc::LoadSessionEmptyArea (void)
 {
-    int            *lastpoint = NULL, icc, icr, ic, ir, idx, izc, izr,
-                   i, nmax, ncells, nmean, zeroflag;
-    int            idxc;
-    CSW_F          x1, y1, x2, y2, xspacec, yspacec;
-    CSW_F          xt, yt;
-    CSW_F          *bin_min = NULL, *bin_max = NULL;
+    CSW_F          *grid = NULL;
 
-    bool      bsuccess = false;
+    if (Session.empty_valid == 0  ||  SessionTableKeyMatches () == 0) {
+        return 0;
+    }
 
-    auto fscope = [&]()
-    {
-        csw_Free (lastpoint);
-        csw_Free (bin_min);
-        if (bsuccess == false) {
-            FreeMem ();
+    if (Session.empty_anisotropy_in != AnisotropyFlag  ||
+        Session.triangulate_in != TriangulateFlag  ||
+        Session.empty_region_in != EmptyRegionFlag) {
+        return 0;
+    }
+
+    if (Session.empty_grid != NULL) {
+        grid = (CSW_F *)csw_Malloc (Nccol * Ncrow * sizeof(CSW_F));
+        if (grid == NULL) {
+            return 0;
         }
-    };
-    CSWScopeGuard func_scope_guard (fscope);
+        memcpy (grid, Session.empty_grid, Nccol * Ncrow * sizeof(CSW_F));
+    }
 
+    csw_Free (EmptyAreaGrid);
+    EmptyAreaGrid = grid;
+    Npass1 = 0;
 
-    zeroflag = 0;
-    if (zflag == 1  &&  ThicknessFlag == 1) zeroflag = 1;
+    return 1;
 
-    if (first == 1) {
+}  /*  end of private LoadSessionEmptyArea function  */
 
-    /*
-        Allocate space for the private work arrays.
-    */
-        if (true) {
-            nmax = Ncol * Nrow * 5 + Nccol * Ncrow * 6 + Ndata * 2;
-MSL
-            Grid = (CSW_F *)csw_Malloc (nmax * sizeof (CSW_F));
-            if (!Grid) {
-                grd_utils_ptr->grd_set_err (1);
-                return -1;
-            }
 
-            nmax = Ncol * Nrow * 2 + Ndata + 2 * Nrow;
-MSL
-            DataTable = (int *)csw_Malloc (nmax * sizeof(int));
-            if (!DataTable) {
-                grd_utils_ptr->grd_set_err (1);
-                return -1;
-            }
 
-            nmax = 2 * Nccol * Ncrow + 2 * Ncol * Nrow;
-MSL
-            Icoarse = (char *)csw_Calloc (nmax * sizeof(char));
-            if (!Icoarse) {
-                grd_utils_ptr->grd_set_err (1);
-                return -1;
-            }
 
-        /*
-            assign various pointers into the allocated space.
-        */
-            Gwork1 = Grid + Ncol * Nrow;
-            Gwork2 = Gwork1 + Ncol * Nrow;
-            Gwork3 = Gwork2 + Ncol * Nrow;
-            TrendGrid = Gwork3 + Ncol * Nrow;
-            AratioGrid = TrendGrid + Nccol * Ncrow;
-            AnisoStrike = AratioGrid + Nccol * Ncrow;
-            AnisoPower = AnisoStrike + Nccol *Ncrow;
-            Zerr = AnisoPower + Nccol * Ncrow;
-            ZerrBC = Zerr + Ndata;
-            ShapeGrid = ZerrBC + Ndata;
-            DifferenceGrid = ShapeGrid + Ncol * Nrow;
+/*
+  ****************************************************************
 
-            ClosestPoint = DataTable + Ncol * Nrow;
-            LinkList = ClosestPoint + Ncol * Nrow;
-            Left = LinkList + Ndata;
-            Right = Left + Nrow;
+              S a v e S e s s i o n E m p t y A r e a
 
-            NodeMask = Icoarse + Nccol * Ncrow;
-            ZeroCoarse = NodeMask + Ncol * Nrow;
-        }
+  ****************************************************************
 
-    }
+    Save the empty area grid made by AddPointsToEmptyRegions along
+  with the anisotropy flag it was made with.  This is called after
+  the session tables are saved or loaded, since saving the tables
+  clears the rest of the session.
 
-/*
-    allocate a temporary array to use while building
-    the link lists for data in each cell
 */
-MSL
-    lastpoint = (int *)csw_Malloc (Ncol * Nrow * sizeof(int));
-    if (!lastpoint) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
-    }
 
-/*
-    initialize some of the workspace arrays
-*/
-    for (i=0; i<Ncol*Nrow; i++) {
-        DataTable[i] = -1;
-    }
-    if (first == 1) {
-        for (i=0; i<Ncol*Nrow; i++) {
-            Grid[i] = 1.e30f;
-        }
+void CSWGrdCalc::SaveSessionEmptyArea (int anisotropy_in)
+{
+
+    if (Session.table_valid == 0  ||  SessionTablesUsable () == 0) {
+        return;
     }
 
-    memset ((char *)ClosestPoint, 0, Ncol*Nrow*sizeof(int));
-    memset ((char *)Icoarse, 0, Nccol*Ncrow*sizeof(char));
-    memset ((char *)ZeroCoarse, 0, Nccol*Ncrow*sizeof(char));
+    Session.empty_valid = 0;
+    csw_Free (Session.empty_grid);
+    Session.empty_grid = NULL;
 
-/*
-  Allocate and initialize the nosy data bins (min and max in each bin).
-*/
-    bool bnoise = false;
-    if (NoisyDataFlag == 0) {
-      bin_min = (CSW_F *)csw_Malloc (Nccol * Ncrow * 2 * sizeof(CSW_F));
-      if (bin_min == NULL) {
-        return -1;
-      }
-      bin_max = bin_min + Nccol * Ncrow;
-      for (i=0; i<Nccol * Ncrow; i++) {
-        bin_min[i] = 1.e30;
-        bin_max[i] = -1.e30;
-      }
-      bnoise = true;
+    if (EmptyAreaGrid != NULL) {
+        Session.empty_grid = (CSW_F *)csw_Malloc (Nccol * Ncrow * sizeof(CSW_F));
+        if (Session.empty_grid == NULL) {
+            return;
+        }
+        memcpy (Session.empty_grid, EmptyAreaGrid, Nccol * Ncrow * sizeof(CSW_F));
     }
 
-/*
-    build the data table and link list
-*/
-    Zmin = 1.e30f;
-    Zmax = -1.e30f;
-    x1 = 1.e30f;
-    y1 = 1.e30f;
-    x2 = -1.e30f;
-    y2 = -1.e30f;
-    Zmean = 0.0f;
-    nmean = 0;
-    ncells = 0;
-    xspacec = Xspace * Ncoarse;
-    yspacec = Yspace * Ncoarse;
+    Session.empty_anisotropy_in = anisotropy_in;
+    Session.triangulate_in = TriangulateFlag;
+    Session.empty_region_in = EmptyRegionFlag;
+    Session.empty_valid = 1;
 
-    for (i=0; i<Ndata; i++) {
+    return;
 
-        if (Xdata[i] < x1) x1 = Xdata[i];
-        if (Ydata[i] < y1) y1 = Ydata[i];
-        if (Xdata[i] > x2) x2 = Xdata[i];
-        if (Ydata[i] > y2) y2 = Ydata[i];
+}  /*  end of private SaveSessionEmptyArea function  */
 
-    /*
-        If the thickness flag is set, no negative z values are allowed.
-    */
-        if (ThicknessFlag == 1) {
-            if (Zdata[i] < 0.0f) Zdata[i] = 0.0f;
 
-        /*
-            Set the closest node in the coarse zero grid to 1.
-            This is used to control extrapolation from the non
-            zero data area.
-        */
-            if (Zdata[i] <= 0.0f  &&  first == 1) {
-                izc = (int) ((Xdata[i] - Xmin) / xspacec + 0.5f);
-                izr = (int) ((Ydata[i] - Ymin) / yspacec + 0.5f);
-                if (izc >= 0  &&  izr >= 0  &&  izc < Nccol  &&  izr < Ncrow) {
-                    ZeroCoarse[izr*Nccol + izc] = 1;
-                }
-            }
-        }
 
-    /*
-        If the zeroflag is set, no zero or very near zero
-        values are indexed.
-    */
-        if (zeroflag == 1  &&  Zdata[i] <= 0.0f) {
-            continue;
-        }
 
-        if (Xdata[i] < Xmin  ||  Xdata[i] > Xmax  ||
-            Ydata[i] < Ymin  ||  Ydata[i] > Ymax) {
-        /*
-         * Bug 9735 fix, update z limits even if the point
-         * is not in the area of interest.
-         */
-            if (Zdata != NULL) {
-                if (Zdata[i] < Zmin) Zmin = Zdata[i];
-                if (Zdata[i] > Zmax) Zmax = Zdata[i];
-            }
-            AddToExtraPoints (i);
-            continue;
-        }
+/*
+  ****************************************************************
 
-        if (Zdata[i] < Zmin) {
-            Zmin = Zdata[i];
-            Rxmin = Xdata[i];
-            Rymin = Ydata[i];
-        }
-        if (Zdata[i] > Zmax) {
-            Zmax = Zdata[i];
-            Rxmax = Xdata[i];
-            Rymax = Ydata[i];
-        }
-        Zmean += Zdata[i];
-        nmean++;
+                 L o a d S e s s i o n T r e n d
 
-    /*
-        which detail grid cell holds the point
-    */
-        ic = (int) ((Xdata[i] - Xmin) / Xspace);
-        if (ic < 0  ||  ic >= Ncol) {
-        /*
-         * Bug 9735 fix, update z limits even if the point
-         * is not in the area of interest.
-         */
-            if (Zdata != NULL) {
-                if (Zdata[i] < Zmin) Zmin = Zdata[i];
-                if (Zdata[i] > Zmax) Zmax = Zdata[i];
-            }
-            AddToExtraPoints (i);
-            continue;
-        }
-        ir = (int) ((Ydata[i] - Ymin) / Yspace);
-        if (ir < 0  ||  ir >= Nrow) {
-        /*
-         * Bug 9735 fix, update z limits even if the point
-         * is not in the area of interest.
-         */
-            if (Zdata != NULL) {
-                if (Zdata[i] < Zmin) Zmin = Zdata[i];
-                if (Zdata[i] > Zmax) Zmax = Zdata[i];
-            }
-            AddToExtraPoints (i);
-            continue;
-        }
+  ****************************************************************
 
-    /*
-        set the coarse grid cell to occupied
-    */
-        icc = ic / Ncoarse;
-        icr = ir / Ncoarse;
-        idxc = Nccol * icr + icc;
-        *(Icoarse + idxc) = 1;
+    If the data tables came from the gridding session and the trend
+  surface was calculated with the same option values, copy the saved
+  trend grid and the values FitBestTrendSurface sets.  Returns 1 if
+  the trend was loaded or zero if it needs to be calculated.
 
-    /*
-        Set the detail grid data table and link list
-    */
-        idx = ic + Ncol * ir;
-        if (DataTable[idx] == -1) {
-            DataTable[idx] = i;
-            LinkList[i] = -1;
-            ncells++;
-        }
-        else {
-            LinkList[lastpoint[idx]] = i;
-            LinkList[i] = -1;
-        }
-        lastpoint[idx] = i;
+*/
 
-    /*
-       Update the bin min and max values.
-    */
-        if (bnoise) {
-          CSW_F  zt = Zdata[i];
-          if (zt < 1.e20  &&  zt > -1.e20) {
-            if (zt < bin_min[idxc]) bin_min[idxc] = zt;
-            if (zt > bin_max[idxc]) bin_max[idxc] = zt;
-          }
-        }
+int CSWGrdCalc::LoadSessionTrend (void)
+{
 
+    if (Session.table_hit == 0  ||  Session.trend_valid == 0) {
+        return 0;
     }
 
-/*
- * Check if data are noisy.  This is pretty much empirical.
- */
-    if (bnoise && Zmax > Zmin) {
-      CSW_F zt;
-      int ng4 = 0;
-      CSW_F  zr4 = (Zmax - Zmin) / 3.0;
-      for (i=0; i<Nccol*Ncrow; i++) {
-        if (bin_min[i] < bin_max[i]) {
-          zt = bin_max[i] - bin_min[i];
-          if (zt > zr4) {
-            ng4++;
-          }
-        }
-      }
-      if (ng4 > Nccol * Ncrow / 10) {
-        CSW_F  nprat = (CSW_F)Ndata / 100000.0;
-        if (nprat > 1.5) nprat = 1.5;
-        if (nprat < .05) nprat = .05;
-        CSW_F  drat = (CSW_F)ng4 / (CSW_F)(Nccol * Ncrow);
-        NoisyDataFlag = (int)(drat * 10.0 * nprat + 1.5);
-      }
-    }
-    else {
-      if (NoisyDataFlag == 1) NoisyDataFlag = 10;
+    if (Session.anisotropy_in != AnisotropyFlag  ||
+        Session.smoothing_in != SmoothingFactor  ||
+        Session.strike_in != PreferredStrike) {
+        return 0;
     }
 
-/*
- * Add the control points if specified.
- */
-    if (UseControlInDataTable == 1) {
+    memcpy (TrendGrid, Session.trend_grid, Nccol * Ncrow * sizeof(CSW_F));
+    InLineFlag = Session.in_line_flag;
+    TrendDistance = Session.trend_distance;
+    AnisotropyFlag = Session.anisotropy_flag;
+    SmoothingFactor = Session.smoothing_factor;
+    PreferredStrike = Session.preferred_strike;
+
+    return 1;
+
+}  /*  end of private LoadSessionTrend function  */
 
-        for (i=0; i<NumControlPoints; i++) {
 
-            xt = ControlPoints[i].x;
-            yt = ControlPoints[i].y;
 
-            if (xt < Xmin  ||  xt > Xmax  ||
-                yt < Ymin  ||  yt > Ymax) {
-                continue;
-            }
 
-        /*
-            which detail grid cell holds the point
-        */
-            ic = (int) ((xt - Xmin) / Xspace);
-            if (ic < 0  ||  ic >= Ncol) {
-                continue;
-            }
-            ir = (int) ((yt - Ymin) / Yspace);
-            if (ir < 0  ||  ir >= Nrow) {
-                continue;
-            }
+/*
+  ****************************************************************
 
-        /*
-            set the coarse grid cell to occupied
-        */
-            icc = ic / Ncoarse;
-            icr = ir / Ncoarse;
-            *(Icoarse + icc + Nccol * icr) = 1;
+                 S a v e S e s s i o n T r e n d
 
-        /*
-            Set the detail grid data table and link list
-        */
-            idx = ic + Ncol * ir;
-            if (DataTable[idx] == -1) {
-                DataTable[idx] = i;
-                LinkList[i] = -1;
-                ncells++;
-            }
-            else {
-                LinkList[lastpoint[idx]] = i;
-                LinkList[i] = -1;
-            }
-            lastpoint[idx] = i;
-        }
+  ****************************************************************
 
-    } /* end of control point if block */
+    Save the trend grid just calculated by FitBestTrendSurface along
+  with the option values that were used to calculate it.  The values
+  in the key are the values before FitBestTrendSurface was called.
 
-    if (x1 < OrigXmin) x1 = OrigXmin;
-    if (x2 > OrigXmax) x2 = OrigXmax;
-    if (y1 < OrigYmin) y1 = OrigYmin;
-    if (y2 > OrigYmax) y2 = OrigYmax;
-    Xrange = x2 - x1;
-    Yrange = y2 - y1;
-    Zrange = Zmax - Zmin;
-    if (ThicknessFlag == 1) {
-        Zrange = Zmax;
-    }
-    ZminusVal = Zrange / 2.0f;
-    ZminusVal = -ZminusVal;
-    Ztiny = Zrange / 100000.0f;
-    if (nmean > 0) {
-        Zmean /= (CSW_F)nmean;
+*/
+
+void CSWGrdCalc::SaveSessionTrend (int anisotropy_in,
+                                   CSW_F smoothing_in, CSW_F strike_in)
+{
+
+    if (Session.table_valid == 0  ||  SessionTablesUsable () == 0) {
+        return;
     }
-    if (Zrange <= 0.0) {
-        FlatGridFlag = 1;
+
+    Session.trend_valid = 0;
+    if (Session.trend_grid == NULL) {
+        Session.trend_grid = (CSW_F *)csw_Malloc (Nccol * Ncrow * sizeof(CSW_F));
+        if (Session.trend_grid == NULL) {
+            return;
+        }
     }
 
+    memcpy (Session.trend_grid, TrendGrid, Nccol * Ncrow * sizeof(CSW_F));
+    Session.anisotropy_in = anisotropy_in;
+    Session.smoothing_in = smoothing_in;
+    Session.strike_in = strike_in;
+    Session.in_line_flag = InLineFlag;
+    Session.trend_distance = TrendDistance;
+    Session.anisotropy_flag = AnisotropyFlag;
+    Session.smoothing_factor = SmoothingFactor;
+    Session.preferred_strike = PreferredStrike;
+    Session.trend_valid = 1;
+
+    return;
+
+}  /*  end of private SaveSessionTrend function  */
+
+
+
+
 /*
-    The point density is used to determine how far
-    to extend the coarse grid outward from well controlled
-    areas.  The extension is done after the local nodes
-    are calculated by extrapolating local node gradients
-    to neighboring uncalculated nodes.
+  ****************************************************************
+
+                  F r e e S e s s i o n D a t a
+
+  ****************************************************************
+
+    Free the gridding session copies and reset the session to its
+  inactive state.
+
 */
-    PointDensity = (CSW_F)ncells / (CSW_F)(OrigNcol * OrigNrow);
 
-    bsuccess = true;
+void CSWGrdCalc::FreeSessionData (void)
+{
 
-    return 1;
+    csw_Free (Session.xdata);
+    csw_Free (Session.itable);
+    csw_Free (Session.ctable);
+    csw_Free (Session.empty_grid);
+    csw_Free (Session.trend_grid);
 
+    memset (&Session, 0, sizeof(CAlcSessionStruct));
 
-}  /*  end of private SetupDataTable function  */
+    return;
+
+}  /*  end of private FreeSessionData function  */
 
 
 
@@ -2749,10 +4410,439 @@ int CSWGrdCalc::SetupDistanceTable (void)
         }
     }
 
-    return 1;
+    return 1;
+
+}  /*  end of private SetupDistanceTable function  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+              C o l l e c t L o c a l P o i n t s
+
+  ****************************************************************
+
+    Return the points surrounding the specified grid node.  If a
+  multiple attribute calculation is sharing its local point lists,
+  a list recorded earlier for the same node and search parameters
+  is used when there is one.  Otherwise SearchLocalPoints does the
+  search, and the result is recorded for the later attributes.
+
+    The lists are only shared when the search depends on nothing
+  but the data locations.  Faulted, anisotropic and preferred
+  strike searches always use SearchLocalPoints.
+
+*/
+
+int CSWGrdCalc::CollectLocalPoints
+          (int i, int j, int start, int end,
+           int maxquad, int maxloc,
+           int *listout, int *nlist, int *nquad,
+           LOcalNodeWork *wk)
+{
+    int              istat, ishare;
+
+    ishare = 0;
+    if (SharedSearch.mode != 0  &&  SharedSearch.itable >= 0  &&
+        FaultedFlag == 0  &&  PreferredStrike < 0  &&
+        AnisotropyFlag == 0) {
+        ishare = 1;
+    }
+
+    if (ishare == 1) {
+        istat = ReplaySharedList (i, j, start, end, maxquad, maxloc,
+                                  listout, nlist, nquad, wk);
+        if (istat == 1) {
+            return 1;
+        }
+    }
+
+    istat = SearchLocalPoints (i, j, start, end, maxquad, maxloc,
+                               listout, nlist, nquad, wk);
+
+    if (ishare == 1) {
+        RecordSharedList (i, j, start, end, maxquad, maxloc,
+                          listout, *nlist, *nquad, wk);
+    }
+
+    return istat;
+
+}  /*  end of private CollectLocalPoints function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+               S t a r t S h a r e d S e a r c h
+
+  ****************************************************************
+
+    Called each time the data table and distance table have been
+  set up during a grid calculation.  If local point lists are being
+  shared, this selects the set of lists to use with the new tables.
+  For the first attribute, a new set is started with a copy of the
+  table contents.  For the later attributes, the recorded set is
+  used only if its copy matches the new tables exactly.  If no set
+  can be used, SharedSearch.itable is set to -1 and the searches
+  are done as usual.
+
+*/
+
+void CSWGrdCalc::StartSharedSearch (void)
+{
+    int              k, n, ip, ntab;
+    SHaredListTable  *tp;
+
+    if (SharedSearch.mode == 0) {
+        return;
+    }
+
+    k = SharedSearch.ibuild;
+    SharedSearch.ibuild++;
+    SharedSearch.itable = -1;
+
+    if (k >= MAX_SHARED_TABLES) {
+        return;
+    }
+    if (NumControlPoints > 0  ||  UseControlInDataTable  ||
+        FaultedFlag  ||  DataTable == NULL  ||  LinkList == NULL) {
+        return;
+    }
+
+    tp = SharedSearch.tables + k;
+    ntab = Ncol * Nrow;
+
+/*
+    Check the recorded copy against the current tables.
+*/
+    if (k < SharedSearch.ntables) {
+        if (tp->rows == NULL) {
+            return;
+        }
+        if (tp->ncol != Ncol  ||  tp->nrow != Nrow  ||
+            tp->ndata != Ndata  ||
+            tp->search_engine != SearchEngine  ||
+            tp->search_pattern != LocalSearchPattern  ||
+            tp->num_local != NumLocalPoints  ||
+            tp->max_distance != MaxNodeDistance  ||
+            tp->xmin != Xmin  ||  tp->ymin != Ymin  ||
+            tp->xspace != Xspace  ||  tp->yspace != Yspace) {
+            return;
+        }
+        if (memcmp (tp->table, DataTable, ntab * sizeof(int)) != 0  ||
+            memcmp (tp->xdata, Xdata, Ndata * sizeof(CSW_F)) != 0  ||
+            memcmp (tp->ydata, Ydata, Ndata * sizeof(CSW_F)) != 0) {
+            return;
+        }
+        for (n=0; n<ntab; n++) {
+            ip = DataTable[n];
+            while (ip >= 0) {
+                if (ip >= Ndata  ||  tp->table[ntab+ip] != LinkList[ip]) {
+                    return;
+                }
+                ip = LinkList[ip];
+            }
+        }
+        SharedSearch.itable = k;
+        return;
+    }
+
+/*
+    Only the first attribute records new sets of lists.
+*/
+    if (k > SharedSearch.ntables  ||  SharedSearch.mode != 1) {
+        return;
+    }
+    SharedSearch.ntables = k + 1;
+
+    tp->ncol = Ncol;
+    tp->nrow = Nrow;
+    tp->ndata = Ndata;
+    tp->search_engine = SearchEngine;
+    tp->search_pattern = LocalSearchPattern;
+    tp->num_local = NumLocalPoints;
+    tp->max_distance = MaxNodeDistance;
+    tp->row_limit = MAX_SHARED_POINTS / Nrow;
+    tp->xmin = Xmin;
+    tp->ymin = Ymin;
+    tp->xspace = Xspace;
+    tp->yspace = Yspace;
+
+MSL
+    tp->table = (int *)csw_Malloc ((ntab + Ndata) * sizeof(int));
+MSL
+    tp->xdata = (CSW_F *)csw_Malloc (Ndata * 2 * sizeof(CSW_F));
+MSL
+    tp->rows = (SHaredListRow *)csw_Calloc (Nrow * sizeof(SHaredListRow));
+    if (tp->table == NULL  ||  tp->xdata == NULL  ||  tp->rows == NULL) {
+        csw_Free (tp->table);
+        csw_Free (tp->xdata);
+        csw_Free (tp->rows);
+        memset (tp, 0, sizeof(SHaredListTable));
+        return;
+    }
+    tp->ydata = tp->xdata + Ndata;
+
+    memcpy (tp->table, DataTable, ntab * sizeof(int));
+    memcpy (tp->xdata, Xdata, Ndata * sizeof(CSW_F));
+    memcpy (tp->ydata, Ydata, Ndata * sizeof(CSW_F));
+
+/*
+    Only the links reachable from the data table are used, so
+    only those are copied.
+*/
+    for (n=0; n<Ndata; n++) {
+        tp->table[ntab+n] = -1;
+    }
+    for (n=0; n<ntab; n++) {
+        ip = DataTable[n];
+        while (ip >= 0) {
+            if (ip >= Ndata) {
+                csw_Free (tp->table);
+                csw_Free (tp->xdata);
+                csw_Free (tp->rows);
+                memset (tp, 0, sizeof(SHaredListTable));
+                return;
+            }
+            tp->table[ntab+ip] = LinkList[ip];
+            ip = LinkList[ip];
+        }
+    }
+
+    SharedSearch.itable = k;
+
+    return;
+
+}  /*  end of private StartSharedSearch function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+               R e p l a y S h a r e d L i s t
+
+  ****************************************************************
+
+    Look for a recorded list with the same node and search parameters.
+  If one is found, put it and the other search results into the output
+  and work structure exactly as SearchLocalPoints would, and return 1.
+  Return zero if there is no such list.
+
+    Each row of recorded lists is only used by the task that is
+  calculating that row, so no locking is needed.
+
+*/
+
+int CSWGrdCalc::ReplaySharedList
+          (int i, int j, int start, int end,
+           int maxquad, int maxloc,
+           int *listout, int *nlist, int *nquad,
+           LOcalNodeWork *wk)
+{
+    int                k;
+    SHaredListTable    *tp;
+    SHaredListRow      *rp;
+    SHaredListRecord   *rec;
+
+    tp = SharedSearch.tables + SharedSearch.itable;
+    if (i < 0  ||  i >= tp->nrow  ||  j < 0  ||  j >= tp->ncol) {
+        return 0;
+    }
+
+    rp = tp->rows + i;
+    if (rp->first == NULL) {
+        return 0;
+    }
+
+    for (k=rp->first[j]; k>=0; k=rec->next) {
+        rec = rp->recs + k;
+        if (rec->start == start  &&  rec->end == end  &&
+            rec->maxquad == maxquad  &&  rec->maxloc == maxloc  &&
+            rec->coincident == CoincidentDistance) {
+            memset (wk->ploc_int1, 0, MAX_LOCAL * sizeof(int));
+            memcpy (wk->ploc_int1, rp->points + rec->offset,
+                    rec->nlist * sizeof(int));
+            if (listout != wk->ploc_int1) {
+                memcpy (listout, rp->points + rec->offset,
+                        rec->nlist * sizeof(int));
+            }
+            *nlist = rec->nlist;
+            *nquad = rec->nquad;
+            wk->firstq1 = rec->firstq1;
+            wk->firstq2 = rec->firstq2;
+            wk->firstq3 = rec->firstq3;
+            wk->firstq4 = rec->firstq4;
+            wk->local_area_size = rec->area;
+            return 1;
+        }
+    }
+
+    return 0;
+
+}  /*  end of private ReplaySharedList function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+               R e c o r d S h a r e d L i s t
+
+  ****************************************************************
+
+    Save the results of a local point search so the later attributes
+  can replay them.  If the row already has as many points as it is
+  allowed, or if memory cannot be allocated, the list is not saved
+  and the later attributes will do the search themselves.
+
+*/
+
+void CSWGrdCalc::RecordSharedList
+          (int i, int j, int start, int end,
+           int maxquad, int maxloc,
+           int *listout, int nlist, int nquad,
+           LOcalNodeWork *wk)
+{
+    int                k, nmax;
+    int                *itmp;
+    SHaredListTable    *tp;
+    SHaredListRow      *rp;
+    SHaredListRecord   *rec;
+
+    if (SharedSearch.mode != 1) {
+        return;
+    }
+
+    tp = SharedSearch.tables + SharedSearch.itable;
+    if (i < 0  ||  i >= tp->nrow  ||  j < 0  ||  j >= tp->ncol) {
+        return;
+    }
+    if (nlist < 0  ||  nlist > MAX_LOCAL) {
+        return;
+    }
+
+    rp = tp->rows + i;
+    if (rp->npoints + nlist > tp->row_limit) {
+        return;
+    }
+
+    if (rp->first == NULL) {
+MSL
+        rp->first = (int *)csw_Malloc (tp->ncol * sizeof(int));
+        if (rp->first == NULL) {
+            return;
+        }
+        for (k=0; k<tp->ncol; k++) {
+            rp->first[k] = -1;
+        }
+    }
+
+    if (rp->nrecs >= rp->maxrecs) {
+        nmax = rp->maxrecs * 2;
+        if (nmax < tp->ncol) nmax = tp->ncol;
+        rec = (SHaredListRecord *)csw_Realloc
+            (rp->recs, nmax * sizeof(SHaredListRecord));
+        if (rec == NULL) {
+            return;
+        }
+        rp->recs = rec;
+        rp->maxrecs = nmax;
+    }
+
+    if (rp->npoints + nlist > rp->maxpoints) {
+        nmax = rp->maxpoints * 2;
+        if (nmax < rp->npoints + nlist) nmax = rp->npoints + nlist;
+        if (nmax < tp->ncol * 4) nmax = tp->ncol * 4;
+        itmp = (int *)csw_Realloc (rp->points, nmax * sizeof(int));
+        if (itmp == NULL) {
+            return;
+        }
+        rp->points = itmp;
+        rp->maxpoints = nmax;
+    }
+
+    rec = rp->recs + rp->nrecs;
+    rec->jcol = j;
+    rec->start = start;
+    rec->end = end;
+    rec->maxquad = maxquad;
+    rec->maxloc = maxloc;
+    rec->coincident = CoincidentDistance;
+    rec->nlist = nlist;
+    rec->nquad = nquad;
+    rec->firstq1 = wk->firstq1;
+    rec->firstq2 = wk->firstq2;
+    rec->firstq3 = wk->firstq3;
+    rec->firstq4 = wk->firstq4;
+    rec->area = wk->local_area_size;
+    rec->offset = rp->npoints;
+    rec->next = rp->first[j];
+
+    memcpy (rp->points + rp->npoints, listout, nlist * sizeof(int));
+    rp->npoints += nlist;
+
+    rp->first[j] = rp->nrecs;
+    rp->nrecs++;
+
+    return;
+
+}  /*  end of private RecordSharedList function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+               F r e e S h a r e d S e a r c h
+
+  ****************************************************************
+
+    Free all of the recorded local point lists and turn off
+  list sharing.
+
+*/
+
+void CSWGrdCalc::FreeSharedSearch (void)
+{
+    int                k, i;
+    SHaredListTable    *tp;
+    SHaredListRow      *rp;
+
+    for (k=0; k<SharedSearch.ntables; k++) {
+        tp = SharedSearch.tables + k;
+        if (tp->rows != NULL) {
+            for (i=0; i<tp->nrow; i++) {
+                rp = tp->rows + i;
+                csw_Free (rp->recs);
+                csw_Free (rp->points);
+                csw_Free (rp->first);
+            }
+        }
+        csw_Free (tp->table);
+        csw_Free (tp->xdata);
+        csw_Free (tp->rows);
+    }
+
+    memset (&SharedSearch, 0, sizeof(SharedSearch));
+    SharedSearch.itable = -1;
 
-}  /*  end of private SetupDistanceTable function  */
+    return;
 
+}  /*  end of private FreeSharedSearch function  */
 
 
 
@@ -2761,7 +4851,7 @@ int CSWGrdCalc::SetupDistanceTable (void)
 /*
   ****************************************************************
 
-              C o l l e c t L o c a l P o i n t s
+               S e a r c h L o c a l P o i n t s
 
   ****************************************************************
 
@@ -2771,15 +4861,16 @@ int CSWGrdCalc::SetupDistanceTable (void)
 
 */
 
-int CSWGrdCalc::CollectLocalPoints
+int CSWGrdCalc::SearchLocalPoints
           (int i, int j, int start, int end,
            int maxquad, int maxloc,
-           int *listout, int *nlist, int *nquad)
+           int *listout, int *nlist, int *nquad,
+           LOcalNodeWork *wk)
 {
     int              jj, ii, i0, i2, j0, j2, level, astat, istat,
                      nmax, nq1, nq2, nq3, nq4, offset, nt, ipt;
     int              noctant[8], osearch, maxoct, minquad;
-    int              *list = ploc_int1;
+    int              *list = wk->ploc_int1;
     CSW_F            x1, y1, x2, y2, swgt;
 
 /*
@@ -2811,10 +4902,10 @@ int CSWGrdCalc::CollectLocalPoints
     nq3 = 0;
     nq4 = 0;
 
-    Firstq1 = -1;
-    Firstq2 = -1;
-    Firstq3 = -1;
-    Firstq4 = -1;
+    wk->firstq1 = -1;
+    wk->firstq2 = -1;
+    wk->firstq3 = -1;
+    wk->firstq4 = -1;
 
     nt = 0;
 
@@ -2847,6 +4938,177 @@ int CSWGrdCalc::CollectLocalPoints
 */
     if (end > MaxNodeDistance) end = MaxNodeDistance;
 
+/*
+    The packed bucket search visits the same cells in the same
+    order as the link list search below, but it jumps directly
+    from one occupied cell to the next along each row or column
+    segment of a level, and the points in a cell are contiguous.
+*/
+    if (SearchEngine == GRD_PACKED_BUCKET_ENGINE  &&  PackedStart != NULL) {
+
+        int     *firstq[4] = {&wk->firstq1, &wk->firstq2,
+                              &wk->firstq3, &wk->firstq4};
+        int     *nqp[4] = {&nq1, &nq2, &nq3, &nq4};
+
+    /*
+        Add the points in a cell to the list.  Returns 1 if the
+        list is full.
+    */
+        auto add_cell = [&](int k, int iq, int ioct) -> int
+        {
+            int    n, n2, ip;
+            n2 = PackedStart[k+1];
+            for (n=PackedStart[k]; n<n2; n++) {
+                ip = PackedPoints[n];
+                if (*firstq[iq] < 0)
+                    *firstq[iq] = ip;
+                list[nt] = ip;
+                nt++;
+                (*nqp[iq])++;
+                if (nt >= maxloc) {
+                    *nlist = nt;
+                    return 1;
+                }
+                noctant[ioct]++;
+            }
+            return 0;
+        };
+
+    /*
+        Scan the occupied cells in row irow from column jc0 to jc2.
+    */
+        auto scan_row = [&](int irow, int jc0, int jc2, int iq, int ioct) -> int
+        {
+            int    k, kend;
+            if (jc0 > jc2) return 0;
+            kend = irow * Ncol + jc2;
+            k = PackedRowNext[irow * Ncol + jc0];
+            while (k <= kend) {
+                if (add_cell (k, iq, ioct) == 1) return 1;
+                k = PackedRowNext[k+1];
+            }
+            return 0;
+        };
+
+    /*
+        Scan the occupied cells in column jcol from row ir0 to ir2.
+    */
+        auto scan_col = [&](int jcol, int ir0, int ir2, int iq, int ioct) -> int
+        {
+            int    ir;
+            if (ir0 > ir2) return 0;
+            ir = PackedColNext[ir0 * Ncol + jcol];
+            while (ir <= ir2) {
+                if (add_cell (ir * Ncol + jcol, iq, ioct) == 1) return 1;
+                if (ir + 1 >= Nrow) break;
+                ir = PackedColNext[(ir + 1) * Ncol + jcol];
+            }
+            return 0;
+        };
+
+        for (level=start; level<=end; level++) {
+
+        /*
+            points in first quadrant (northeast)
+        */
+            if (nq1 < minquad) {
+                if (!osearch  ||  noctant[0] < maxoct) {
+                    ii = i + level;
+                    if (ii < Nrow - 1) {
+                        j2 = j + level;
+                        if (j2 > Ncol - 2) j2 = Ncol - 2;
+                        if (scan_row (ii, j, j2, 0, 0) == 1) goto LEVELS_DONE;
+                    }
+                }
+                if (!osearch  ||  noctant[1] < maxoct) {
+                    jj = j + level;
+                    if (jj < Ncol-1) {
+                        i2 = i + level - 1;
+                        if (i2 > Nrow - 2) i2 = Nrow - 2;
+                        if (scan_col (jj, i, i2, 0, 1) == 1) goto LEVELS_DONE;
+                    }
+                }
+            }
+
+        /*
+            points in second quadrant (northwest)
+        */
+            if (nq2 < minquad) {
+                if (!osearch  ||  noctant[2] < maxoct) {
+                    ii = i + level;
+                    if (ii < Nrow - 1) {
+                        j0 = j - level - 1;
+                        if (j0 < 0) j0 = 0;
+                        if (scan_row (ii, j0, j - 1, 1, 2) == 1) goto LEVELS_DONE;
+                    }
+                }
+                if (!osearch  ||  noctant[3] < maxoct) {
+                    jj = j - level - 1;
+                    if (jj >= 0) {
+                        i2 = i + level - 1;
+                        if (i2 > Nrow - 2) i2 = Nrow - 2;
+                        if (scan_col (jj, i, i2, 1, 3) == 1) goto LEVELS_DONE;
+                    }
+                }
+            }
+
+        /*
+            points in third quadrant (southwest)
+        */
+            if (nq3 < minquad) {
+                if (!osearch  ||  noctant[4] < maxoct) {
+                    ii = i - level - 1;
+                    if (ii >= 0) {
+                        j0 = j - level - 1;
+                        if (j0 < 0) j0 = 0;
+                        if (scan_row (ii, j0, j - 1, 2, 4) == 1) goto LEVELS_DONE;
+                    }
+                }
+                if (!osearch  ||  noctant[5] < maxoct) {
+                    jj = j - level - 1;
+                    if (jj >= 0) {
+                        i0 = i - level;
+                        if (i0 < 0) i0 = 0;
+                        if (scan_col (jj, i0, i - 1, 2, 5) == 1) goto LEVELS_DONE;
+                    }
+                }
+            }
+
+        /*
+            points in fourth quadrant (southeast)
+        */
+            if (nq4 < minquad) {
+                if (!osearch  ||  noctant[6] < maxoct) {
+                    ii = i - level - 1;
+                    if (ii >= 0) {
+                        j2 = j + level;
+                        if (j2 > Ncol - 2) j2 = Ncol - 2;
+                        if (scan_row (ii, j, j2, 3, 6) == 1) goto LEVELS_DONE;
+                    }
+                }
+                if (!osearch  ||  noctant[7] < maxoct) {
+                    jj = j + level;
+                    if (jj < Ncol-1) {
+                        i0 = i - level;
+                        if (i0 < 0) i0 = 0;
+                        if (scan_col (jj, i0, i - 1, 3, 7) == 1) goto LEVELS_DONE;
+                    }
+                }
+            }
+
+            if (level < 2) {
+                istat = CheckForCoincidentPointInList (i, j, list, nt);
+                if (istat == 1) {
+                    goto LEVELS_DONE;
+                }
+            }
+
+        }
+
+        goto LEVELS_DONE;
+
+    }
+
 /*
     loop through levels for each quadrant
 */
@@ -2867,8 +5129,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (jj=j0; jj<=j2; jj++) {
                         ipt = DataTable[offset+jj];
                         while (ipt >= 0) {
-                            if (Firstq1 < 0)
-                                Firstq1 = ipt;
+                            if (wk->firstq1 < 0)
+                                wk->firstq1 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq1++;
@@ -2892,8 +5154,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (ii = i0; ii<=i2; ii++) {
                         ipt = DataTable[jj + Ncol * ii];
                         while (ipt >= 0) {
-                            if (Firstq1 < 0)
-                                Firstq1 = ipt;
+                            if (wk->firstq1 < 0)
+                                wk->firstq1 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq1++;
@@ -2924,8 +5186,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (jj=j0; jj<=j2; jj++) {
                         ipt = DataTable[offset+jj];
                         while (ipt >= 0) {
-                            if (Firstq2 < 0)
-                                Firstq2 = ipt;
+                            if (wk->firstq2 < 0)
+                                wk->firstq2 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq2++;
@@ -2949,8 +5211,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (ii = i0; ii<=i2; ii++) {
                         ipt = DataTable[jj + Ncol * ii];
                         while (ipt >= 0) {
-                            if (Firstq2 < 0)
-                                Firstq2 = ipt;
+                            if (wk->firstq2 < 0)
+                                wk->firstq2 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq2++;
@@ -2981,8 +5243,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (jj=j0; jj<=j2; jj++) {
                         ipt = DataTable[offset+jj];
                         while (ipt >= 0) {
-                            if (Firstq3 < 0)
-                                Firstq3 = ipt;
+                            if (wk->firstq3 < 0)
+                                wk->firstq3 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq3++;
@@ -3006,8 +5268,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (ii = i0; ii<=i2; ii++) {
                         ipt = DataTable[jj + Ncol * ii];
                         while (ipt >= 0) {
-                            if (Firstq3 < 0)
-                                Firstq3 = ipt;
+                            if (wk->firstq3 < 0)
+                                wk->firstq3 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq3++;
@@ -3038,8 +5300,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (jj=j0; jj<=j2; jj++) {
                         ipt = DataTable[offset+jj];
                         while (ipt >= 0) {
-                            if (Firstq4 < 0)
-                                Firstq4 = ipt;
+                            if (wk->firstq4 < 0)
+                                wk->firstq4 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq4++;
@@ -3063,8 +5325,8 @@ int CSWGrdCalc::CollectLocalPoints
                     for (ii = i0; ii<=i2; ii++) {
                         ipt = DataTable[jj + Ncol * ii];
                         while (ipt >= 0) {
-                            if (Firstq4 < 0)
-                                Firstq4 = ipt;
+                            if (wk->firstq4 < 0)
+                                wk->firstq4 = ipt;
                             list[nt] = ipt;
                             nt++;
                             nq4++;
@@ -3101,7 +5363,7 @@ int CSWGrdCalc::CollectLocalPoints
 
   LEVELS_DONE:
 
-    LocalPointAreaSize = (CSW_F)(level + 1);
+    wk->local_area_size = (CSW_F)(level + 1);
 
     nmax = 0;
     if (nq1 > 0) nmax++;
@@ -3128,22 +5390,22 @@ int CSWGrdCalc::CollectLocalPoints
 //StrikeSearch = 0;
     if (astat == 1  &&  StrikeSearch == 1) {
         FilterPointsForStrike (list, nt, listout, nlist, nmax, *nquad,
-                               i, j, x1, y1, x2, y2);
+                               i, j, x1, y1, x2, y2, wk);
         nt = *nlist;
-        if (nt < maxloc  &&  Firstq1 >= 0) {
-            listout[nt] = Firstq1;
+        if (nt < maxloc  &&  wk->firstq1 >= 0) {
+            listout[nt] = wk->firstq1;
             nt++;
         }
-        if (nt < maxloc  &&  Firstq2 >= 0) {
-            listout[nt] = Firstq2;
+        if (nt < maxloc  &&  wk->firstq2 >= 0) {
+            listout[nt] = wk->firstq2;
             nt++;
         }
-        if (nt < maxloc  &&  Firstq3 >= 0) {
-            listout[nt] = Firstq3;
+        if (nt < maxloc  &&  wk->firstq3 >= 0) {
+            listout[nt] = wk->firstq3;
             nt++;
         }
-        if (nt < maxloc  &&  Firstq4 >= 0) {
-            listout[nt] = Firstq4;
+        if (nt < maxloc  &&  wk->firstq4 >= 0) {
+            listout[nt] = wk->firstq4;
             nt++;
         }
         *nlist = nt;
@@ -3156,7 +5418,7 @@ int CSWGrdCalc::CollectLocalPoints
 
     return 1;
 
-}  /*  end of private CollectLocalPoints function  */
+}  /*  end of private SearchLocalPoints function  */
 
 
 
@@ -3179,6 +5441,7 @@ int CSWGrdCalc::FreeMem (void)
     csw_Free (Grid);
     csw_Free (Icoarse);
     csw_Free (ExtraPoints);
+    FreePackedBuckets ();
 
     DataTable = NULL;
     Grid = NULL;
@@ -3240,18 +5503,18 @@ int CSWGrdCalc::FreeMem (void)
 int CSWGrdCalc::ProcessLocalPoints
           (int *list, int nlist, int nquad,
            int irow, int jcol, int cp,
-           CSW_F *value)
+           CSW_F *value, LOcalNodeWork *wk)
 {
 
-    CSW_F     *xloc = p_xloc,
-              *yloc = p_yloc,
-              *zloc = p_zloc,
-              *dsq = p_dsq,
-              *xp = p_xp,
-              *yp = p_yp,
-              *zp = p_zp,
-              *ep = p_ep,
-              *pdsq = p_pdsq;
+    CSW_F     *xloc = wk->p_xloc,
+              *yloc = wk->p_yloc,
+              *zloc = wk->p_zloc,
+              *dsq = wk->p_dsq,
+              *xp = wk->p_xp,
+              *yp = wk->p_yp,
+              *zp = wk->p_zp,
+              *ep = wk->p_ep,
+              *pdsq = wk->p_pdsq;
 
     CSW_F        x0, y0, xt, yt,
                  avperr[8],
@@ -3327,8 +5590,8 @@ int CSWGrdCalc::ProcessLocalPoints
 
     if (nlist > MAX_LOCAL / 2) nlist = MAX_LOCAL / 2;
 
-    ZlocMin = 1.e30f;
-    ZlocMax = -1.e30f;
+    wk->zloc_min = 1.e30f;
+    wk->zloc_max = -1.e30f;
     k = 0;
     for (i=0; i<nlist; i++) {
         j = list[i];
@@ -3374,8 +5637,8 @@ int CSWGrdCalc::ProcessLocalPoints
         xloc[k] = Xdata[j] - x0 + px;
         yloc[k] = Ydata[j] - y0 + py;
         zloc[k] = Zdata[j];
-        if (zloc[k] < ZlocMin) ZlocMin = zloc[k];
-        if (zloc[k] > ZlocMax) ZlocMax = zloc[k];
+        if (zloc[k] < wk->zloc_min) wk->zloc_min = zloc[k];
+        if (zloc[k] > wk->zloc_max) wk->zloc_max = zloc[k];
         k++;
     }
 
@@ -3392,9 +5655,9 @@ int CSWGrdCalc::ProcessLocalPoints
     dist_min = 1.e30;
     dcrit = Ncoarse * (Xspace + Yspace) / 2.0;
     if (AnisotropyFlag == 1  ||  PreferredStrike >= 0.0) {
+        CSWGrdSimd::Distances (xloc, yloc, nlist, wk->p_dist);
         for (i=0; i<nlist; i++) {
-            dist = xloc[i] * xloc[i] + yloc[i] * yloc[i];
-            dist = sqrt (dist);
+            dist = wk->p_dist[i];
             if (dist < dist_min) {
                 dist_min = dist;
             }
@@ -3411,11 +5674,9 @@ int CSWGrdCalc::ProcessLocalPoints
     if (FaultedFlag) {
         double   xldmin, xldist;
         xldmin = 1.e30;
+        CSWGrdSimd::Distances (xloc, yloc, nlist, wk->p_dist);
         for (i=0; i<nlist; i++) {
-            xt = xloc[i];
-            yt = yloc[i];
-            xldist = xt * xt + yt * yt;
-            xldist = sqrt (xldist);
+            xldist = wk->p_dist[i];
             if (xldist < xldmin) xldmin = xldist;
         }
         if (xldmin > FaultedCriticalDistance) {
@@ -3518,8 +5779,8 @@ int CSWGrdCalc::ProcessLocalPoints
  *  fit and evaluation.  In this case, only
  *  an inverse distance value is returned.
  */
-    zloc_min = (double)ZlocMin;
-    zloc_max = (double)ZlocMax;
+    zloc_min = (double)wk->zloc_min;
+    zloc_max = (double)wk->zloc_max;
     zloc_delta = zloc_max - zloc_min;
 
     if (zloc_delta > 1.e15) {
@@ -3688,19 +5949,11 @@ int CSWGrdCalc::ProcessLocalPoints
     cf = 0;
     if (istat == 1) {
 
+        CSWGrdSimd::PlaneResiduals (coef, xloc, yloc, zloc, nlist,
+                                    tiny_value, tiny_value_2, wk->p_res);
         sum = 0.0f;
         for (i=0; i<nlist; i++) {
-            zt = coef[0] + coef[1] * xloc[i] + coef[2] * yloc[i];
-            zpt = zloc[i];
-            if (zpt > -tiny_value  &&  zpt < tiny_value) {
-                zpt = 0.0;
-            }
-            zt -= zpt;
-            if (zt > -tiny_value_2  &&  zt < tiny_value_2) {
-                zt = 0.0;
-            }
-            zt *= zt;
-            sum += zt;
+            sum += wk->p_res[i];
         }
 
         sum /= (CSW_F)nlist;
@@ -3739,7 +5992,7 @@ int CSWGrdCalc::ProcessLocalPoints
 // cluster of points, weight the plane much lower.
 
         if (cp > Ncoarse * 2) {
-            CSW_F  wprat = LocalPointAreaSize / (CSW_F)(cp + 1);
+            CSW_F  wprat = wk->local_area_size / (CSW_F)(cp + 1);
             if (wprat > 1.0) wprat = 1.0;
 //TODO            wprat *= wprat;
             wgtplane *= wprat;
@@ -3790,7 +6043,7 @@ return 1;
     when this condition occurs.
 */
     else {
-        Extension = PROFILE_EXTENSION;
+        wk->extension = PROFILE_EXTENSION;
         return -2;
     }
 
@@ -4322,9 +6575,10 @@ int CSWGrdCalc::HalfPlaneSwitch
 
 int CSWGrdCalc::CalcLocalNodes (void)
 {
-    int           i, j, k, j1, *list = ploc_int1, nlist, nquad, start, maxquad,
-                  icrit, offset, istat, iend, iendmax, ncmax,
-                  nc2, nmin, cf, fcrit, smallmult, ic, jc, kc, tmult;
+    int           i, j, k, j1, maxquad,
+                  icrit, offset, istat, iendmax, ncmax,
+                  nc2, nmin, fcrit, smallmult, ic, jc, kc, tmult,
+                  nthreads;
     CSW_F         value;
     int           do_write;
 
@@ -4425,69 +6679,50 @@ int CSWGrdCalc::CalcLocalNodes (void)
     }
 
 /*
-    Loop through every Ncoarse'th row and column.
+    The local node calculation can be spread over several threads
+    unless it depends on shared state that is changed from node
+    to node.  The local anisotropy calculation changes the preferred
+    strike for each node, and the fault blocking checks and debug
+    output are not thread safe.  These cases are always done serially.
 */
-    cf = 100000000;
-    for (i=0; i<Nrow; i+=Ncoarse) {
+    nthreads = CSWParallel::NumThreads (NumThreads);
+    do_write = csw_GetDoWrite ();
+    if (FaultedFlag  ||  AnisotropyFlag == GRD_LOCAL_ANISOTROPY  ||
+        do_write == 1) {
+        nthreads = 1;
+    }
 
-        offset = i * Ncol;
+    if (nthreads > 1) {
+        istat = CalcLocalNodesParallel (nthreads, icrit, fcrit, ncmax,
+                                        nc2, iendmax, maxquad);
+        if (istat == -1) {
+            return -1;
+        }
+    }
 
-        for (j=0; j<Ncol; j+=Ncoarse) {
+    else {
 
-            start = ClosestPoint[offset+j];
-            if (start > MaxNodeDistance) {
-                continue;
-            }
-            if (start < 0) start = 0;
-            if (FaultedFlag) {
-                cf = ClosestFault[i*Ncol+j];
-            }
-            if (start >= icrit) {
-                continue;
-            }
-            cf = cf;
+    /*
+        Loop through every Ncoarse'th row and column.
+    */
+        SerialWork.extension = Extension;
+        for (i=0; i<Nrow; i+=Ncoarse) {
 
-            if (StepGridFlag) {
-                iend = start * 2;
-            }
-            else {
-                iend = icrit * Extension / 2;
-                if (fcrit > icrit)
-                    iend = fcrit * Extension / 2;
-                if (PreferredStrike >= 0.0f  &&  AnisotropyFlag == 0) {
-                    iend *= StrikePower;
-                }
-                if (iend > ncmax) iend = ncmax;
-                if (iend < nc2) iend = nc2;
-            }
+            offset = i * Ncol;
 
-            for (;;) {
-                nlist = 0;
-                LocalPointAreaSize = 0.0;
-                CollectLocalPoints (i, j, start, iend * Ndivide,
-                                    maxquad, MAX_LOCAL / 2, list, &nlist,
-                                    &nquad);
-                istat = ProcessLocalPoints (list, nlist, nquad, i, j, start,
-                                            &value);
-                LocalPointAreaSize = 0.0;
+            for (j=0; j<Ncol; j+=Ncoarse) {
 
-                if (istat == -2) {
-                    iend *= 2;
-                    nlist = 0;
-                    if (iend > iendmax) break;
-                    continue;
+                istat = CalcLocalNode (i, j, icrit, fcrit, ncmax, nc2,
+                                       iendmax, maxquad,
+                                       &value, &SerialWork);
+                if (istat == 1) {
+                    Grid[offset+j] = value;
                 }
-                break;
-            }
 
-            if (nlist < 1) {
-                continue;
             }
 
-            Grid[offset+j] = value;
-
         }
-
+        Extension = SerialWork.extension;
     }
 
 
@@ -4496,7 +6731,6 @@ int CSWGrdCalc::CalcLocalNodes (void)
 /*
  *  !!!!  debug only
  */
-    do_write = csw_GetDoWrite ();
     if (do_write == 1) {
         grd_triangle_ptr->grd_WriteXYZGridFile (
             (char *)"pre_extend.xyz",
@@ -4516,68 +6750,271 @@ int CSWGrdCalc::CalcLocalNodes (void)
     }
 
 /*
- * Use the EmptyAreaGrid to fill in empty areas if it is available.
+ * Use the EmptyAreaGrid to fill in empty areas if it is available.
+ */
+    if (EmptyAreaGrid != NULL) {
+
+        tmult = 3;
+        if (TriangulateFlag == 3) {
+            tmult = 2;
+        }
+        for (i=Ncoarse; i<Nrow-1; i+=Ncoarse ) {
+            j1 = i * Ncol;
+            for (j=Ncoarse; j<Ncol-1; j++) {
+                k = j1 + j;
+                jc = j / Ncoarse;
+                ic = i / Ncoarse;
+                kc = ic * Nccol + jc;
+                if (Grid[k] > 1.e19) {
+                    if (ClosestPoint[k] > Ncoarse * tmult) {
+                        Grid[k] = EmptyAreaGrid[kc];
+                    }
+                }
+            }
+        }
+    }
+
+/*
+    Extend the coarse grid by extrapolating local gradients.
+*/
+    if (DefaultSizeMultiplier < 1) DefaultSizeMultiplier = 1;
+    nmin = 4;
+
+// This extension will help fill in holes and bays in the 
+// "interior" of the data
+    j = (Ncol + Nrow) / Ncoarse;
+    j /= 3;
+    if (j < Extension) j = Extension;
+    if (j < 2) j = 2;
+    if (j > 8) j = 8;
+    j *= DefaultSizeMultiplier;
+    for (i=0; i<j; i++) {
+        ExtendCoarseNodes (i, nmin);
+    }
+    offset = j;
+
+// This extension will help extend the grid out from the edges
+// of the data
+    nmin = 1;
+    j = Extension / 2;
+    if (j < 2) j = 2;
+    if (ThicknessFlag == 1  ||  FaultedFlag) {
+        j *= 2;
+    }
+    if (j > 4) j = 4;
+    if (FaultedFlag) {
+        if (j < 8) j = 8;
+    }
+    for (i=0; i<j; i++) {
+        ExtendCoarseNodes (i+offset, nmin);
+    }
+
+    return 1;
+
+}  /*  end of private CalcLocalNodes function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                      C a l c L o c a l N o d e
+
+  ****************************************************************
+
+  Calculate the elevation of a single coarse grid node from its
+  local data.  All scratch space comes from the specified work
+  structure.  The extension member of the work structure is used
+  for the search distance and it may be changed by this function.
+  This is the same calculation for the serial and parallel cases.
+
+  If a value is calculated for the node, 1 is returned and the
+  value is put into the value parameter.  If the node is too far
+  from the data, zero is returned.
+
+*/
+
+int CSWGrdCalc::CalcLocalNode (int i, int j,
+                               int icrit, int fcrit,
+                               int ncmax, int nc2,
+                               int iendmax, int maxquad,
+                               CSW_F *value, LOcalNodeWork *wk)
+{
+    int           *list = wk->ploc_int1, nlist, nquad,
+                  start, istat, iend;
+
+    start = ClosestPoint[i*Ncol+j];
+    if (start > MaxNodeDistance) {
+        return 0;
+    }
+    if (start < 0) start = 0;
+    if (start >= icrit) {
+        return 0;
+    }
+
+    if (StepGridFlag) {
+        iend = start * 2;
+    }
+    else {
+        iend = icrit * wk->extension / 2;
+        if (fcrit > icrit)
+            iend = fcrit * wk->extension / 2;
+        if (PreferredStrike >= 0.0f  &&  AnisotropyFlag == 0) {
+            iend *= StrikePower;
+        }
+        if (iend > ncmax) iend = ncmax;
+        if (iend < nc2) iend = nc2;
+    }
+
+    for (;;) {
+        nlist = 0;
+        wk->local_area_size = 0.0;
+        CollectLocalPoints (i, j, start, iend * Ndivide,
+                            maxquad, MAX_LOCAL / 2, list, &nlist,
+                            &nquad, wk);
+        istat = ProcessLocalPoints (list, nlist, nquad, i, j, start,
+                                    value, wk);
+        wk->local_area_size = 0.0;
+
+        if (istat == -2) {
+            iend *= 2;
+            nlist = 0;
+            if (iend > iendmax) break;
+            continue;
+        }
+        break;
+    }
+
+    if (nlist < 1) {
+        return 0;
+    }
+
+    return 1;
+
+}  /*  end of private CalcLocalNode function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+              C a l c L o c a l N o d e s P a r a l l e l
+
+  ****************************************************************
+
+  Calculate the local coarse grid nodes using several threads.
+  Each coarse row is a separate task and each thread has its own
+  scratch space.  The results are put into the Grid array in the
+  same order as the serial calculation, and they are identical to
+  the serial results.
+
+  The only state carried from one node to the next in the serial
+  calculation is the Extension value, which is switched to
+  PROFILE_EXTENSION the first time a node fails its plane fit.
+  To reproduce this, every node is first calculated with the
+  original Extension.  The nodes after the first node (in serial
+  order) that switched the extension are then recalculated using
+  PROFILE_EXTENSION.
+
+  On success, 1 is returned.  On a memory allocation failure, -1
+  is returned.
+
+*/
+
+int CSWGrdCalc::CalcLocalNodesParallel (int nthreads,
+                                        int icrit, int fcrit,
+                                        int ncmax, int nc2,
+                                        int iendmax, int maxquad)
+{
+    int             i, j, k, ncr, ncc, nnode, first, ext0;
+    CSW_F           *nvals = NULL;
+    int             *nflags = NULL, *rowfirst = NULL;
+    LOcalNodeWork   *works = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (nvals);
+        csw_Free (nflags);
+        csw_Free (works);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    ncr = (Nrow - 1) / Ncoarse + 1;
+    ncc = (Ncol - 1) / Ncoarse + 1;
+    nnode = ncr * ncc;
+
+    nvals = (CSW_F *)csw_Malloc (nnode * sizeof(CSW_F));
+    nflags = (int *)csw_Malloc ((nnode + ncr) * sizeof(int));
+    works = (LOcalNodeWork *)csw_Malloc (nthreads * sizeof(LOcalNodeWork));
+    if (nvals == NULL  ||  nflags == NULL  ||  works == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    rowfirst = nflags + nnode;
+
+    ext0 = Extension;
+
+/*
+ * Calculate all the nodes in a coarse row.  If istart is not
+ * negative, only nodes with a serial index greater than istart
+ * are calculated, with the extension set to PROFILE_EXTENSION.
  */
-    if (EmptyAreaGrid != NULL) {
+    auto frow = [&](int ir, int ithread, int istart)
+    {
+        int            jc, kk;
+        LOcalNodeWork  *wk = works + ithread;
 
-        tmult = 3;
-        if (TriangulateFlag == 3) {
-            tmult = 2;
-        }
-        for (i=Ncoarse; i<Nrow-1; i+=Ncoarse ) {
-            j1 = i * Ncol;
-            for (j=Ncoarse; j<Ncol-1; j++) {
-                k = j1 + j;
-                jc = j / Ncoarse;
-                ic = i / Ncoarse;
-                kc = ic * Nccol + jc;
-                if (Grid[k] > 1.e19) {
-                    if (ClosestPoint[k] > Ncoarse * tmult) {
-                        Grid[k] = EmptyAreaGrid[kc];
-                    }
-                }
+        rowfirst[ir] = -1;
+        for (jc=0; jc<ncc; jc++) {
+            kk = ir * ncc + jc;
+            if (kk <= istart) {
+                continue;
+            }
+            wk->extension = (istart >= 0) ? PROFILE_EXTENSION : ext0;
+            nflags[kk] =
+                CalcLocalNode (ir * Ncoarse, jc * Ncoarse,
+                               icrit, fcrit, ncmax, nc2,
+                               iendmax, maxquad,
+                               nvals + kk, wk);
+            if (wk->extension != ext0  &&  rowfirst[ir] < 0) {
+                rowfirst[ir] = kk;
             }
         }
-    }
+    };
 
-/*
-    Extend the coarse grid by extrapolating local gradients.
-*/
-    if (DefaultSizeMultiplier < 1) DefaultSizeMultiplier = 1;
-    nmin = 4;
+    CSWParallel::ForEach (nthreads, ncr,
+        [&](int ir, int ithread) {frow (ir, ithread, -1);});
 
-// This extension will help fill in holes and bays in the 
-// "interior" of the data
-    j = (Ncol + Nrow) / Ncoarse;
-    j /= 3;
-    if (j < Extension) j = Extension;
-    if (j < 2) j = 2;
-    if (j > 8) j = 8;
-    j *= DefaultSizeMultiplier;
-    for (i=0; i<j; i++) {
-        ExtendCoarseNodes (i, nmin);
+    first = -1;
+    for (i=0; i<ncr; i++) {
+        if (rowfirst[i] >= 0) {
+            first = rowfirst[i];
+            break;
+        }
     }
-    offset = j;
 
-// This extension will help extend the grid out from the edges
-// of the data
-    nmin = 1;
-    j = Extension / 2;
-    if (j < 2) j = 2;
-    if (ThicknessFlag == 1  ||  FaultedFlag) {
-        j *= 2;
-    }
-    if (j > 4) j = 4;
-    if (FaultedFlag) {
-        if (j < 8) j = 8;
+    if (first >= 0) {
+        CSWParallel::ForEach (nthreads, ncr - first / ncc,
+            [&](int ir, int ithread) {frow (ir + first / ncc, ithread, first);});
+        Extension = PROFILE_EXTENSION;
     }
-    for (i=0; i<j; i++) {
-        ExtendCoarseNodes (i+offset, nmin);
+
+    for (i=0; i<ncr; i++) {
+        for (j=0; j<ncc; j++) {
+            k = i * ncc + j;
+            if (nflags[k] == 1) {
+                Grid[i*Ncoarse*Ncol+j*Ncoarse] = nvals[k];
+            }
+        }
     }
 
     return 1;
 
-}  /*  end of private CalcLocalNodes function  */
+}  /*  end of private CalcLocalNodesParallel function  */
 
 
 
@@ -4956,11 +7393,8 @@ int CSWGrdCalc::FillInPerimeter (void)
 int CSWGrdCalc::StrikeSmoothGrid (void)
 {
 
-    int       cp, ismt, i, j, k, offset, off2, ki, kj, astat;
-    CSW_F     wt, avg, sum3, sum4, st, x1, y1, x2, y2, x, y;
-    CSW_F     st0, stiny, fdum, datafact, fncc, cpmult;
-    CSW_F     cpmult2, z0, z1, z2, zt, zt2;
-    CSW_F     zgrid;
+    int       ismt, i, j, k, offset, nthreads, ncr;
+    CSW_F     wt, stiny, datafact, fncc;
 
     AdjustForUnderflow ();
 
@@ -5033,10 +7467,19 @@ int CSWGrdCalc::StrikeSmoothGrid (void)
     }
 
 /*
-    Smooth and put the smoothed results into the Gwork1 array
+    Smooth a coarse row, reading from Grid and writing to Gwork1.
 */
-    for (i=0; i<Nrow; i+=Ncoarse) {
+    auto frow = [&](int ir, int ithread)
+    {
+        int       cp, i, j, k, offset, off2, ki, kj, astat;
+        CSW_F     wt, avg, sum3, sum4, st, x1, y1, x2, y2, x, y;
+        CSW_F     st0, fdum, cpmult;
+        CSW_F     cpmult2, z0, z1, z2, zt, zt2;
+        CSW_F     zgrid;
+
+        (void)ithread;
 
+        i = ir * Ncoarse;
         offset = i * Ncol;
 
         for (j=0; j<Ncol; j+=Ncoarse) {
@@ -5139,7 +7582,20 @@ int CSWGrdCalc::StrikeSmoothGrid (void)
 
         }  /*  end of j loop through columns  */
 
-    }  /*  end of i loop through rows  */
+    };
+
+/*
+    Smooth and put the smoothed results into the Gwork1 array.
+    The Grid array is not changed until all the rows are done,
+    so the rows can be done in any order.  The local anisotropy
+    strike lookup changes class members, so it is done serially.
+*/
+    nthreads = IterationThreads ();
+    if (AnisotropyFlag == GRD_LOCAL_ANISOTROPY) {
+        nthreads = 1;
+    }
+    ncr = (Nrow - 1) / Ncoarse + 1;
+    CSWParallel::ForEach (nthreads, ncr, frow);
 
 /*
     Copy the smoothed results back to the Grid array.
@@ -5305,17 +7761,18 @@ int CSWGrdCalc::FillInCoarse (void)
   bilinear estimate of the z value at each point.  The estimate is
   subtracted from the actual z value to get the error.  The errors
   are then averaged with inverse distance squared weighting to get
-  the error at the node.
+  the error at the node.  All scratch space comes from the specified
+  work structure.
 
 */
 
 int CSWGrdCalc::CalcErrorAtNode
            (int irow, int jcol, int *list, int nlist,
-            CSW_F *error)
+            CSW_F *error, LOcalNodeWork *wk)
 {
     int         i, istat;
-    CSW_F       x0, y0, *x = ploc_f1, *y = ploc_f2,
-                *z = ploc_f3, *z2 = ploc_f4, locerror;
+    CSW_F       x0, y0, *x = wk->ploc_f1, *y = wk->ploc_f2,
+                *z = wk->ploc_f3, *z2 = wk->ploc_f4, locerror;
     double      dmin, dist, wgt;
     int         closest;
 
@@ -5348,9 +7805,9 @@ int CSWGrdCalc::CalcErrorAtNode
     closest = -1;
     x0 = jcol * Xspace + Xmin;
     y0 = irow * Yspace + Ymin;
+    CSWGrdSimd::Reorigin (x, y, nlist, x0, y0);
+    CSWGrdSimd::Distances (x, y, nlist, wk->p_dist);
     for (i=0; i<nlist; i++) {
-        x[i] -= x0;
-        y[i] -= y0;
         if (z2[i] > 1.e20f  ||  z2[i] < -1.e20f) {
             z2[i] = z[i];
         }
@@ -5363,8 +7820,7 @@ int CSWGrdCalc::CalcErrorAtNode
             }
         }
         z[i] -= z2[i];
-        dist = x[i] * x[i] + y[i] * y[i];
-        dist = sqrt (dist);
+        dist = wk->p_dist[i];
         if (dist < dmin) {
             dmin = dist;
             closest = i;
@@ -5518,15 +7974,27 @@ int CSWGrdCalc::CheckForBicub (int i, int j)
   data point to the node.  These overcorrections are smoothed out
   using a simple 3 by 3 moving average.
 
-*/
+  The node errors only depend on the data and the current Grid,
+  and they are written to Gwork1, so each coarse row can be done
+  by a separate thread.  Each thread needs its own scratch space.
+  If that space cannot be allocated, the rows are done serially
+  using the SerialWork member.
 
+*/
 int CSWGrdCalc::CalcErrorGrid (int iter)
 {
-    int            i, j, offset, cp, nquad, istat,
-                   *list = ploc_int1, nlist, nc2, nc22;
-    CSW_F          err, emultmax, wgt;
+    int            i, j, offset, nthreads, ncr;
+    CSW_F          emultmax;
+    int            nc2, nc22;
+    LOcalNodeWork  *works = NULL;
     static const CSW_F   embase[] = {3.0f, 2.5f, 2.0f, 1.5f, 1.0f, 1.0f};
 
+    auto fscope = [&]()
+    {
+        csw_Free (works);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
     if (iter > 5) iter = 5;
     if (iter < 0) iter = 0;
 
@@ -5543,35 +8011,61 @@ int CSWGrdCalc::CalcErrorGrid (int iter)
     }
 
 /*
-    Calculate the errors at the nodes.
+    The fault checks are not thread safe and the local anisotropy
+    strike lookup changes class members, so these error grids are
+    always done serially.
 */
-    ErrorSearch = 1;
-    StrikeSearch = 0;
-    for (i=0; i<Nrow; i+= Ncoarse) {
+    nthreads = IterationThreads ();
+    if (FaultedFlag  ||  AnisotropyFlag == GRD_LOCAL_ANISOTROPY) {
+        nthreads = 1;
+    }
+    ncr = (Nrow - 1) / Ncoarse + 1;
+    if (nthreads > ncr) nthreads = ncr;
 
-        offset = i * Ncol;
+    if (nthreads > 1) {
+        works = (LOcalNodeWork *)csw_Malloc (nthreads * sizeof(LOcalNodeWork));
+        if (works == NULL) {
+            nthreads = 1;
+        }
+    }
 
-        for (j=0; j<Ncol; j+=Ncoarse) {
+/*
+    Calculate the errors at the nodes in a coarse row.
+*/
+    auto frow = [&](int ir, int ithread)
+    {
+        int            jc, cp, nquad, istat, nlist, offrow;
+        int            *list;
+        CSW_F          err, wgt;
+        LOcalNodeWork  *wk;
+
+        wk = (nthreads > 1) ? works + ithread : &SerialWork;
+        list = wk->ploc_int1;
+
+        offrow = ir * Ncoarse * Ncol;
+
+        for (jc=0; jc<Ncol; jc+=Ncoarse) {
 
         /*
             Only nodes with data points relatively close
             have errors calculated.  The rest of the nodes
             have errors set to zero.
         */
-            cp = ClosestPoint[offset+j];
+            cp = ClosestPoint[offrow+jc];
             if (cp < 0) cp = 0;
             err = 0.0f;
             wgt = 1.0f;
             if (cp <= nc2) {
-                CollectLocalPoints (i, j, cp, nc2,
+                CollectLocalPoints (ir * Ncoarse, jc, cp, nc2,
                                     8, MAX_LOCAL / 2,
-                                    list, &nlist, &nquad);
+                                    list, &nlist, &nquad,
+                                    wk);
                 if (nlist > 0) {
-                    if (FaultedFlag  &&  grd_fault_ptr->grd_fault_check_needed (i, j, nc2+1)) {
-                        istat = CalcFaultedErrorAtNode (i, j, list, nlist, &err);
+                    if (FaultedFlag  &&  grd_fault_ptr->grd_fault_check_needed (ir * Ncoarse, jc, nc2+1)) {
+                        istat = CalcFaultedErrorAtNode (ir * Ncoarse, jc, list, nlist, &err);
                     }
                     else {
-                        istat = CalcErrorAtNode (i, j, list, nlist, &err);
+                        istat = CalcErrorAtNode (ir * Ncoarse, jc, list, nlist, &err, wk);
                     }
                     if (istat == 999) {
                         wgt = 0.0f;
@@ -5592,10 +8086,17 @@ int CSWGrdCalc::CalcErrorGrid (int iter)
                 }
             }
 
-            Gwork1[offset + j] = err * wgt;
+            Gwork1[offrow + jc] = err * wgt;
 
         }
-    }
+    };
+
+/*
+    Calculate the errors at the nodes.
+*/
+    ErrorSearch = 1;
+    StrikeSearch = 0;
+    CSWParallel::ForEach (nthreads, ncr, frow);
     StrikeSearch = 1;
     ErrorSearch = 0;
 
@@ -5661,6 +8162,7 @@ int CSWGrdCalc::MaskBadNodes (void)
         UseControlInDataTable = 1;
         SetupDataTable (0, 0);
         SetupDistanceTable ();
+        StartSharedSearch ();
         UseControlInDataTable = 0;
     }
 
@@ -5914,9 +8416,8 @@ int CSWGrdCalc::DivideLeftBoundary (int start, int end)
 
 int CSWGrdCalc::SmoothErrors (void)
 {
-    int       i, j, k, offset, off2, ki, kj, mult, cp;
-    int       ndo, ido, cpmax;
-    CSW_F     sum, sum2, cwgt, cpwgt, emin, emax, tfact;
+    int       ndo, ido, cpmax, nthreads, ncr;
+    CSW_F     cwgt, tfact;
     int       do_write;
 
     if (FaultedFlag) {
@@ -5952,84 +8453,101 @@ int CSWGrdCalc::SmoothErrors (void)
 
     tfact = 1.0;
 
+    nthreads = IterationThreads ();
+    ncr = (Nrow - 1) / Ncoarse + 1;
+    ido = 0;
+
 /*
-    Smooth and put the smoothed results into the Gwork2 array
+    Smooth a coarse row, reading from Gwork1 and writing to Gwork2.
 */
-    for (ido = 0; ido < ndo; ido++) {
-        mult = 1;
-        for (i=0; i<Nrow; i+=Ncoarse) {
+    auto frow = [&](int ir, int ithread)
+    {
+        int       i, j, k, offset, off2, ki, kj, mult, cp;
+        CSW_F     sum, sum2, cpwgt, emin, emax;
 
-            offset = i * Ncol;
+        (void)ithread;
 
-            for (j=0; j<Ncol; j+=Ncoarse) {
+        i = ir * Ncoarse;
+        offset = i * Ncol;
+        mult = 1;
+
+        for (j=0; j<Ncol; j+=Ncoarse) {
 
         /*
             Sum the values of the immediate neighbors of the node.
         */
-                k = offset + j;
-                cp = ClosestPoint[k];
-                if (cp < 0) {
-                    Gwork2[k] = Gwork1[k];
+            k = offset + j;
+            cp = ClosestPoint[k];
+            if (cp < 0) {
+                Gwork2[k] = Gwork1[k];
+                continue;
+            }
+            if (cp > cpmax) {
+                Gwork2[k] = 0.0f;
+                continue;
+            }
+            if (ido > 1) {
+                if (cp <= Ncoarse) {
                     continue;
                 }
-                if (cp > cpmax) {
-                    Gwork2[k] = 0.0f;
+            }
+            if (NumControlPoints > 0) {
+                mult = cp / Ncoarse / 4;
+                if (mult < 1) mult = 1;
+                if (mult > 3) mult = 3;
+            }
+            sum = 0.0f;
+            sum2 = 0.0f;
+            cpwgt = (CSW_F)(cp + 1) / (CSW_F)Ncoarse;
+            cpwgt /= tfact;
+            cpwgt *= cpwgt;
+            if (cwgt > 0.0) {
+                cpwgt /= cwgt;
+            }
+
+        /*
+         * Do not use the highest or lowest neighbor.
+         */
+            emin = 1.e30f;
+            emax = -1.e30f;
+            for (ki=i-Ncoarse*mult; ki<=i+Ncoarse*mult; ki+=Ncoarse) {
+                if (ki<0  ||  ki>=Nrow) {
                     continue;
                 }
-                if (ido > 1) {
-                    if (cp <= Ncoarse) {
-                        continue;
-                    }
-                }
-                if (NumControlPoints > 0) {
-                    mult = cp / Ncoarse / 4;
-                    if (mult < 1) mult = 1;
-                    if (mult > 3) mult = 3;
-                }
-                sum = 0.0f;
-                sum2 = 0.0f;
-                cpwgt = (CSW_F)(cp + 1) / (CSW_F)Ncoarse;
-                cpwgt /= tfact;
-                cpwgt *= cpwgt;
-                if (cwgt > 0.0) {
-                    cpwgt /= cwgt;
-                }
-
-            /*
-             * Do not use the highest or lowest neighbor.
-             */
-                emin = 1.e30f;
-                emax = -1.e30f;
-                for (ki=i-Ncoarse*mult; ki<=i+Ncoarse*mult; ki+=Ncoarse) {
-                    if (ki<0  ||  ki>=Nrow) {
-                        continue;
-                    }
-                    off2 = ki*Ncol;
-                    for (kj=j-Ncoarse*mult; kj<=j+Ncoarse*mult; kj+=Ncoarse) {
-                        if (kj>=0  &&  kj<Ncol) {
-                            CSW_F zt;
-                            zt = Gwork1[off2+kj];
-                            if (zt < emin) emin = zt;
-                            if (zt > emax) emax = zt;
-                            sum += zt;
-                            sum2 += 1.0f;
-                        }
+                off2 = ki*Ncol;
+                for (kj=j-Ncoarse*mult; kj<=j+Ncoarse*mult; kj+=Ncoarse) {
+                    if (kj>=0  &&  kj<Ncol) {
+                        CSW_F zt;
+                        zt = Gwork1[off2+kj];
+                        if (zt < emin) emin = zt;
+                        if (zt > emax) emax = zt;
+                        sum += zt;
+                        sum2 += 1.0f;
                     }
                 }
+            }
 
-                if (sum < TinySum  &&  sum > -TinySum) {
-                    sum = 0.0;
-                }
-                if (sum2 > 2) {
-                    sum -= emin;
-                    sum -= emax;
-                    sum2 -= 2;
-                }
-                Gwork2[k] = (Gwork1[k] + cpwgt * sum / sum2) / (1.0f + cpwgt);
-
+            if (sum < TinySum  &&  sum > -TinySum) {
+                sum = 0.0;
+            }
+            if (sum2 > 2) {
+                sum -= emin;
+                sum -= emax;
+                sum2 -= 2;
             }
+            Gwork2[k] = (Gwork1[k] + cpwgt * sum / sum2) / (1.0f + cpwgt);
 
         }
+    };
+
+/*
+    Smooth and put the smoothed results into the Gwork2 array.
+    Each pass only reads Gwork1, so the rows can be done in
+    any order.
+*/
+    for (ido = 0; ido < ndo; ido++) {
+
+        CSWParallel::ForEach (nthreads, ncr, frow);
 
         do_write = csw_GetDoWrite ();
         if (do_write == 1) {
@@ -6076,6 +8594,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
     int       i, lastpass, maxiter;
     CSW_F     smsave, maxerr, avgerr, lastmax, lastavg, tinyavg, tinymax;
     int       do_write;
+    double    tstart;
 
     if (PointNodeRatio > 20  &&  Ncoarse == 1) {
         return 1;
@@ -6133,6 +8652,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
             them to create an error grid.  The error grid is
             smoothed and then added to the elevation grid.
         */
+            tstart = WallTime ();
             NumControlAdjust = 0;
             CoincidentDistance = (Xspace + Yspace) / 20.0f;
             CalcErrorGrid (i);
@@ -6150,6 +8670,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
             else {
                 DataPointErrors (&maxerr, &avgerr);
             }
+            PhaseTimes.error_grid += WallTime () - tstart;
 
             if (FastGridFlag) {
                 break;
@@ -6223,6 +8744,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
     /*
         Smooth before refining.
     */
+        tstart = WallTime ();
         smsave = SmoothingFactor;
         if (DistancePower == 2) {
             SmoothingFactor = 6.0f;
@@ -6246,6 +8768,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
             }
         }
         SmoothingFactor = smsave;
+        PhaseTimes.smooth += WallTime () - tstart;
 
         if (do_write == 1) {
             grd_triangle_ptr->grd_WriteXYZGridFile (
@@ -6257,6 +8780,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
     /*
         Interpolate the grid at half the current coarse interval.
     */
+        tstart = WallTime ();
         if (Ncoarse > 1) {
             if (FaultedFlag) {
                 RefineFaultedGrid ();
@@ -6265,6 +8789,7 @@ int CSWGrdCalc::IterateToFinalGrid (void)
                 RefineGrid ();
             }
         }
+        PhaseTimes.refine += WallTime () - tstart;
         Ncoarse /= 2;
         if (Ncoarse < 1) {
             Ncoarse = 1;
@@ -6291,6 +8816,62 @@ int CSWGrdCalc::IterateToFinalGrid (void)
 
 
 
+/*
+  ****************************************************************
+
+                 I t e r a t i o n T h r e a d s
+
+  ****************************************************************
+
+  Return the number of threads to use for the error grid, smoothing
+  and refinement steps of the iteration.  These steps read one array
+  and write another, one coarse row per task, so the results are the
+  same for any number of threads.  The debug output is written from
+  inside some of the steps, so everything is done serially when the
+  debug output is enabled.
+
+*/
+
+int CSWGrdCalc::IterationThreads (void)
+{
+    if (csw_GetDoWrite () == 1) {
+        return 1;
+    }
+
+    return CSWParallel::NumThreads (NumThreads);
+
+}  /*  end of private IterationThreads function  */
+
+
+
+
+
+/*
+  ****************************************************************
+
+                        W a l l T i m e
+
+  ****************************************************************
+
+  Return the wall clock time in seconds from an arbitrary start.
+  This is only used for the differences in the phase times report.
+
+*/
+
+double CSWGrdCalc::WallTime (void)
+{
+    std::chrono::duration<double>   dt;
+
+    dt = std::chrono::steady_clock::now ().time_since_epoch ();
+
+    return dt.count ();
+
+}  /*  end of private WallTime function  */
+
+
+
+
+
 /*
   ****************************************************************
 
@@ -6380,11 +8961,11 @@ int CSWGrdCalc::DataPointErrors
 
 int CSWGrdCalc::RefineGrid (void)
 {
-    int      istat, i, j, k, n, offset, nrlast, nc2, off2;
-    CSW_F    x0, y0, xsp, ysp, xsp2, ysp2;
+    int      nrlast, nc2, off2, nthreads, ncr;
+    CSW_F    xsp, ysp, xsp2, ysp2;
     int      bcflag;
 
-    CSW_F    x[10], y[10], z[10];
+    std::atomic<int>  nbad (0);
 
 /*
     set some counting constants
@@ -6400,10 +8981,19 @@ int CSWGrdCalc::RefineGrid (void)
     bcflag = 1;
 
 /*
-    loop through columns and rows of coarse grid.
+    Refine the cells in a row of the coarse grid.  Only the
+    coarse nodes are read and only the nodes at half the coarse
+    spacing are written, so the rows can be done in any order.
 */
-    for (i=0; i<Nrow-1; i+=Ncoarse) {
+    auto frow = [&](int ir, int ithread)
+    {
+        int      istat, i, j, k, n, offset;
+        CSW_F    x0, y0;
+        CSW_F    x[10], y[10], z[10];
+
+        (void)ithread;
 
+        i = ir * Ncoarse;
         offset = Ncol * i;
         y0 = i * Yspace + Ymin;
 
@@ -6463,8 +9053,8 @@ int CSWGrdCalc::RefineGrid (void)
                                   Xmin, Ymin, Xmax, Ymax);
             }
             if (istat == -1) {
-                grd_utils_ptr->grd_set_err(1);
-                return -1;
+                nbad++;
+                return;
             }
 
         /*
@@ -6498,7 +9088,19 @@ int CSWGrdCalc::RefineGrid (void)
 
         }  /*  end of loop through columns  */
 
-    }  /*  end of loop through rows  */
+    };
+
+/*
+    loop through the rows of the coarse grid.
+*/
+    nthreads = IterationThreads ();
+    ncr = (Nrow - 2) / Ncoarse + 1;
+    CSWParallel::ForEach (nthreads, ncr, frow);
+
+    if (nbad > 0) {
+        grd_utils_ptr->grd_set_err(1);
+        return -1;
+    }
 
     return 1;
 
@@ -6631,10 +9233,9 @@ int CSWGrdCalc::TrendPointErrors (void)
 
 int CSWGrdCalc::SimpleSmoothGrid (void)
 {
-    int       i, j, k, offset, off2, ki, kj, ismt, cp;
-    int       cpcrit;
-    CSW_F     fncc, sum, sum2, wt, avg, datafact, cpmult, cpmult2;
-    CSW_F     z0, z1, z2, zt, zt2, zgrid;
+    int       i, j, offset, ismt;
+    int       cpcrit, nthreads, ncr;
+    CSW_F     fncc, datafact;
 
     AdjustForUnderflow ();
 
@@ -6688,10 +9289,17 @@ int CSWGrdCalc::SimpleSmoothGrid (void)
     }
 
 /*
-    Smooth and put the smoothed results into the Gwork1 array
+    Smooth a coarse row, reading from Grid and writing to Gwork1.
 */
-    for (i=0; i<Nrow; i+=Ncoarse) {
+    auto frow = [&](int ir, int ithread)
+    {
+        int       i, j, k, offset, off2, ki, kj, cp;
+        CSW_F     sum, sum2, wt, avg, cpmult, cpmult2;
+        CSW_F     z0, z1, z2, zt, zt2, zgrid;
 
+        (void)ithread;
+
+        i = ir * Ncoarse;
         offset = i * Ncol;
 
         for (j=0; j<Ncol; j+=Ncoarse) {
@@ -6783,8 +9391,16 @@ int CSWGrdCalc::SimpleSmoothGrid (void)
             Gwork1[k] = (zgrid + avg * wt) / (1.0f + wt);
 
         }
+    };
 
-    }
+/*
+    Smooth and put the smoothed results into the Gwork1 array.
+    The Grid array is not changed until all the rows are done,
+    so the rows can be done in any order.
+*/
+    nthreads = IterationThreads ();
+    ncr = (Nrow - 1) / Ncoarse + 1;
+    CSWParallel::ForEach (nthreads, ncr, frow);
 
 /*
     Copy the smoothed results back to the Grid array.
@@ -8610,7 +11226,7 @@ int CSWGrdCalc::GenerateReport (char **report)
 /*
     Allocate a character array for the report.
 */
-    nc = nrep * 100 + 2500;
+    nc = nrep * 100 + 3000;
     nc += nflist * 40;
 MSL
     cbuf = (char *)csw_Malloc (nc * sizeof(char));
@@ -8785,6 +11401,22 @@ dmean, dstd, gmean, gstd);
         strcat (cbuf, cline);
     }
 
+/*
+    Wall clock times for the major phases of the calculation.
+*/
+    sprintf (cline,
+"\nWall clock seconds for the grid calculation (number of threads = %d):\n\
+  Data tables and trend surface:  %.3f\n\
+  Coarse grid nodes:              %.3f\n\
+  Error correction:               %.3f\n\
+  Smoothing:                      %.3f\n\
+  Refinement:                     %.3f\n\
+  Total:                          %.3f\n",
+    PhaseTimes.nthreads, PhaseTimes.tables, PhaseTimes.coarse,
+    PhaseTimes.error_grid, PhaseTimes.smooth, PhaseTimes.refine,
+    PhaseTimes.total);
+    strcat (cbuf, cline);
+
     *report = cbuf;
 
     bsuccess = true;
@@ -8948,9 +11580,11 @@ int CSWGrdCalc::StrikeAverage
           CSW_F *val, CSW_F *stwgt)
 {
 
-    int       i, nc, astat;
+    int       i, i0, ic, nc, astat;
     CSW_F     sum3, sum4, st, st0, x1, y1, x2, y2, tiny, dmin, dcrit,
               fdum, spower, dy, dx, slope, yint, storig;
+    CSW_F     stchunk[GRD_SIMD_CHUNK],
+              wtchunk[GRD_SIMD_CHUNK];
 
 /*
     Intialize output in case of an error return.
@@ -9043,20 +11677,20 @@ int CSWGrdCalc::StrikeAverage
     sum3 = 0.0f;
     sum4 = 0.0f;
     dmin = 1.e30f;
-    for (i=0; i<n; i++) {
-        gpf_perpdsquare (x1, y1, x2, y2, x[i], y[i], &st0);
-        if (st0 > 1.e15f  &&  spower > 2)
-            st0 = 1.e15f;
-        if (st0 > 1.e10f  &&  spower > 4)
-            st0 = 1.e10f;
-        if (st0 < tiny) st0 = tiny;
-        st = st0;
-        if (st < dmin) dmin = st;
-        st = 1.0f / st;
-        if (spower > 2) st *= st;
-        if (spower > 4) st *= st0;
-        sum3 += z[i] * st;
-        sum4 += st;
+    for (i0=0; i0<n; i0+=GRD_SIMD_CHUNK) {
+        nc = n - i0;
+        if (nc > GRD_SIMD_CHUNK) nc = GRD_SIMD_CHUNK;
+        for (ic=0; ic<nc; ic++) {
+            gpf_perpdsquare (x1, y1, x2, y2, x[i0+ic], y[i0+ic], stchunk+ic);
+        }
+        CSWGrdSimd::StrikeWeights (stchunk, nc, spower, tiny, wtchunk);
+        for (ic=0; ic<nc; ic++) {
+            st = stchunk[ic];
+            if (st < dmin) dmin = st;
+            st = wtchunk[ic];
+            sum3 += z[i0+ic] * st;
+            sum4 += st;
+        }
     }
 
 /*
@@ -9169,14 +11803,15 @@ int CSWGrdCalc::CalcStrikeLine
 int CSWGrdCalc::FilterPointsForStrike
          (int *list1, int n1, int *list2, int *n2,
           int nmax, int nquad, int irow, int jcol,
-          CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2)
+          CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2,
+          LOcalNodeWork *wk)
 {
 
     int          i, j, k, kk, n, jmin, maxm2, maxloc, ipt;
-    int          *count = ploc_int1, *bin = ploc_int2;
+    int          *count = wk->ploc_int1, *bin = wk->ploc_int2;
     CSW_F        dt, pd1, pd2, x, y, x0, y0,
                  xmin, ymin, xmax, ymax, dz, z1, z2;
-    CSW_F        *pdist = ploc_f1, pdmax, *zdist = ploc_f2;
+    CSW_F        *pdist = wk->ploc_f1, pdmax, *zdist = wk->ploc_f2;
 
 /*
     Initialize some local arrays to suppress lint messages.
@@ -9340,16 +11975,16 @@ int CSWGrdCalc::FilterPointsForStrike
             if (bin[i] == k) {
                 ipt = list1[i];
                 if (Xdata[ipt] >= x0  &&  Ydata[ipt] >= y0) {
-                    Firstq1 = -1;
+                    wk->firstq1 = -1;
                 }
                 if (Xdata[ipt] < x0  &&  Ydata[ipt] >= y0) {
-                    Firstq2 = -1;
+                    wk->firstq2 = -1;
                 }
                 if (Xdata[ipt] < x0  &&  Ydata[ipt] < y0) {
-                    Firstq3 = -1;
+                    wk->firstq3 = -1;
                 }
                 if (Xdata[ipt] >= x0  &&  Ydata[ipt] < y0) {
-                    Firstq4 = -1;
+                    wk->firstq4 = -1;
                 }
                 list2[n] = ipt;
                 n++;
@@ -9469,7 +12104,7 @@ int CSWGrdCalc::CalcLocalAnisotropy (void)
                 nlist = 0;
                 CollectLocalPoints (ii, jj, start, jend,
                                     100, 100, list, &nlist,
-                                    &nquad);
+                                    &nquad, &SerialWork);
                 if (nlist > 5  ||  jend > 2 * iend) {
                     break;
                 }
@@ -9679,7 +12314,8 @@ int CSWGrdCalc::FillInStepGrid (void)
                         cp1 = ClosestPoint[i2+jj];
                         if (cp1 < 0) cp1 = 0;
                         CollectLocalPoints (ii, jj, cp1, cp1*2,
-                                            100, 500, list, &nlist, &nquad);
+                                            100, 500, list, &nlist, &nquad,
+                                            &SerialWork);
                         for (k=0; k<nlist; k++) {
                             n = list[k];
                             xloc[k] = Xdata[n] - xt;
@@ -10848,10 +13484,10 @@ int CSWGrdCalc::CalcFaultedErrorAtNode
           CSW_F *error)
 {
     int         i, n, istat;
-    CSW_F       x0, y0, *x = ploc_f1, *y = ploc_f2,
+    CSW_F       x0, y0, *x = SerialWork.ploc_f1, *y = SerialWork.ploc_f2,
                 locerror;
     CSW_F       fwgt;
-    CSW_F       *z = p_zp, *z2 = p_yp;
+    CSW_F       *z = SerialWork.p_zp, *z2 = SerialWork.p_yp;
 
 /*
     put points into local arrays if they are not blocked off
@@ -11232,7 +13868,8 @@ int CSWGrdCalc::CheckClosePointFaulting
     LocalSearchPattern = GRD_RADIAL_SEARCH;
     CollectLocalPoints (irow, jcol, start, nc+1,
                         4, 100,
-                        list, &nlist, &nquad);
+                        list, &nlist, &nquad,
+                        &SerialWork);
     LocalSearchPattern = search_save;
 
     if (nlist < 1) {
@@ -14092,6 +16729,7 @@ int CSWGrdCalc::grd_calc_grid_from_double
 {
     int           istat, i;
     CSW_F         *xt = NULL, *yt = NULL, *zt = NULL,
+                  *xp = NULL, *yp = NULL, *zp = NULL,
                   xt1, yt1, xt2, yt2;
     double        xmin, ymin;
     int           fsave;
@@ -14122,18 +16760,6 @@ int CSWGrdCalc::grd_calc_grid_from_double
         return -1;
     }
 
-/*
-    allocate CSW_F arrays
-*/
-MSL
-    xt = (CSW_F *)csw_Malloc (npts * 3 * sizeof(CSW_F));
-    if (!xt) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
-    }
-    yt = xt + npts;
-    zt = yt + npts;
-
 /*
     subtract minimum x and y values from double arrays
 */
@@ -14177,12 +16803,39 @@ MSL
     }
 
 /*
-    copy to the CSW_F arrays
+    CSW_F is double (see csw_.h), so the shifted double arrays can
+    be used directly by grd_calc_grid.  The calculation already
+    copies the z values it changes, so only a faulted calculation,
+    which marks points on faults in the x array, needs its own copy.
+    This keeps the application's x values intact if the faulted
+    calculation returns early with an error.
 */
-    for (i=0; i<npts; i++) {
-        xt[i] = (CSW_F)x[i];
-        yt[i] = (CSW_F)y[i];
-        zt[i] = (CSW_F)z[i];
+    xp = x;
+    yp = y;
+    zp = z;
+
+    if (faults  &&  nfaults > 0) {
+MSL
+        xt = (CSW_F *)csw_Malloc (npts * 3 * sizeof(CSW_F));
+        if (!xt) {
+            for (i=0; i<npts; i++) {
+                x[i] += xmin;
+                y[i] += ymin;
+            }
+            grd_set_output_shifts (0.0, 0.0);
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        yt = xt + npts;
+        zt = yt + npts;
+        for (i=0; i<npts; i++) {
+            xt[i] = (CSW_F)x[i];
+            yt[i] = (CSW_F)y[i];
+            zt[i] = (CSW_F)z[i];
+        }
+        xp = xt;
+        yp = yt;
+        zp = zt;
     }
 
     xt1 = (CSW_F)x1;
@@ -14214,7 +16867,7 @@ MSL
 /*
     calculate a CSW_F grid
 */
-    istat = grd_calc_grid (xt, yt, zt, error, npts,
+    istat = grd_calc_grid (xp, yp, zp, error, npts,
                            grid, mask, report, ncol, nrow,
                            xt1, yt1, xt2, yt2, options);
 
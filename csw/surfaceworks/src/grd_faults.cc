@@ -272,6 +272,70 @@ int CSWGrdFault::grd_free_fault_indices (void)
 
 
 
+/*
+  ****************************************************************
+
+     g r d _ s e t _ f a u l t _ i n d e x _ c a c h e _ s i z e
+
+  ****************************************************************
+
+    Set the maximum number of bytes used to cache fault index grids
+  between grid calculations.  Entries are removed, least recently
+  used first, until the cache fits in the new size.  A size of zero
+  or less disables the cache.
+
+*/
+
+int CSWGrdFault::grd_set_fault_index_cache_size (long nbytes)
+{
+    int               i, ioldest;
+
+    if (nbytes < 0) nbytes = 0;
+    IndexCacheLimit = nbytes;
+
+    while (NumIndexCache > 0  &&  IndexCacheBytes > IndexCacheLimit) {
+        ioldest = 0;
+        for (i=1; i<NumIndexCache; i++) {
+            if (IndexCache[i].stamp < IndexCache[ioldest].stamp) {
+                ioldest = i;
+            }
+        }
+        RemoveCachedIndices (ioldest);
+    }
+
+    return 1;
+
+}  /*  end of function grd_set_fault_index_cache_size  */
+
+
+
+
+/*
+  ****************************************************************
+
+        g r d _ f r e e _ f a u l t _ i n d e x _ c a c h e
+
+  ****************************************************************
+
+    Free all of the cached fault index grids.  The cache size limit
+  is not changed.
+
+*/
+
+void CSWGrdFault::grd_free_fault_index_cache (void)
+{
+
+    while (NumIndexCache > 0) {
+        RemoveCachedIndices (NumIndexCache - 1);
+    }
+    IndexCacheBytes = 0;
+
+}  /*  end of function grd_free_fault_index_cache  */
+
+
+
+
+
 /*
   ****************************************************************
 
@@ -697,9 +761,8 @@ void CSWGrdFault::grd_set_fault_index_extent (int extent)
 int CSWGrdFault::grd_build_fault_indices (CSW_F *grid, int ncol, int nrow,
                              CSW_F x1, CSW_F y1, CSW_F x2, CSW_F y2)
 {
-    int            istat, i, j, k, offset;
-    CSW_F          xt, yt;
-    double         dsav;
+    int                 istat, i, ientry;
+    unsigned long long  hash;
 
     bool           bsuccess = false;    
 
@@ -830,8 +893,106 @@ int CSWGrdFault::grd_build_fault_indices (CSW_F *grid, int ncol, int nrow,
     AdjustProblemFaults ();
 
 /*
-    Build the various index grids.
+    The index grids only depend upon the fault vectors and the grid
+    geometry.  If they have been built before for the same faults and
+    geometry, copy them from the cache rather than building them again.
+*/
+    hash = IndexCacheHash ();
+    ientry = FindCachedIndices (hash);
+    if (ientry >= 0) {
+        istat = RestoreCachedIndices (ientry);
+    }
+    else {
+        istat = BuildIndexGrids ();
+        if (istat == 1) {
+            SaveCachedIndices (hash);
+        }
+    }
+    if (istat == -1) {
+        return -1;
+    }
+
+/*
+    Calculate fault elevations where each fault crosses a row
+    or column.  These are used when interpolating the surface
+    in cells intersected by faults to insure that the same
+    interpolation scheme is used regardless of how a contour
+    enters or exits the grid cell.
+*/
+    if (ElevIndex) csw_Free (ElevIndex);
+    ElevIndex = (int *)csw_Malloc (3 * ncol * nrow * sizeof(int));
+    if (ElevIndex == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    ElevIndex2 = ElevIndex + ncol * nrow;
+    EndPointIndex = ElevIndex2 + ncol * nrow;
+
+    for (i=0; i<ncol*nrow; i++) {
+        ElevIndex[i] = -1;
+        ElevIndex2[i] = -1;
+        EndPointIndex[i] = -1;
+    }
+
+    MaxElevList = INDEX_CHUNK;
+    NumElevList = 0;
+    ElevList = (CRossingElevation **)csw_Malloc
+               (MaxElevList * sizeof(CRossingElevation*));
+    if (ElevList == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    istat = SetupRowCrossingElevations ();
+    if (istat == -1) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    istat = SetupColumnCrossingElevations ();
+    if (istat == -1) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    istat = BuildEndPointIndex ();
+    if (istat == -1) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+
+    bsuccess = true;
+
+    return 1;
+
+}  /*  end of function grd_build_fault_indices  */
+
+
+
+
+/*
+  ****************************************************************
+
+                  B u i l d I n d e x G r i d s
+
+  ****************************************************************
+
+    Build the cell index, the row and column crossing flags, the
+  closest fault distance table, the cell crossing flags and the node
+  grazing flags.  This is only called from grd_build_fault_indices,
+  which has already allocated the ColumnCrossings and ClosestFault
+  arrays and clipped the fault vectors to the grid.
+
 */
+
+int CSWGrdFault::BuildIndexGrids (void)
+{
+    int            istat, i, j, k, offset, ncol, nrow;
+    CSW_F          xt, yt;
+    double         dsav;
+
+    ncol = Ncol;
+    nrow = Nrow;
+
     istat = BuildCellIndex ();
     if (istat == -1) {
         return -1;
@@ -910,59 +1071,312 @@ int CSWGrdFault::grd_build_fault_indices (CSW_F *grid, int ncol, int nrow,
         }
     }
 
+    return 1;
+
+}  /*  end of private BuildIndexGrids function  */
+
+
+
+
 /*
-    Calculate fault elevations where each fault crosses a row
-    or column.  These are used when interpolating the surface
-    in cells intersected by faults to insure that the same
-    interpolation scheme is used regardless of how a contour
-    enters or exits the grid cell.
+  ****************************************************************
+
+                  I n d e x C a c h e H a s h
+
+  ****************************************************************
+
+    Return a 64 bit FNV-1a hash of the grid geometry, the index
+  extent and the clipped fault vectors.  Only the fields that the
+  index grids depend upon are used.
+
 */
-    if (ElevIndex) csw_Free (ElevIndex);
-    ElevIndex = (int *)csw_Malloc (3 * ncol * nrow * sizeof(int));
-    if (ElevIndex == NULL) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
+
+unsigned long long CSWGrdFault::IndexCacheHash (void)
+{
+    unsigned long long    hash;
+    const unsigned char   *cp;
+    int                   i, j;
+    FAultVector           *fv;
+
+    hash = 14695981039346656037ULL;
+
+    auto fmix = [&](const void *ptr, int nbytes)
+    {
+        cp = (const unsigned char *)ptr;
+        for (j=0; j<nbytes; j++) {
+            hash ^= (unsigned long long)cp[j];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    fmix (&Ncol, sizeof(int));
+    fmix (&Nrow, sizeof(int));
+    fmix (&FaultIndexExtent, sizeof(int));
+    fmix (&Xmin, sizeof(CSW_F));
+    fmix (&Ymin, sizeof(CSW_F));
+    fmix (&Xmax, sizeof(CSW_F));
+    fmix (&Ymax, sizeof(CSW_F));
+    fmix (&NumFaultVectors, sizeof(int));
+
+    for (i=0; i<NumFaultVectors; i++) {
+        fv = FaultVectors + i;
+        fmix (&fv->x1, sizeof(CSW_F));
+        fmix (&fv->y1, sizeof(CSW_F));
+        fmix (&fv->x2, sizeof(CSW_F));
+        fmix (&fv->y2, sizeof(CSW_F));
+        fmix (&fv->flag, sizeof(int));
     }
-    ElevIndex2 = ElevIndex + ncol * nrow;
-    EndPointIndex = ElevIndex2 + ncol * nrow;
 
-    for (i=0; i<ncol*nrow; i++) {
-        ElevIndex[i] = -1;
-        ElevIndex2[i] = -1;
-        EndPointIndex[i] = -1;
+    return hash;
+
+}  /*  end of private IndexCacheHash function  */
+
+
+
+
+/*
+  ****************************************************************
+
+               F i n d C a c h e d I n d i c e s
+
+  ****************************************************************
+
+    Return the index of the cache entry that matches the current
+  grid geometry and fault vectors, or -1 if there is no match.  The
+  hash is only used to skip entries quickly.  The geometry and the
+  fault vectors are compared exactly before an entry is used.
+
+*/
+
+int CSWGrdFault::FindCachedIndices (unsigned long long hash)
+{
+    int               i, j;
+    FAultIndexCache   *cptr;
+    FAultVector       *fv1, *fv2;
+
+    for (i=0; i<NumIndexCache; i++) {
+        cptr = IndexCache + i;
+        if (cptr->hash != hash) continue;
+        if (cptr->ncol != Ncol  ||  cptr->nrow != Nrow) continue;
+        if (cptr->extent != FaultIndexExtent) continue;
+        if (cptr->nvec != NumFaultVectors) continue;
+        if (cptr->x1 != Xmin  ||  cptr->y1 != Ymin  ||
+            cptr->x2 != Xmax  ||  cptr->y2 != Ymax) {
+            continue;
+        }
+        for (j=0; j<NumFaultVectors; j++) {
+            fv1 = cptr->vectors + j;
+            fv2 = FaultVectors + j;
+            if (fv1->x1 != fv2->x1  ||  fv1->y1 != fv2->y1  ||
+                fv1->x2 != fv2->x2  ||  fv1->y2 != fv2->y2  ||
+                fv1->flag != fv2->flag) {
+                break;
+            }
+        }
+        if (j < NumFaultVectors) continue;
+        return i;
     }
 
-    MaxElevList = INDEX_CHUNK;
-    NumElevList = 0;
-    ElevList = (CRossingElevation **)csw_Malloc
-               (MaxElevList * sizeof(CRossingElevation*));
-    if (ElevList == NULL) {
+    return -1;
+
+}  /*  end of private FindCachedIndices function  */
+
+
+
+
+/*
+  ****************************************************************
+
+            R e s t o r e C a c h e d I n d i c e s
+
+  ****************************************************************
+
+    Copy the index grids from the specified cache entry into the
+  arrays used by the rest of the fault functions.  The ColumnCrossings
+  and ClosestFault arrays must already be allocated.
+
+*/
+
+int CSWGrdFault::RestoreCachedIndices (int ientry)
+{
+    int               n;
+    FAultIndexCache   *cptr;
+
+    cptr = IndexCache + ientry;
+    n = Ncol * Nrow;
+
+    csw_Free (IndexLink);
+    IndexLink = NULL;
+    csw_Free (IndexGrid1);
+    IndexGrid1 = NULL;
+    IndexGrid2 = NULL;
+    csw_Free (CellCrossings);
+    CellCrossings = NULL;
+    NumIndexLink = 0;
+    MaxIndexLink = 0;
+
+    MaxIndexLink = cptr->nlink + INDEX_CHUNK;
+    IndexLink = (FAultIndexLink *)csw_Malloc
+                (MaxIndexLink * sizeof(FAultIndexLink));
+    IndexGrid1 = (int *)csw_Malloc (n * 2 * sizeof(int));
+    CellCrossings = (char *)csw_Malloc (n * sizeof(char));
+    if (IndexLink == NULL  ||  IndexGrid1 == NULL  ||
+        CellCrossings == NULL) {
         grd_utils_ptr->grd_set_err (1);
         return -1;
     }
+    IndexGrid2 = IndexGrid1 + n;
+    NumIndexLink = cptr->nlink;
 
-    istat = SetupRowCrossingElevations ();
-    if (istat == -1) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
+    memcpy (IndexLink, cptr->links, NumIndexLink * sizeof(FAultIndexLink));
+    memcpy (IndexGrid1, cptr->index_grid, n * 2 * sizeof(int));
+    memcpy (ColumnCrossings, cptr->crossings, 3 * n * sizeof(char));
+    memcpy (CellCrossings, cptr->crossings + 3 * n, n * sizeof(char));
+    memcpy (ClosestFault, cptr->closest, n * sizeof(int));
+
+    IndexCacheStamp++;
+    cptr->stamp = IndexCacheStamp;
+
+    return 1;
+
+}  /*  end of private RestoreCachedIndices function  */
+
+
+
+
+/*
+  ****************************************************************
+
+               S a v e C a c h e d I n d i c e s
+
+  ****************************************************************
+
+    Add copies of the current index grids to the cache.  The least
+  recently used entries are removed until the new entry fits in the
+  cache size limit.  If the new entry is bigger than the limit by
+  itself, or if memory cannot be allocated, nothing is cached.  This
+  is not an error, since the index grids can always be rebuilt.
+
+*/
+
+int CSWGrdFault::SaveCachedIndices (unsigned long long hash)
+{
+    int               i, n, ioldest;
+    long              nbytes;
+    FAultIndexCache   *cptr;
+
+    n = Ncol * Nrow;
+
+    nbytes = (long)NumFaultVectors * (long)sizeof(FAultVector) +
+             (long)n * 4L * (long)sizeof(char) +
+             (long)n * 3L * (long)sizeof(int) +
+             (long)NumIndexLink * (long)sizeof(FAultIndexLink);
+
+    if (nbytes > IndexCacheLimit) {
+        return 0;
     }
-    istat = SetupColumnCrossingElevations ();
-    if (istat == -1) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
+
+/*
+    Remove the least recently used entries until there is room.
+*/
+    while (NumIndexCache > 0  &&
+           (NumIndexCache >= MAX_FAULT_INDEX_CACHE  ||
+            IndexCacheBytes + nbytes > IndexCacheLimit)) {
+        ioldest = 0;
+        for (i=1; i<NumIndexCache; i++) {
+            if (IndexCache[i].stamp < IndexCache[ioldest].stamp) {
+                ioldest = i;
+            }
+        }
+        RemoveCachedIndices (ioldest);
     }
 
-    istat = BuildEndPointIndex ();
-    if (istat == -1) {
-        grd_utils_ptr->grd_set_err (1);
-        return -1;
+    cptr = IndexCache + NumIndexCache;
+    memset (cptr, 0, sizeof(FAultIndexCache));
+
+    cptr->vectors = (FAultVector *)csw_Malloc
+                    ((NumFaultVectors + 1) * sizeof(FAultVector));
+    cptr->crossings = (char *)csw_Malloc (n * 4 * sizeof(char));
+    cptr->closest = (int *)csw_Malloc (n * 3 * sizeof(int));
+    cptr->links = (FAultIndexLink *)csw_Malloc
+                  ((NumIndexLink + 1) * sizeof(FAultIndexLink));
+    if (cptr->vectors == NULL  ||  cptr->crossings == NULL  ||
+        cptr->closest == NULL  ||  cptr->links == NULL) {
+        csw_Free (cptr->vectors);
+        csw_Free (cptr->crossings);
+        csw_Free (cptr->closest);
+        csw_Free (cptr->links);
+        memset (cptr, 0, sizeof(FAultIndexCache));
+        return 0;
     }
+    cptr->index_grid = cptr->closest + n;
 
-    bsuccess = true;
+    memcpy (cptr->vectors, FaultVectors,
+            NumFaultVectors * sizeof(FAultVector));
+    memcpy (cptr->crossings, ColumnCrossings, 3 * n * sizeof(char));
+    memcpy (cptr->crossings + 3 * n, CellCrossings, n * sizeof(char));
+    memcpy (cptr->closest, ClosestFault, n * sizeof(int));
+    memcpy (cptr->index_grid, IndexGrid1, n * 2 * sizeof(int));
+    memcpy (cptr->links, IndexLink, NumIndexLink * sizeof(FAultIndexLink));
+
+    cptr->hash = hash;
+    cptr->ncol = Ncol;
+    cptr->nrow = Nrow;
+    cptr->extent = FaultIndexExtent;
+    cptr->nvec = NumFaultVectors;
+    cptr->nlink = NumIndexLink;
+    cptr->x1 = Xmin;
+    cptr->y1 = Ymin;
+    cptr->x2 = Xmax;
+    cptr->y2 = Ymax;
+    cptr->nbytes = nbytes;
+    IndexCacheStamp++;
+    cptr->stamp = IndexCacheStamp;
+
+    NumIndexCache++;
+    IndexCacheBytes += nbytes;
 
     return 1;
 
-}  /*  end of function grd_build_fault_indices  */
+}  /*  end of private SaveCachedIndices function  */
+
+
+
+
+/*
+  ****************************************************************
+
+             R e m o v e C a c h e d I n d i c e s
+
+  ****************************************************************
+
+    Free the memory of the specified cache entry and move the last
+  entry into its slot.
+
+*/
+
+void CSWGrdFault::RemoveCachedIndices (int ientry)
+{
+    FAultIndexCache   *cptr;
+
+    if (ientry < 0  ||  ientry >= NumIndexCache) {
+        return;
+    }
+
+    cptr = IndexCache + ientry;
+    csw_Free (cptr->vectors);
+    csw_Free (cptr->crossings);
+    csw_Free (cptr->closest);
+    csw_Free (cptr->links);
+    IndexCacheBytes -= cptr->nbytes;
+
+    NumIndexCache--;
+    if (ientry < NumIndexCache) {
+        *cptr = IndexCache[NumIndexCache];
+    }
+    memset (IndexCache + NumIndexCache, 0, sizeof(FAultIndexCache));
+
+}  /*  end of private RemoveCachedIndices function  */
 
 
 
@@ -6533,7 +6947,7 @@ int CSWGrdFault::UnionFaults (void)
 {
     int                i, j, k, n, n2, ndo, istat,
                        maxpts, maxcomp, nstruct;
-    int                norig, nc, nk, nk2, nj, nt, nv, nfw;
+    int                norig, nc, nk, nk2, nj, nt, nv, nfw = 0;
     FAultLineStruct    *fptr = NULL, *fwork = NULL;
     double             *xf1 = NULL, *yf1 = NULL,
                        *xf2 = NULL, *yf2 = NULL,
@@ -158,6 +158,10 @@ int CSWGrdFileio::grd_write_file (const char *filename, const char *comment,
                        ncol, nrow,
                        xmin, ymin, xmax, ymax,
                        gridtype);
+    if (istat == -1) {
+        CloseFile (filenum);
+        return -1;
+    }
 
 /*
     Write the number of faults to the file.
@@ -234,6 +238,442 @@ int CSWGrdFileio::grd_write_file (const char *filename, const char *comment,
 
 
 
+/*
+  ****************************************************************
+
+             g r d _ b e g i n _ t i l e d _ f i l e
+
+  ****************************************************************
+
+    Start writing a grid file whose values are supplied a block
+  at a time rather than as one big array.  The blocks are put
+  together a band of rows at a time in a scratch file, so only
+  one band (band_rows by ncol) is ever kept in the band scratch
+  file and only one row is ever in memory here.  The actual grid
+  file is written by grd_end_tiled_file.
+
+    The grid file has the same format as one written by
+  grd_write_file, with a mask and without faults.
+
+*/
+
+int CSWGrdFileio::grd_begin_tiled_file (const char *filename,
+                                        const char *comment,
+                                        int ncol, int nrow,
+                                        double xmin, double ymin,
+                                        double xmax, double ymax,
+                                        int gridtype, int band_rows)
+{
+    double        dsize;
+
+/*
+    Check obvious errors.
+*/
+    if (ncol < 2  ||  ncol > WildInt  ||
+        nrow < 2  ||  nrow > WildInt  ||
+        band_rows < 1  ||
+        xmin > WildFloat   ||  xmin < -WildFloat   ||
+        ymin > WildFloat   ||  ymin < -WildFloat   ||
+        xmax > WildFloat   ||  xmax < -WildFloat   ||
+        ymax > WildFloat   ||  ymax < -WildFloat) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+    if (filename == NULL) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    if (filename[0] == '\0') {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+/*
+    The file positions used for the band scratch file and the
+    data size in the grid file header are int values, so
+    they must not overflow.
+*/
+    if (band_rows > nrow) band_rows = nrow;
+    dsize = (double)band_rows * (double)ncol * (double)(sizeof(CSW_F) + 1);
+    if (dsize > 2.e9) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+    dsize = (double)ncol * (double)nrow * 4.0;
+    if (dsize > 2.e9) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+/*
+    Any tiled file that was not finished is abandoned.
+*/
+    grd_end_tiled_file (0);
+
+    Tiled.band_file = fileio_util_obj.csw_OpenScratchFile ("b");
+    if (Tiled.band_file < 0) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    Tiled.row_file = fileio_util_obj.csw_OpenScratchFile ("b");
+    if (Tiled.row_file < 0) {
+        fileio_util_obj.csw_CloseScratchFile (Tiled.band_file);
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    Tiled.active = 1;
+    Tiled.ncol = ncol;
+    Tiled.nrow = nrow;
+    Tiled.band_rows = band_rows;
+    Tiled.rows_done = 0;
+    Tiled.gridtype = gridtype;
+    Tiled.xmin = xmin;
+    Tiled.ymin = ymin;
+    Tiled.xmax = xmax;
+    Tiled.ymax = ymax;
+    Tiled.zmin = 1.e20f;
+    Tiled.zmax = -1.e20f;
+    csw_StrTruncate (Tiled.filename, filename, 500);
+    if (comment) {
+        csw_StrTruncate (Tiled.comment, comment, COMMENT_SIZE);
+    }
+    else {
+        Tiled.comment[0] = '\0';
+    }
+
+    return 1;
+
+}  /*  end of function grd_begin_tiled_file  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+              g r d _ p u t _ t i l e d _ b l o c k
+
+  ****************************************************************
+
+    Put a block of grid values and mask values into the current
+  band.  The block has bcol columns and brow rows, and its first
+  column is column col0 of the full grid.  Row zero of the block
+  is the first row of the current band.
+
+*/
+
+int CSWGrdFileio::grd_put_tiled_block (CSW_F *block, char *mask,
+                                       int bcol, int brow, int col0)
+{
+    int           i, istat, offset, moffset;
+
+    if (Tiled.active == 0) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    if (block == NULL  ||  mask == NULL) {
+        grd_utils_ptr->grd_set_err (3);
+        return -1;
+    }
+
+    if (bcol < 1  ||  brow < 1  ||  col0 < 0  ||
+        col0 + bcol > Tiled.ncol  ||  brow > Tiled.band_rows) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+/*
+    The values for the whole band come first in the scratch
+    file, followed by the mask values for the whole band.
+*/
+    moffset = Tiled.band_rows * Tiled.ncol * sizeof(CSW_F);
+
+    for (i=0; i<brow; i++) {
+        offset = (i * Tiled.ncol + col0) * sizeof(CSW_F);
+        fileio_util_obj.csw_SetFilePosition (Tiled.band_file, offset, 0);
+        istat = BinFileWrite ((void *)(block + i * bcol),
+                              bcol * sizeof(CSW_F), 1, Tiled.band_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        offset = moffset + i * Tiled.ncol + col0;
+        fileio_util_obj.csw_SetFilePosition (Tiled.band_file, offset, 0);
+        istat = BinFileWrite ((void *)(mask + i * bcol),
+                              bcol, 1, Tiled.band_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+    }
+
+    return 1;
+
+}  /*  end of function grd_put_tiled_block  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+               g r d _ e n d _ t i l e d _ b a n d
+
+  ****************************************************************
+
+    All of the blocks for the current band have been put, so copy
+  the first nrows rows of the band to the end of the row scratch
+  file and update the z range of the grid.  The next block put
+  will be in the first row of the next band.
+
+*/
+
+int CSWGrdFileio::grd_end_tiled_band (int nrows)
+{
+    int           i, j, istat, offset, moffset, ncol;
+    CSW_F         *row = NULL, zt;
+    char          *rmask = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (row);
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    if (Tiled.active == 0) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    if (nrows < 1  ||  nrows > Tiled.band_rows  ||
+        Tiled.rows_done + nrows > Tiled.nrow) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+    ncol = Tiled.ncol;
+
+MSL
+    row = (CSW_F *)csw_Malloc (ncol * (sizeof(CSW_F) + 1));
+    if (row == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    rmask = (char *)(row + ncol);
+
+    moffset = Tiled.band_rows * ncol * sizeof(CSW_F);
+
+    for (i=0; i<nrows; i++) {
+
+        offset = i * ncol * sizeof(CSW_F);
+        fileio_util_obj.csw_SetFilePosition (Tiled.band_file, offset, 0);
+        istat = BinFileRead ((void *)row, ncol * sizeof(CSW_F), 1,
+                             Tiled.band_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+        offset = moffset + i * ncol;
+        fileio_util_obj.csw_SetFilePosition (Tiled.band_file, offset, 0);
+        istat = BinFileRead ((void *)rmask, ncol, 1, Tiled.band_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+
+        for (j=0; j<ncol; j++) {
+            zt = row[j];
+            if (zt > HARD_NULL  ||  zt < -HARD_NULL) {
+                continue;
+            }
+            if (zt < Tiled.zmin) Tiled.zmin = zt;
+            if (zt > Tiled.zmax) Tiled.zmax = zt;
+        }
+
+        istat = BinFileWrite ((void *)row, ncol * (sizeof(CSW_F) + 1), 1,
+                              Tiled.row_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
+    }
+
+    Tiled.rows_done += nrows;
+
+    return 1;
+
+}  /*  end of function grd_end_tiled_band  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+               g r d _ e n d _ t i l e d _ f i l e
+
+  ****************************************************************
+
+    If write_flag is 1 and every row has been supplied, write the
+  grid file from the rows in the row scratch file.  In any case,
+  the scratch files are closed and deleted.  Calling this when no
+  tiled file is active does nothing and returns zero.
+
+*/
+
+int CSWGrdFileio::grd_end_tiled_file (int write_flag)
+{
+    int           i, istat, filenum, dlen, ncol, retval;
+    double        scalezmin, zscale;
+    CSW_F         *row = NULL;
+    char          *rmask = NULL;
+
+    auto fscope = [&]()
+    {
+        csw_Free (row);
+        if (Tiled.active) {
+            fileio_util_obj.csw_CloseScratchFile (Tiled.band_file);
+            fileio_util_obj.csw_CloseScratchFile (Tiled.row_file);
+        }
+        Tiled.active = 0;
+    };
+    CSWScopeGuard func_scope_guard (fscope);
+
+    if (Tiled.active == 0) {
+        return 0;
+    }
+
+    if (write_flag == 0) {
+        return 1;
+    }
+
+    if (Tiled.rows_done != Tiled.nrow) {
+        grd_utils_ptr->grd_set_err (4);
+        return -1;
+    }
+
+    ncol = Tiled.ncol;
+
+MSL
+    row = (CSW_F *)csw_Malloc (ncol * (sizeof(CSW_F) + 1));
+    if (row == NULL) {
+        grd_utils_ptr->grd_set_err (1);
+        return -1;
+    }
+    rmask = (char *)(row + ncol);
+
+    filenum = CreateFile (Tiled.filename, "b");
+    if (filenum < 0) {
+        grd_utils_ptr->grd_set_err (2);
+        return -1;
+    }
+
+    retval = -1;
+
+    auto fileclose = [&]()
+    {
+        CloseFile (filenum);
+    };
+    CSWScopeGuard file_scope_guard (fileclose);
+
+/*
+    The headers are the same as those written by grd_write_file.
+*/
+    dlen = ncol * Tiled.nrow * 4;
+    sprintf (Head1, "%d", FILE_VERSION);
+    sprintf (Head2, "%d", HEADER_SIZE);
+    sprintf (Head3, "%d", dlen);
+    sprintf (Head4, "%d", COMMENT_SIZE);
+
+    istat = BinFileWrite ((void *)Head1, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+    istat = BinFileWrite ((void *)Head2, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+    istat = BinFileWrite ((void *)Head3, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+    istat = BinFileWrite ((void *)Head4, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+
+    istat = WriteGridHeader (filenum, 0, Tiled.comment,
+                             ncol, Tiled.nrow,
+                             Tiled.xmin, Tiled.ymin,
+                             Tiled.xmax, Tiled.ymax,
+                             Tiled.gridtype, Tiled.zmin, Tiled.zmax,
+                             &scalezmin, &zscale);
+    if (istat == -1) {
+        return retval;
+    }
+
+/*
+    Copy the rows from the scratch file, scaling each as it is
+    written to the grid file.
+*/
+    fileio_util_obj.csw_RewindFile (Tiled.row_file);
+    for (i=0; i<Tiled.nrow; i++) {
+        istat = BinFileRead ((void *)row, ncol * (sizeof(CSW_F) + 1), 1,
+                             Tiled.row_file);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return retval;
+        }
+        istat = WriteGridValues (filenum, row, rmask, ncol,
+                                 scalezmin, zscale);
+        if (istat == -1) {
+            return retval;
+        }
+    }
+
+/*
+    No faults and no expanded mask are written.
+*/
+    sprintf (Head1, "%d", 0);
+    istat = BinFileWrite ((void *)Head1, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+    sprintf (Head1, "0");
+    istat = BinFileWrite ((void *)Head1, 10, 1, filenum);
+    if (istat < 1) {
+        grd_utils_ptr->grd_set_err (1);
+        return retval;
+    }
+
+    retval = 1;
+
+    return retval;
+
+}  /*  end of function grd_end_tiled_file  */
+
+
+
+
+
+
+
 /*
   ****************************************************************
 
@@ -1071,13 +1511,8 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
                       double xmin, double ymin, double xmax, double ymax,
                       int gridtype)
 {
-    int           istat, tval, i, n;
-    double        zmin, zmax, scalezmin, scalezmax,
-                  zscale, zt;
-    unsigned char *c4;
-    char          local_comment[COMMENT_SIZE];
-    char          tmask;
-    unsigned char    crow[10000];
+    int           istat, i;
+    double        zmin, zmax, scalezmin, zscale, zt;
 
 /*
     Find the non null grid limits.
@@ -1093,6 +1528,53 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
         if (zt > zmax) zmax = zt;
     }
 
+    istat = WriteGridHeader (filenum, fileptr, comment,
+                             ncol, nrow,
+                             xmin, ymin, xmax, ymax,
+                             gridtype, zmin, zmax,
+                             &scalezmin, &zscale);
+    if (istat == -1) {
+        return -1;
+    }
+
+    istat = WriteGridValues (filenum, grid, mask, ncol * nrow,
+                             scalezmin, zscale);
+    if (istat == -1) {
+        return -1;
+    }
+
+    return 1;
+
+}  /*  end of private WriteGrid function  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+                  W r i t e G r i d H e a d e r
+
+  ****************************************************************
+
+    Write the geometry and value scaling header for a grid whose
+  non null values are between zmin and zmax.  The scaling values
+  needed by WriteGridValues are returned in scalezmin and zscale.
+
+*/
+
+int CSWGrdFileio::WriteGridHeader (int filenum, int fileptr, const char *comment,
+                      int ncol, int nrow,
+                      double xmin, double ymin, double xmax, double ymax,
+                      int gridtype, double zmin, double zmax,
+                      double *scalezmin_out, double *zscale_out)
+{
+    int           istat;
+    double        scalezmin, scalezmax, zscale, zt;
+    char          local_comment[COMMENT_SIZE];
+
 /*
  * bug 8710
  *
@@ -1121,6 +1603,9 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
     scalezmin = zmin - zt;
     scalezmax = zmax + zt;
     zscale = (scalezmax - scalezmin) / 10000000.0f;
+
+    *scalezmin_out = scalezmin;
+    *zscale_out = zscale;
     
 /*
     Fill in geometry and value scaling information in the 
@@ -1139,7 +1624,7 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
         fileio_util_obj.csw_SetFilePosition (filenum, fileptr, 0);
 
     istat = BinFileWrite ((void *)Header, HEADER_SIZE, 1, filenum);
-    if (istat == -1) {
+    if (istat < 1) {
         grd_utils_ptr->grd_set_err (1);
         return -1;
     }
@@ -1150,11 +1635,42 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
         local_comment[0] = '\0';
     }
     istat = BinFileWrite ((void *)local_comment, COMMENT_SIZE, 1, filenum);
-    if (istat == -1) {
+    if (istat < 1) {
         grd_utils_ptr->grd_set_err (1);
         return -1;
     }
 
+    return 1;
+
+}  /*  end of private WriteGridHeader function  */
+
+
+
+
+
+
+/*
+  ****************************************************************
+
+                  W r i t e G r i d V a l u e s
+
+  ****************************************************************
+
+    Write n grid values (and optional mask values) to the current
+  position of an open file, using the scaling from WriteGridHeader.
+  A long grid can be written with several calls, since each value
+  always takes 4 bytes in the file.
+
+*/
+
+int CSWGrdFileio::WriteGridValues (int filenum, CSW_F *grid, char *mask,
+                                   int nval, double scalezmin, double zscale)
+{
+    int           istat, tval, i, n;
+    unsigned char *c4;
+    char          tmask;
+    unsigned char    crow[10000];
+
 /*
     For each value, scale it to an unsigned integer, convert the
     integer to a portable 4 byte representation, and write the
@@ -1163,7 +1679,7 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
 */
     n = 0;
     c4 = crow;
-    for (i=0; i<ncol*nrow; i++) {
+    for (i=0; i<nval; i++) {
         if (grid[i] > HARD_NULL  ||  grid[i] < -HARD_NULL) {
             tval = NULL_INT;
         }
@@ -1180,7 +1696,7 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
         c4 += 4;
         if (n == 10000) {
             istat = BinFileWrite ((void *)crow, 10000, 1, filenum);
-            if (istat == -1) {
+            if (istat < 1) {
                 grd_utils_ptr->grd_set_err (1);
                 return -1;
             }
@@ -1191,11 +1707,15 @@ int CSWGrdFileio::WriteGrid (int filenum, int fileptr, const char *comment,
 
     if (n > 0) {
         istat = BinFileWrite ((void *)crow, n, 1, filenum);
+        if (istat < 1) {
+            grd_utils_ptr->grd_set_err (1);
+            return -1;
+        }
     }
 
     return 1;
 
-}  /*  end of private WriteGrid function  */
+}  /*  end of private WriteGridValues function  */
 
 
 
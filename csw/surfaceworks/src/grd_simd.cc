@@ -0,0 +1,681 @@
+/*
+         ************************************************
+         *                                              *
+         *    Copyright (1997-2017) Glenn Pinkerton.    *
+         *    All rights reserved.                      *
+         *                                              *
+         ************************************************
+*/
+
+/*
+ * This file has the implementation of the CSWGrdSimd class.
+ * Each kernel has a plain scalar version, an SSE2 version and
+ * an AVX2 version.  The SSE2 version is only built where the
+ * compiler always has SSE2 available (e.g. x86_64).  The AVX2
+ * version is built with a function target attribute and is
+ * only called if the cpu says it supports AVX2, so the rest
+ * of the library does not need any special compile flags.
+ *
+ * The AVX2 versions are not used unless the CSW_SIMD_LEVEL
+ * environment variable asks for them.  The kernels only see a
+ * few hundred points per call, and with one thread on a 601 by
+ * 601 grid the AVX2 versions were no faster overall than SSE2.
+ * The grd_simd_bench program can be used to check this on other
+ * hardware.
+ *
+ * The vector versions do the same operations in the same order
+ * as the scalar versions, so the results are bit for bit the
+ * same.  Where the scalar code has an if statement, the vector
+ * code does both branches and selects the result with a mask.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "csw/utils/include/csw_.h"
+
+#include "csw/surfaceworks/private_include/grd_simd.h"
+
+#if defined(__SSE2__)
+#  define GRD_SIMD_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)  &&  defined(GRD_SIMD_HAVE_SSE2)
+#  define GRD_SIMD_HAVE_AVX2
+#  include <immintrin.h>
+#  define GRD_AVX2_FUNC  __attribute__((target("avx2")))
+#endif
+
+
+/*
+ * The original loops compare double values against float
+ * constants, so the limits here are the float constants
+ * promoted to double.
+ */
+static const double   LIMIT_15 = (double)1.e15f;
+static const double   LIMIT_10 = (double)1.e10f;
+static const double   BIG_30 = (double)1.e30f;
+
+
+
+
+/*
+  ****************************************************************
+
+                     D e t e c t L e v e l
+
+  ****************************************************************
+
+  Find the instruction set level to use.  This is SSE2 where the
+  compiler has it, unless the CSW_SIMD_LEVEL environment variable
+  asks for "scalar" or, if the cpu supports it, "avx2".
+
+*/
+
+static int DetectLevel (void)
+{
+    int       level;
+    char      *cenv;
+
+    level = GRD_SIMD_SCALAR;
+
+#ifdef GRD_SIMD_HAVE_SSE2
+    level = GRD_SIMD_SSE2;
+#endif
+
+    cenv = csw_getenv ("CSW_SIMD_LEVEL");
+    if (cenv) {
+        if (strcmp (cenv, "scalar") == 0) {
+            level = GRD_SIMD_SCALAR;
+        }
+#ifdef GRD_SIMD_HAVE_AVX2
+        else if (strcmp (cenv, "avx2") == 0) {
+            __builtin_cpu_init ();
+            if (__builtin_cpu_supports ("avx2")) {
+                level = GRD_SIMD_AVX2;
+            }
+        }
+#endif
+    }
+
+    return level;
+
+}  /*  end of static DetectLevel function  */
+
+
+
+int CSWGrdSimd::Level (void)
+{
+    static const int  level = DetectLevel ();
+    return level;
+}
+
+
+
+
+/*
+  ****************************************************************
+
+          S c a l a r   v e r s i o n s   o f   k e r n e l s
+
+  ****************************************************************
+
+  These are also used for the elements left over at the end of
+  the arrays by the vector versions.
+
+*/
+
+static void ScalarDistancePowers (const CSW_F *x, const CSW_F *y,
+                                  int n, int dpower, CSW_F *dt)
+{
+    int        i;
+    CSW_F      dt0, dtt;
+
+    for (i=0; i<n; i++) {
+        dtt = x[i] * x[i] + y[i] * y[i];
+        dt0 = dtt;
+        if (dpower > 2) {
+            if (dt0 < LIMIT_15)
+                dtt *= dtt;
+            else
+                dtt = BIG_30;
+        }
+        if (dpower > 4) {
+            if (dt0 < LIMIT_10)
+                dtt *= dt0;
+            else
+                dtt = BIG_30;
+        }
+        dt[i] = dtt;
+    }
+}
+
+
+static void ScalarReorigin (CSW_F *x, CSW_F *y, int n,
+                            CSW_F x0, CSW_F y0)
+{
+    int        i;
+
+    for (i=0; i<n; i++) {
+        x[i] -= x0;
+        y[i] -= y0;
+    }
+}
+
+
+static void ScalarDistances (const CSW_F *x, const CSW_F *y,
+                             int n, double *dist)
+{
+    int        i;
+    double     dt;
+
+    for (i=0; i<n; i++) {
+        dt = x[i] * x[i] + y[i] * y[i];
+        dist[i] = sqrt (dt);
+    }
+}
+
+
+static void ScalarPlaneResiduals (const CSW_F *coef,
+                                  const CSW_F *x, const CSW_F *y,
+                                  const CSW_F *z, int n,
+                                  CSW_F tiny_value, CSW_F tiny_value_2,
+                                  CSW_F *res)
+{
+    int        i;
+    CSW_F      zt, zpt;
+
+    for (i=0; i<n; i++) {
+        zt = coef[0] + coef[1] * x[i] + coef[2] * y[i];
+        zpt = z[i];
+        if (zpt > -tiny_value  &&  zpt < tiny_value) {
+            zpt = 0.0;
+        }
+        zt -= zpt;
+        if (zt > -tiny_value_2  &&  zt < tiny_value_2) {
+            zt = 0.0;
+        }
+        res[i] = zt * zt;
+    }
+}
+
+
+static void ScalarStrikeWeights (CSW_F *st0, int n, CSW_F spower,
+                                 CSW_F tiny, CSW_F *wgt)
+{
+    int        i;
+    CSW_F      s0, st;
+
+    for (i=0; i<n; i++) {
+        s0 = st0[i];
+        if (s0 > LIMIT_15  &&  spower > 2)
+            s0 = LIMIT_15;
+        if (s0 > LIMIT_10  &&  spower > 4)
+            s0 = LIMIT_10;
+        if (s0 < tiny) s0 = tiny;
+        st = 1.0f / s0;
+        if (spower > 2) st *= st;
+        if (spower > 4) st *= s0;
+        st0[i] = s0;
+        wgt[i] = st;
+    }
+}
+
+
+
+
+/*
+  ****************************************************************
+
+            S S E 2   v e r s i o n s   o f   k e r n e l s
+
+  ****************************************************************
+
+*/
+
+#ifdef GRD_SIMD_HAVE_SSE2
+
+static inline __m128d Sse2Select (__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd (_mm_and_pd (mask, a), _mm_andnot_pd (mask, b));
+}
+
+
+static void Sse2DistancePowers (const CSW_F *x, const CSW_F *y,
+                                int n, int dpower, CSW_F *dt)
+{
+    int        i;
+    __m128d    vx, vy, vdt, vdt0, lim15, lim10, big;
+
+    lim15 = _mm_set1_pd (LIMIT_15);
+    lim10 = _mm_set1_pd (LIMIT_10);
+    big = _mm_set1_pd (BIG_30);
+
+    for (i=0; i+2<=n; i+=2) {
+        vx = _mm_loadu_pd (x + i);
+        vy = _mm_loadu_pd (y + i);
+        vdt = _mm_add_pd (_mm_mul_pd (vx, vx), _mm_mul_pd (vy, vy));
+        vdt0 = vdt;
+        if (dpower > 2) {
+            vdt = Sse2Select (_mm_cmplt_pd (vdt0, lim15),
+                              _mm_mul_pd (vdt, vdt), big);
+        }
+        if (dpower > 4) {
+            vdt = Sse2Select (_mm_cmplt_pd (vdt0, lim10),
+                              _mm_mul_pd (vdt, vdt0), big);
+        }
+        _mm_storeu_pd (dt + i, vdt);
+    }
+
+    ScalarDistancePowers (x + i, y + i, n - i, dpower, dt + i);
+}
+
+
+static void Sse2Reorigin (CSW_F *x, CSW_F *y, int n,
+                          CSW_F x0, CSW_F y0)
+{
+    int        i;
+    __m128d    vx0, vy0;
+
+    vx0 = _mm_set1_pd (x0);
+    vy0 = _mm_set1_pd (y0);
+
+    for (i=0; i+2<=n; i+=2) {
+        _mm_storeu_pd (x + i, _mm_sub_pd (_mm_loadu_pd (x + i), vx0));
+        _mm_storeu_pd (y + i, _mm_sub_pd (_mm_loadu_pd (y + i), vy0));
+    }
+
+    ScalarReorigin (x + i, y + i, n - i, x0, y0);
+}
+
+
+static void Sse2Distances (const CSW_F *x, const CSW_F *y,
+                           int n, double *dist)
+{
+    int        i;
+    __m128d    vx, vy;
+
+    for (i=0; i+2<=n; i+=2) {
+        vx = _mm_loadu_pd (x + i);
+        vy = _mm_loadu_pd (y + i);
+        _mm_storeu_pd (dist + i,
+            _mm_sqrt_pd (_mm_add_pd (_mm_mul_pd (vx, vx),
+                                     _mm_mul_pd (vy, vy))));
+    }
+
+    ScalarDistances (x + i, y + i, n - i, dist + i);
+}
+
+
+static void Sse2PlaneResiduals (const CSW_F *coef,
+                                const CSW_F *x, const CSW_F *y,
+                                const CSW_F *z, int n,
+                                CSW_F tiny_value, CSW_F tiny_value_2,
+                                CSW_F *res)
+{
+    int        i;
+    __m128d    c0, c1, c2, tp, tm, tp2, tm2, vzt, vzpt, mask;
+
+    c0 = _mm_set1_pd (coef[0]);
+    c1 = _mm_set1_pd (coef[1]);
+    c2 = _mm_set1_pd (coef[2]);
+    tp = _mm_set1_pd (tiny_value);
+    tm = _mm_set1_pd (-tiny_value);
+    tp2 = _mm_set1_pd (tiny_value_2);
+    tm2 = _mm_set1_pd (-tiny_value_2);
+
+    for (i=0; i+2<=n; i+=2) {
+        vzt = _mm_add_pd (c0, _mm_mul_pd (c1, _mm_loadu_pd (x + i)));
+        vzt = _mm_add_pd (vzt, _mm_mul_pd (c2, _mm_loadu_pd (y + i)));
+        vzpt = _mm_loadu_pd (z + i);
+        mask = _mm_and_pd (_mm_cmpgt_pd (vzpt, tm), _mm_cmplt_pd (vzpt, tp));
+        vzpt = _mm_andnot_pd (mask, vzpt);
+        vzt = _mm_sub_pd (vzt, vzpt);
+        mask = _mm_and_pd (_mm_cmpgt_pd (vzt, tm2), _mm_cmplt_pd (vzt, tp2));
+        vzt = _mm_andnot_pd (mask, vzt);
+        _mm_storeu_pd (res + i, _mm_mul_pd (vzt, vzt));
+    }
+
+    ScalarPlaneResiduals (coef, x + i, y + i, z + i, n - i,
+                          tiny_value, tiny_value_2, res + i);
+}
+
+
+static void Sse2StrikeWeights (CSW_F *st0, int n, CSW_F spower,
+                               CSW_F tiny, CSW_F *wgt)
+{
+    int        i;
+    __m128d    vs0, vst, lim15, lim10, vtiny, one;
+
+    lim15 = _mm_set1_pd (LIMIT_15);
+    lim10 = _mm_set1_pd (LIMIT_10);
+    vtiny = _mm_set1_pd (tiny);
+    one = _mm_set1_pd (1.0);
+
+    for (i=0; i+2<=n; i+=2) {
+        vs0 = _mm_loadu_pd (st0 + i);
+        if (spower > 2) {
+            vs0 = Sse2Select (_mm_cmpgt_pd (vs0, lim15), lim15, vs0);
+        }
+        if (spower > 4) {
+            vs0 = Sse2Select (_mm_cmpgt_pd (vs0, lim10), lim10, vs0);
+        }
+        vs0 = Sse2Select (_mm_cmplt_pd (vs0, vtiny), vtiny, vs0);
+        vst = _mm_div_pd (one, vs0);
+        if (spower > 2) vst = _mm_mul_pd (vst, vst);
+        if (spower > 4) vst = _mm_mul_pd (vst, vs0);
+        _mm_storeu_pd (st0 + i, vs0);
+        _mm_storeu_pd (wgt + i, vst);
+    }
+
+    ScalarStrikeWeights (st0 + i, n - i, spower, tiny, wgt + i);
+}
+
+#endif  /* GRD_SIMD_HAVE_SSE2 */
+
+
+
+
+/*
+  ****************************************************************
+
+            A V X 2   v e r s i o n s   o f   k e r n e l s
+
+  ****************************************************************
+
+
+  Each of these clears the upper halves of the ymm registers
+  before calling the scalar version for the last few points.
+  The rest of the library is compiled without VEX encoding, and
+  running that code with dirty upper halves is very slow on
+  many cpus.
+
+*/
+
+#ifdef GRD_SIMD_HAVE_AVX2
+
+GRD_AVX2_FUNC
+static void Avx2DistancePowers (const CSW_F *x, const CSW_F *y,
+                                int n, int dpower, CSW_F *dt)
+{
+    int        i;
+    __m256d    vx, vy, vdt, vdt0, lim15, lim10, big;
+
+    lim15 = _mm256_set1_pd (LIMIT_15);
+    lim10 = _mm256_set1_pd (LIMIT_10);
+    big = _mm256_set1_pd (BIG_30);
+
+    for (i=0; i+4<=n; i+=4) {
+        vx = _mm256_loadu_pd (x + i);
+        vy = _mm256_loadu_pd (y + i);
+        vdt = _mm256_add_pd (_mm256_mul_pd (vx, vx), _mm256_mul_pd (vy, vy));
+        vdt0 = vdt;
+        if (dpower > 2) {
+            vdt = _mm256_blendv_pd (big, _mm256_mul_pd (vdt, vdt),
+                                    _mm256_cmp_pd (vdt0, lim15, _CMP_LT_OQ));
+        }
+        if (dpower > 4) {
+            vdt = _mm256_blendv_pd (big, _mm256_mul_pd (vdt, vdt0),
+                                    _mm256_cmp_pd (vdt0, lim10, _CMP_LT_OQ));
+        }
+        _mm256_storeu_pd (dt + i, vdt);
+    }
+
+    _mm256_zeroupper ();
+
+    ScalarDistancePowers (x + i, y + i, n - i, dpower, dt + i);
+}
+
+
+GRD_AVX2_FUNC
+static void Avx2Reorigin (CSW_F *x, CSW_F *y, int n,
+                          CSW_F x0, CSW_F y0)
+{
+    int        i;
+    __m256d    vx0, vy0;
+
+    vx0 = _mm256_set1_pd (x0);
+    vy0 = _mm256_set1_pd (y0);
+
+    for (i=0; i+4<=n; i+=4) {
+        _mm256_storeu_pd (x + i, _mm256_sub_pd (_mm256_loadu_pd (x + i), vx0));
+        _mm256_storeu_pd (y + i, _mm256_sub_pd (_mm256_loadu_pd (y + i), vy0));
+    }
+
+    _mm256_zeroupper ();
+
+    ScalarReorigin (x + i, y + i, n - i, x0, y0);
+}
+
+
+GRD_AVX2_FUNC
+static void Avx2Distances (const CSW_F *x, const CSW_F *y,
+                           int n, double *dist)
+{
+    int        i;
+    __m256d    vx, vy;
+
+    for (i=0; i+4<=n; i+=4) {
+        vx = _mm256_loadu_pd (x + i);
+        vy = _mm256_loadu_pd (y + i);
+        _mm256_storeu_pd (dist + i,
+            _mm256_sqrt_pd (_mm256_add_pd (_mm256_mul_pd (vx, vx),
+                                           _mm256_mul_pd (vy, vy))));
+    }
+
+    _mm256_zeroupper ();
+
+    ScalarDistances (x + i, y + i, n - i, dist + i);
+}
+
+
+GRD_AVX2_FUNC
+static void Avx2PlaneResiduals (const CSW_F *coef,
+                                const CSW_F *x, const CSW_F *y,
+                                const CSW_F *z, int n,
+                                CSW_F tiny_value, CSW_F tiny_value_2,
+                                CSW_F *res)
+{
+    int        i;
+    __m256d    c0, c1, c2, tp, tm, tp2, tm2, vzt, vzpt, mask;
+
+    c0 = _mm256_set1_pd (coef[0]);
+    c1 = _mm256_set1_pd (coef[1]);
+    c2 = _mm256_set1_pd (coef[2]);
+    tp = _mm256_set1_pd (tiny_value);
+    tm = _mm256_set1_pd (-tiny_value);
+    tp2 = _mm256_set1_pd (tiny_value_2);
+    tm2 = _mm256_set1_pd (-tiny_value_2);
+
+    for (i=0; i+4<=n; i+=4) {
+        vzt = _mm256_add_pd (c0, _mm256_mul_pd (c1, _mm256_loadu_pd (x + i)));
+        vzt = _mm256_add_pd (vzt, _mm256_mul_pd (c2, _mm256_loadu_pd (y + i)));
+        vzpt = _mm256_loadu_pd (z + i);
+        mask = _mm256_and_pd (_mm256_cmp_pd (vzpt, tm, _CMP_GT_OQ),
+                              _mm256_cmp_pd (vzpt, tp, _CMP_LT_OQ));
+        vzpt = _mm256_andnot_pd (mask, vzpt);
+        vzt = _mm256_sub_pd (vzt, vzpt);
+        mask = _mm256_and_pd (_mm256_cmp_pd (vzt, tm2, _CMP_GT_OQ),
+                              _mm256_cmp_pd (vzt, tp2, _CMP_LT_OQ));
+        vzt = _mm256_andnot_pd (mask, vzt);
+        _mm256_storeu_pd (res + i, _mm256_mul_pd (vzt, vzt));
+    }
+
+    _mm256_zeroupper ();
+
+    ScalarPlaneResiduals (coef, x + i, y + i, z + i, n - i,
+                          tiny_value, tiny_value_2, res + i);
+}
+
+
+GRD_AVX2_FUNC
+static void Avx2StrikeWeights (CSW_F *st0, int n, CSW_F spower,
+                               CSW_F tiny, CSW_F *wgt)
+{
+    int        i;
+    __m256d    vs0, vst, lim15, lim10, vtiny, one;
+
+    lim15 = _mm256_set1_pd (LIMIT_15);
+    lim10 = _mm256_set1_pd (LIMIT_10);
+    vtiny = _mm256_set1_pd (tiny);
+    one = _mm256_set1_pd (1.0);
+
+    for (i=0; i+4<=n; i+=4) {
+        vs0 = _mm256_loadu_pd (st0 + i);
+        if (spower > 2) {
+            vs0 = _mm256_blendv_pd (vs0, lim15,
+                                    _mm256_cmp_pd (vs0, lim15, _CMP_GT_OQ));
+        }
+        if (spower > 4) {
+            vs0 = _mm256_blendv_pd (vs0, lim10,
+                                    _mm256_cmp_pd (vs0, lim10, _CMP_GT_OQ));
+        }
+        vs0 = _mm256_blendv_pd (vs0, vtiny,
+                                _mm256_cmp_pd (vs0, vtiny, _CMP_LT_OQ));
+        vst = _mm256_div_pd (one, vs0);
+        if (spower > 2) vst = _mm256_mul_pd (vst, vst);
+        if (spower > 4) vst = _mm256_mul_pd (vst, vs0);
+        _mm256_storeu_pd (st0 + i, vs0);
+        _mm256_storeu_pd (wgt + i, vst);
+    }
+
+    _mm256_zeroupper ();
+
+    ScalarStrikeWeights (st0 + i, n - i, spower, tiny, wgt + i);
+}
+
+#endif  /* GRD_SIMD_HAVE_AVX2 */
+
+
+
+
+/*
+  ****************************************************************
+
+         D i s p a t c h   t o   t h e   b e s t   l e v e l
+
+  ****************************************************************
+
+*/
+
+void CSWGrdSimd::DistancePowers (const CSW_F *x, const CSW_F *y,
+                                 int n, int dpower, CSW_F *dt)
+{
+    int    level = Level ();
+
+#ifdef GRD_SIMD_HAVE_AVX2
+    if (level == GRD_SIMD_AVX2) {
+        Avx2DistancePowers (x, y, n, dpower, dt);
+        return;
+    }
+#endif
+#ifdef GRD_SIMD_HAVE_SSE2
+    if (level == GRD_SIMD_SSE2) {
+        Sse2DistancePowers (x, y, n, dpower, dt);
+        return;
+    }
+#endif
+
+    (void)level;
+    ScalarDistancePowers (x, y, n, dpower, dt);
+}
+
+
+void CSWGrdSimd::Reorigin (CSW_F *x, CSW_F *y, int n,
+                           CSW_F x0, CSW_F y0)
+{
+    int    level = Level ();
+
+#ifdef GRD_SIMD_HAVE_AVX2
+    if (level == GRD_SIMD_AVX2) {
+        Avx2Reorigin (x, y, n, x0, y0);
+        return;
+    }
+#endif
+#ifdef GRD_SIMD_HAVE_SSE2
+    if (level == GRD_SIMD_SSE2) {
+        Sse2Reorigin (x, y, n, x0, y0);
+        return;
+    }
+#endif
+
+    (void)level;
+    ScalarReorigin (x, y, n, x0, y0);
+}
+
+
+void CSWGrdSimd::Distances (const CSW_F *x, const CSW_F *y,
+                            int n, double *dist)
+{
+    int    level = Level ();
+
+#ifdef GRD_SIMD_HAVE_AVX2
+    if (level == GRD_SIMD_AVX2) {
+        Avx2Distances (x, y, n, dist);
+        return;
+    }
+#endif
+#ifdef GRD_SIMD_HAVE_SSE2
+    if (level == GRD_SIMD_SSE2) {
+        Sse2Distances (x, y, n, dist);
+        return;
+    }
+#endif
+
+    (void)level;
+    ScalarDistances (x, y, n, dist);
+}
+
+
+void CSWGrdSimd::PlaneResiduals (const CSW_F *coef,
+                                 const CSW_F *x, const CSW_F *y,
+                                 const CSW_F *z, int n,
+                                 CSW_F tiny_value, CSW_F tiny_value_2,
+                                 CSW_F *res)
+{
+    int    level = Level ();
+
+#ifdef GRD_SIMD_HAVE_AVX2
+    if (level == GRD_SIMD_AVX2) {
+        Avx2PlaneResiduals (coef, x, y, z, n,
+                            tiny_value, tiny_value_2, res);
+        return;
+    }
+#endif
+#ifdef GRD_SIMD_HAVE_SSE2
+    if (level == GRD_SIMD_SSE2) {
+        Sse2PlaneResiduals (coef, x, y, z, n,
+                            tiny_value, tiny_value_2, res);
+        return;
+    }
+#endif
+
+    (void)level;
+    ScalarPlaneResiduals (coef, x, y, z, n,
+                          tiny_value, tiny_value_2, res);
+}
+
+
+void CSWGrdSimd::StrikeWeights (CSW_F *st0, int n, CSW_F spower,
+                                CSW_F tiny, CSW_F *wgt)
+{
+    int    level = Level ();
+
+#ifdef GRD_SIMD_HAVE_AVX2
+    if (level == GRD_SIMD_AVX2) {
+        Avx2StrikeWeights (st0, n, spower, tiny, wgt);
+        return;
+    }
+#endif
+#ifdef GRD_SIMD_HAVE_SSE2
+    if (level == GRD_SIMD_SSE2) {
+        Sse2StrikeWeights (st0, n, spower, tiny, wgt);
+        return;
+    }
+#endif
+
+    (void)level;
+    ScalarStrikeWeights (st0, n, spower, tiny, wgt);
+}
@@ -0,0 +1,158 @@
+/*
+         ************************************************
+         *                                              *
+         *    Copyright (1997-2017) Glenn Pinkerton.    *
+         *    All rights reserved.                      *
+         *                                              *
+         ************************************************
+*/
+
+/*
+ * Small benchmark for the gridding inner loops.  A scattered
+ * point set is gridded on a single thread and the grid nodes
+ * calculated per second are printed along with the instruction
+ * set level picked by CSWGrdSimd.  Run it again with the
+ * CSW_SIMD_LEVEL environment variable set to "avx2" or "scalar"
+ * to compare the kernel versions on the same data.
+ *
+ * Usage:  grd_simd_bench [npts [ncol [nreps]]]
+ *
+ * The defaults are 100000 points, a 601 by 601 grid and 3 reps.
+ * The fastest rep is used for the nodes per second figure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <chrono>
+
+#include "csw/surfaceworks/include/grid_api.h"
+#include "csw/surfaceworks/private_include/grd_simd.h"
+
+
+static const char    *LevelNames[] = {"scalar", "sse2", "avx2"};
+
+
+/*
+  ****************************************************************
+
+                    M a k e P o i n t s
+
+  ****************************************************************
+
+  Fill the arrays with a repeatable point set.  A third of the
+  points are on east-west lines, like a set of seismic lines,
+  and the rest are scattered over the whole area.
+
+*/
+
+static void MakePoints (CSW_F *x, CSW_F *y, CSW_F *z, int npts)
+{
+    int          i;
+    double       t, u;
+
+    srand (12345);
+
+    for (i=0; i<npts; i++) {
+        t = (double)rand () / (double)RAND_MAX;
+        u = (double)rand () / (double)RAND_MAX;
+        if (i % 3 == 0) {
+            x[i] = (CSW_F)(1000.0 + 9000.0 * t);
+            y[i] = (CSW_F)(1000.0 + 1000.0 * (int)(u * 8.0));
+        }
+        else {
+            x[i] = (CSW_F)(1000.0 + 9000.0 * t);
+            y[i] = (CSW_F)(1000.0 + 8000.0 * u);
+        }
+        z[i] = (CSW_F)(100.0 * sin (x[i] / 1500.0) +
+                       50.0 * cos (y[i] / 900.0) +
+                       0.001 * x[i]);
+    }
+
+}  /*  end of static MakePoints function  */
+
+
+
+
+int main (int argc, char *argv[])
+{
+    int                  npts, ncol, nrow, nreps, i, istat, level;
+    CSW_F                *x = NULL, *y = NULL, *z = NULL,
+                         *err = NULL, *grid = NULL;
+    char                 *mask = NULL, *report = NULL;
+    double               sec, best, sum;
+    GRidCalcOptions      options;
+    CSWGrdAPI            api;
+
+    npts = 100000;
+    ncol = 601;
+    nreps = 3;
+    if (argc > 1) npts = atoi (argv[1]);
+    if (argc > 2) ncol = atoi (argv[2]);
+    if (argc > 3) nreps = atoi (argv[3]);
+    if (npts < 10  ||  ncol < 2  ||  nreps < 1) {
+        fprintf (stderr, "Usage: grd_simd_bench [npts [ncol [nreps]]]\n");
+        return 1;
+    }
+    nrow = ncol;
+
+    x = (CSW_F *)malloc (npts * 4 * sizeof(CSW_F));
+    grid = (CSW_F *)malloc (ncol * nrow * sizeof(CSW_F));
+    mask = (char *)malloc (ncol * nrow * sizeof(char));
+    if (x == NULL  ||  grid == NULL  ||  mask == NULL) {
+        fprintf (stderr, "Memory allocation error\n");
+        return 1;
+    }
+    y = x + npts;
+    z = y + npts;
+    err = z + npts;
+
+    MakePoints (x, y, z, npts);
+
+    api.grd_DefaultCalcOptions (&options);
+    options.num_threads = 1;
+
+    level = CSWGrdSimd::Level ();
+    printf ("simd level %s, %d points, %d x %d grid\n",
+            LevelNames[level], npts, ncol, nrow);
+
+    best = 1.e30;
+    for (i=0; i<nreps; i++) {
+        auto t0 = std::chrono::steady_clock::now ();
+        istat =
+        api.grd_CalcGrid (x, y, z, err, npts,
+                          grid, mask, &report,
+                          ncol, nrow,
+                          0.0f, 0.0f, 11000.0f, 10000.0f,
+                          NULL, 0, &options);
+        auto t1 = std::chrono::steady_clock::now ();
+        if (istat == -1) {
+            fprintf (stderr, "grd_CalcGrid failed, error %d\n",
+                     api.grd_GetErr ());
+            return 1;
+        }
+        sec = std::chrono::duration<double>(t1 - t0).count ();
+        if (sec < best) best = sec;
+        printf ("  rep %d: %.3f seconds\n", i + 1, sec);
+    }
+
+/*
+ * The grid sum is printed so runs at different levels can be
+ * checked for the same results.
+ */
+    sum = 0.0;
+    for (i=0; i<ncol*nrow; i++) {
+        sum += grid[i];
+    }
+
+    printf ("best %.3f seconds, %.0f nodes/sec, grid sum %.10g\n",
+            best, (double)(ncol * nrow) / best, sum);
+
+    free (x);
+    free (grid);
+    free (mask);
+
+    return 0;
+
+}
@@ -34,6 +34,7 @@
 #include "csw/utils/private_include/ply_protoP.h"
 
 #include "csw/surfaceworks/private_include/grd_utils.h"
+#include "csw/surfaceworks/private_include/grd_simd.h"
 
 
 
@@ -2030,8 +2031,9 @@ int CSWGrdUtils::grd_inverse_distance_average
                           (CSW_F *x, CSW_F *y, CSW_F *z, int n, int dpower,
                            CSW_F tiny, CSW_F *dsq, CSW_F *avg)
 {
-    int         i, retval;
+    int         i, i0, ic, nc, retval;
     CSW_F       sum1, sum2, dt, dt0, dt02, tiny2;
+    CSW_F       dtchunk[GRD_SIMD_CHUNK];
 
     retval = 1;
 
@@ -2051,33 +2053,31 @@ int CSWGrdUtils::grd_inverse_distance_average
         tiny2 = 0.0;
     }
 
-    for (i=0; i<n; i++) {
-        dt = x[i] * x[i] + y[i] * y[i];
-        dt0 = dt;
-        if (dpower > 2) {
-            if (dt0 < 1.e15f)
-                dt *= dt;
-            else
-                dt = 1.e30f;
-        }
-        if (dpower > 4) {
-            if (dt0 < 1.e10f)
-                dt *= dt0;
-            else
-                dt = 1.e30f;
-        }
-        if (dt <= tiny2) {
-            *avg = z[i];
-            return 999;
-        }
-        if (dt < tiny) {
-            dt = tiny;
-            retval = 999;
+/*
+    The distance powers are calculated a chunk at a time by the
+    vector kernel.  The sums are still done one point at a time
+    in the original order so the result does not change.
+*/
+    for (i0=0; i0<n; i0+=GRD_SIMD_CHUNK) {
+        nc = n - i0;
+        if (nc > GRD_SIMD_CHUNK) nc = GRD_SIMD_CHUNK;
+        CSWGrdSimd::DistancePowers (x + i0, y + i0, nc, dpower, dtchunk);
+        for (ic=0; ic<nc; ic++) {
+            i = i0 + ic;
+            dt = dtchunk[ic];
+            if (dt <= tiny2) {
+                *avg = z[i];
+                return 999;
+            }
+            if (dt < tiny) {
+                dt = tiny;
+                retval = 999;
+            }
+            if (dsq) dsq[i] = dt;
+            dt = 1.0f / dt;
+            sum1 += dt;
+            sum2 += dt * z[i];
         }
-        if (dsq) dsq[i] = dt;
-        dt = 1.0f / dt;
-        sum1 += dt;
-        sum2 += dt * z[i];
     }
 
     *avg = sum2 / sum1;
@@ -0,0 +1,135 @@
+
+/*
+         ************************************************
+         *                                              *
+         *    Copyright (1997-2017) Glenn Pinkerton.    *
+         *    All rights reserved.                      *
+         *                                              *
+         ************************************************
+*/
+
+/*
+    csw_parallel.h
+*/
+
+
+/*
+ *  This header defines the CSWParallel class.
+ *
+ *  The class only has static methods.  It is used to spread a
+ *  number of independent tasks over several threads.  Tasks are
+ *  handed out one at a time from a shared counter, so a thread
+ *  that finishes a cheap task simply picks up the next one.
+ *
+ *  The calling thread also works on the tasks.  If a worker
+ *  thread cannot be created, the tasks it would have done are
+ *  done by the remaining threads, so every task is always run
+ *  exactly once.
+ *
+ *  The caller is responsible for making sure that the tasks
+ *  do not write to any shared memory.  The thread index passed
+ *  to the task function can be used to select per thread
+ *  scratch space.
+ *
+ *  A simple example is shown below.
+ *
+ *  auto ftask = [&](int itask, int ithread)
+ *  {
+ *      do_something (itask, scratch + ithread);
+ *  };
+ *  CSWParallel::ForEach (nthreads, ntasks, ftask);
+ *
+ */
+
+#ifndef CSW_PARALLEL_H
+#define CSW_PARALLEL_H
+
+#include <atomic>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+class CSWParallel
+{
+
+  public:
+
+/*
+ * Return the number of threads to use given an option value.
+ * A value of -1 (or any negative value) means use one thread
+ * per hardware core.  A value of 0 or 1 means do the work in
+ * the calling thread only.
+ */
+    static int NumThreads (int requested)
+    {
+        int    ncore;
+
+        if (requested >= 0) {
+            return (requested > 1) ? requested : 1;
+        }
+
+        ncore = (int)std::thread::hardware_concurrency ();
+        if (ncore < 1) ncore = 1;
+        return ncore;
+    };
+
+/*
+ * Run func (itask, ithread) for every itask from 0 to ntasks - 1.
+ * At most nthreads threads are used, and ithread is always less
+ * than nthreads.  The method returns after all tasks are done.
+ */
+    static void ForEach (int nthreads, int ntasks,
+                         std::function<void(int, int)> func)
+    {
+        int      i;
+
+        if (ntasks < 1) return;
+        if (nthreads > ntasks) nthreads = ntasks;
+
+        if (nthreads < 2) {
+            for (i=0; i<ntasks; i++) {
+                func (i, 0);
+            }
+            return;
+        }
+
+        std::atomic<int>  next (0);
+
+        auto fwork = [&](int ithread)
+        {
+            int    itask;
+            for (;;) {
+                itask = next.fetch_add (1);
+                if (itask >= ntasks) break;
+                func (itask, ithread);
+            }
+        };
+
+        std::vector<std::thread>  workers;
+        workers.reserve (nthreads - 1);
+
+        for (i=1; i<nthreads; i++) {
+            try {
+                workers.push_back (std::thread (fwork, i));
+            }
+            catch (std::system_error &e) {
+                (void)e;
+                break;
+            }
+        }
+
+        fwork (0);
+
+        for (auto &th : workers) {
+            th.join ();
+        }
+    };
+
+};
+
+#endif
+/*
+    end of header file
+    add nothing below this endif
+*/
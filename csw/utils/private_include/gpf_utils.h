@@ -70,6 +70,10 @@
                            double x, double y, double *dist);
     int gpf_calcdistance2 (double x1, double y1, double x2, double y2,
                            double *dist);
+    double gpf_orient2d (double ax, double ay, double bx, double by,
+                         double cx, double cy);
+    double gpf_incircle (double ax, double ay, double bx, double by,
+                         double cx, double cy, double dx, double dy);
     int gpf_CalcCirclePoints (CSW_F x, CSW_F y, CSW_F r,
                               CSW_F *xout, CSW_F *yout, int npts);
     int gpf_xandylimits (CSW_F *x, CSW_F *y, int npt,
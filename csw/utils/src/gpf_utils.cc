@@ -95,6 +95,19 @@ static int SplitAgainstLongest (
     int       npmax,
     int       nlmax);
 
+static void TwoSum (double a, double b, double *x, double *y);
+static void TwoDiff (double a, double b, double *x, double *y);
+static void TwoProduct (double a, double b, double *x, double *y);
+static int ExpansionSum (int elen, const double *e,
+                         int flen, const double *f, double *h);
+static int ScaleExpansion (int elen, const double *e, double b, double *h);
+static int MultiplyExpansion (int elen, const double *e,
+                              int flen, const double *f, double *h);
+static double ExactOrient2d (double ax, double ay, double bx, double by,
+                             double cx, double cy);
+static double ExactInCircle (double ax, double ay, double bx, double by,
+                             double cx, double cy, double dx, double dy);
+
 
 /*
 ******************************************************************
@@ -976,6 +989,422 @@ int gpf_calcdistance2 (double x1, double y1, double x2, double y2,
 }  /*  end of function gpf_calcdistance2  */
 
 
+
+
+/*
+******************************************************************
+
+                   g p f _ o r i e n t 2 d
+
+******************************************************************
+
+  function name:    gpf_orient2d     (double)
+
+  call sequence:    gpf_orient2d (ax, ay, bx, by, cx, cy)
+
+  purpose:          Return a value with the exact sign of twice the
+                    signed area of the a, b, c triangle.  A quick
+                    floating point calculation is used when its error
+                    bound shows the sign is correct.  Otherwise, the
+                    determinant is calculated exactly with floating
+                    point expansions.  This only happens for points
+                    that are colinear or almost exactly colinear.
+
+  return value:     positive if a, b, c are counter clockwise,
+                    negative if they are clockwise, and exactly
+                    zero if they are colinear
+
+  calling parameters:
+
+    ax      r   double    x coordinate of first point
+    ay      r   double    y coordinate of first point
+    bx      r   double    x coordinate of second point
+    by      r   double    y coordinate of second point
+    cx      r   double    x coordinate of third point
+    cy      r   double    y coordinate of third point
+
+*/
+
+double gpf_orient2d (double ax, double ay, double bx, double by,
+                     double cx, double cy)
+{
+    double      detleft, detright, det, detsum, errbound;
+
+    detleft = (ax - cx) * (by - cy);
+    detright = (ay - cy) * (bx - cx);
+    det = detleft - detright;
+
+    if (detleft > 0.0) {
+        if (detright <= 0.0) {
+            return det;
+        }
+        detsum = detleft + detright;
+    }
+    else if (detleft < 0.0) {
+        if (detright >= 0.0) {
+            return det;
+        }
+        detsum = -detleft - detright;
+    }
+    else {
+        return det;
+    }
+
+    errbound = (3.0 + 8.0 * DBL_EPSILON) * 0.5 * DBL_EPSILON * detsum;
+    if (det >= errbound  ||  -det >= errbound) {
+        return det;
+    }
+
+    return ExactOrient2d (ax, ay, bx, by, cx, cy);
+
+}  /*  end of function gpf_orient2d  */
+
+
+
+/*
+******************************************************************
+
+                   g p f _ i n c i r c l e
+
+******************************************************************
+
+  function name:    gpf_incircle     (double)
+
+  call sequence:    gpf_incircle (ax, ay, bx, by, cx, cy, dx, dy)
+
+  purpose:          Return a value with the exact sign of the incircle
+                    determinant of the d point relative to the circle
+                    through the a, b and c points.  As with gpf_orient2d,
+                    the exact calculation is only done when the quick
+                    floating point result is not certain.
+
+  return value:     positive if d is inside the circle and a, b, c are
+                    counter clockwise, negative if d is outside the
+                    circle, and exactly zero if the four points are
+                    cocircular.  The sign is reversed if a, b, c are
+                    clockwise.
+
+  calling parameters:
+
+    ax      r   double    x coordinate of first circle point
+    ay      r   double    y coordinate of first circle point
+    bx      r   double    x coordinate of second circle point
+    by      r   double    y coordinate of second circle point
+    cx      r   double    x coordinate of third circle point
+    cy      r   double    y coordinate of third circle point
+    dx      r   double    x coordinate of the point to test
+    dy      r   double    y coordinate of the point to test
+
+*/
+
+double gpf_incircle (double ax, double ay, double bx, double by,
+                     double cx, double cy, double dx, double dy)
+{
+    double      adx, ady, bdx, bdy, cdx, cdy;
+    double      bdxcdy, cdxbdy, cdxady, adxcdy, adxbdy, bdxady;
+    double      alift, blift, clift, det, permanent, errbound;
+
+    adx = ax - dx;
+    ady = ay - dy;
+    bdx = bx - dx;
+    bdy = by - dy;
+    cdx = cx - dx;
+    cdy = cy - dy;
+
+    bdxcdy = bdx * cdy;
+    cdxbdy = cdx * bdy;
+    alift = adx * adx + ady * ady;
+
+    cdxady = cdx * ady;
+    adxcdy = adx * cdy;
+    blift = bdx * bdx + bdy * bdy;
+
+    adxbdy = adx * bdy;
+    bdxady = bdx * ady;
+    clift = cdx * cdx + cdy * cdy;
+
+    det = alift * (bdxcdy - cdxbdy) +
+          blift * (cdxady - adxcdy) +
+          clift * (adxbdy - bdxady);
+
+    permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift +
+                (fabs(cdxady) + fabs(adxcdy)) * blift +
+                (fabs(adxbdy) + fabs(bdxady)) * clift;
+    errbound = (10.0 + 48.0 * DBL_EPSILON) * 0.5 * DBL_EPSILON * permanent;
+    if (det > errbound  ||  -det > errbound) {
+        return det;
+    }
+
+    return ExactInCircle (ax, ay, bx, by, cx, cy, dx, dy);
+
+}  /*  end of function gpf_incircle  */
+
+
+
+/*
+******************************************************************
+
+        E x p a n s i o n   A r i t h m e t i c   H e l p e r s
+
+******************************************************************
+
+  The exact predicates represent a number as an expansion, which is an
+  array of doubles whose exact sum is the value.  The components do not
+  overlap and they are ordered by increasing magnitude, so the sign of
+  the expansion is the sign of its last component.  Zero components are
+  left out, and an expansion of zero has a single zero component.
+
+  TwoSum, TwoDiff and TwoProduct return the rounded result in x and the
+  rounding error in y, so x + y is exactly the result.
+*/
+
+static void TwoSum (double a, double b, double *x, double *y)
+{
+    double      sum, bvirt, avirt;
+
+    sum = a + b;
+    bvirt = sum - a;
+    avirt = sum - bvirt;
+    *x = sum;
+    *y = (a - avirt) + (b - bvirt);
+}
+
+static void TwoDiff (double a, double b, double *x, double *y)
+{
+    double      diff, bvirt, avirt;
+
+    diff = a - b;
+    bvirt = a - diff;
+    avirt = diff + bvirt;
+    *x = diff;
+    *y = (a - avirt) + (bvirt - b);
+}
+
+static void TwoProduct (double a, double b, double *x, double *y)
+{
+    double      prod;
+
+    prod = a * b;
+    *x = prod;
+    *y = fma (a, b, -prod);
+}
+
+
+/*
+  Add the e and f expansions into h, which must have room for
+  elen + flen components.  The e expansion may be empty.  The components of both are merged in
+  increasing magnitude order and accumulated with TwoSum.
+*/
+static int ExpansionSum (int elen, const double *e,
+                         int flen, const double *f, double *h)
+{
+    int         i, j, k, n, nh;
+    double      q, qnew, hh, g;
+
+    i = 0;
+    j = 0;
+    n = elen + flen;
+    nh = 0;
+    q = 0.0;
+
+    for (k=0; k<n; k++) {
+        if (j >= flen  ||
+            (i < elen  &&  fabs(e[i]) < fabs(f[j]))) {
+            g = e[i];
+            i++;
+        }
+        else {
+            g = f[j];
+            j++;
+        }
+        if (k == 0) {
+            q = g;
+            continue;
+        }
+        TwoSum (q, g, &qnew, &hh);
+        if (hh != 0.0) {
+            h[nh] = hh;
+            nh++;
+        }
+        q = qnew;
+    }
+
+    if (q != 0.0  ||  nh == 0) {
+        h[nh] = q;
+        nh++;
+    }
+
+    return nh;
+}
+
+
+/*
+  Multiply the e expansion by b into h, which must have room for
+  2 * elen components.
+*/
+static int ScaleExpansion (int elen, const double *e, double b, double *h)
+{
+    int         i, nh;
+    double      q, sum, hh, p1, p0;
+
+    nh = 0;
+    TwoProduct (e[0], b, &q, &hh);
+    if (hh != 0.0) {
+        h[nh] = hh;
+        nh++;
+    }
+
+    for (i=1; i<elen; i++) {
+        TwoProduct (e[i], b, &p1, &p0);
+        TwoSum (q, p0, &sum, &hh);
+        if (hh != 0.0) {
+            h[nh] = hh;
+            nh++;
+        }
+        TwoSum (p1, sum, &q, &hh);
+        if (hh != 0.0) {
+            h[nh] = hh;
+            nh++;
+        }
+    }
+
+    if (q != 0.0  ||  nh == 0) {
+        h[nh] = q;
+        nh++;
+    }
+
+    return nh;
+}
+
+
+/*
+  Multiply the e and f expansions into h, which must have room for
+  2 * elen * flen components.  This is only used for the small
+  expansions of ExactInCircle, so neither can have more than
+  16 components.
+*/
+static int MultiplyExpansion (int elen, const double *e,
+                              int flen, const double *f, double *h)
+{
+    double      scaled[32], acc1[512], acc2[512];
+    double      *acc, *accnew, *tmp;
+    int         j, nacc, ns;
+
+    assert (elen <= 16  &&  flen <= 16);
+
+    acc = acc1;
+    accnew = acc2;
+    nacc = 0;
+
+    for (j=0; j<flen; j++) {
+        ns = ScaleExpansion (elen, e, f[j], scaled);
+        nacc = ExpansionSum (nacc, acc, ns, scaled, accnew);
+        tmp = acc;
+        acc = accnew;
+        accnew = tmp;
+    }
+
+    memcpy (h, acc, nacc * sizeof(double));
+
+    return nacc;
+}
+
+
+/*
+  Calculate the orientation determinant exactly as the sum of the
+  six coordinate products in its expanded form.
+*/
+static double ExactOrient2d (double ax, double ay, double bx, double by,
+                             double cx, double cy)
+{
+    double      prod[2], acc1[12], acc2[12];
+    double      *acc, *accnew, *tmp;
+    double      pa[6], pb[6];
+    int         i, nacc;
+
+    pa[0] = ax;   pb[0] = by;
+    pa[1] = -ax;  pb[1] = cy;
+    pa[2] = -cx;  pb[2] = by;
+    pa[3] = -ay;  pb[3] = bx;
+    pa[4] = ay;   pb[4] = cx;
+    pa[5] = cy;   pb[5] = bx;
+
+    acc = acc1;
+    accnew = acc2;
+    nacc = 0;
+
+    for (i=0; i<6; i++) {
+        TwoProduct (pa[i], pb[i], prod+1, prod);
+        nacc = ExpansionSum (nacc, acc, 2, prod, accnew);
+        tmp = acc;
+        acc = accnew;
+        accnew = tmp;
+    }
+
+    return acc[nacc-1];
+}
+
+
+/*
+  Calculate the incircle determinant exactly, using the d point as
+  the origin.  The coordinate differences are kept as two component
+  expansions so nothing is rounded.
+*/
+static double ExactInCircle (double ax, double ay, double bx, double by,
+                             double cx, double cy, double dx, double dy)
+{
+    double      adx[2], ady[2], bdx[2], bdy[2], cdx[2], cdy[2];
+    double      *d1[3], *d2[3], *e1[3], *e2[3], *lx[3], *ly[3];
+    double      t1[8], t2[8], cross[16], sq1[8], sq2[8], lift[16];
+    double      term[512], sum1[1536], sum2[1536];
+    double      *acc, *accnew, *tmp;
+    int         i, k, n1, n2, ncross, nlift, nterm, nacc;
+
+    TwoDiff (ax, dx, adx+1, adx);
+    TwoDiff (ay, dy, ady+1, ady);
+    TwoDiff (bx, dx, bdx+1, bdx);
+    TwoDiff (by, dy, bdy+1, bdy);
+    TwoDiff (cx, dx, cdx+1, cdx);
+    TwoDiff (cy, dy, cdy+1, cdy);
+
+/*
+    Each term is the lift of one point times the cross product
+    of the other two points.
+*/
+    lx[0] = adx;  ly[0] = ady;
+    d1[0] = bdx;  e1[0] = cdy;  d2[0] = cdx;  e2[0] = bdy;
+    lx[1] = bdx;  ly[1] = bdy;
+    d1[1] = cdx;  e1[1] = ady;  d2[1] = adx;  e2[1] = cdy;
+    lx[2] = cdx;  ly[2] = cdy;
+    d1[2] = adx;  e1[2] = bdy;  d2[2] = bdx;  e2[2] = ady;
+
+    acc = sum1;
+    accnew = sum2;
+    nacc = 0;
+
+    for (i=0; i<3; i++) {
+        n1 = MultiplyExpansion (2, d1[i], 2, e1[i], t1);
+        n2 = MultiplyExpansion (2, d2[i], 2, e2[i], t2);
+        for (k=0; k<n2; k++) {
+            t2[k] = -t2[k];
+        }
+        ncross = ExpansionSum (n1, t1, n2, t2, cross);
+
+        n1 = MultiplyExpansion (2, lx[i], 2, lx[i], sq1);
+        n2 = MultiplyExpansion (2, ly[i], 2, ly[i], sq2);
+        nlift = ExpansionSum (n1, sq1, n2, sq2, lift);
+
+        nterm = MultiplyExpansion (nlift, lift, ncross, cross, term);
+        nacc = ExpansionSum (nacc, acc, nterm, term, accnew);
+        tmp = acc;
+        acc = accnew;
+        accnew = tmp;
+    }
+
+    return acc[nacc-1];
+}
+
+
 /*
   ****************************************************************
 